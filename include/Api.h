@@ -2,6 +2,9 @@
 #include <Arduino.h>
 #include "Global.h"
 
+// [TRAKKR] s as a quoted JSON string (also for other modules' statsJSON())
+String jsonEscape(const char* s);
+
 #if __has_include(<WebServer.h>)
   #include <WebServer.h>
   void Api_attach(WebServer& srv);
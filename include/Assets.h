@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Read-only asset bundle, memory-mapped from the "assets" partition
+// [TRAKKR-NOTE] Built from data/ by scripts/build_assets.py and flashed with
+// `pio run -t uploadassets`. Everything (paths, content types, bodies) is used
+// in place from mapped flash: no VFS, no copies. Files the firmware writes at
+// runtime (ticker text etc.) stay on LittleFS.
+//
+// Layout (little-endian):
+//   Header  { "TRKA", u16 version, u16 count, u32 dirOff, u32 total, u32 fnv, u32 reserved[3] }
+//   Dir[count] sorted by pathHash:
+//           { u32 pathHash, u32 pathOff, u32 ctypeOff, u32 dataOff, u32 size, u32 etag, u16 flags, u16 pathLen }
+//   String pool (NUL-terminated paths / content types), then file bodies.
+//   fnv = FNV-1a over every byte after the header.
+//
+namespace Assets {
+  constexpr uint16_t FLAG_GZIP = 1 << 0;     // body is gzip; serve with Content-Encoding
+
+  struct Entry {
+    const char*    path;
+    const char*    ctype;
+    const uint8_t* data;
+    uint32_t       size;
+    uint32_t       etag;                     // FNV-1a of the original (uncompressed) file
+    uint16_t       flags;
+  };
+
+  bool     begin();                          // map + validate; false = fall back to LittleFS
+  bool     ready();
+  uint16_t count();
+  uint32_t bundleHash();
+
+  // Exact path lookup ("/index.htm"). O(log n), no allocation.
+  bool     find(const char* path, Entry& out);
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Cooperative async I/O for data providers
+// [TRAKKR-NOTE] Toolchain is GCC 8 / gnu++11, so no C++20 coroutines. A
+// provider is an Async::Task whose step() is a stackless coroutine built from
+// the ASYNC_* macros (switch-based, protothread style): it runs until the next
+// ASYNC_AWAIT / ASYNC_SLEEP and returns, and the loop resumes it at that line
+// once its socket is ready or its deadline passes. Every task shares the one
+// "net" FreeRTOS task and its stack, so N providers cost N small heap objects,
+// not N stacks, and their I/O interleaves instead of queueing.
+//
+// Rules inside step(): no locals that must survive an await (use members),
+// and no ASYNC_* inside a nested switch.
+//
+namespace Async {
+  enum Io : int8_t { IO_DONE = 0, IO_PENDING = 1, IO_ERR = -1 };
+  enum Wait : uint8_t { WAIT_NONE = 0, WAIT_READ = 1, WAIT_WRITE = 2 };
+
+  class Task {
+  public:
+    virtual ~Task() {}
+    virtual bool step() = 0;                 // true = finished; the loop deletes it
+    const char*  name() const { return name_; }
+
+    // Loop-side wait state (set via the ASYNC_* macros)
+    int          waitFd  = -1;
+    uint8_t      waitEv  = WAIT_NONE;
+    uint32_t     wakeAt  = 0;                // millis(); 0 = run again next pass
+
+  protected:
+    explicit Task(const char* name) : name_(name) {}
+    // Nothing to select on (e.g. DNS in flight): poll every 20 ms up to the deadline.
+    void   waitIo(int fd, uint8_t ev, uint32_t deadline){
+      waitFd = fd; waitEv = ev; wakeAt = deadline;
+      if (ev == WAIT_NONE && (int32_t)(deadline - (millis() + 20)) > 0) wakeAt = millis() + 20;
+    }
+    void   sleepFor(uint32_t ms){ waitFd = -1; waitEv = WAIT_NONE; wakeAt = millis() + (ms ? ms : 1); }
+
+    int    pt_ = 0;                          // resume point (source line)
+    Io     io_ = IO_DONE;                    // result of the last ASYNC_AWAIT
+  private:
+    const char* name_;
+  };
+
+  // ---- TLS (or plain TCP) connection over a non-blocking lwIP socket ----
+  // Each call makes as much progress as it can without blocking and returns
+  // IO_PENDING with fd()/want() saying what to wait for. close() then
+  // connect() again to reconnect.
+  class Conn {
+  public:
+    Conn() {}
+    ~Conn(){ close(); }
+
+    void        setDeadline(uint32_t ms){ deadline_ = millis() + ms; }
+    uint32_t    deadline() const { return deadline_; }
+    int         fd() const { return fd_; }
+    uint8_t     want() const { return want_; }
+    const char* error() const { return err_; }
+    bool        tls() const { return useTls_; }
+
+    Io  connect(const char* host, uint16_t port, bool tls = true);   // DNS → TCP → TLS handshake
+    Io  write(const uint8_t* data, size_t len, size_t& sent);
+    Io  read(uint8_t* buf, size_t cap, int& got);      // got == 0 → peer closed
+    void close();
+
+    uint32_t handshakeMs() const { return hsMs_; }       // TLS only (DNS/TCP excluded)
+    bool     resumed() const { return resumed_; }         // abbreviated handshake (cached session)
+
+  private:
+    Io   fail(const char* why){ err_ = why; want_ = WAIT_NONE; return IO_ERR; }
+    Io   tlsResult(int rc);
+    Io   sockResult(uint8_t ev);
+    bool expired() const { return (int32_t)(millis() - deadline_) >= 0; }
+
+    enum : uint8_t { ST_IDLE, ST_DNS, ST_TCP, ST_TLS, ST_READY, ST_CLOSED };
+    uint8_t     st_       = ST_IDLE;
+    uint8_t     want_     = WAIT_NONE;
+    int         fd_       = -1;
+    uint32_t    ip_       = 0;
+    uint16_t    port_     = 0;
+    bool        useTls_   = true;
+    char        host_[64] = {0};
+    uint32_t    deadline_ = 0;
+    uint32_t    t0_       = 0, tlsT0_ = 0, hsMs_ = 0;
+    uint8_t     mode_     = 0;                         // Tls::Mode used for this connection
+    bool        offered_  = false, resumed_ = false;
+    const char* err_      = "";
+    struct Tls;
+    Tls*        tls_      = nullptr;
+  };
+
+  // ---- Minimal HTTP/1.1 exchange on a Conn (Content-Length, chunked or close-delimited) ----
+  class Http {
+  public:
+    void reset();
+    Io   request(Conn& c, const String& head, const String& body);   // send + read status/headers
+    Io   body(Conn& c, Print& sink);                                  // stream the body into sink
+    int  status() const { return status_; }
+    uint32_t bodyBytes() const { return got_; }
+
+  private:
+    Io   fill(Conn& c);
+    int      pt_ = 0;
+    int      status_ = 0;
+    size_t   sent_ = 0;
+    uint32_t sentAt_ = 0;                    // request fully written (RTT for the Date header)
+    String   hdr_;
+    bool     chunked_ = false;
+    int32_t  remain_  = -1;                  // Content-Length / current chunk; -1 = until close
+    uint8_t  chunkSt_ = 0;
+    char     line_[12];                      // chunk-size line
+    uint8_t  lineLen_ = 0;
+    uint32_t got_ = 0;
+    uint8_t  buf_[1436];
+    int      pos_ = 0, len_ = 0;
+  };
+
+  void     begin();                          // start the "net" task (core 0)
+  bool     spawn(Task* t);                   // any task; the loop owns and deletes t
+  uint32_t dnsCacheHits();
+  String   statsJSON();
+}
+
+// ---- Coroutine macros (use inside Task::step) ----
+#define ASYNC_BEGIN()      switch (pt_) { case 0:
+#define ASYNC_END()        } pt_ = 0; return true
+#define ASYNC_YIELD()      do { sleepFor(0); pt_ = __LINE__; return false; case __LINE__:; } while (0)
+#define ASYNC_SLEEP(ms)    do { sleepFor(ms); pt_ = __LINE__; return false; case __LINE__:; } while (0)
+// Park until the socket has data or `ms` pass, whichever first (then read to see which).
+#define ASYNC_WAIT_FD(fd, ms) \
+  do { waitIo((fd), Async::WAIT_READ, millis() + (ms)); pt_ = __LINE__; return false; case __LINE__:; } while (0)
+#define ASYNC_WAIT_READ(conn, ms) ASYNC_WAIT_FD((conn).fd(), ms)
+// Re-evaluates `expr` (an Async::Io call on `conn`) until it is no longer
+// IO_PENDING; the result lands in io_.
+#define ASYNC_AWAIT(conn, expr) \
+  do { pt_ = __LINE__; case __LINE__: { \
+    Async::Io r_ = (expr); \
+    if (r_ == Async::IO_PENDING){ waitIo((conn).fd(), (conn).want(), (conn).deadline()); return false; } \
+    io_ = r_; } } while (0)
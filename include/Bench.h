@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] On-device benchmark runner (served from /api/bench)
+// [TRAKKR-NOTE] Modules register their own cases at setup; the runner only
+// times them. Runs on the caller's task (the HTTP loop), so the board and
+// ticker pause while display cases hold the TFT.
+//
+namespace Bench {
+  struct Case {
+    const char* name;                 // "group.case", used for ?case= prefix filter
+    void      (*run)(void* ctx);      // one timed iteration
+    void*       ctx;
+    uint16_t    iters;                // default iteration count
+    uint32_t    bytes;                // payload per iteration (0 = n/a), for MB/s
+    bool      (*before)(void* ctx);   // optional, untimed; false = skip case
+    void      (*after)(void* ctx);    // optional, untimed
+  };
+
+  void add(const Case& c);
+
+  // Registered cases (name, default iterations, bytes); runs nothing.
+  String listJSON();
+
+  // Run every case whose name starts with `prefix` ("" = all).
+  // iters = 0 keeps each case's default. tlsHost: the TLS handshake case's
+  // host for this run (nullptr / "" = Darwin). Returns the JSON report.
+  String runJSON(const char* prefix, uint16_t iters, const char* tlsHost = nullptr);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Embedded fixtures for /api/bench (and anything else that needs a
+// canned Darwin/settings payload). Captured shape of a real OpenLDBWS
+// departure board; values are made up.
+//
+static const char BENCH_DARWIN_XML[] PROGMEM =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+  "<soap:Envelope xmlns:soap=\"http://www.w3.org/2003/05/soap-envelope\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xmlns:xsd=\"http://www.w3.org/2001/XMLSchema\">"
+  "<soap:Body><GetDepartureBoardResponse xmlns=\"http://thalesgroup.com/RTTI/2016-02-16/ldb/\">"
+  "<GetStationBoardResult xmlns:lt=\"http://thalesgroup.com/RTTI/2012-01-13/ldb/types\" xmlns:lt4=\"http://thalesgroup.com/RTTI/2015-11-27/ldb/types\" xmlns:lt5=\"http://thalesgroup.com/RTTI/2016-02-16/ldb/types\">"
+  "<lt4:generatedAt>2025-03-04T07:40:12.345+00:00</lt4:generatedAt>"
+  "<lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs><lt4:nrccMessages>"
+  "<lt:message>Disruption between Surbiton and Woking. More details can be found in &lt;a href=\"http://nationalrail.co.uk/\"&gt;Latest Travel News&lt;/a&gt;.</lt:message>"
+  "</lt4:nrccMessages><lt4:platformAvailable>true</lt4:platformAvailable><lt5:trainServices><lt5:service>"
+  "<lt4:std>07:42</lt4:std><lt4:etd>On time</lt4:etd><lt4:platform>3</lt4:platform>"
+  "<lt4:operator>South Western Railway</lt4:operator><lt4:operatorCode>SW</lt4:operatorCode>"
+  "<lt4:serviceType>train</lt4:serviceType><lt4:serviceID>81234567CLPHMJN_</lt4:serviceID><lt5:origin>"
+  "<lt4:location><lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location>"
+  "</lt5:origin><lt5:destination><lt4:location><lt4:locationName>London Waterloo</lt4:locationName>"
+  "<lt4:crs>WIM</lt4:crs></lt4:location></lt5:destination></lt5:service><lt5:service><lt4:std>07:45</lt4:std>"
+  "<lt4:etd>07:49</lt4:etd><lt4:platform>5</lt4:platform><lt4:operator>South Western Railway</lt4:operator>"
+  "<lt4:operatorCode>SW</lt4:operatorCode><lt4:serviceType>train</lt4:serviceType>"
+  "<lt4:serviceID>81242486CLPHMJN_</lt4:serviceID><lt5:origin><lt4:location>"
+  "<lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location></lt5:origin>"
+  "<lt5:destination><lt4:location><lt4:locationName>Reading</lt4:locationName><lt4:crs>RDG</lt4:crs>"
+  "</lt4:location></lt5:destination></lt5:service><lt5:service><lt4:std>07:48</lt4:std><lt4:etd>On time</lt4:etd>"
+  "<lt4:platform>1</lt4:platform><lt4:operator>South Western Railway</lt4:operator>"
+  "<lt4:operatorCode>SW</lt4:operatorCode><lt4:serviceType>train</lt4:serviceType>"
+  "<lt4:serviceID>81250405CLPHMJN_</lt4:serviceID><lt5:origin><lt4:location>"
+  "<lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location></lt5:origin>"
+  "<lt5:destination><lt4:location><lt4:locationName>Windsor &amp; Eton Riverside</lt4:locationName>"
+  "<lt4:crs>WNR</lt4:crs></lt4:location></lt5:destination></lt5:service><lt5:service><lt4:std>07:51</lt4:std>"
+  "<lt4:etd>Delayed</lt4:etd><lt4:platform>2</lt4:platform><lt4:operator>South Western Railway</lt4:operator>"
+  "<lt4:operatorCode>SW</lt4:operatorCode><lt4:serviceType>train</lt4:serviceType>"
+  "<lt4:serviceID>81258324CLPHMJN_</lt4:serviceID><lt5:origin><lt4:location>"
+  "<lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location></lt5:origin>"
+  "<lt5:destination><lt4:location><lt4:locationName>London Waterloo via Hounslow and Richmond</lt4:locationName>"
+  "<lt4:crs>WAT</lt4:crs></lt4:location></lt5:destination></lt5:service><lt5:service><lt4:std>07:55</lt4:std>"
+  "<lt4:etd>Cancelled</lt4:etd><lt4:operator>South Western Railway</lt4:operator>"
+  "<lt4:operatorCode>SW</lt4:operatorCode><lt4:serviceType>train</lt4:serviceType>"
+  "<lt4:serviceID>81266243CLPHMJN_</lt4:serviceID><lt5:origin><lt4:location>"
+  "<lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location></lt5:origin>"
+  "<lt5:destination><lt4:location><lt4:locationName>Guildford</lt4:locationName><lt4:crs>GLD</lt4:crs>"
+  "</lt4:location></lt5:destination></lt5:service><lt5:service><lt4:std>07:58</lt4:std><lt4:etd>On time</lt4:etd>"
+  "<lt4:platform>4</lt4:platform><lt4:operator>South Western Railway</lt4:operator>"
+  "<lt4:operatorCode>SW</lt4:operatorCode><lt4:serviceType>train</lt4:serviceType>"
+  "<lt4:serviceID>81274162CLPHMJN_</lt4:serviceID><lt5:origin><lt4:location>"
+  "<lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location></lt5:origin>"
+  "<lt5:destination><lt4:location><lt4:locationName>Shepperton</lt4:locationName><lt4:crs>SHP</lt4:crs>"
+  "</lt4:location></lt5:destination></lt5:service><lt5:service><lt4:std>08:02</lt4:std><lt4:etd>08:05</lt4:etd>"
+  "<lt4:platform>6</lt4:platform><lt4:operator>South Western Railway</lt4:operator>"
+  "<lt4:operatorCode>SW</lt4:operatorCode><lt4:serviceType>train</lt4:serviceType>"
+  "<lt4:serviceID>81282081CLPHMJN_</lt4:serviceID><lt5:origin><lt4:location>"
+  "<lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location></lt5:origin>"
+  "<lt5:destination><lt4:location><lt4:locationName>Hampton Court</lt4:locationName><lt4:crs>HMC</lt4:crs>"
+  "</lt4:location></lt5:destination></lt5:service><lt5:service><lt4:std>08:06</lt4:std><lt4:etd>On time</lt4:etd>"
+  "<lt4:operator>South Western Railway</lt4:operator><lt4:operatorCode>SW</lt4:operatorCode>"
+  "<lt4:serviceType>bus</lt4:serviceType><lt4:serviceID>81290000CLPHMJN_</lt4:serviceID><lt5:origin>"
+  "<lt4:location><lt4:locationName>Clapham Junction</lt4:locationName><lt4:crs>CLJ</lt4:crs></lt4:location>"
+  "</lt5:origin><lt5:destination><lt4:location><lt4:locationName>Portsmouth Harbour</lt4:locationName>"
+  "<lt4:crs>PMH</lt4:crs></lt4:location></lt5:destination></lt5:service></lt5:trainServices>"
+  "</GetStationBoardResult></GetDepartureBoardResponse></soap:Body></soap:Envelope>";
+
+static const char BENCH_SETTINGS_JSON[] PROGMEM =
+  "{\"source\":\"rail\",\"station\":\"CLJ\",\"nrBoardType\":\"departures\","
+  "\"callingAt\":\"Woking (WOK)\",\"includeBus\":true,\"includePass\":false,"
+  "\"showDate\":true,\"includeWeather\":false,\"autoUpdate\":true,\"updateEvery\":30,"
+  "\"tickerMs\":7000,\"ssStart\":\"23:00\",\"ssEnd\":\"06:00\",\"line\":\"\","
+  "\"direction\":\"\",\"wifi\":{\"ssid\":\"trakkr-lab\",\"pass\":\"not-a-secret\"}}";
@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+#include <gfxfont.h>
+
+//
+// [TRAKKR] Header clock drawn from a pre-rendered glyph atlas
+// [TRAKKR-NOTE] begin() renders 0-9, ':', '-' and a blank colon once, with
+// the 1-px shadow and the header background already in, into one 16-bit
+// buffer in panel byte order, each glyph stored contiguously. draw() then
+// pushes only the cells whose glyph changed since the last call, so a
+// ticking colon is one tiny blit a second and HH:MM:SS is usually one or
+// two. Fixed cells (widest digit), so nothing shifts as digits change.
+//
+class ClockFace {
+public:
+  ~ClockFace(){ end(); }
+
+  // False if the atlas can't be allocated (callers fall back to drawString).
+  bool    begin(const GFXfont* font, uint16_t fg, uint16_t shadow, uint16_t bg, bool seconds);
+  void    end();
+  bool    ready() const { return atlas_ != nullptr; }
+
+  int     width() const;
+  int     height() const { return h_; }
+
+  void    invalidate(){ memset(last_, 0xFF, sizeof(last_)); }   // repaint every cell next time
+  // text: "HH:MM" or "HH:MM:SS" ('-' for unknown). colonOn = false blanks the colons.
+  // Returns the number of cells pushed.
+  uint8_t draw(int x, int y, const char* text, bool colonOn);
+
+private:
+  enum : uint8_t { G_COLON = 10, G_DASH = 11, G_BLANK = 12, G_COUNT = 13, CELLS = 8 };
+  uint8_t glyphFor(char c, bool colonOn) const;
+
+  uint16_t* atlas_ = nullptr;
+  uint32_t  off_[G_COUNT] = {};               // pixel offset of each glyph in the atlas
+  uint8_t   gw_[G_COUNT]  = {};               // glyph widths
+  int       h_ = 0;
+  bool      secs_ = false;
+  uint8_t   last_[CELLS];                     // glyph shown per cell (0xFF = unknown)
+};
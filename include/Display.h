@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Display backends (bulk pixel transport)
+// [TRAKKR-NOTE] TFT_eSPI still owns panel init, rotation and every direct
+// draw call. A backend only borrows the bus to move finished RGB565 frames
+// (ticker etc.) so the CPU can compose the next frame while this one is on
+// the wire. Pixels are in panel byte order (same as a 16-bit TFT_eSprite).
+//
+#ifndef TRAKKR_LCD_DMA
+  #define TRAKKR_LCD_DMA 0      // set in platformio.ini; 0 = TFT_eSPI pushes only
+#endif
+
+class DisplayBackend {
+public:
+  virtual ~DisplayBackend() {}
+
+  virtual bool        begin() = 0;
+  virtual const char* name() const = 0;
+
+  // Buffer for the next frame; safe to write until present() is called.
+  virtual uint16_t*   backBuffer() = 0;
+  virtual size_t      capacity() const = 0;          // pixels per frame
+
+  // Queue the back buffer for window (x,y,w,h) and flip buffers.
+  // Returns once the transfer is queued, not when it has finished.
+  virtual bool        present(int x, int y, int w, int h) = 0;
+
+  // Wait for queued transfers, then hand the bus back to TFT_eSPI.
+  // Call before any direct tft.* drawing while a backend is active.
+  virtual void        yieldBus() = 0;
+
+  virtual uint32_t    frames() const = 0;
+};
+
+namespace Display {
+  // ESP32-S3 LCD_CAM i80 bus + GDMA, double-buffered. nullptr if unavailable.
+  DisplayBackend* i80(size_t maxPixels);
+
+  // In-memory panel of w x h pixels; stands in for the LCD on host builds.
+  DisplayBackend* framebuffer(int w, int h);
+  const uint16_t* framebufferPixels();
+
+  // Backend used by the renderers (nullptr = push through TFT_eSPI).
+  void            setActive(DisplayBackend* b);
+  DisplayBackend* active();
+  void            yieldBus();   // no-op when no backend is active
+}
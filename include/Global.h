@@ -31,6 +31,37 @@ namespace Cfg {
   constexpr const char* DEF_TUBE_LINE    = "";             // e.g. "Victoria"
   constexpr const char* DEF_TUBE_DIR     = "";             // "inbound"/"outbound"/"northbound" etc.
 
+  // Board paging
+  constexpr uint8_t     DEF_BOARD_ROWS   = 8;              // rows fetched from Darwin (1..150)
+  constexpr uint8_t     MAX_BOARD_ROWS   = 150;            // Darwin numRows ceiling
+  constexpr uint8_t     DEF_PAGE_SECS    = 8;              // seconds per page (0 = first page only)
+
+  // Header clock: 0 = HH:MM, 1 = HH:MM with ticking colon, 2 = HH:MM:SS
+  constexpr uint8_t     DEF_CLOCK_STYLE  = 0;
+  // Board transitions (slide / flip between polls); 0 = repaint in place
+  constexpr uint16_t    DEF_ANIM_MS      = 450;
+  constexpr uint16_t    MAX_ANIM_MS      = 2000;
+
+  // Darwin quota (shared by every board on the same token)
+  constexpr uint32_t    DEF_QUOTA_LIMIT  = 0;              // requests per period (0 = unmetered)
+  constexpr uint8_t     DEF_QUOTA_DAYS   = 28;             // quota period length
+  constexpr uint8_t     DEF_FLEET_SIZE   = 1;              // boards sharing the token
+
+  // MQTT board publisher (blank host = off)
+  constexpr const char* DEF_MQTT_HOST    = "";
+  constexpr uint16_t    DEF_MQTT_PORT    = 1883;
+  constexpr const char* DEF_MQTT_TOPIC   = "trakkr";         // topics are <topic>/<CRS>/...
+
+  // LAN peer sharing (one board polls Darwin per station)
+  constexpr bool        DEF_PEER_SHARE   = false;
+
+  // TLS server verification: 0 = none (legacy), 1 = pinned key, 2 = trust anchor
+  constexpr uint8_t     DEF_TLS_MODE     = 0;
+
+  // Firmware updates: base URL of the update server (blank = none) for
+  // /api/firmware/check; never polled on its own (see Ota.h)
+  constexpr const char* DEF_OTA_URL      = "";
+
   struct Settings {
     // Wi-Fi
     char     wifi_ssid[33];
@@ -59,6 +90,31 @@ namespace Cfg {
     char     ss_end[6];          // HH:MM
     char     tube_line[28];
     char     tube_dir[16];
+
+    // Board paging
+    uint8_t  board_rows;         // services fetched per poll
+    uint8_t  page_secs;          // auto-advance period
+    uint8_t  clock_style;        // DEF_CLOCK_STYLE values
+    uint16_t anim_ms;            // board transition length
+
+    // Darwin quota
+    uint32_t quota_limit;        // requests per period, whole token
+    uint8_t  quota_days;
+    uint8_t  fleet_size;
+
+    // MQTT
+    char     mqtt_host[64];
+    uint16_t mqtt_port;
+    char     mqtt_topic[48];
+
+    // Peer sharing
+    bool     peer_share;
+
+    // TLS
+    uint8_t  tls_mode;
+
+    // Firmware updates
+    char     ota_url[96];
   };
 
   // Lifecycle
@@ -90,6 +146,22 @@ namespace Cfg {
   const char*  tubeLine();
   const char*  tubeDir();
   const char* callingAtCrs();
+  uint8_t      boardRows();
+  uint8_t      pageSecs();
+  uint8_t      clockStyle();
+  uint16_t     animMs();
+  uint32_t     quotaLimit();
+  uint8_t      quotaDays();
+  uint8_t      fleetSize();
+  const char*  mqttHost();
+  uint16_t     mqttPort();
+  const char*  mqttTopic();
+  bool         peerShare();
+  uint8_t      tlsMode();
+  const char*  otaUrl();
+
+  // Screensaver window in minutes after midnight; false when disabled (start == end)
+  bool         screensaverWindow(int& startMin, int& endMin);
 
   // Setters (validate + persist)
   bool setWifi(const char* ssid, const char* pass);
@@ -112,6 +184,15 @@ namespace Cfg {
   bool setScreensaver(const char* startHHMM, const char* endHHMM); // "HH:MM"
   bool setTubeLine(const char* line);
   bool setTubeDir(const char* dir);
+  bool setBoardRows(uint8_t rows);          // clamp 1..150
+  bool setPageSecs(uint8_t sec);            // 0 disables paging
+  bool setClockStyle(uint8_t style);        // 0..2
+  bool setAnimMs(uint16_t ms);              // 0 disables, ≤ MAX_ANIM_MS
+  bool setQuota(uint32_t limit, uint8_t days, uint8_t fleet);   // days 1..31, fleet ≥1
+  bool setMqtt(const char* host, uint16_t port, const char* topic); // blank host disables
+  bool setPeerShare(bool v);
+  bool setTlsMode(uint8_t m);               // 0..2
+  bool setOtaUrl(const char* url);          // http://host[:port][/path], blank disables
 
   // Bulk persist / reset
   bool save();
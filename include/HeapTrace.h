@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Heap allocations by subsystem (served from /api/heap)
+// [TRAKKR-NOTE] malloc / calloc / realloc / free and their heap_caps_ forms
+// are wrapped at link time (-Wl,--wrap=..., see platformio.ini), so every
+// caller is seen, the IDF, WiFi and libstdc++ included. While tracing is on,
+// each allocation is charged to the tag of the innermost Scope open on the
+// calling task ("other" when none) and kept in a fixed open table
+// (pointer -> size, tag, mark), so its free is charged back to the same tag.
+// Per tag: live bytes and blocks, peak, allocs / frees and a power-of-two
+// size histogram. mark() starts a leak window: diffJSON() lists, per tag,
+// the change in live bytes since the mark and the blocks allocated since
+// then that are still live (largest first).
+// Blocks allocated before tracing was switched on aren't in the table and
+// their frees are ignored. So are calls made while the flash cache is off
+// (during flash writes); those are counted as cacheOff. Tag names are
+// stored by pointer and must be string literals, as for Trace.
+//
+#ifndef TRAKKR_HEAPTRACE
+  #define TRAKKR_HEAPTRACE 0    // 1 needs the --wrap link flags; 0 compiles Scope down to nothing
+#endif
+
+namespace HeapTrace {
+  bool     begin();                      // allocate the block table (PSRAM if present)
+  void     setEnabled(bool on);          // on clears the counters and the table
+  bool     enabled();
+
+  void     mark();                       // start a leak window
+  String   statsJSON();
+  String   diffJSON();                   // since mark()
+
+  // One line per tag with live bytes to Serial, largest first (checkHeap()).
+  void     logTop(const char* where, uint8_t n);
+
+  void     push(const char* tag);        // prefer Scope
+  void     pop();
+
+  // RAII tag for the calling task; nests.
+  struct Scope {
+#if TRAKKR_HEAPTRACE
+    explicit Scope(const char* tag){ push(tag); }
+    ~Scope(){ pop(); }
+#else
+    explicit Scope(const char*){}
+#endif
+  };
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+//
+// [TRAKKR] On-device departure history (served from /api/history)
+// [TRAKKR-NOTE] record() sees every parsed board. Listed services are tracked
+// by serviceID in an open table sized for the largest board; one that
+// leaves the board at or after its expected time becomes a record: day,
+// scheduled time, last expected delay (the stand-in for the actual time,
+// which LDB lite doesn't give us), destination, first and last platform,
+// flags (cancelled, platform changed, delay unknown, left the board early).
+// Records are buffered in RAM and appended to LittleFS as columnar blocks.
+// Each column is delta / zigzag-varint coded; strings go through a
+// per-segment dictionary, and a block carries only the entries it adds plus
+// a checksum, so a torn write costs one block. Blocks are written when full
+// or an hour or two old, never per poll (flash wear), into /hist/<seq>.seg
+// segments. The oldest segment goes when there are too many or the FS runs
+// low. Punctuality aggregates (overall, by hour, per scheduled time +
+// destination in a bounded table) move with the records: added as they
+// close, subtracted when their segment is deleted, rebuilt at boot.
+//
+namespace History {
+  struct Row {
+    String id;                  // Darwin serviceID ("" = match on time + dest)
+    String time, dest, est, plat;
+  };
+
+  void   begin();               // after LittleFS is mounted: scan segments, rebuild aggregates
+  void   record(const std::vector<Row>& rows, bool arrivals);
+  void   flush();               // write buffered records now (before reboot)
+  void   clear();               // delete every segment and aggregate
+
+  // time "HH:MM" narrows to one scheduled time (dest: optional prefix);
+  // recent > 0 adds the newest matching records (newest segment + RAM).
+  String queryJSON(const char* time, const char* dest, uint16_t recent);
+}
@@ -6,3 +6,5 @@ void http_loop();    // [TRAKKR] Service incoming HTTP requests
 
 // ADD THIS:
 void scheduleReboot(uint32_t delayMs = 1200);  // [TRAKKR] Request a delayed reboot
+void rebootNow(const char* why);               // [TRAKKR] Flush, record why, restart (never returns)
+bool http_restart();                           // [TRAKKR] Supervisor: stop + start the server on the loop task
@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Operator logos for the board's Operator column (/api/icons)
+// [TRAKKR-NOTE] scripts/mkicons.py converts logos into small 16-colour 4 bpp
+// bitmaps with per-colour alpha, one /icons/<TOC>.tki per Darwin operator
+// code, shipped in the asset bundle. The build runs it when the project has
+// a logos/ folder; none is checked in, so a stock build has no icons and
+// shows the operator text. The first time a row needs one, it is decoded
+// once for that row background (palette blended, then Pixel::expand4) into
+// a slot of a fixed PSRAM cache. Later repaints just blit the slot. The
+// least recently used slot is reused when the cache is full. Codes with no
+// icon are remembered, so a miss costs one lookup. The display task is the
+// only caller.
+//
+namespace Icons {
+  struct Icon {
+    const uint16_t* px;                        // w x h, panel byte order
+    uint8_t         w, h;
+  };
+
+  void   begin();                              // after Assets::begin(); allocates the cache
+
+  // toc: Darwin operatorCode ("SW"). False = no icon (or no bundle): draw text.
+  bool   get(const char* toc, uint16_t bg, Icon& out);
+
+  String statsJSON();
+}
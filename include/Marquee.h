@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include <gfxfont.h>
+
+//
+// [TRAKKR] Per-cell marquees for text that doesn't fit its column
+// [TRAKKR-NOTE] Each cell's full text (drop shadow and row background in)
+// is rasterised once into its own strip, text + a gap wide so it wraps
+// seamlessly, in PSRAM when there is some. frame() runs on the ticker's
+// frame scheduler: it builds
+// at most one pending strip, then copies each cell's clipped window out of
+// its strip and pushes it, round-robin, until the per-frame budget is
+// spent. Whatever didn't get a turn goes first next frame. Offsets follow
+// the clock (hold at the start, scroll, repeat), so a cell that misses a
+// frame skips ahead rather than slowing down, and nothing is pushed while a
+// cell is holding.
+//
+namespace Marquee {
+  // Cell at (x, y), w x h on the panel; text is drawn middle-left like the
+  // row it sits in. False if the cell list is full.
+  bool   add(int x, int y, int w, int h, const String& text, const GFXfont* font, uint16_t fg, uint16_t bg);
+  void   clear();                      // drop every cell (the rows are being repainted)
+  size_t count();
+
+  void   frame(uint32_t budgetUs);     // once per ticker frame, from the display task
+
+  String statsJSON();
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+//
+// [TRAKKR] MQTT board publisher (MQTT 3.1.1, QoS 0, retained)
+// [TRAKKR-NOTE] Makes the board the single Darwin poller for its station.
+// Topics, under <topic>/<CRS>/:
+//   status      "online" / "offline" (last will)
+//   board       {"crs","title","gen","at","ids":[...]}: which services are listed, in order
+//   svc/<id>    one service as JSON; empty payload = gone (clears the retained copy)
+// On every (re)connect the whole set is sent; after that only services whose
+// payload changed, plus board when the list or title changes. Everything is
+// retained, so a late subscriber gets the current board without waiting.
+// What we retained isn't remembered across a reboot: with the first board of
+// each session the publisher subscribes to svc/+ for a few seconds and clears
+// any retained row that isn't on it.
+// Runs as an Async task on the shared "net" task; blank host = off.
+//
+// Local check:  mosquitto -v -p 1883
+//               mosquitto_sub -h <pc> -t 'trakkr/#' -v
+//
+namespace Mqtt {
+  struct Row {
+    String id;              // Darwin serviceID
+    String time, dest, est, plat, oper;
+    bool   bus = false;
+  };
+
+  void   begin();                                         // spawn the publisher task
+  void   configure();                                     // after Cfg changes, on the task that made them
+
+  // Hand over a freshly parsed board (rows are moved out). Cheap; the
+  // publisher diffs and sends on its next pass.
+  void   offer(const String& title, uint32_t gen, std::vector<Row>& rows);
+
+  String statsJSON();
+}
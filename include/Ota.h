@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Streaming firmware updates into the idle OTA slot (/api/ota)
+// [TRAKKR-NOTE] An update is a .trkd file (scripts/mkdelta.py): an 80-byte
+// header (sizes, SHA-256 of the base image it applies to, SHA-256 of the
+// result) and then one raw-deflate stream of ops against the running image:
+// COPY a range of it, ADD bytes to a range of it (bsdiff-style: code that
+// moved differs by small deltas and compresses to almost nothing), DATA
+// literal bytes, END. A "full" file has no base and only DATA.
+// Bytes are inflated through a 32 KB window and the output goes to flash a
+// 4 KB page at a time as they arrive, so the memory needed doesn't grow with
+// the image. The board keeps running the whole time; the only downtime is
+// the reboot.
+// The new slot boots on trial: a boot counter in NVS rolls back to the old
+// slot after a crash or a few boots without being confirmed; it's confirmed
+// once a board fetch has succeeded (or it has stayed up a while). With the
+// IDF's own rollback enabled the image is marked valid at the same moment.
+//
+namespace Ota {
+  void   begin();                            // first thing in setup(): trial-boot bookkeeping
+  void   loop();                             // confirm a trial image
+
+  // Push: a file arriving in pieces (HTTP upload). open() returns the
+  // session id (0 = another update is in progress); write / finish / abort
+  // do nothing for any other id, so an upload and a pull can't mix. After
+  // finish() the caller reboots into the new image.
+  uint32_t open();
+  bool   write(uint32_t id, const uint8_t* p, size_t n);
+  bool   finish(uint32_t id);
+  void   abort(uint32_t id, const char* why);
+
+  // Pull: GET <url>/update?from=<running image sha> on a background task;
+  // 204 = up to date. False if an update is already in progress. Only on
+  // request (/api/firmware/check): the file's hashes catch corruption, not
+  // a forged image, so it's trusted no more than an upload.
+  bool   check(const char* url);
+
+  String statusJSON();
+}
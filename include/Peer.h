@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] LAN peer sharing: one board per station polls Darwin
+// [TRAKKR-NOTE] Boards showing the same board (CRS, mode, filter, rows) form
+// a group over UDP multicast. Each sends a heartbeat every 2 s. The lowest
+// id that claims leadership polls Darwin and multicasts each good board as a
+// versioned binary snapshot ('TRKB' v2, fragmented to fit a datagram); the
+// others render those. A follower that hears no leader for 7 s runs the
+// election again (lowest live id wins) and takes over polling. The leader's
+// heartbeat says when it polls next (or that it is idle); a follower whose
+// board has not come by then, plus a margin, polls for itself until it does.
+// Sockets allow address reuse and multicast loopback, so several instances
+// on one host (same port) see each other. The group is advertised over mDNS
+// as _trakkr._udp for tools; election runs on the heartbeats alone.
+//
+namespace Peer {
+  // Called on the net task with a complete snapshot from the leader (the
+  // payload of encodeBoard() in rail.cpp).
+  typedef void (*BoardFn)(const uint8_t* data, size_t len);
+
+  constexpr uint16_t PORT = 47554;
+
+  void     begin(BoardFn onBoard);          // no-op unless Cfg::peerShare()
+  void     configure();                     // after Cfg changes, on the task that made them
+
+  bool     shouldPoll();                    // leader, alone, sharing off, or leader's boards gone stale
+  void     share(const uint8_t* data, size_t len);    // leader: after each good fetch
+  void     askRefresh();                    // follower: ask the leader for a fresh fetch
+
+  // Loop task, each pass: when our own timer fires next (millis()), whether it
+  // is idle (quiet hours on a budget) and whether polls are budgeted at all.
+  void     setSchedule(uint32_t nextPollAt, bool idle, bool budgeted);
+
+  String   statsJSON();
+}
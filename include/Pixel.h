@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] RGB565 pixel kernels for sprite / frame buffers
+// [TRAKKR-NOTE] Fill, copy and byte-swap have ESP32-S3 PIE versions (128-bit
+// q registers, 16 bytes per load/store) and portable scalar versions in
+// Pixel::ref. Palette expand (a 16-entry lookup, two pixels per source byte)
+// and blend (one pixel per step, its three channels spread across a 32-bit
+// word so one multiply scales them all) are scalar on every target. PIE
+// loads/stores need 16-byte alignment, so each call does the unaligned head
+// and tail in scalar code, and when src and dst are misaligned against each
+// other the whole call takes the scalar path.
+// begin() checks every vector kernel against Pixel::ref on odd lengths and
+// offsets; a kernel that differs by a single bit is switched off (see
+// statsJSON()). Counts are pixels; buffers may be in either byte order
+// unless noted.
+//
+namespace Pixel {
+  void     begin();                     // self-check + /api/bench cases
+
+  void     fill16(uint16_t* dst, uint16_t v, size_t n);
+  void     copy16(uint16_t* dst, const uint16_t* src, size_t n);
+  void     copyRect(uint16_t* dst, int dstStride, const uint16_t* src, int srcStride, int w, int h);
+  void     swap16(uint16_t* dst, const uint16_t* src, size_t n);    // dst == src is fine
+
+  // 4 bpp → RGB565 through a 16-entry palette (values as they should land in
+  // dst). High nibble first; n pixels.
+  void     expand4(uint16_t* dst, const uint8_t* src, size_t n, const uint16_t pal[16]);
+
+  // dst = a*alpha + b*(32-alpha), alpha 0..32, per channel. panelOrder: all
+  // three buffers hold byte-swapped pixels (TFT_eSprite / DMA frame order).
+  void     blend(uint16_t* dst, const uint16_t* a, const uint16_t* b, size_t n, uint8_t alpha, bool panelOrder);
+
+  // Off-screen pixel buffer of n pixels: PSRAM when there is some, else
+  // internal RAM only while RESERVE bytes stay free after it. nullptr when
+  // neither fits; release with heap_caps_free().
+  constexpr size_t RESERVE = 48 * 1024;
+  uint16_t* alloc(size_t n);
+
+  inline uint16_t panel(uint16_t c){ return (uint16_t)((c >> 8) | (c << 8)); }   // RGB565 → panel byte order
+
+  // Scalar reference versions (fallbacks, and the baseline for the self-check)
+  namespace ref {
+    void   fill16(uint16_t* dst, uint16_t v, size_t n);
+    void   copy16(uint16_t* dst, const uint16_t* src, size_t n);
+    void   swap16(uint16_t* dst, const uint16_t* src, size_t n);
+  }
+
+  String   statsJSON();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Sampling CPU profiler (served from /api/profile)
+// [TRAKKR-NOTE] A hardware timer per core interrupts at `hz` and records
+// the interrupted task and a short backtrace (pc, then return addresses)
+// from the exception frame the port saved on that task's stack. Samples go
+// into a lock-free ring per core; a low-priority "prof" task folds them into
+// a table of unique stacks with counts. Samples that land in another ISR
+// are counted under "[isr]".
+// FreeRTOS run-time counters are snapshotted at start and read again at the
+// end (or now, while running) for per-task CPU share; the sample counts give
+// a second opinion that doesn't depend on the run-time stats config.
+// Collapsed output ("task;outer;...;leaf count", raw addresses) is meant for
+// scripts/symbolize_profile.py with the matching firmware.elf, whose output
+// goes straight into flamegraph.pl or speedscope.
+//
+namespace Profile {
+  bool   start(uint16_t hz, uint32_t ms);   // false if already running or no memory
+  void   stop();
+  bool   running();
+
+  String statsJSON();                       // state, sample counts, per-task share
+
+  // Stream the collapsed stacks. `emit` gets ~1 KB pieces.
+  void   writeCollapsed(void (*emit)(const String& chunk, void* ctx), void* ctx);
+}
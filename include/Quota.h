@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Darwin request accounting + budget-aware poll planner
+// [TRAKKR-NOTE] Every HTTP attempt counts, failed or not. Counts are kept per
+// token (NVS key is a hash of the token) and written back in batches to spare
+// flash; a crash can lose at most one batch. The planner gives this board
+// 1/fleet of the token's quota and spreads what is left over the active
+// (non-screensaver) time remaining in the period.
+//
+namespace Quota {
+  void     begin();
+
+  // Key a token's counts are kept under. Callers off the HTTP task hash
+  // their own snapshot of the token, never Cfg directly.
+  uint32_t tokenKey(const char* token);
+
+  void     noteRequest(uint32_t tokKey);  // call right before each Darwin request
+  void     noteResult(bool ok);         // consecutive failures drive the backoff
+  void     flush();                     // persist now (before reboot etc.)
+  void     resetPeriod();               // start a new period with zero spend
+
+  // Delay until the next timer poll, from the last result and remaining budget.
+  uint32_t nextPollMs(bool lastOk);
+
+  uint32_t used();                      // this period, this board
+  bool     metered();                   // a budget is set (quotaLimit != 0)
+  String   statsJSON();
+}
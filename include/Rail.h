@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Board fetch coordinator (implemented in rail.cpp)
+// [TRAKKR-NOTE] Every trigger funnels into one Darwin request at a time.
+// A trigger that arrives while a fetch is queued or in flight shares its
+// result instead of starting another one. Settings changes are the exception:
+// they never join an in-flight fetch, because that request was built from the
+// old settings.
+//
+namespace Rail {
+  enum Trigger : uint8_t {
+    TRIG_TIMER = 0,   // poll interval elapsed
+    TRIG_API,         // POST /api/refresh
+    TRIG_SETTINGS,    // board settings changed
+    TRIG_RESUME,      // screensaver window ended
+    TRIG_BOOT,        // first fetch in setup
+    TRIG_PEER,        // took over as peer leader, or a follower asked
+    TRIG_COUNT
+  };
+
+  // Copy the Darwin request settings from Cfg. Call after Cfg changes, on
+  // the task that made them; fetches only read this copy.
+  void     configure();
+
+  // Queue (or join) a fetch. Returns the snapshot generation that satisfies it.
+  uint32_t requestRefresh(Trigger why);
+
+  // Wait until generation `gen` has been published. False on timeout.
+  bool     waitFor(uint32_t gen, uint32_t timeoutMs);
+
+  uint32_t publishedGen();
+  bool     lastFetchOk();
+
+  // Coordinator counters for /api/refresh.
+  String   fetchStatsJSON();
+}
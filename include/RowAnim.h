@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Board transitions: row diff + off-screen row bitmaps
+// [TRAKKR-NOTE] begin() matches the old and new service lists by key (the
+// Darwin serviceID) and turns the visible page into a plan. Rows that moved
+// slide from their old slot to the new one, rows that left fold shut, new
+// rows unfold into their slot (split-flap style, shaded as they turn), rows
+// whose text changed in place flip (old folds, new unfolds) and the rest
+// stay put. Every row that takes part is painted once into an off-screen
+// bitmap (PSRAM when there is some), a few per step. Frames are then built
+// line by line from those bitmaps into strips and pushed, covering only the
+// lines that can change.
+// Progress follows the clock, not the frame count, and step() stops when its
+// budget runs out, so a slow bus shows fewer frames of the same length of
+// animation and the ticker keeps its cadence.
+//
+namespace RowAnim {
+  struct Geometry {
+    int      x, y, w;                 // row area on the panel
+    int      rowH, slots;             // row height, rows per page
+    uint16_t bg[2];                   // slot background, even / odd (panel byte order)
+    uint16_t tailBg;                  // below the last row (panel byte order)
+  };
+
+  struct Source {
+    const uint32_t* oldKeys; int nOld; int oldFirst;   // whole board + first row of the page shown
+    const uint32_t* newKeys; int nNew; int newFirst;   // (keys are only read by begin())
+    bool (*same)(int oldIdx, int newIdx, void* ctx);   // row text unchanged?
+    // Paint row idx of the old or new board, as it looks in `slot`, into
+    // dst (w x rowH, panel byte order). Only called from step().
+    bool (*render)(uint16_t* dst, bool old, int idx, int slot, void* ctx);
+    void* ctx;
+  };
+
+  enum Start : uint8_t {
+    NOTHING,                          // visible page unchanged: nothing to draw
+    PLAYING,                          // call step() until active() is false
+    REPAINT                           // disabled or no memory: repaint the rows normally
+  };
+
+  Start    begin(const Geometry& g, const Source& s, uint16_t durMs);
+  bool     active();
+
+  // Up to budgetUs of work (at least one unit): row bitmaps, then strips of
+  // the current frame. True while there's more to do right away; false when
+  // idle until dueMs() (or finished).
+  bool     step(uint32_t budgetUs);
+  uint32_t dueMs();                   // millis() the next frame is due
+  void     abort();                   // free everything; the caller repaints
+
+  String   statsJSON();
+}
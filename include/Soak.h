@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Accelerated-time soak runner (served from /api/soak)
+// [TRAKKR-NOTE] Replays weeks of poll / parse / repaint / ticker / API cycles
+// in minutes, on the board's own allocator. Modules register steps with a
+// period in virtual seconds; the runner advances a virtual clock one second
+// per tick and runs whatever is due, back to back. The code under test still
+// reads millis(), so only the schedule is virtual: what the steps replay is
+// the sequence of work that churns the heap.
+// Every window (1 virtual hour, longer on long runs) samples free heap,
+// largest block and per-step latency. The report fits trends over the run
+// and fails on leaks, fragmentation or latency creep. Runs on its own task;
+// display steps park the display task until the run ends.
+//
+namespace Soak {
+  struct Step {
+    const char* name;                 // "group.step", used for ?step= prefix filter
+    void      (*run)(void* ctx);      // one occurrence; vary it with Soak::rand()
+    void*       ctx;
+    uint16_t    everyS;               // virtual seconds between occurrences
+    bool      (*before)(void* ctx);   // optional, once per run; false = skip step
+    void      (*after)(void* ctx);    // optional, once per run
+  };
+
+  void     add(const Step& s);
+
+  uint32_t rand();                    // per-run PRNG (same seed, same run)
+  uint32_t now();                     // virtual seconds since the run started
+
+  // Start a run of `hours` virtual hours over steps matching `prefix` ("" = all).
+  // False if one is already running.
+  bool     start(uint32_t hours, uint32_t seed, const char* prefix);
+  void     stop();                    // end early; the report covers what ran
+  String   reportJSON();              // progress while running, verdict when done
+}
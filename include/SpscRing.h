@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+
+//
+// [TRAKKR] Lock-free single-producer / single-consumer ring
+// [TRAKKR-NOTE] Exactly one task may push and exactly one may pop. N must be
+// a power of two; one slot is never used so full and empty are distinguishable.
+//
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+public:
+  bool push(const T& v){
+    const size_t h = head_.load(std::memory_order_relaxed);
+    const size_t n = (h + 1) & (N - 1);
+    if (n == tail_.load(std::memory_order_acquire)) return false;   // full
+    buf_[h] = v;
+    head_.store(n, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& out){
+    const size_t t = tail_.load(std::memory_order_relaxed);
+    if (t == head_.load(std::memory_order_acquire)) return false;   // empty
+    out = buf_[t];
+    tail_.store((t + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+private:
+  T                   buf_[N];
+  std::atomic<size_t> head_{0};   // written by the producer
+  std::atomic<size_t> tail_{0};   // written by the consumer
+};
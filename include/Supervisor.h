@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Subsystem supervisor: restart what failed, not the board (/api/health)
+// [TRAKKR-NOTE] A "super" task checks every part once a second:
+//   net      the Async loop beats each pass; silent 30 s = wedged. No hook:
+//            a wedged loop may hold the Tls, History or lwIP/mbedTLS locks,
+//            so it reboots rather than being replaced in place
+//   wifi     not associated for 30 s. The hook is the one place that
+//            reconnects after setup, with its own copy of the credentials
+//   tls      4 handshakes failed in a row while Wi-Fi is up
+//   loop     the Arduino loop (HTTP handlers, settings, timers) silent 60 s
+//   http     a loopback GET /api/health fails 3 times while the loop is alive
+//   display  no ticker frame for 10 s (a parked display is held, not failing).
+//            No hook: the display task's waits (SPI bus, DMA) have no
+//            timeout, so a stall can't be stopped between steps; it reboots
+//   heap     largest 8-bit block under 12 KB for 10 s
+// A failing part gets its own restart hook. The board on screen is kept:
+// only the part is restarted. A part still failing after MAX_TRIES restarts,
+// or one with no hook, reboots the board. Parts that can heal by themselves
+// (wifi, tls) are retried with backoff instead. Each episode is counted and
+// timed from first failure to healthy again. The reason for the last reboot
+// is kept in RTC memory.
+//
+namespace Supervisor {
+  enum Part : uint8_t { P_NET, P_WIFI, P_TLS, P_LOOP, P_HTTP, P_DISPLAY, P_HEAP, P_COUNT };
+
+  typedef bool (*RestartFn)();               // false = couldn't restart; escalates
+
+  void   begin();                            // end of setup(): start the "super" task
+  void   configure();                        // after Cfg changes, on the task that made them
+  void   beat(Part p);                       // cheap; from the part's own task
+  void   hold(Part p, bool on);              // parked on purpose: not failing while held
+  void   setRestart(Part p, RestartFn fn);
+  void   heapLow(const char* where);         // checkHeap() saw a low block here
+
+  // Queued for the next tick (API, settings). Only wifi, tls and http: their
+  // hooks are safe on a healthy part. The rest restart only when failing.
+  bool   restart(Part p, const char* why);
+  int    partByName(const char* name);       // -1 = unknown
+  void   noteReboot(const char* why);        // kept across the restart (rebootNow())
+
+  String healthJSON();
+}
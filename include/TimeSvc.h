@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Wall-clock time from the first trustworthy source
+// [TRAKKR-NOTE] Sources, best last: RTC (the time saved in RTC memory before
+// a software reset or crash), HTTP (the Date header of an HTTPS response,
+// ±0.5 s + half the round trip), SNTP. The first source to arrive sets the
+// clock. Better sources after that correct it by slewing with adjtime() when
+// the error is a few seconds or less, and by stepping only when it is larger.
+// SNTP runs in the background from startSntp() on and keeps refining; nothing
+// waits for it.
+//
+namespace TimeSvc {
+  enum Source : uint8_t { SRC_NONE = 0, SRC_RTC, SRC_HTTP, SRC_SNTP };
+
+  void        begin();                  // TZ + RTC restore; call early in setup()
+  void        startSntp();              // once the network is up; idempotent
+  void        loop();                   // saves the time to RTC memory now and then
+  void        persist();                // save now (before ESP.restart())
+
+  // Value of a Date header (IMF-fixdate), rttMs from request sent to headers read.
+  void        offerHttpDate(const char* value, uint32_t rttMs);
+
+  bool        valid();                  // any source has set the clock
+  Source      source();
+  const char* sourceName(Source s);
+  String      statsJSON();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+//
+// [TRAKKR] Look-ahead timetable: keeps the board going through outages (/api/timetable)
+// [TRAKKR-NOTE] While Darwin answers, rail.cpp refreshes this table about
+// once an hour with up to two wide 150-row requests. The second one starts
+// where the first one's rows ran out, so together they cover the next 2-4
+// hours. Rows are kept compact: scheduled minute plus dictionary indexes for
+// destination, platform, operator and operator code (8 bytes each).
+// Cancelled rows are left out.
+// When board fetches keep failing, project() rebuilds the board from it for
+// the current minute with "Scheduled" in the expected column. Projection
+// needs no network, so an outage costs no extra requests. The table is keyed
+// by the board settings (mode, station, filter): a table fetched for another
+// board is never shown.
+//
+namespace Timetable {
+  struct Row {
+    String time, dest, est, plat, oper, toc;    // as parsed ("HH:MM", ...)
+    bool   bus = false;
+  };
+
+  void   begin();
+
+  // Is a refresh due for this board? (clock set, table missing/old/other board)
+  bool   due(const char* key);
+
+  // A refresh: start(), addPart() per response, then commit(). addPart returns
+  // the offset (minutes from now) the next request should start at, or -1
+  // when the table reaches far enough. full: the response hit its row limit.
+  void   start(const char* key);
+  int    addPart(const String& title, const std::vector<Row>& rows, int offset, int window, bool full);
+  void   commit();                              // keeps the old table if nothing was added
+
+  // Up to maxRows services not yet departed, est = "Scheduled". False when
+  // there is no table for this board or none of it is still ahead.
+  bool   project(const char* key, size_t maxRows, std::vector<Row>& out, String& title);
+
+  String statsJSON();
+}
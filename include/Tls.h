@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+#include <mbedtls/ssl.h>
+
+//
+// [TRAKKR] TLS server verification policy + session cache for Async::Conn
+// [TRAKKR-NOTE] Three modes (Cfg::tlsMode), all cheaper than chain building
+// against a CA bundle:
+//   insecure  no verification (what WiFiClientSecure::setInsecure() did)
+//   pin       after the handshake, SHA-256 of some certificate's
+//             SubjectPublicKeyInfo in the served chain must match a pin
+//             stored for the host. A pinned leaf is accepted as is (one hash
+//             per cert); a pinned intermediate or root must also verify the
+//             leaf and hostname, with only that cert trusted.
+//   anchor    mbedTLS verifies the chain and hostname against one trust
+//             anchor (an intermediate or root, DER) for the host. The DER is
+//             taken from the asset bundle (/certs/<host>.der) and parsed in
+//             place from mapped flash, once, on first use.
+// Verified sessions are cached per host (RAM, 4 slots) and offered on the
+// next connect, so most polls do an abbreviated handshake with no
+// certificate work at all. Changing the mode or pins drops the cache.
+// Pins live in NVS ("trakkrtls"); the chain seen last per host is kept
+// so a pin can be taken from it (trust on first use, by an operator).
+//
+namespace Tls {
+  enum Mode : uint8_t { MODE_INSECURE = 0, MODE_PIN = 1, MODE_ANCHOR = 2, MODE_COUNT };
+
+  void        begin();
+  Mode        mode();
+  const char* modeName(Mode m);
+
+  // ---- Conn side (net task) ----
+  mbedtls_x509_crt* anchor(const char* host);                       // nullptr = none for host
+  bool        pinMatch(const char* host, const mbedtls_x509_crt* chain);
+  void        observe(const char* host, const mbedtls_x509_crt* chain);
+  bool        offerSession(const char* host, Mode m, mbedtls_ssl_context* ssl);
+  bool        keepSession(const char* host, Mode m, const mbedtls_ssl_context* ssl);   // true = resumed
+  void        dropSession(const char* host);
+  void        noteHandshake(Mode m, bool ok, bool resumed, uint32_t ms);
+
+  // ---- Supervisor ----
+  uint32_t    failStreak();                                         // handshakes failed in a row
+  void        reset();                                              // drop every cached session
+
+  // ---- API side ----
+  bool        setPins(const char* host, const String& csvBase64);   // "" clears
+  bool        pinObserved(const char* host);                        // pin the chain seen last
+  String      statsJSON();
+}
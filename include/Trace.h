@@ -0,0 +1,44 @@
+#pragma once
+#include <Arduino.h>
+
+//
+// [TRAKKR] Span recorder (served from /api/trace as Chrome trace-event JSON)
+// [TRAKKR-NOTE] One ring per core; a writer only touches its own core's ring
+// and claims a slot with a single atomic add, so recording never blocks and
+// never takes a lock. Old events are overwritten. Names are stored by
+// pointer and must be string literals (or otherwise live forever).
+// Off at boot: /api/trace?on=1 allocates the rings (PSRAM if present) and
+// starts recording. Load the dump in ui.perfetto.dev or chrome://tracing.
+//
+#ifndef TRAKKR_TRACE
+  #define TRAKKR_TRACE 1        // 0 compiles every Trace:: call down to nothing
+#endif
+
+namespace Trace {
+  void     begin();                                  // recorder off; no memory taken yet
+  void     setEnabled(bool on);                      // first enable allocates the rings
+  bool     enabled();
+  void     clear();
+
+  void     spanBegin(const char* name);              // phase "B"
+  void     spanEnd(const char* name);                // phase "E"
+  void     instant(const char* name);                // phase "i"
+
+  // Span from t0Us (esp_timer_get_time) to now, dropped if shorter than minUs.
+  // For busy loops where most iterations do nothing worth recording.
+  void     spanSince(const char* name, uint32_t t0Us, uint32_t minUs);
+
+  // Events held (both cores) and total recorded/overwritten since clear().
+  uint32_t held();
+  uint32_t recorded();
+
+  // Stream the rings as {"traceEvents":[...]}. `emit` gets ~1 KB pieces.
+  void     writeJSON(void (*emit)(const String& chunk, void* ctx), void* ctx);
+
+  // RAII span; cheap enough to leave in hot paths.
+  struct Span {
+    const char* n;
+    explicit Span(const char* name) : n(name) { spanBegin(n); }
+    ~Span(){ spanEnd(n); }
+  };
+}
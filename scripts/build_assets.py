@@ -0,0 +1,158 @@
+# [TRAKKR] Build the read-only asset bundle (see include/Assets.h) from data/
+# and add `pio run -t uploadassets` to flash it into the "assets" partition.
+#
+# Runs as a PlatformIO pre-script; can also be run by hand:
+#   python scripts/build_assets.py data out/assets.bin
+# As a pre-script it first converts logos/ (if the project has one) into
+# data/icons with mkicons.py. Logos aren't in the repo (operator artwork):
+# without them the board shows operator names as text.
+
+import gzip
+import io
+import os
+import struct
+import subprocess
+import sys
+
+MAGIC   = 0x414B5254      # "TRKA"
+VERSION = 1
+FLAG_GZIP = 1 << 0
+
+HDR_FMT = "<IHHIII12x"    # 32 bytes
+DIR_FMT = "<IIIIIIHH"     # 28 bytes
+
+CONTENT_TYPES = {
+    ".htm": "text/html", ".html": "text/html", ".css": "text/css",
+    ".js": "application/javascript", ".json": "application/json",
+    ".png": "image/png", ".jpg": "image/jpeg", ".jpeg": "image/jpeg",
+    ".ico": "image/x-icon", ".svg": "image/svg+xml", ".txt": "text/plain",
+    ".woff2": "font/woff2", ".ttf": "font/ttf", ".otf": "font/otf",
+}
+GZIP_TYPES = ("text/", "application/javascript", "application/json", "image/svg+xml")
+
+# Device-only files that must not be served or bundled.
+SKIP = {"ticker.txt", "ticker.meta"}
+
+
+def fnv1a(data, h=2166136261):
+    for b in data:
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def collect(src_dir):
+    files = []
+    for root, _, names in os.walk(src_dir):
+        for n in names:
+            if n in SKIP or n.startswith("."):
+                continue
+            full = os.path.join(root, n)
+            rel = "/" + os.path.relpath(full, src_dir).replace(os.sep, "/")
+            files.append((rel, full))
+    return files
+
+
+def build(src_dir, out_path):
+    entries = []
+    for path, full in collect(src_dir):
+        with open(full, "rb") as f:
+            raw = f.read()
+        ctype = CONTENT_TYPES.get(os.path.splitext(path)[1].lower(), "application/octet-stream")
+        body, flags = raw, 0
+        if ctype.startswith(GZIP_TYPES) and len(raw) > 512:
+            buf = io.BytesIO()
+            with gzip.GzipFile(fileobj=buf, mode="wb", compresslevel=9, mtime=0) as gz:
+                gz.write(raw)
+            if buf.tell() < len(raw) * 9 // 10:
+                body, flags = buf.getvalue(), FLAG_GZIP
+        entries.append({"path": path, "hash": fnv1a(path.encode()), "ctype": ctype,
+                        "body": body, "etag": fnv1a(raw), "flags": flags})
+
+    entries.sort(key=lambda e: (e["hash"], e["path"]))
+
+    hdr_size = struct.calcsize(HDR_FMT)
+    dir_off = hdr_size
+    pool_off = dir_off + len(entries) * struct.calcsize(DIR_FMT)
+
+    # String pool: paths + de-duplicated content types
+    pool = bytearray()
+    str_off = {}
+
+    def intern(s):
+        if s not in str_off:
+            str_off[s] = pool_off + len(pool)
+            pool.extend(s.encode() + b"\0")
+        return str_off[s]
+
+    for e in entries:
+        e["pathOff"] = intern(e["path"])
+        e["ctypeOff"] = intern(e["ctype"])
+
+    data = bytearray()
+    data_base = pool_off + len(pool)
+    data_base += (-data_base) & 3
+    for e in entries:
+        data.extend(b"\0" * ((-len(data)) & 3))       # 4-byte align bodies
+        e["dataOff"] = data_base + len(data)
+        data.extend(e["body"])
+
+    dir_bytes = b"".join(struct.pack(DIR_FMT, e["hash"], e["pathOff"], e["ctypeOff"], e["dataOff"],
+                                     len(e["body"]), e["etag"], e["flags"], len(e["path"]))
+                         for e in entries)
+    tail = dir_bytes + bytes(pool) + b"\0" * (data_base - pool_off - len(pool)) + bytes(data)
+    total = hdr_size + len(tail)
+    out = struct.pack(HDR_FMT, MAGIC, VERSION, len(entries), dir_off, total, fnv1a(tail)) + tail
+
+    os.makedirs(os.path.dirname(out_path) or ".", exist_ok=True)
+    with open(out_path, "wb") as f:
+        f.write(out)
+
+    raw_total = sum(os.path.getsize(full) for _, full in collect(src_dir))
+    print("[ASSETS] %d files, %d -> %d bytes -> %s" % (len(entries), raw_total, total, out_path))
+    return total
+
+
+def partition_offset(csv_path, name="assets"):
+    with open(csv_path) as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            cols = [c.strip() for c in line.split(",")]
+            if cols[0] == name:
+                return int(cols[3], 0), int(cols[4], 0)
+    raise SystemExit("[ASSETS] no '%s' partition in %s" % (name, csv_path))
+
+
+if __name__ == "__main__" and "Import" not in globals():
+    build(sys.argv[1] if len(sys.argv) > 1 else "data",
+          sys.argv[2] if len(sys.argv) > 2 else "assets.bin")
+else:
+    Import("env")  # noqa: F821  (PlatformIO/SCons)
+
+    project = env.subst("$PROJECT_DIR")
+    logos = os.path.join(project, "logos")
+    if os.path.isdir(logos):
+        mkicons = os.path.join(project, "scripts", "mkicons.py")
+        icons = os.path.join(env.subst("$PROJECT_DATA_DIR"), "icons")
+        if subprocess.call([env.subst("$PYTHONEXE"), mkicons, logos, icons]) != 0:
+            print("[ASSETS] mkicons.py failed (is Pillow installed?); bundling without new icons")
+    bundle = os.path.join(env.subst("$BUILD_DIR"), "assets.bin")
+    size = build(env.subst("$PROJECT_DATA_DIR"), bundle)
+
+    csv = os.path.join(project, env.GetProjectOption("board_build.partitions", "partitions.csv"))
+    offset, limit = partition_offset(csv)
+    if size > limit:
+        raise SystemExit("[ASSETS] bundle %d B exceeds partition %d B" % (size, limit))
+
+    env.AddCustomTarget(
+        name="uploadassets",
+        dependencies=None,
+        actions=[
+            '"$PYTHONEXE" "$UPLOADER" --chip $BOARD_MCU --port "$UPLOAD_PORT" --baud $UPLOAD_SPEED '
+            'write_flash 0x%x "%s"' % (offset, bundle)
+        ],
+        title="Upload assets",
+        description="Flash data/ as a memory-mapped asset bundle",
+    )
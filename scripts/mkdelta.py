@@ -0,0 +1,201 @@
+# [TRAKKR] Build a .trkd firmware update for /api/ota (see include/Ota.h).
+#
+#   python scripts/mkdelta.py old.bin new.bin update.trkd    # delta against old.bin
+#   python scripts/mkdelta.py --full new.bin update.trkd     # whole image, any base
+#
+# old.bin must be exactly the image the board is running (the device checks
+# its appended SHA-256). Every file is applied back here before it's written,
+# so a bad delta never leaves this script.
+#
+# Layout: 80-byte header ("<IHHII32s32s": magic, version, flags, base size,
+# target size, base image hash, SHA-256 of new.bin), then one raw-deflate
+# stream of ops:
+#   0 END | 1 COPY off len | 2 ADD off len <len bytes> | 3 DATA len <len bytes>
+# ADD bytes are added (mod 256) to the base bytes at off; it covers code
+# that moved and differs only in the addresses it contains.
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+MAGIC = 0x444B5254          # "TRKD"
+VERSION = 1
+FLAG_FULL = 1 << 0
+HDR_FMT = "<IHHII32s32s"    # 80 bytes
+OP_END, OP_COPY, OP_ADD, OP_DATA = 0, 1, 2, 3
+
+KEY = 8                     # bytes indexed per base position
+MIN_MATCH = 24              # shorter exact matches stay literal
+PER_KEY = 4                 # base positions kept per key
+WINDOW = 16                 # approximate extension: give up when a window of
+MAX_MISS = 8                #   this many bytes has more mismatches than this
+
+
+def image_hash(img, what):
+    """The SHA-256 esptool appends; esp_partition_get_sha256() returns it."""
+    if len(img) < 64 or img[0] != 0xE9:
+        raise SystemExit("[DELTA] %s is not an ESP app image" % what)
+    if img[23] != 1:
+        raise SystemExit("[DELTA] %s has no appended SHA-256 (hash_appended = 0)" % what)
+    return img[-32:]
+
+
+def index(base):
+    idx = {}
+    for i in range(len(base) - KEY + 1):
+        k = base[i:i + KEY]
+        hits = idx.get(k)
+        if hits is None:
+            idx[k] = [i]
+        elif len(hits) < PER_KEY:
+            hits.append(i)
+    return idx
+
+
+def exact_len(a, ai, b, bi):
+    n, limit = 0, min(len(a) - ai, len(b) - bi)
+    while n + 32 <= limit and a[ai + n:ai + n + 32] == b[bi + n:bi + n + 32]:
+        n += 32
+    while n < limit and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+def extend(base, boff, new, start):
+    """Past an exact match, keep going on the same diagonal while it mostly matches."""
+    end, miss = start, []
+    j = start
+    while j < len(new) and boff + (j - start) < len(base):
+        if new[j] == base[boff + (j - start)]:
+            end = j + 1
+        else:
+            miss.append(j)
+            while miss[0] <= j - WINDOW:
+                miss.pop(0)
+            if len(miss) > MAX_MISS:
+                break
+        j += 1
+    return end
+
+
+def diff(base, new):
+    ops = bytearray()
+
+    def data(a, b):
+        if b > a:
+            ops.extend(struct.pack("<BI", OP_DATA, b - a))
+            ops.extend(new[a:b])
+
+    idx = index(base)
+    i, lit, diag = 0, 0, None
+    n = len(new)
+    while i <= n - KEY:
+        best_len, best_off = 0, -1
+        cands = list(idx.get(new[i:i + KEY], ()))
+        if diag is not None and 0 <= i + diag < len(base):
+            cands.append(i + diag)              # same shift as the last match first
+        for off in cands:
+            m = exact_len(base, off, new, i)
+            if m > best_len:
+                best_len, best_off = m, off
+        if best_len < MIN_MATCH:
+            i += 1
+            continue
+        data(lit, i)
+        end = extend(base, best_off + best_len, new, i + best_len)
+        length = end - i
+        if end == i + best_len:
+            ops.extend(struct.pack("<BII", OP_COPY, best_off, length))
+        else:
+            ops.extend(struct.pack("<BII", OP_ADD, best_off, length))
+            ops.extend(bytes((new[i + k] - base[best_off + k]) & 0xFF for k in range(length)))
+        diag = best_off - i
+        i = lit = end
+    data(lit, n)
+    ops.append(OP_END)
+    return bytes(ops)
+
+
+def pack(base, new):
+    full = base is None
+    ops = bytearray()
+    if full:
+        ops.extend(struct.pack("<BI", OP_DATA, len(new)))
+        ops.extend(new)
+        ops.append(OP_END)
+    else:
+        ops = diff(base, new)
+    z = zlib.compressobj(9, zlib.DEFLATED, -15)
+    body = z.compress(bytes(ops)) + z.flush()
+    hdr = struct.pack(HDR_FMT, MAGIC, VERSION, FLAG_FULL if full else 0,
+                      0 if full else len(base), len(new),
+                      b"\0" * 32 if full else image_hash(base, "base"),
+                      hashlib.sha256(new).digest())
+    return hdr + body
+
+
+def apply(base, trkd):
+    """What the device does, minus the flash."""
+    magic, ver, flags, base_size, size, base_sha, sha = struct.unpack_from(HDR_FMT, trkd)
+    if magic != MAGIC or ver != VERSION:
+        raise ValueError("not a .trkd v%d file" % VERSION)
+    if not flags & FLAG_FULL and (base is None or image_hash(base, "base") != base_sha):
+        raise ValueError("delta is for a different base image")
+    ops = zlib.decompress(trkd[struct.calcsize(HDR_FMT):], -15)
+    out = bytearray()
+    p = 0
+    while True:
+        op = ops[p]
+        if op == OP_END:
+            break
+        if op == OP_DATA:
+            (ln,) = struct.unpack_from("<I", ops, p + 1)
+            out += ops[p + 5:p + 5 + ln]
+            p += 5 + ln
+            continue
+        off, ln = struct.unpack_from("<II", ops, p + 1)
+        if off + ln > base_size:
+            raise ValueError("op outside the base image")
+        if op == OP_COPY:
+            out += base[off:off + ln]
+            p += 9
+        elif op == OP_ADD:
+            d = ops[p + 9:p + 9 + ln]
+            out += bytes((base[off + k] + d[k]) & 0xFF for k in range(ln))
+            p += 9 + ln
+        else:
+            raise ValueError("bad op %d" % op)
+    if len(out) != size or hashlib.sha256(out).digest() != sha:
+        raise ValueError("result doesn't match the target")
+    return bytes(out)
+
+
+def make(base, new):
+    """Build and check a .trkd; base None = full image."""
+    image_hash(new, "target")
+    trkd = pack(base, new)
+    apply(base, trkd)
+    return trkd
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Build a TRAKKR .trkd firmware update")
+    ap.add_argument("--full", action="store_true", help="whole image, no base")
+    ap.add_argument("files", nargs="+", help="[old.bin] new.bin out.trkd")
+    args = ap.parse_args()
+    if len(args.files) != (2 if args.full else 3):
+        ap.error("expected %s" % ("new.bin out.trkd" if args.full else "old.bin new.bin out.trkd"))
+
+    base = None if args.full else open(args.files[0], "rb").read()
+    new = open(args.files[-2], "rb").read()
+    trkd = make(base, new)
+    with open(args.files[-1], "wb") as f:
+        f.write(trkd)
+    print("[DELTA] %s: %d -> %d bytes (%.1f%%)" % (args.files[-1], len(new), len(trkd),
+                                                   100.0 * len(trkd) / len(new)))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
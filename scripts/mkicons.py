@@ -0,0 +1,116 @@
+# [TRAKKR] Convert operator logos to board icons (see include/Icons.h).
+#
+#   python scripts/mkicons.py logos/ data/icons [--height 18] [--max-width 96]
+#
+# build_assets.py runs it with the defaults on every build when the project
+# has a logos/ folder; run it by hand for other sizes. Logos aren't shipped
+# in the repo (they're the operators' artwork): supply your own.
+#
+# logos/ holds one image per train operator, named by its Darwin TOC code
+# (operatorCode): GW.png, SW.png, XR.png, ... Anything Pillow opens will do;
+# transparency is kept. Each one is trimmed, scaled to --height (narrower if
+# it would exceed --max-width) and quantised to 16 colours with alpha, then
+# written as data/icons/<TOC>.tki for the asset bundle (build_assets.py).
+# Operators without an icon keep the text column.
+#
+# Layout: 8-byte header ("<4sBBBB": "TKI1", width, height, colours, 0), 16
+# palette entries ("<HB": RGB565, alpha 0..32), then 4 bpp indices, high
+# nibble first, rows packed back to back.
+
+import argparse
+import glob
+import os
+import struct
+import sys
+
+from PIL import Image
+
+MAGIC = b"TKI1"
+HDR_FMT = "<4sBBBB"
+PAL_FMT = "<HB"
+COLOURS = 16
+MAX_W, MAX_H = 96, 22       # cache slot size on the device (Icons.cpp)
+
+
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def convert(path, height, max_width):
+    img = Image.open(path).convert("RGBA")
+    box = img.getchannel("A").getbbox()
+    if not box:
+        raise ValueError("image is fully transparent")
+    img = img.crop(box)
+    w = max(1, round(img.width * height / img.height))
+    h = height
+    if w > max_width:
+        w, h = max_width, max(1, round(img.height * max_width / img.width))
+    img = img.resize((w, h), Image.LANCZOS)
+
+    q = img.quantize(colors=COLOURS, method=Image.Quantize.FASTOCTREE)
+    rgba = q.getpalette("RGBA") or []
+    idx = list(q.tobytes())                 # P mode: one palette index per byte
+    used = max(idx) + 1
+    pal = []
+    for i in range(COLOURS):
+        r, g, b, a = rgba[i * 4:i * 4 + 4] if i < used and len(rgba) >= i * 4 + 4 else (0, 0, 0, 0)
+        pal.append((rgb565(r, g, b), (a * 32 + 127) // 255))
+
+    if len(idx) & 1:
+        idx.append(0)
+    pixels = bytes((idx[i] << 4) | idx[i + 1] for i in range(0, len(idx), 2))
+    body = struct.pack(HDR_FMT, MAGIC, w, h, used, 0)
+    body += b"".join(struct.pack(PAL_FMT, c, a) for c, a in pal)
+    return body + pixels
+
+
+def decode(tki):
+    """What the device does before blending: (w, h, [(rgb565, alpha)] per pixel)."""
+    magic, w, h, n, _ = struct.unpack_from(HDR_FMT, tki)
+    if magic != MAGIC or not 0 < n <= COLOURS or w > MAX_W or h > MAX_H:
+        raise ValueError("not a TKI1 icon")
+    off = struct.calcsize(HDR_FMT)
+    pal = [struct.unpack_from(PAL_FMT, tki, off + i * 3) for i in range(COLOURS)]
+    data = tki[off + COLOURS * 3:]
+    if len(data) != (w * h + 1) // 2:
+        raise ValueError("pixel data size")
+    out = []
+    for i in range(w * h):
+        v = data[i >> 1]
+        out.append(pal[(v >> 4) if not i & 1 else (v & 15)])
+    return w, h, out
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Convert operator logos to TRAKKR board icons")
+    ap.add_argument("src", help="folder of <TOC>.png (or any image Pillow reads)")
+    ap.add_argument("out", nargs="?", default="data/icons")
+    ap.add_argument("--height", type=int, default=18)
+    ap.add_argument("--max-width", type=int, default=MAX_W)
+    args = ap.parse_args()
+    if not 0 < args.height <= MAX_H or not 0 < args.max_width <= MAX_W:
+        ap.error("icons are at most %dx%d" % (MAX_W, MAX_H))
+
+    os.makedirs(args.out, exist_ok=True)
+    done = 0
+    for path in sorted(glob.glob(os.path.join(args.src, "*"))):
+        toc = os.path.splitext(os.path.basename(path))[0].upper()
+        if len(toc) != 2 or not toc.isalnum():
+            print("[ICONS] skip %s: name it by its 2-character TOC code" % path, file=sys.stderr)
+            continue
+        try:
+            tki = convert(path, args.height, args.max_width)
+            w, h, _ = decode(tki)
+        except (OSError, ValueError) as e:
+            print("[ICONS] skip %s: %s" % (path, e), file=sys.stderr)
+            continue
+        with open(os.path.join(args.out, toc + ".tki"), "wb") as f:
+            f.write(tki)
+        print("[ICONS] %s: %dx%d, %d bytes" % (toc, w, h, len(tki)))
+        done += 1
+    print("[ICONS] %d icon(s) -> %s" % (done, args.out))
+
+
+if __name__ == "__main__":
+    main()
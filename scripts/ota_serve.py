@@ -0,0 +1,98 @@
+# [TRAKKR] Local update server for /api/firmware/check (see include/Ota.h).
+#
+#   python scripts/ota_serve.py images/ [--port 8070] [--target new.bin]
+#
+# images/ holds firmware .bin files (every build you may have flashed). The
+# newest one (or --target) is what boards get. A board asks
+#   GET /update?from=<sha of the image it runs>
+# and gets 204 if it's already on the target, a delta if its image is in
+# images/, otherwise the full image. Deltas are built on first request and
+# kept in memory. Point a board at it with otaUrl = http://<this host>:8070.
+# Handy with .pio/build/esp32-s3/ as the directory while developing.
+
+import argparse
+import glob
+import http.server
+import os
+import sys
+import urllib.parse
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import mkdelta  # noqa: E402
+
+
+class Images:
+    def __init__(self, folder, target):
+        self.folder, self.target_path = folder, target
+        self.cache = {}                     # (base sha, target sha) -> .trkd
+
+    def scan(self):
+        """{appended sha hex: (path, bytes)} for every app image, re-read on mtime change."""
+        found = {}
+        for path in glob.glob(os.path.join(self.folder, "*.bin")):
+            try:
+                img = open(path, "rb").read()
+                found[mkdelta.image_hash(img, path).hex()] = (path, img)
+            except (OSError, SystemExit):
+                continue                    # bootloader.bin, partitions.bin, ...
+        return found
+
+    def target(self, found):
+        if self.target_path:
+            img = open(self.target_path, "rb").read()
+            return mkdelta.image_hash(img, self.target_path).hex(), (self.target_path, img)
+        if not found:
+            return None, None
+        sha = max(found, key=lambda s: os.path.getmtime(found[s][0]))
+        return sha, found[sha]
+
+    def update_for(self, base_sha):
+        found = self.scan()
+        tsha, entry = self.target(found)
+        if tsha is None:
+            return 404, None, "no images"
+        tpath, timg = entry
+        if base_sha == tsha:
+            return 204, None, "up to date (%s)" % os.path.basename(tpath)
+        base = found.get(base_sha)
+        key = (base_sha if base else "full", tsha)
+        if key not in self.cache:
+            self.cache[key] = mkdelta.make(base[1] if base else None, timg)
+        what = ("delta from %s" % os.path.basename(base[0])) if base else "full image"
+        return 200, self.cache[key], "%s -> %s" % (what, os.path.basename(tpath))
+
+
+def handler(images):
+    class H(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            url = urllib.parse.urlparse(self.path)
+            if url.path != "/update":
+                self.send_error(404)
+                return
+            base = urllib.parse.parse_qs(url.query).get("from", [""])[0].lower()
+            code, body, note = images.update_for(base)
+            self.log_message("%s: %s%s", self.client_address[0], note,
+                             " (%d bytes)" % len(body) if body else "")
+            self.send_response(code)
+            if body:
+                self.send_header("Content-Type", "application/octet-stream")
+                self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            if body:
+                self.wfile.write(body)
+    return H
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Serve TRAKKR firmware updates")
+    ap.add_argument("folder")
+    ap.add_argument("--port", type=int, default=8070)
+    ap.add_argument("--target", help="image to serve (default: newest .bin in folder)")
+    args = ap.parse_args()
+    srv = http.server.ThreadingHTTPServer(("", args.port), handler(Images(args.folder, args.target)))
+    print("[OTA] serving %s on :%d" % (args.folder, args.port))
+    srv.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
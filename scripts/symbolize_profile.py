@@ -0,0 +1,139 @@
+# [TRAKKR] Symbolise /api/profile?collapsed=1 against the firmware ELF.
+#
+# Input lines are "task;0x4200abcd;...;0x40378123 count" (root first, raw
+# addresses); output is the same with function names, ready for
+# flamegraph.pl or speedscope. A hot-function report (self and inclusive
+# samples, per task totals) goes to stderr.
+#
+#   python scripts/symbolize_profile.py .pio/build/esp32-s3/firmware.elf \
+#       http://trakkr.local/api/profile?collapsed=1 > prof.folded
+#   flamegraph.pl prof.folded > prof.svg
+#
+# The input may also be a file or "-" (stdin). The ELF must be the one that
+# is running, or the names are wrong. addr2line comes from --addr2line, the
+# PATH, or PlatformIO's toolchain-xtensa-esp32s3 package.
+
+import argparse
+import collections
+import glob
+import os
+import shutil
+import subprocess
+import sys
+import urllib.request
+
+ADDR2LINE = "xtensa-esp32s3-elf-addr2line"
+
+
+def find_addr2line(explicit):
+    if explicit:
+        return explicit
+    found = shutil.which(ADDR2LINE)
+    if found:
+        return found
+    pio = os.path.expanduser("~/.platformio/packages/toolchain-xtensa-esp32s3/bin/" + ADDR2LINE)
+    hits = glob.glob(pio) + glob.glob(pio + ".exe")
+    if hits:
+        return hits[0]
+    raise SystemExit("[PROF] %s not found; pass --addr2line" % ADDR2LINE)
+
+
+def read_input(src):
+    if src == "-":
+        return sys.stdin.read()
+    if src.startswith("http://") or src.startswith("https://"):
+        with urllib.request.urlopen(src, timeout=30) as r:
+            return r.read().decode("utf-8", "replace")
+    with open(src, "r") as f:
+        return f.read()
+
+
+def parse(text):
+    stacks = []
+    for line in text.splitlines():
+        line = line.strip()
+        if not line:
+            continue
+        frames, _, count = line.rpartition(" ")
+        try:
+            stacks.append((frames.split(";"), int(count)))
+        except ValueError:
+            continue
+    return stacks
+
+
+def symbolize(tool, elf, addrs, with_lines):
+    """One addr2line run for every address: {"0x4200abcd": "name"}."""
+    if not addrs:
+        return {}
+    out = subprocess.run([tool, "-a", "-f", "-C", "-e", elf], input="\n".join(addrs) + "\n",
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    names = {}
+    # -a: address line, then function, then file:line, per input address
+    for i in range(0, len(out) - 2, 3):
+        addr = "0x%08x" % int(out[i], 16)
+        func, where = out[i + 1], out[i + 2]
+        if func == "??":
+            names[addr] = addr
+            continue
+        if with_lines and not where.startswith("??"):
+            func += " (%s)" % os.path.basename(where.split(" ")[0])
+        names[addr] = func
+    return names
+
+
+def report(stacks, top):
+    self_n, incl_n, task_n = collections.Counter(), collections.Counter(), collections.Counter()
+    total = 0
+    for frames, n in stacks:
+        total += n
+        task_n[frames[0]] += n
+        funcs = [f for f in frames[1:] if f != "[deeper]"]
+        if funcs:
+            self_n[funcs[-1]] += n
+        for f in set(funcs):
+            incl_n[f] += n
+    if not total:
+        return
+    err = sys.stderr
+    err.write("[PROF] %d samples\n\n%-7s %s\n" % (total, "share", "task"))
+    for task, n in task_n.most_common():
+        err.write("%6.1f%% %s\n" % (100.0 * n / total, task))
+    err.write("\n%-7s %-7s %s\n" % ("self", "total", "function"))
+    for f, n in self_n.most_common(top):
+        err.write("%6.1f%% %6.1f%% %s\n" % (100.0 * n / total, 100.0 * incl_n[f] / total, f))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Symbolise TRAKKR collapsed profile stacks")
+    ap.add_argument("elf")
+    ap.add_argument("input", help="file, URL or - for stdin")
+    ap.add_argument("-o", "--output", help="write folded stacks here instead of stdout")
+    ap.add_argument("--addr2line")
+    ap.add_argument("--lines", action="store_true", help="append the source file to names")
+    ap.add_argument("--top", type=int, default=25, help="functions in the report")
+    args = ap.parse_args()
+
+    stacks = parse(read_input(args.input))
+    addrs = sorted({f for frames, _ in stacks for f in frames[1:] if f.startswith("0x")})
+    names = symbolize(find_addr2line(args.addr2line), args.elf, addrs, args.lines)
+
+    # Identical stacks after symbolising (inlined callers, same function) merge
+    folded = collections.OrderedDict()
+    named = []
+    for frames, n in stacks:
+        sym = [frames[0]] + [names.get(f, f) for f in frames[1:]]
+        named.append((sym, n))
+        key = ";".join(s.replace(";", ":") for s in sym)
+        folded[key] = folded.get(key, 0) + n
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    for key, n in folded.items():
+        out.write("%s %d\n" % (key, n))
+    if args.output:
+        out.close()
+    report(named, args.top)
+
+
+if __name__ == "__main__":
+    main()
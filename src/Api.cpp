@@ -3,9 +3,29 @@
 #include <limits.h>   
 #include <ctype.h>    
 #include "HttpServer.h"   
+#include "Bench.h"
+#include "Soak.h"
+#include "BenchFixtures.h"
+#include "Rail.h"
+#include "Trace.h"
+#include "Quota.h"
+#include "Mqtt.h"
+#include "Peer.h"
+#include "Tls.h"
+#include "TimeSvc.h"
+#include "Pixel.h"
+#include "RowAnim.h"
+#include "Marquee.h"
+#include "History.h"
+#include "Timetable.h"
+#include "Icons.h"
+#include "HeapTrace.h"
+#include "Profile.h"
+#include "Ota.h"
+#include "Supervisor.h"
 
 
-static String jsonEscape(const char* s){
+String jsonEscape(const char* s){
   String o; if (!s) return "\"\"";
   o.reserve(strlen(s) + 4);
   o += '"';
@@ -15,6 +35,7 @@ static String jsonEscape(const char* s){
     else if (c=='\n') o+="\\n";
     else if (c=='\r') o+="\\r";
     else if (c=='\t') o+="\\t";
+    else if ((uint8_t)c < 0x20){ char u[8]; snprintf(u, sizeof(u), "\\u%04x", (unsigned)c); o+=u; }
     else o+=c;
   }
   o += '"';
@@ -48,6 +69,7 @@ static int getJsonBool(const String& body, const char* key){
 }
 
 static String buildSettingsJSON(){
+  HeapTrace::Scope hs("api.json");
   const auto& s = Cfg::get();
   String j; j.reserve(512);
   j += '{';
@@ -65,18 +87,59 @@ static String buildSettingsJSON(){
   j += "\"ssEnd\":"        + jsonEscape(Cfg::ssEnd())   + ',';
   j += "\"line\":"         + jsonEscape(Cfg::tubeLine())+ ',';
   j += "\"direction\":"    + jsonEscape(Cfg::tubeDir())+ ',';
+  j += "\"boardRows\":"    + String((int)Cfg::boardRows()) + ',';
+  j += "\"pageSecs\":"     + String((int)Cfg::pageSecs()) + ',';
+  j += "\"clockStyle\":"   + String((int)Cfg::clockStyle()) + ',';
+  j += "\"animMs\":"       + String((int)Cfg::animMs()) + ',';
+  j += "\"quotaLimit\":"   + String(Cfg::quotaLimit()) + ',';
+  j += "\"quotaDays\":"    + String((int)Cfg::quotaDays()) + ',';
+  j += "\"fleetSize\":"    + String((int)Cfg::fleetSize()) + ',';
+  j += "\"mqttHost\":"     + jsonEscape(Cfg::mqttHost()) + ',';
+  j += "\"mqttPort\":"     + String((int)Cfg::mqttPort()) + ',';
+  j += "\"mqttTopic\":"    + jsonEscape(Cfg::mqttTopic()) + ',';
+  j += "\"peerShare\":"    + String(Cfg::peerShare()? "true":"false") + ',';
+  j += "\"otaUrl\":"       + jsonEscape(Cfg::otaUrl()) + ',';
   // optional: expose wifi ssid (not pass)
   j += "\"wifi\":{\"ssid\":" + jsonEscape(Cfg::wifiSsid()) + "}";
   j += '}';
   return j;
 }
 
-static bool applySettingsFromJSON(const String& body){
+// [TRAKKR] quotaLimit / quotaDays / fleetSize (shared by /api/settings and /api/quota)
+static bool applyQuotaFromJSON(const String& body){
+  long lim = getJsonInt(body,"quotaLimit"), days = getJsonInt(body,"quotaDays"), fleet = getJsonInt(body,"fleetSize");
+  if (lim==LONG_MIN && days==LONG_MIN && fleet==LONG_MIN) return true;
+  return Cfg::setQuota(lim   != LONG_MIN ? (uint32_t)max(0L, lim)              : Cfg::quotaLimit(),
+                       days  != LONG_MIN ? (uint8_t)constrain(days, 1L, 31L)   : Cfg::quotaDays(),
+                       fleet != LONG_MIN ? (uint8_t)constrain(fleet, 1L, 255L) : Cfg::fleetSize());
+}
+
+// [TRAKKR] mqttHost / mqttPort / mqttTopic; the publisher picks changes up live
+static bool applyMqttFromJSON(const String& body){
+  const bool hasHost = findKey(body,"mqttHost")>=0, hasTopic = findKey(body,"mqttTopic")>=0;
+  long port = getJsonInt(body,"mqttPort");
+  if (!hasHost && !hasTopic && port==LONG_MIN) return true;
+  String host  = hasHost  ? getJsonString(body,"mqttHost")  : String(Cfg::mqttHost());
+  String topic = hasTopic ? getJsonString(body,"mqttTopic") : String(Cfg::mqttTopic());
+  return Cfg::setMqtt(host.c_str(), port != LONG_MIN ? (uint16_t)constrain(port, 1L, 65535L) : Cfg::mqttPort(), topic.c_str());
+}
+
+// [TRAKKR] needReboot: set when a change can't be applied live (data source, peer sharing);
+// wifiChanged: new credentials, applied by restarting Wi-Fi alone
+static bool applySettingsFromJSON(const String& body, bool& needReboot, bool& wifiChanged){
+  HeapTrace::Scope hs("api.json");
   bool ok = true;
   String v;
+  needReboot = false;
+  wifiChanged = false;
 
   // source, station, mode
-  v = getJsonString(body,"source");       if (v.length()) ok &= Cfg::setSource(v.c_str());
+  v = getJsonString(body,"source");
+  if (v.length()){                        // compare after setSource() has normalised it
+    const String was = Cfg::source();
+    ok &= Cfg::setSource(v.c_str());
+    needReboot |= (was != Cfg::source());
+  }
   v = getJsonString(body,"station");      if (v.length()==3) ok &= Cfg::setCRS(v.c_str());
   v = getJsonString(body,"nrBoardType");  if (v.length()) ok &= Cfg::setMode(v.c_str());
 
@@ -90,11 +153,18 @@ static bool applySettingsFromJSON(const String& body){
   b = getJsonBool(body,"showDate");       if (b!=-1) ok &= Cfg::setShowDate(!!b);
   b = getJsonBool(body,"includeWeather"); if (b!=-1) ok &= Cfg::setIncludeWeather(!!b);
   b = getJsonBool(body,"autoUpdate");     if (b!=-1) ok &= Cfg::setAutoUpdate(!!b);
+  b = getJsonBool(body,"peerShare");      if (b!=-1){ needReboot |= (!!b != Cfg::peerShare()); ok &= Cfg::setPeerShare(!!b); }
 
   // numbers
   long n;
   n = getJsonInt(body,"updateEvery");     if (n!=LONG_MIN) ok &= Cfg::setUpdateEvery((uint16_t)n);
   n = getJsonInt(body,"tickerMs");        if (n!=LONG_MIN) ok &= Cfg::setTickerMs((uint32_t)n);
+  n = getJsonInt(body,"boardRows");       if (n!=LONG_MIN) ok &= Cfg::setBoardRows((uint8_t)constrain(n, 1L, 150L));
+  n = getJsonInt(body,"pageSecs");        if (n!=LONG_MIN) ok &= Cfg::setPageSecs((uint8_t)constrain(n, 0L, 255L));
+  n = getJsonInt(body,"clockStyle");      if (n!=LONG_MIN) ok &= n >= 0 && Cfg::setClockStyle((uint8_t)n);
+  n = getJsonInt(body,"animMs");          if (n!=LONG_MIN) ok &= n >= 0 && n <= 65535 && Cfg::setAnimMs((uint16_t)n);
+  ok &= applyQuotaFromJSON(body);
+  ok &= applyMqttFromJSON(body);
 
   // screensaver
   String s1 = getJsonString(body,"ssStart");
@@ -105,15 +175,47 @@ static bool applySettingsFromJSON(const String& body){
   v = getJsonString(body,"line");         if (v.length() || findKey(body,"line")>=0) ok &= Cfg::setTubeLine(v.c_str());
   v = getJsonString(body,"direction");    if (v.length() || findKey(body,"direction")>=0) ok &= Cfg::setTubeDir(v.c_str());
 
+  // firmware updates
+  v = getJsonString(body,"otaUrl");       if (v.length() || findKey(body,"otaUrl")>=0) ok &= Cfg::setOtaUrl(v.c_str());
+
   // Optional nested wifi { wifi: { ssid, pass } }
   if (findKey(body,"wifi")>=0){
     String ssid = getJsonString(body,"ssid");
     String pass = getJsonString(body,"pass");
-    if (ssid.length()) ok &= Cfg::setWifi(ssid.c_str(), pass.c_str());
+    if (ssid.length()){ ok &= Cfg::setWifi(ssid.c_str(), pass.c_str()); wifiChanged = true; }
   }
   return ok;
 }
 
+// [TRAKKR] /api/bench case: pull every settings key out of a canned body (nothing applied)
+static String gBenchJson;
+static bool benchJsonBegin(void*){ gBenchJson = BENCH_SETTINGS_JSON; return gBenchJson.length() > 0; }
+static void benchJsonEnd(void*){ gBenchJson = String(); }
+static void benchParseJson(void*){
+  static const char* const strKeys[]  = { "source","station","nrBoardType","callingAt","ssStart","ssEnd","line","direction","ssid","pass" };
+  static const char* const boolKeys[] = { "includeBus","includePass","showDate","includeWeather","autoUpdate" };
+  static const char* const intKeys[]  = { "updateEvery","tickerMs" };
+  for (const char* k : strKeys)  getJsonString(gBenchJson, k);
+  for (const char* k : boolKeys) getJsonBool(gBenchJson, k);
+  for (const char* k : intKeys)  getJsonInt(gBenchJson, k);
+}
+
+// [TRAKKR] /api/soak step: one random read-side API call, as a browser or
+// poller would make it (nothing is applied, so NVS is left alone).
+static void soakApiCall(void*){
+  String out;
+  switch (Soak::rand() % 8){
+    case 0: out = buildSettingsJSON(); break;
+    case 1: benchJsonBegin(nullptr); benchParseJson(nullptr); benchJsonEnd(nullptr); break;
+    case 2: out = Rail::fetchStatsJSON(); break;
+    case 3: out = Quota::statsJSON(); break;
+    case 4: out = Mqtt::statsJSON(); break;
+    case 5: out = Peer::statsJSON(); break;
+    case 6: out = Tls::statsJSON(); break;
+    default: out = TimeSvc::statsJSON(); break;
+  }
+}
+
 static String buildTokenJSON(const char* token){
   String j("{\"token\":"); j += jsonEscape(token); j += '}';
   return j;
@@ -122,21 +224,246 @@ static String buildTokenJSON(const char* token){
 // =================== Arduino WebServer =============================
 #if __has_include(<WebServer.h>)
 #include <WebServer.h>
+static uint32_t gOtaUpload = 0;                 // /api/ota: this upload's Ota session (0 = none)
+
 static void attachCommon(WebServer& srv){
   // Settings
   srv.on("/api/settings", HTTP_GET, [&](){
     srv.send(200, "application/json", buildSettingsJSON());
   });
   srv.on("/api/settings", HTTP_POST, [&](){
-    bool ok = applySettingsFromJSON(srv.arg("plain"));
+    bool needReboot = false, wifiChanged = false;
+    bool ok = applySettingsFromJSON(srv.arg("plain"), needReboot, wifiChanged);
+    Mqtt::configure();                           // the publisher works from its own copy
+    Rail::configure();                           // ...and so do Darwin fetches
+    Peer::configure();                           // ...and the peer group key
+    Supervisor::configure();                     // ...and the Wi-Fi reconnect
 
     // Respond first so the browser sees "saved"
     String body = ok ? buildSettingsJSON() : String("{\"err\":\"bad json\"}");
     int code = ok ? 200 : 400;
     srv.send(code, "application/json", body);
 
-    // Then schedule a soft reboot shortly after
-    if (ok) scheduleReboot(1200);
+    // Board settings are read per fetch: refetch now. New Wi-Fi credentials
+    // restart Wi-Fi alone (the board stays up); source/peer sharing still reboot.
+    if (ok && needReboot) scheduleReboot(1200);
+    else if (ok){
+      if (wifiChanged && !Supervisor::restart(Supervisor::P_WIFI, "settings")) scheduleReboot(1200);
+      Rail::requestRefresh(Rail::TRIG_SETTINGS);
+    }
+  });
+
+  // Refresh: POST /api/refresh?wait=<ms> joins (or starts) a board fetch; GET = counters only
+  srv.on("/api/refresh", HTTP_GET, [&](){
+    srv.send(200, "application/json", Rail::fetchStatsJSON());
+  });
+  srv.on("/api/refresh", HTTP_POST, [&](){
+    uint32_t ticket = Rail::requestRefresh(Rail::TRIG_API);
+    long wait = srv.hasArg("wait") ? constrain(srv.arg("wait").toInt(), 0L, 15000L) : 0;
+    bool done = wait ? Rail::waitFor(ticket, (uint32_t)wait) : (Rail::publishedGen() >= ticket);
+    String j("{\"ticket\":"); j += String(ticket);
+    j += ",\"published\":"; j += done ? "true" : "false";
+    if (done){ j += ",\"ok\":"; j += Rail::lastFetchOk() ? "true" : "false"; }
+    j += ",\"stats\":"; j += Rail::fetchStatsJSON(); j += '}';
+    srv.send(done ? 200 : 202, "application/json", j);
+  });
+
+  // Benchmarks: GET lists the cases; POST ?case=<prefix>&n=<iters>&host=<tls host>
+  // runs them (cases write NVS and LittleFS; host is for this run only)
+  srv.on("/api/bench", HTTP_GET, [&](){
+    srv.send(200, "application/json", Bench::listJSON());
+  });
+  srv.on("/api/bench", HTTP_POST, [&](){
+    long n = srv.hasArg("n") ? srv.arg("n").toInt() : 0;
+    String body = Bench::runJSON(srv.arg("case").c_str(), (uint16_t)(n > 0 ? n : 0),
+                                 srv.hasArg("host") ? srv.arg("host").c_str() : nullptr);
+    srv.send(200, "application/json", body);
+  });
+
+  // MQTT publisher state (settings go through /api/settings)
+  srv.on("/api/mqtt", HTTP_GET, [&](){
+    srv.send(200, "application/json", Mqtt::statsJSON());
+  });
+
+  // Peer sharing: role, leader and snapshot counters (enable via /api/settings peerShare)
+  srv.on("/api/peer", HTTP_GET, [&](){
+    srv.send(200, "application/json", Peer::statsJSON());
+  });
+
+  // TLS: GET = mode, handshake times per mode, pins / chain seen per host.
+  // POST {"mode":"insecure|pin|anchor"} and/or {"host":"..","pins":"b64,b64"}
+  // ("" clears), or ?pinObserved=<host> to pin the chain that host served last.
+  srv.on("/api/tls", HTTP_GET, [&](){
+    srv.send(200, "application/json", Tls::statsJSON());
+  });
+  srv.on("/api/tls", HTTP_POST, [&](){
+    const String body = srv.arg("plain");
+    bool ok = true;
+    String m = getJsonString(body, "mode");
+    if (m.length()){
+      int mi = -1;
+      for (int i = 0; i < Tls::MODE_COUNT; ++i) if (m == Tls::modeName((Tls::Mode)i)) mi = i;
+      ok &= mi >= 0 && Cfg::setTlsMode((uint8_t)mi);
+    }
+    String host = getJsonString(body, "host");
+    if (host.length() && findKey(body, "pins") >= 0) ok &= Tls::setPins(host.c_str(), getJsonString(body, "pins"));
+    if (srv.hasArg("pinObserved")) ok &= Tls::pinObserved(srv.arg("pinObserved").c_str());
+    srv.send(ok ? 200 : 400, "application/json", ok ? Tls::statsJSON() : String("{\"err\":\"bad request\"}"));
+  });
+
+  // Clock: current source (rtc/http/sntp), estimated error, steps vs slews
+  srv.on("/api/time", HTTP_GET, [&](){
+    srv.send(200, "application/json", TimeSvc::statsJSON());
+  });
+
+  // Pixel kernels: which ones run on PIE vectors (and which failed the boot self-check)
+  srv.on("/api/pixel", HTTP_GET, [&](){
+    srv.send(200, "application/json", Pixel::statsJSON());
+  });
+
+  // Board transitions: runs, frames pushed, fallbacks to a plain repaint, worst step
+  srv.on("/api/anim", HTTP_GET, [&](){
+    srv.send(200, "application/json", RowAnim::statsJSON());
+  });
+
+  // Marquees: cells scrolling now, strips built / skipped (memory), frames that ran out of budget
+  srv.on("/api/marquee", HTTP_GET, [&](){
+    srv.send(200, "application/json", Marquee::statsJSON());
+  });
+
+  // Icons: operator logo cache (slots, hits, decodes, evictions, codes with no icon)
+  srv.on("/api/icons", HTTP_GET, [&](){
+    srv.send(200, "application/json", Icons::statsJSON());
+  });
+
+  // History: GET [?time=HH:MM[&dest=prefix]][&recent=N] = punctuality (overall, by
+  // hour, or one scheduled time) + newest records; POST ?clear=1 wipes it.
+  srv.on("/api/history", HTTP_GET, [&](){
+    const String r = History::queryJSON(srv.arg("time").c_str(), srv.arg("dest").c_str(),
+                                        (uint16_t)constrain(srv.arg("recent").toInt(), 0L, 50L));
+    srv.send(r.startsWith("{\"err") ? 400 : 200, "application/json", r);
+  });
+  srv.on("/api/history", HTTP_POST, [&](){
+    if (!srv.hasArg("clear")){ srv.send(400, "application/json", "{\"err\":\"clear=1 to wipe\"}"); return; }
+    History::clear();
+    srv.send(200, "application/json", History::queryJSON("", "", 0));
+  });
+
+  // Timetable: look-ahead cache the board is projected from while Darwin is down
+  srv.on("/api/timetable", HTTP_GET, [&](){
+    srv.send(200, "application/json", Timetable::statsJSON());
+  });
+
+  // Health: GET = supervisor view (per part: ok, failures, restarts, recoveries and
+  // their durations; last boot reason). POST ?restart=wifi|tls|http restarts one part now.
+  srv.on("/api/health", HTTP_GET, [&](){
+    srv.send(200, "application/json", Supervisor::healthJSON());
+  });
+  srv.on("/api/health", HTTP_POST, [&](){
+    const int p = Supervisor::partByName(srv.arg("restart").c_str());
+    if (p < 0){ srv.send(400, "application/json", "{\"err\":\"restart=wifi|tls|http\"}"); return; }
+    if (!Supervisor::restart((Supervisor::Part)p, "api")){ srv.send(409, "application/json", "{\"err\":\"only wifi, tls and http restart on request\"}"); return; }
+    srv.send(202, "application/json", Supervisor::healthJSON());
+  });
+
+  // Soak: POST ?hours=N&seed=S[&step=prefix] starts a run (?stop=1 ends it);
+  // GET = progress, then the verdict (pass, failures, heap trend, per-step latency).
+  srv.on("/api/soak", HTTP_GET, [&](){
+    srv.send(200, "application/json", Soak::reportJSON());
+  });
+  srv.on("/api/soak", HTTP_POST, [&](){
+    if (srv.hasArg("stop")){ Soak::stop(); srv.send(200, "application/json", Soak::reportJSON()); return; }
+    const long hours = srv.hasArg("hours") ? srv.arg("hours").toInt() : 24;
+    const uint32_t seed = srv.hasArg("seed") ? (uint32_t)strtoul(srv.arg("seed").c_str(), nullptr, 10) : esp_random();
+    const bool ok = hours > 0 && Soak::start((uint32_t)hours, seed, srv.arg("step").c_str());
+    srv.send(ok ? 202 : 409, "application/json", ok ? Soak::reportJSON() : String("{\"err\":\"already running or bad hours\"}"));
+  });
+
+  // Quota: GET = spend for the current token; POST {quotaLimit,quotaDays,fleetSize} / ?reset=1
+  srv.on("/api/quota", HTTP_GET, [&](){
+    srv.send(200, "application/json", Quota::statsJSON());
+  });
+  srv.on("/api/quota", HTTP_POST, [&](){
+    bool ok = applyQuotaFromJSON(srv.arg("plain"));
+    if (srv.arg("reset") == "1") Quota::resetPeriod();
+    srv.send(ok ? 200 : 400, "application/json", ok ? Quota::statsJSON() : String("{\"err\":\"bad json\"}"));
+  });
+
+  // Heap: GET /api/heap = per-tag live bytes / counts / size histogram; ?on=0|1 switches
+  // tracing (on clears), ?mark=1 starts a leak window, ?diff=1 = what grew since the mark
+  srv.on("/api/heap", HTTP_GET, [&](){
+    if (srv.hasArg("on"))   HeapTrace::setEnabled(srv.arg("on") != "0");
+    if (srv.hasArg("mark")) HeapTrace::mark();
+    String r;
+    { HeapTrace::Scope hs("api.json"); r = srv.hasArg("diff") ? HeapTrace::diffJSON() : HeapTrace::statsJSON(); }
+    srv.send(r.startsWith("{\"err") ? 409 : 200, "application/json", r);
+  });
+
+  // Firmware: POST /api/ota with a .trkd upload (multipart, any field name) flashes the
+  // idle slot as it arrives and reboots into it; GET = state of the last update.
+  // POST /api/firmware/check[?url=] pulls from the update server (default: otaUrl)
+  srv.on("/api/ota", HTTP_GET, [&](){
+    srv.send(200, "application/json", Ota::statusJSON());
+  });
+  srv.on("/api/ota", HTTP_POST, [&](){
+    const bool opened = gOtaUpload != 0;
+    gOtaUpload = 0;
+    if (!opened){ srv.send(409, "application/json", "{\"err\":\"update in progress\"}"); return; }
+    const String r = Ota::statusJSON();
+    const bool ready = r.startsWith("{\"state\":\"ready\"");
+    srv.send(ready ? 200 : 400, "application/json", r);
+    if (ready) scheduleReboot(1500);
+  }, [&](){
+    HTTPUpload& up = srv.upload();
+    Supervisor::beat(Supervisor::P_LOOP);       // one upload holds the loop for its whole length
+    if (up.status == UPLOAD_FILE_START){ gOtaUpload = Ota::open(); return; }
+    if (!gOtaUpload) return;                    // a pull (or another upload) has the slot
+    if      (up.status == UPLOAD_FILE_WRITE)   Ota::write(gOtaUpload, up.buf, up.currentSize);
+    else if (up.status == UPLOAD_FILE_END)     Ota::finish(gOtaUpload);
+    else if (up.status == UPLOAD_FILE_ABORTED){ Ota::abort(gOtaUpload, "upload aborted"); gOtaUpload = 0; }
+  });
+  srv.on("/api/firmware/check", HTTP_POST, [&](){
+    const String url = srv.hasArg("url") ? srv.arg("url") : String(Cfg::otaUrl());
+    if (!url.length()){ srv.send(400, "application/json", "{\"err\":\"no otaUrl set\"}"); return; }
+    if (!Ota::check(url.c_str())){ srv.send(409, "application/json", "{\"err\":\"update in progress\"}"); return; }
+    srv.send(202, "application/json", Ota::statusJSON());
+  });
+
+  // Profile: POST ?hz=N&ms=M starts a sampling run (?stop=1 ends it); GET = per-task
+  // CPU share, ?collapsed=1 = raw stacks for scripts/symbolize_profile.py
+  srv.on("/api/profile", HTTP_GET, [&](){
+    if (!srv.hasArg("collapsed")){ srv.send(200, "application/json", Profile::statsJSON()); return; }
+    srv.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    srv.send(200, "text/plain", "");
+    Profile::writeCollapsed([](const String& chunk, void* ctx){ ((WebServer*)ctx)->sendContent(chunk); }, &srv);
+    srv.sendContent("");
+  });
+  srv.on("/api/profile", HTTP_POST, [&](){
+    if (srv.hasArg("stop")){ Profile::stop(); srv.send(200, "application/json", Profile::statsJSON()); return; }
+    const long hz = srv.hasArg("hz") ? constrain(srv.arg("hz").toInt(), 10L, 2000L) : 250;
+    const long ms = srv.hasArg("ms") ? constrain(srv.arg("ms").toInt(), 100L, 120000L) : 10000;
+    if (!Profile::start((uint16_t)hz, (uint32_t)ms)){
+      srv.send(409, "application/json", "{\"err\":\"already running or no memory\"}");
+      return;
+    }
+    srv.send(202, "application/json", Profile::statsJSON());
+  });
+
+  // Trace: GET /api/trace (Chrome trace-event JSON); ?on=0|1, ?clear=1 control the recorder
+  srv.on("/api/trace", HTTP_GET, [&](){
+    if (srv.hasArg("on") || srv.hasArg("clear")){
+      if (srv.hasArg("on"))    Trace::setEnabled(srv.arg("on") != "0");
+      if (srv.hasArg("clear")) Trace::clear();
+      String j("{\"enabled\":"); j += Trace::enabled() ? "true" : "false";
+      j += ",\"held\":"; j += String(Trace::held()); j += '}';
+      srv.send(200, "application/json", j);
+      return;
+    }
+    srv.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    srv.sendHeader("Content-Disposition", "attachment; filename=trakkr-trace.json");
+    srv.send(200, "application/json", "");
+    Trace::writeJSON([](const String& chunk, void* ctx){ ((WebServer*)ctx)->sendContent(chunk); }, &srv);
+    srv.sendContent("");
   });
 
   // Version (lightweight)
@@ -156,10 +483,12 @@ static void attachCommon(WebServer& srv){
     int q1 = body.indexOf('"', c+1), q2 = body.indexOf('"', q1+1);
     String tok = (k<0||c<0||q1<0||q2<0) ? String() : body.substring(q1+1,q2);
     bool ok = Cfg::setDarwinToken(tok.c_str());
+    Rail::configure();
     srv.send(ok?200:400, "application/json", ok? buildTokenJSON(Cfg::darwinToken()) : "{\"err\":\"bad json\"}");
   });
   srv.on("/api/rail/token", HTTP_DELETE, [&](){
     Cfg::setDarwinToken("");
+    Rail::configure();
     srv.send(200, "application/json", buildTokenJSON(Cfg::darwinToken()));
   });
 
@@ -202,14 +531,17 @@ static void attachCommon(WebServer& srv){
   srv.on("/api/token", HTTP_GET,  [&](){ srv.send(200,"application/json", buildTokenJSON(Cfg::darwinToken())); });
   srv.on("/api/token", HTTP_POST, [&](){ String b=srv.arg("plain"); int k=b.indexOf("\"token\""); int c=b.indexOf(':',k);
     int q1=b.indexOf('"',c+1), q2=b.indexOf('"',q1+1); String t=(k<0||c<0||q1<0||q2<0)?String():b.substring(q1+1,q2);
-    bool ok=Cfg::setDarwinToken(t.c_str()); srv.send(ok?200:400,"application/json", ok? buildTokenJSON(Cfg::darwinToken()):"{\"err\":\"bad json\"}"); });
+    bool ok=Cfg::setDarwinToken(t.c_str()); Rail::configure(); srv.send(ok?200:400,"application/json", ok? buildTokenJSON(Cfg::darwinToken()):"{\"err\":\"bad json\"}"); });
 
   // Stubs (so pages don't error)
-  srv.on("/api/firmware/check", HTTP_POST, [&](){ srv.send(200,"application/json","{\"status\":\"noop\"}"); });
-  srv.on("/api/reset-wifi",     HTTP_POST, [&](){ srv.send(200,"application/json","{\"status\":\"queued\"}"); });
-  srv.on("/api/factory-reset",  HTTP_POST, [&](){ Cfg::resetToDefaults(); srv.send(200,"application/json","{\"status\":\"ok\"}"); });
+  srv.on("/api/reset-wifi",     HTTP_POST, [&](){ Supervisor::restart(Supervisor::P_WIFI, "api"); srv.send(200,"application/json","{\"status\":\"queued\"}"); });
+  srv.on("/api/factory-reset",  HTTP_POST, [&](){ Cfg::resetToDefaults(); Mqtt::configure(); Rail::configure(); Peer::configure(); Supervisor::configure(); srv.send(200,"application/json","{\"status\":\"ok\"}"); });
 
 }
-void Api_attach(WebServer& srv){ attachCommon(srv); }
+void Api_attach(WebServer& srv){
+  attachCommon(srv);
+  Bench::add({ "parse.json", &benchParseJson, nullptr, 50, (uint32_t)strlen_P(BENCH_SETTINGS_JSON), &benchJsonBegin, &benchJsonEnd });
+  Soak::add({ "api.read", &soakApiCall, nullptr, 30, nullptr, nullptr });
+}
 #endif
 
@@ -0,0 +1,99 @@
+#include "Assets.h"
+#include <esp_partition.h>
+
+namespace {
+  constexpr uint32_t MAGIC   = 0x414B5254;   // "TRKA"
+  constexpr uint16_t VERSION = 1;
+  constexpr esp_partition_subtype_t SUBTYPE = (esp_partition_subtype_t)0x40;
+
+  struct Header {
+    uint32_t magic;
+    uint16_t version, count;
+    uint32_t dirOff, total, fnv;
+    uint32_t reserved[3];
+  };
+  struct Dir {
+    uint32_t pathHash, pathOff, ctypeOff, dataOff, size, etag;
+    uint16_t flags, pathLen;
+  };
+  static_assert(sizeof(Header) == 32 && sizeof(Dir) == 28, "bundle layout");
+
+  const uint8_t*          gBase = nullptr;
+  const Header*           gHdr  = nullptr;
+  const Dir*              gDir  = nullptr;
+  spi_flash_mmap_handle_t gMap  = 0;
+
+  uint32_t fnv1a(const uint8_t* d, size_t n, uint32_t h = 2166136261u){
+    for (size_t i = 0; i < n; ++i){ h ^= d[i]; h *= 16777619u; }
+    return h;
+  }
+  uint32_t fnv1a(const char* s){
+    uint32_t h = 2166136261u;
+    while (*s){ h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+  }
+
+  bool mapRange(const esp_partition_t* p, size_t len){
+    if (gMap){ spi_flash_munmap(gMap); gMap = 0; gBase = nullptr; }
+    const void* ptr = nullptr;
+    if (esp_partition_mmap(p, 0, len, SPI_FLASH_MMAP_DATA, &ptr, &gMap) != ESP_OK) return false;
+    gBase = (const uint8_t*)ptr;
+    return true;
+  }
+}
+
+bool Assets::begin(){
+  if (gHdr) return true;
+  const esp_partition_t* p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SUBTYPE, "assets");
+  if (!p){ Serial.println("[ASSETS] no assets partition; using LittleFS"); return false; }
+
+  // Map the header first; the bundle is usually far smaller than the partition.
+  Header h;
+  if (esp_partition_read(p, 0, &h, sizeof(h)) != ESP_OK || h.magic != MAGIC || h.version != VERSION ||
+      h.total < sizeof(Header) || h.total > p->size ||
+      h.dirOff + (uint32_t)h.count * sizeof(Dir) > h.total){
+    Serial.println("[ASSETS] partition empty or stale; run `pio run -t uploadassets`");
+    return false;
+  }
+  if (!mapRange(p, h.total)){ Serial.println("[ASSETS][ERR] mmap failed"); return false; }
+
+  if (fnv1a(gBase + sizeof(Header), h.total - sizeof(Header)) != h.fnv){
+    Serial.println("[ASSETS][ERR] checksum mismatch; ignoring bundle");
+    spi_flash_munmap(gMap); gMap = 0; gBase = nullptr;
+    return false;
+  }
+  gHdr = (const Header*)gBase;
+  gDir = (const Dir*)(gBase + h.dirOff);
+  Serial.printf("[ASSETS] %u files, %u bytes mapped (bundle %08x)\n",
+                (unsigned)h.count, (unsigned)h.total, (unsigned)h.fnv);
+  return true;
+}
+
+bool     Assets::ready(){ return gHdr != nullptr; }
+uint16_t Assets::count(){ return gHdr ? gHdr->count : 0; }
+uint32_t Assets::bundleHash(){ return gHdr ? gHdr->fnv : 0; }
+
+bool Assets::find(const char* path, Entry& out){
+  if (!gHdr || !path) return false;
+  const uint32_t want = fnv1a(path);
+
+  // Lower bound on hash, then walk the (rare) run of equal hashes.
+  int lo = 0, hi = gHdr->count;
+  while (lo < hi){
+    const int mid = (lo + hi) >> 1;
+    if (gDir[mid].pathHash < want) lo = mid + 1; else hi = mid;
+  }
+  for (int i = lo; i < gHdr->count && gDir[i].pathHash == want; ++i){
+    const Dir& d = gDir[i];
+    const char* p = (const char*)gBase + d.pathOff;
+    if (strcmp(p, path) != 0) continue;
+    out.path  = p;
+    out.ctype = (const char*)gBase + d.ctypeOff;
+    out.data  = gBase + d.dataOff;
+    out.size  = d.size;
+    out.etag  = d.etag;
+    out.flags = d.flags;
+    return true;
+  }
+  return false;
+}
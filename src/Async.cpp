@@ -0,0 +1,454 @@
+#include "Async.h"
+#include "Trace.h"
+#include "Supervisor.h"
+#include "Tls.h"
+#include "TimeSvc.h"
+#include <vector>
+#include <lwip/sockets.h>
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <esp_timer.h>
+#include <freertos/queue.h>
+
+// =================== DNS cache ======================================
+// [TRAKKR-NOTE] Resolution runs on the lwIP thread (tcpip_callback) and
+// completes into a cache slot; callers just poll the slot. Slots are never
+// freed while a lookup is in flight, so the callback can't write to a dead
+// object.
+namespace {
+  constexpr int      DNS_SLOTS  = 8;
+  constexpr uint32_t DNS_TTL_MS = 10UL * 60 * 1000;   // lwIP doesn't hand us the TTL
+
+  enum : uint8_t { DNS_FREE, DNS_PENDING, DNS_OK, DNS_FAIL };
+  struct DnsSlot {
+    char              host[64];
+    ip_addr_t         addr;
+    volatile uint8_t  state;
+    uint32_t          at;                               // millis() of last state change
+  };
+  DnsSlot  gDns[DNS_SLOTS];
+  uint32_t gDnsHits = 0, gDnsMiss = 0;
+
+  void dnsFound(const char*, const ip_addr_t* ip, void* arg){
+    DnsSlot* s = (DnsSlot*)arg;
+    if (ip && IP_IS_V4(ip)){ s->addr = *ip; s->state = DNS_OK; }
+    else s->state = DNS_FAIL;
+    s->at = millis();
+  }
+  void dnsStart(void* arg){                           // on the lwIP thread
+    DnsSlot* s = (DnsSlot*)arg;
+    err_t e = dns_gethostbyname(s->host, &s->addr, dnsFound, s);
+    if (e == ERR_OK){ s->state = DNS_OK; s->at = millis(); }
+    else if (e != ERR_INPROGRESS){ s->state = DNS_FAIL; s->at = millis(); }
+  }
+
+  // IO_DONE with ip set, IO_PENDING, or IO_ERR.
+  Async::Io dnsLookup(const char* host, uint32_t& ip){
+    const uint32_t now = millis();
+    DnsSlot* hit = nullptr; DnsSlot* victim = nullptr;
+    for (auto& s : gDns){
+      if (s.state != DNS_FREE && strcmp(s.host, host) == 0){ hit = &s; break; }
+      if (s.state == DNS_PENDING) continue;
+      if (!victim || s.state == DNS_FREE || (victim->state != DNS_FREE && s.at < victim->at)) victim = &s;
+    }
+    if (hit){
+      if (hit->state == DNS_PENDING) return Async::IO_PENDING;
+      if (hit->state == DNS_OK && now - hit->at < DNS_TTL_MS){
+        ip = ip_2_ip4(&hit->addr)->addr; ++gDnsHits; return Async::IO_DONE;
+      }
+      if (hit->state == DNS_FAIL && now - hit->at < 2000) return Async::IO_ERR;   // don't hammer a failing name
+      victim = hit;                                   // stale: refresh in place
+    }
+    if (!victim) return Async::IO_PENDING;            // every slot busy resolving
+    ++gDnsMiss;
+    strncpy(victim->host, host, sizeof(victim->host) - 1);
+    victim->host[sizeof(victim->host) - 1] = '\0';
+    victim->state = DNS_PENDING;
+    victim->at = now;
+    if (tcpip_callback(dnsStart, victim) != ERR_OK){ victim->state = DNS_FAIL; return Async::IO_ERR; }
+    return Async::IO_PENDING;
+  }
+}
+
+uint32_t Async::dnsCacheHits(){ return gDnsHits; }
+
+// =================== TLS over non-blocking socket ===================
+namespace {
+  mbedtls_entropy_context  gEntropy;
+  mbedtls_ctr_drbg_context gDrbg;
+  bool                     gRngReady = false;
+
+  bool rngInit(){
+    if (gRngReady) return true;
+    mbedtls_entropy_init(&gEntropy);
+    mbedtls_ctr_drbg_init(&gDrbg);
+    static const char pers[] = "trakkr-async";
+    gRngReady = mbedtls_ctr_drbg_seed(&gDrbg, mbedtls_entropy_func, &gEntropy,
+                                      (const unsigned char*)pers, sizeof(pers) - 1) == 0;
+    return gRngReady;
+  }
+
+  int bioSend(void* ctx, const unsigned char* buf, size_t len){
+    int n = send(*(int*)ctx, buf, len, MSG_DONTWAIT);
+    if (n >= 0) return n;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_CONN_RESET;
+  }
+  int bioRecv(void* ctx, unsigned char* buf, size_t len){
+    int n = recv(*(int*)ctx, buf, len, MSG_DONTWAIT);
+    if (n >= 0) return n;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+  }
+
+  // Boot no longer waits for the clock: until TimeSvc has one, validity dates can't be judged.
+  int verifyDates(void*, mbedtls_x509_crt*, int, uint32_t* flags){
+    if (!TimeSvc::valid()) *flags &= ~(uint32_t)(MBEDTLS_X509_BADCERT_EXPIRED | MBEDTLS_X509_BADCERT_FUTURE);
+    return 0;
+  }
+}
+
+struct Async::Conn::Tls {
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config  conf;
+  int                 fd;
+};
+
+Async::Io Async::Conn::tlsResult(int rc){
+  if (rc == MBEDTLS_ERR_SSL_WANT_READ){  want_ = WAIT_READ;  return expired() ? fail("timeout") : IO_PENDING; }
+  if (rc == MBEDTLS_ERR_SSL_WANT_WRITE){ want_ = WAIT_WRITE; return expired() ? fail("timeout") : IO_PENDING; }
+  return fail("tls");
+}
+
+Async::Io Async::Conn::connect(const char* host, uint16_t port, bool tls){
+  switch (st_){
+    case ST_IDLE:
+    case ST_CLOSED:
+      strncpy(host_, host, sizeof(host_) - 1);
+      port_ = port; useTls_ = tls; t0_ = millis(); err_ = "";
+      offered_ = resumed_ = false; hsMs_ = 0;
+      st_ = ST_DNS;
+      // fall through
+    case ST_DNS: {
+      Io r = dnsLookup(host_, ip_);
+      if (r == IO_ERR) return fail("dns");
+      if (r == IO_PENDING){ want_ = WAIT_NONE; return expired() ? fail("dns timeout") : IO_PENDING; }
+
+      fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+      if (fd_ < 0) return fail("socket");
+      fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+      int one = 1; setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      struct sockaddr_in sa; memset(&sa, 0, sizeof(sa));
+      sa.sin_family = AF_INET; sa.sin_port = htons(port_); sa.sin_addr.s_addr = ip_;
+      if (::connect(fd_, (struct sockaddr*)&sa, sizeof(sa)) < 0 && errno != EINPROGRESS) return fail("connect");
+      st_ = ST_TCP; want_ = WAIT_WRITE;
+      return IO_PENDING;
+    }
+    case ST_TCP: {
+      int err = 0; socklen_t l = sizeof(err);
+      if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &l) < 0 || (err && err != EINPROGRESS)) return fail("connect");
+      if (err == EINPROGRESS){ want_ = WAIT_WRITE; return expired() ? fail("connect timeout") : IO_PENDING; }
+      if (!useTls_){ hsMs_ = millis() - t0_; st_ = ST_READY; want_ = WAIT_NONE; return IO_DONE; }
+
+      if (!rngInit()) return fail("rng");
+      tls_ = new (std::nothrow) Tls;
+      if (!tls_) return fail("oom");
+      tls_->fd = fd_;
+      mbedtls_ssl_init(&tls_->ssl);
+      mbedtls_ssl_config_init(&tls_->conf);
+      if (mbedtls_ssl_config_defaults(&tls_->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) != 0)
+        return fail("tls config");
+      // Verification per ::Tls::mode(): pin is checked after the handshake; anchor lets mbedTLS verify.
+      mode_ = ::Tls::mode();
+      if (mode_ == ::Tls::MODE_ANCHOR){
+        mbedtls_x509_crt* ca = ::Tls::anchor(host_);
+        if (!ca){ ::Tls::noteHandshake((::Tls::Mode)mode_, false, false, 0); return fail("no trust anchor"); }
+        mbedtls_ssl_conf_ca_chain(&tls_->conf, ca, nullptr);
+        mbedtls_ssl_conf_authmode(&tls_->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_verify(&tls_->conf, verifyDates, nullptr);
+      } else {
+        mbedtls_ssl_conf_authmode(&tls_->conf, MBEDTLS_SSL_VERIFY_NONE);
+      }
+      mbedtls_ssl_conf_rng(&tls_->conf, mbedtls_ctr_drbg_random, &gDrbg);
+      if (mbedtls_ssl_setup(&tls_->ssl, &tls_->conf) != 0) return fail("tls setup");
+      mbedtls_ssl_set_hostname(&tls_->ssl, host_);
+      mbedtls_ssl_set_bio(&tls_->ssl, &tls_->fd, bioSend, bioRecv, nullptr);
+      offered_ = ::Tls::offerSession(host_, (::Tls::Mode)mode_, &tls_->ssl);
+      tlsT0_ = millis();
+      st_ = ST_TLS;
+    }
+      // fall through
+    case ST_TLS: {
+      int rc = mbedtls_ssl_handshake(&tls_->ssl);
+      if (rc != 0){
+        Io r = tlsResult(rc);
+        if (r == IO_ERR){
+          if (rc == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) err_ = "cert verify";
+          if (offered_) ::Tls::dropSession(host_);
+          ::Tls::noteHandshake((::Tls::Mode)mode_, false, false, 0);
+        }
+        return r;
+      }
+      hsMs_ = millis() - tlsT0_;
+      const mbedtls_x509_crt* chain = mbedtls_ssl_get_peer_cert(&tls_->ssl);
+      ::Tls::observe(host_, chain);
+      if (mode_ == ::Tls::MODE_PIN && !::Tls::pinMatch(host_, chain)){
+        ::Tls::dropSession(host_);
+        ::Tls::noteHandshake((::Tls::Mode)mode_, false, false, 0);
+        return fail("pin mismatch");
+      }
+      resumed_ = ::Tls::keepSession(host_, (::Tls::Mode)mode_, &tls_->ssl);
+      ::Tls::noteHandshake((::Tls::Mode)mode_, true, resumed_, hsMs_);
+      st_ = ST_READY; want_ = WAIT_NONE;
+      return IO_DONE;
+    }
+    case ST_READY: return IO_DONE;
+    default:       return fail("closed");
+  }
+}
+
+// Plain-TCP errno → Io (same contract as tlsResult)
+Async::Io Async::Conn::sockResult(uint8_t ev){
+  if (errno == EAGAIN || errno == EWOULDBLOCK){ want_ = ev; return expired() ? fail("timeout") : IO_PENDING; }
+  return fail(ev == WAIT_READ ? "recv" : "send");
+}
+
+Async::Io Async::Conn::write(const uint8_t* data, size_t len, size_t& sent){
+  if (st_ != ST_READY) return fail("not connected");
+  while (sent < len){
+    if (!tls_){
+      int n = send(fd_, data + sent, len - sent, MSG_DONTWAIT);
+      if (n < 0) return sockResult(WAIT_WRITE);
+      sent += (size_t)n;
+      continue;
+    }
+    int rc = mbedtls_ssl_write(&tls_->ssl, data + sent, len - sent);
+    if (rc < 0) return tlsResult(rc);
+    sent += (size_t)rc;
+  }
+  want_ = WAIT_NONE;
+  return IO_DONE;
+}
+
+Async::Io Async::Conn::read(uint8_t* buf, size_t cap, int& got){
+  if (st_ != ST_READY) return fail("not connected");
+  if (!tls_){
+    int n = recv(fd_, buf, cap, MSG_DONTWAIT);
+    if (n < 0) return sockResult(WAIT_READ);
+    got = n; want_ = WAIT_NONE;
+    return IO_DONE;
+  }
+  int rc = mbedtls_ssl_read(&tls_->ssl, buf, cap);
+  if (rc > 0){ got = rc; want_ = WAIT_NONE; return IO_DONE; }
+  if (rc == 0 || rc == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || rc == MBEDTLS_ERR_SSL_CONN_EOF){
+    got = 0; want_ = WAIT_NONE; return IO_DONE;
+  }
+  return tlsResult(rc);
+}
+
+void Async::Conn::close(){
+  if (tls_){
+    if (st_ == ST_READY) mbedtls_ssl_close_notify(&tls_->ssl);   // best effort, non-blocking
+    mbedtls_ssl_free(&tls_->ssl);
+    mbedtls_ssl_config_free(&tls_->conf);
+    delete tls_; tls_ = nullptr;
+  }
+  if (fd_ >= 0){ ::close(fd_); fd_ = -1; }
+  if (st_ != ST_IDLE) st_ = ST_CLOSED;
+  want_ = WAIT_NONE;
+}
+
+// =================== HTTP/1.1 ========================================
+void Async::Http::reset(){
+  pt_ = 0; status_ = 0; sent_ = 0; hdr_ = String();
+  chunked_ = false; remain_ = -1; chunkSt_ = 0; lineLen_ = 0; got_ = 0; pos_ = len_ = 0;
+}
+
+Async::Io Async::Http::fill(Conn& c){
+  int got = 0;
+  Io r = c.read(buf_, sizeof(buf_), got);
+  if (r != IO_DONE) return r;
+  pos_ = 0; len_ = got;
+  return IO_DONE;
+}
+
+Async::Io Async::Http::request(Conn& c, const String& head, const String& body){
+  Io r;
+  switch (pt_){
+    case 0:                                          // request line + headers
+      r = c.write((const uint8_t*)head.c_str(), head.length(), sent_);
+      if (r != IO_DONE) return r;
+      sent_ = 0; pt_ = 1;
+      // fall through
+    case 1:                                          // body
+      r = c.write((const uint8_t*)body.c_str(), body.length(), sent_);
+      if (r != IO_DONE) return r;
+      sentAt_ = millis();
+      pt_ = 2; hdr_.reserve(512);
+      // fall through
+    case 2:                                          // status line + headers
+      for (;;){
+        if (pos_ >= len_){
+          r = fill(c);
+          if (r != IO_DONE) return r;
+          if (len_ == 0) return IO_ERR;              // closed before headers
+        }
+        while (pos_ < len_){
+          hdr_ += (char)buf_[pos_++];
+          if (hdr_.endsWith("\r\n\r\n")) goto parsed;
+          if (hdr_.length() > 4096) return IO_ERR;
+        }
+      }
+    parsed: {
+      int sp = hdr_.indexOf(' ');
+      status_ = sp > 0 ? hdr_.substring(sp + 1, sp + 4).toInt() : 0;
+      String low = hdr_; low.toLowerCase();
+      chunked_ = low.indexOf("transfer-encoding: chunked") >= 0;
+      int cl = low.indexOf("content-length:");
+      remain_ = (!chunked_ && cl >= 0) ? low.substring(cl + 15).toInt() : -1;
+      int date = low.indexOf("\r\ndate:");
+      if (date >= 0 && c.tls()) TimeSvc::offerHttpDate(hdr_.c_str() + date + 7, millis() - sentAt_);
+      hdr_ = String();
+      pt_ = 3;
+      return IO_DONE;
+    }
+    default: return IO_DONE;
+  }
+}
+
+// Chunked states: 0 = size line, 1 = data, 2 = CRLF after data, 3 = done
+Async::Io Async::Http::body(Conn& c, Print& sink){
+  for (;;){
+    if (!chunked_ && remain_ == 0) return IO_DONE;
+    if (chunked_ && chunkSt_ == 3) return IO_DONE;
+    if (pos_ >= len_){
+      Io r = fill(c);
+      if (r != IO_DONE) return r;
+      if (len_ == 0) return (remain_ < 0 && !chunked_) ? IO_DONE : IO_ERR;   // close-delimited body ends here
+    }
+    if (!chunked_){
+      int n = len_ - pos_;
+      if (remain_ >= 0 && n > remain_) n = remain_;
+      sink.write(buf_ + pos_, n);
+      pos_ += n; got_ += n;
+      if (remain_ > 0) remain_ -= n;
+      continue;
+    }
+    switch (chunkSt_){
+      case 0:
+        while (pos_ < len_){
+          char ch = (char)buf_[pos_++];
+          if (ch == '\n'){
+            line_[lineLen_] = '\0';
+            remain_ = (int32_t)strtol(line_, nullptr, 16);
+            lineLen_ = 0;
+            chunkSt_ = remain_ ? 1 : 3;
+            break;
+          }
+          if (ch != '\r' && lineLen_ < sizeof(line_) - 1) line_[lineLen_++] = ch;
+        }
+        break;
+      case 1: {
+        int n = len_ - pos_;
+        if (n > remain_) n = remain_;
+        sink.write(buf_ + pos_, n);
+        pos_ += n; got_ += n; remain_ -= n;
+        if (!remain_){ chunkSt_ = 2; lineLen_ = 0; }
+        break;
+      }
+      case 2:                                        // skip CRLF, then next size line
+        while (pos_ < len_ && lineLen_ < 2){ pos_++; lineLen_++; }
+        if (lineLen_ == 2){ chunkSt_ = 0; lineLen_ = 0; }
+        break;
+    }
+  }
+}
+
+// =================== Loop ============================================
+namespace {
+  TaskHandle_t        gNetTask = nullptr;
+  QueueHandle_t       gSpawnQ  = nullptr;
+  std::vector<Async::Task*> gTasks;
+  uint32_t gSteps = 0, gSpawned = 0, gMaxStepUs = 0, gPeak = 0;
+
+  constexpr uint32_t IDLE_POLL_MS = 50;              // spawn queue latency while every task waits
+  constexpr size_t   MAX_TASKS    = 8;
+
+  void netLoop(void*){
+    for(;;){
+      Supervisor::beat(Supervisor::P_NET);
+      Async::Task* t;
+      while (gTasks.size() < MAX_TASKS && xQueueReceive(gSpawnQ, &t, gTasks.empty() ? pdMS_TO_TICKS(IDLE_POLL_MS) : 0) == pdTRUE){
+        gTasks.push_back(t); t->wakeAt = 0;
+        if (gTasks.size() > gPeak) gPeak = gTasks.size();
+      }
+      if (gTasks.empty()) continue;
+
+      // Wait for any socket a task is parked on, or the nearest deadline.
+      fd_set rd, wr; FD_ZERO(&rd); FD_ZERO(&wr);
+      int maxFd = -1;
+      uint32_t now = millis(), waitMs = IDLE_POLL_MS;
+      for (auto* k : gTasks){
+        if (k->waitFd >= 0 && k->waitEv){
+          FD_SET(k->waitFd, (k->waitEv == Async::WAIT_READ) ? &rd : &wr);
+          if (k->waitFd > maxFd) maxFd = k->waitFd;
+        }
+        if (!k->wakeAt){ waitMs = 0; continue; }
+        int32_t d = (int32_t)(k->wakeAt - now);
+        if (d <= 0) waitMs = 0; else if ((uint32_t)d < waitMs) waitMs = d;
+      }
+      if (maxFd >= 0 || waitMs){
+        struct timeval tv = { (long)(waitMs / 1000), (long)((waitMs % 1000) * 1000) };
+        if (maxFd >= 0) select(maxFd + 1, &rd, &wr, nullptr, &tv);
+        else vTaskDelay(pdMS_TO_TICKS(waitMs));
+      }
+
+      now = millis();
+      for (size_t i = 0; i < gTasks.size();){
+        Async::Task* k = gTasks[i];
+        bool ready = !k->wakeAt || (int32_t)(now - k->wakeAt) >= 0;
+        if (!ready && k->waitFd >= 0 && k->waitEv)
+          ready = FD_ISSET(k->waitFd, (k->waitEv == Async::WAIT_READ) ? &rd : &wr);
+        if (!ready){ ++i; continue; }
+
+        k->waitFd = -1; k->waitEv = Async::WAIT_NONE; k->wakeAt = 0;
+        const int64_t t0 = esp_timer_get_time();
+        bool done;
+        { Trace::Span sp(k->name()); done = k->step(); }
+        const uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        if (us > gMaxStepUs) gMaxStepUs = us;
+        ++gSteps;
+        if (done){ delete k; gTasks.erase(gTasks.begin() + i); }
+        else ++i;
+      }
+    }
+  }
+}
+
+void Async::begin(){
+  if (gNetTask) return;
+  gSpawnQ = xQueueCreate(MAX_TASKS, sizeof(Task*));
+  // One stack for every provider; sized for an mbedTLS handshake.
+  xTaskCreatePinnedToCore(netLoop, "net", 8192, nullptr, 1, &gNetTask, 0);
+}
+
+bool Async::spawn(Task* t){
+  if (!t) return false;
+  if (!gSpawnQ || xQueueSend(gSpawnQ, &t, 0) != pdTRUE){ delete t; return false; }
+  ++gSpawned;
+  return true;
+}
+
+String Async::statsJSON(){
+  String j; j.reserve(200);
+  j += "{\"tasks\":";     j += String((unsigned)gTasks.size());
+  j += ",\"peak\":";      j += String(gPeak);
+  j += ",\"spawned\":";   j += String(gSpawned);
+  j += ",\"steps\":";     j += String(gSteps);
+  j += ",\"maxStepUs\":"; j += String(gMaxStepUs);
+  j += ",\"dnsHits\":";   j += String(gDnsHits);
+  j += ",\"dnsMiss\":";   j += String(gDnsMiss);
+  j += '}';
+  return j;
+}
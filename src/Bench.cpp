@@ -0,0 +1,163 @@
+#include "Bench.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <Preferences.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include "Supervisor.h"
+#include "Api.h"
+
+namespace {
+  std::vector<Bench::Case> gCases;
+  const char* DEF_TLS_HOST = "lite.realtime.nationalrail.co.uk";
+  char gTlsHost[64];                 // this run's, from runJSON()
+
+  constexpr uint16_t MAX_ITERS  = 500;
+  constexpr size_t   NVS_BLOB   = 64;
+  constexpr size_t   FS_BLOB    = 4096;
+  const char*        kFsPath    = "/bench.tmp";
+
+  uint8_t* gBlob = nullptr;          // shared scratch for NVS/FS cases
+
+  // ---- Built-in cases: NVS, LittleFS, TLS ----
+  Preferences gNvs;
+  bool nvsOpen(void*){ return gNvs.begin("trakkrbench", false); }
+  void nvsClose(void*){ gNvs.end(); }
+  void nvsWrite(void*){ gBlob[0]++; gNvs.putBytes("blob", gBlob, NVS_BLOB); }
+  void nvsRead(void*){ gNvs.getBytes("blob", gBlob, NVS_BLOB); }
+
+  bool fsPrep(void*){
+    File f = LittleFS.open(kFsPath, "w"); if (!f) return false;
+    f.write(gBlob, FS_BLOB); f.close();
+    return true;
+  }
+  void fsDone(void*){ LittleFS.remove(kFsPath); }
+  void fsWrite(void*){ File f = LittleFS.open(kFsPath, "w"); if (f){ f.write(gBlob, FS_BLOB); f.close(); } }
+  void fsRead(void*){ File f = LittleFS.open(kFsPath, "r"); if (f){ f.read(gBlob, FS_BLOB); f.close(); } }
+
+  bool tlsPrep(void*){ return WiFi.status() == WL_CONNECTED; }
+  void tlsHandshake(void*){
+    WiFiClientSecure c; c.setInsecure(); c.setTimeout(8000);
+    if (!c.connect(gTlsHost, 443)) Serial.printf("[BENCH] TLS connect %s failed\n", gTlsHost);
+    c.stop();
+  }
+
+  void addBuiltins(){
+    static bool done = false;
+    if (done) return;
+    done = true;
+    gBlob = (uint8_t*)malloc(FS_BLOB);
+    if (!gBlob) return;
+    for (size_t i = 0; i < FS_BLOB; ++i) gBlob[i] = (uint8_t)(i * 31u);
+
+    Bench::add({ "nvs.write",     &nvsWrite,     nullptr, 20, NVS_BLOB, &nvsOpen, &nvsClose });
+    Bench::add({ "nvs.read",      &nvsRead,      nullptr, 50, NVS_BLOB, &nvsOpen, &nvsClose });
+    Bench::add({ "fs.write",      &fsWrite,      nullptr, 20, FS_BLOB,  &fsPrep,  &fsDone  });
+    Bench::add({ "fs.read",       &fsRead,       nullptr, 50, FS_BLOB,  &fsPrep,  &fsDone  });
+    Bench::add({ "tls.handshake", &tlsHandshake, nullptr, 3,  0,        &tlsPrep, nullptr  });
+  }
+
+  struct Stats { uint32_t n, minUs, maxUs, p50, p95; double mean, sd; };
+
+  Stats summarise(std::vector<uint32_t>& v){
+    Stats s; memset(&s, 0, sizeof(s));
+    s.n = v.size(); if (!s.n) return s;
+    std::sort(v.begin(), v.end());
+    s.minUs = v.front(); s.maxUs = v.back();
+    s.p50   = v[(s.n - 1) / 2];
+    s.p95   = v[(s.n - 1) * 95 / 100];
+    double sum = 0; for (uint32_t x : v) sum += x;
+    s.mean = sum / s.n;
+    double var = 0; for (uint32_t x : v){ double d = x - s.mean; var += d * d; }
+    s.sd = (s.n > 1) ? sqrt(var / (s.n - 1)) : 0;
+    return s;
+  }
+}
+
+void Bench::add(const Case& c){
+  for (auto& e : gCases) if (strcmp(e.name, c.name) == 0){ e = c; return; }
+  gCases.push_back(c);
+}
+
+String Bench::listJSON(){
+  addBuiltins();
+  String j; j.reserve(32 + gCases.size() * 64);
+  j += "{\"cases\":[";
+  for (size_t i = 0; i < gCases.size(); ++i){
+    if (i) j += ',';
+    j += "{\"name\":";    j += jsonEscape(gCases[i].name);
+    j += ",\"iters\":";   j += String((unsigned)gCases[i].iters);
+    j += ",\"bytes\":";   j += String((unsigned)gCases[i].bytes);
+    j += '}';
+  }
+  j += "]}";
+  return j;
+}
+
+String Bench::runJSON(const char* prefix, uint16_t iters, const char* tlsHost){
+  addBuiltins();
+  if (!prefix) prefix = "";
+  strncpy(gTlsHost, tlsHost && *tlsHost ? tlsHost : DEF_TLS_HOST, sizeof(gTlsHost) - 1);
+  gTlsHost[sizeof(gTlsHost) - 1] = '\0';
+  const size_t plen = strlen(prefix);
+
+  String j; j.reserve(256 + gCases.size() * 160);
+  j += "{\"build\":\""; j += __DATE__; j += ' '; j += __TIME__; j += "\",";
+  j += "\"cpuMHz\":"; j += String((unsigned)ESP.getCpuFreqMHz()); j += ',';
+  j += "\"heapFree\":"; j += String((unsigned)ESP.getFreeHeap()); j += ',';
+  j += "\"tlsHost\":"; j += jsonEscape(gTlsHost); j += ',';
+  j += "\"cases\":[";
+
+  std::vector<uint32_t> samples;
+  bool first = true;
+  for (const auto& c : gCases){
+    if (plen && strncmp(c.name, prefix, plen) != 0) continue;
+    uint16_t n = iters ? iters : c.iters;
+    if (n == 0) n = 1;
+    if (n > MAX_ITERS) n = MAX_ITERS;
+
+    if (!first) j += ',';
+    first = false;
+    j += "{\"name\":\""; j += c.name; j += "\",";
+
+    if (c.before && !c.before(c.ctx)){
+      j += "\"skipped\":true}";
+      continue;
+    }
+
+    samples.clear(); samples.reserve(n);
+    const size_t heap0 = ESP.getFreeHeap();
+    c.run(c.ctx);                                  // warm-up (caches, first-use allocs)
+    for (uint16_t i = 0; i < n; ++i){
+      int64_t t0 = esp_timer_get_time();
+      c.run(c.ctx);
+      samples.push_back((uint32_t)(esp_timer_get_time() - t0));
+      Supervisor::beat(Supervisor::P_LOOP);       // a long run holds the loop task; outside the timing
+    }
+    const long heapDelta = (long)ESP.getFreeHeap() - (long)heap0;
+    if (c.after) c.after(c.ctx);
+
+    Stats s = summarise(samples);
+    j += "\"n\":";       j += String((unsigned)s.n);
+    j += ",\"minUs\":";  j += String((unsigned)s.minUs);
+    j += ",\"p50Us\":";  j += String((unsigned)s.p50);
+    j += ",\"p95Us\":";  j += String((unsigned)s.p95);
+    j += ",\"maxUs\":";  j += String((unsigned)s.maxUs);
+    j += ",\"meanUs\":"; j += String(s.mean, 1);
+    j += ",\"sdUs\":";   j += String(s.sd, 1);
+    j += ",\"heapDelta\":"; j += String(heapDelta);
+    if (c.bytes){
+      j += ",\"bytes\":"; j += String((unsigned)c.bytes);
+      j += ",\"MBps\":";  j += String(s.mean > 0 ? c.bytes / s.mean : 0.0, 2);   // bytes/us == MB/s
+    }
+    j += '}';
+    yield();
+  }
+  j += "]}";
+  return j;
+}
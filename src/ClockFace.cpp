@@ -0,0 +1,85 @@
+#include "ClockFace.h"
+#include <esp_heap_caps.h>
+#include "TFT.h"
+#include "Pixel.h"
+#include "HeapTrace.h"
+
+// [TRAKKR] Header clock glyph atlas (see ClockFace.h)
+
+static const char kGlyphChars[] = "0123456789:-";
+
+bool ClockFace::begin(const GFXfont* font, uint16_t fg, uint16_t shadow, uint16_t bg, bool seconds){
+  end();
+  secs_ = seconds;
+  HeapTrace::Scope hs("sprites");
+
+  // Cell geometry from the font: digits (and '-') share the widest digit's
+  // cell so the clock never shifts; the colon and its blank get their own.
+  tft.setFreeFont(font);
+  int dw = 0;
+  for (int i = 0; i < 10; i++){ char s[2] = { kGlyphChars[i], 0 }; dw = max(dw, (int)tft.textWidth(s)); }
+  dw = max(dw, (int)tft.textWidth("-")) + 1;                   // +1 for the shadow
+  int cw = tft.textWidth(":") + 1 + 2;                          // +2 breathing room either side
+  h_ = tft.fontHeight() + 1;
+
+  uint32_t total = 0;
+  for (uint8_t g = 0; g < G_COUNT; g++){
+    gw_[g] = (uint8_t)((g == G_COLON || g == G_BLANK) ? cw : dw);
+    off_[g] = total;
+    total += (uint32_t)gw_[g] * h_;
+  }
+  // Internal RAM: these are pushed every second on the ticking styles
+  atlas_ = (uint16_t*)heap_caps_malloc(total * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!atlas_) return false;
+
+  // One scratch sprite per glyph; its buffer is already in panel order, so
+  // the atlas is too and pushImage() sends it as-is.
+  TFT_eSprite spr(&tft);
+  spr.setColorDepth(16);
+  for (uint8_t g = 0; g < G_COUNT; g++){
+    if (!spr.createSprite(gw_[g], h_)){ end(); return false; }
+    spr.fillSprite(bg);
+    if (g != G_BLANK){
+      char s[2] = { kGlyphChars[g], 0 };
+      spr.setFreeFont(font);
+      spr.setTextDatum(TC_DATUM);
+      int cx = (gw_[g] - 1) / 2;
+      spr.setTextColor(shadow); spr.drawString(s, cx + 1, 1);
+      spr.setTextColor(fg);     spr.drawString(s, cx,     0);
+    }
+    Pixel::copy16(atlas_ + off_[g], (const uint16_t*)spr.getPointer(), (size_t)gw_[g] * h_);
+    spr.deleteSprite();
+  }
+  invalidate();
+  return true;
+}
+
+void ClockFace::end(){
+  if (atlas_){ heap_caps_free(atlas_); atlas_ = nullptr; }
+}
+
+int ClockFace::width() const {
+  return secs_ ? 6 * gw_[0] + 2 * gw_[G_COLON]
+               : 4 * gw_[0] +     gw_[G_COLON];
+}
+
+uint8_t ClockFace::glyphFor(char c, bool colonOn) const {
+  if (c >= '0' && c <= '9') return (uint8_t)(c - '0');
+  if (c == ':') return colonOn ? G_COLON : G_BLANK;
+  return G_DASH;
+}
+
+uint8_t ClockFace::draw(int x, int y, const char* text, bool colonOn){
+  if (!atlas_ || !text) return 0;
+  uint8_t cells = secs_ ? 8 : 5, pushed = 0;
+  for (uint8_t i = 0; i < cells && text[i]; i++){
+    uint8_t g = glyphFor(text[i], colonOn);
+    if (g != last_[i]){
+      tft.pushImage(x, y, gw_[g], h_, atlas_ + off_[g]);
+      last_[i] = g;
+      pushed++;
+    }
+    x += gw_[g];
+  }
+  return pushed;
+}
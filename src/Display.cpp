@@ -0,0 +1,226 @@
+#include "Display.h"
+#include "Pixel.h"
+#include <esp_heap_caps.h>
+#include <cstring>
+
+#if TRAKKR_LCD_DMA && defined(CONFIG_IDF_TARGET_ESP32S3)
+  #include <esp_idf_version.h>
+  #include <esp_lcd_panel_io.h>
+  #include <esp_rom_gpio.h>
+  #include <soc/lcd_periph.h>
+  #include <soc/gpio_sig_map.h>
+  #define TRAKKR_HAVE_I80 1
+#else
+  #define TRAKKR_HAVE_I80 0
+#endif
+
+namespace {
+  DisplayBackend* sActive = nullptr;
+}
+
+// =================== ESP32-S3 i80 + DMA =============================
+#if TRAKKR_HAVE_I80
+namespace {
+  // [TRAKKR-NOTE] ILI9488 write cycle is ~30ns; 20 MHz leaves margin on
+  // the flying leads used for the 8-bit bus.
+  constexpr uint32_t kPclkHz     = 20 * 1000 * 1000;
+  constexpr uint8_t  CMD_CASET   = 0x2A;
+  constexpr uint8_t  CMD_PASET   = 0x2B;
+  constexpr uint8_t  CMD_RAMWR   = 0x2C;
+
+  const int kDataPins[8] = { TFT_D0, TFT_D1, TFT_D2, TFT_D3, TFT_D4, TFT_D5, TFT_D6, TFT_D7 };
+
+  class I80Backend : public DisplayBackend {
+  public:
+    explicit I80Backend(size_t maxPixels) : cap_(maxPixels) {}
+
+    bool begin() override {
+      const size_t bytes = cap_ * sizeof(uint16_t);
+      for (int i = 0; i < 2; ++i){
+        buf_[i] = (uint16_t*)heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!buf_[i]){ Serial.printf("[LCD][ERR] DMA buffer %d (%uB) alloc failed\n", i, (unsigned)bytes); return false; }
+      }
+      idle_ = xSemaphoreCreateBinary();
+      if (!idle_) return false;
+
+      esp_lcd_i80_bus_config_t bc;
+      memset(&bc, 0, sizeof(bc));
+      bc.dc_gpio_num = TFT_DC;
+      bc.wr_gpio_num = TFT_WR;
+      for (int i = 0; i < 8; ++i) bc.data_gpio_nums[i] = kDataPins[i];
+      bc.bus_width          = 8;
+      bc.max_transfer_bytes = bytes;
+#if ESP_IDF_VERSION_MAJOR >= 5
+      bc.clk_src            = LCD_CLK_SRC_DEFAULT;
+#endif
+      esp_err_t err = esp_lcd_new_i80_bus(&bc, &bus_);
+      if (err != ESP_OK){ Serial.printf("[LCD][ERR] i80 bus: %s\n", esp_err_to_name(err)); return false; }
+
+      esp_lcd_panel_io_i80_config_t ic;
+      memset(&ic, 0, sizeof(ic));
+      ic.cs_gpio_num       = -1;          // CS stays with TFT_eSPI; we drive it in acquire()
+      ic.pclk_hz           = kPclkHz;
+      ic.trans_queue_depth = 4;
+      ic.on_color_trans_done = &I80Backend::onDone;
+      ic.user_ctx          = this;
+      ic.lcd_cmd_bits      = 8;
+      ic.lcd_param_bits    = 8;
+      ic.dc_levels.dc_idle_level  = 0;
+      ic.dc_levels.dc_cmd_level   = 0;
+      ic.dc_levels.dc_dummy_level = 0;
+      ic.dc_levels.dc_data_level  = 1;
+      err = esp_lcd_new_panel_io_i80(bus_, &ic, &io_);
+      if (err != ESP_OK){ Serial.printf("[LCD][ERR] i80 io: %s\n", esp_err_to_name(err)); return false; }
+
+      // Creating the bus routed the pins to LCD_CAM; give them straight back.
+      owned_ = true;
+      release();
+      Serial.printf("[LCD] i80 DMA backend up: %u px x2 @ %u MHz\n", (unsigned)cap_, (unsigned)(kPclkHz / 1000000));
+      return true;
+    }
+
+    const char* name() const override { return "i80-dma"; }
+    uint16_t*   backBuffer() override { return buf_[back_]; }
+    size_t      capacity() const override { return cap_; }
+    uint32_t    frames() const override { return done_; }
+
+    bool present(int x, int y, int w, int h) override {
+      if (w <= 0 || h <= 0 || (size_t)(w * h) > cap_) return false;
+      acquire();
+
+      const uint16_t x1 = x + w - 1, y1 = y + h - 1;
+      const uint8_t caset[4] = { (uint8_t)(x >> 8), (uint8_t)x, (uint8_t)(x1 >> 8), (uint8_t)x1 };
+      const uint8_t paset[4] = { (uint8_t)(y >> 8), (uint8_t)y, (uint8_t)(y1 >> 8), (uint8_t)y1 };
+
+      // tx_param blocks until the previous colour transfer has drained, so
+      // on return the other buffer is free for the next frame.
+      // Any failure hands the bus back: the caller falls back to a TFT_eSPI
+      // push, which needs the pins on plain GPIO.
+      if (esp_lcd_panel_io_tx_param(io_, CMD_CASET, caset, 4) != ESP_OK ||
+          esp_lcd_panel_io_tx_param(io_, CMD_PASET, paset, 4) != ESP_OK){
+        yieldBus();
+        return false;
+      }
+      ++queued_;
+      if (esp_lcd_panel_io_tx_color(io_, CMD_RAMWR, buf_[back_], (size_t)w * h * 2) != ESP_OK){
+        --queued_;
+        yieldBus();
+        return false;
+      }
+      back_ ^= 1;
+      return true;
+    }
+
+    void yieldBus() override {
+      while (done_ != queued_) xSemaphoreTake(idle_, pdMS_TO_TICKS(20));
+      release();
+    }
+
+  private:
+#if ESP_IDF_VERSION_MAJOR >= 5
+    static bool IRAM_ATTR onDone(esp_lcd_panel_io_handle_t, esp_lcd_panel_io_event_data_t*, void* ctx){
+#else
+    static bool IRAM_ATTR onDone(esp_lcd_panel_io_handle_t, void* ctx, void*){
+#endif
+      I80Backend* self = (I80Backend*)ctx;
+      BaseType_t woke = pdFALSE;
+      ++self->done_;
+      if (self->done_ == self->queued_) xSemaphoreGiveFromISR(self->idle_, &woke);
+      return woke == pdTRUE;
+    }
+
+    // Route WR/DC/D0..D7 to the LCD_CAM peripheral and hold CS low.
+    void acquire(){
+      if (owned_) return;
+      for (int i = 0; i < 8; ++i)
+        esp_rom_gpio_connect_out_signal(kDataPins[i], lcd_periph_signals.buses[0].data_sigs[i], false, false);
+      esp_rom_gpio_connect_out_signal(TFT_WR, lcd_periph_signals.buses[0].wr_sig, false, false);
+      esp_rom_gpio_connect_out_signal(TFT_DC, lcd_periph_signals.buses[0].dc_sig, false, false);
+      digitalWrite(TFT_CS, LOW);
+      owned_ = true;
+    }
+
+    // Back to plain GPIO so TFT_eSPI's register writes reach the pins.
+    void release(){
+      if (!owned_) return;
+      for (int i = 0; i < 8; ++i) esp_rom_gpio_connect_out_signal(kDataPins[i], SIG_GPIO_OUT_IDX, false, false);
+      esp_rom_gpio_connect_out_signal(TFT_WR, SIG_GPIO_OUT_IDX, false, false);
+      esp_rom_gpio_connect_out_signal(TFT_DC, SIG_GPIO_OUT_IDX, false, false);
+      digitalWrite(TFT_WR, HIGH);
+      digitalWrite(TFT_CS, HIGH);
+      owned_ = false;
+    }
+
+    size_t                    cap_;
+    uint16_t*                 buf_[2]  = { nullptr, nullptr };
+    uint8_t                   back_    = 0;
+    bool                      owned_   = false;
+    esp_lcd_i80_bus_handle_t  bus_     = nullptr;
+    esp_lcd_panel_io_handle_t io_      = nullptr;
+    SemaphoreHandle_t         idle_    = nullptr;
+    volatile uint32_t         queued_  = 0;
+    volatile uint32_t         done_    = 0;
+  };
+}
+#endif
+
+// =================== Framebuffer (host / simulator) ================
+namespace {
+  class FramebufferBackend : public DisplayBackend {
+  public:
+    FramebufferBackend(int w, int h) : w_(w), h_(h) {}
+
+    bool begin() override {
+      const size_t n = (size_t)w_ * h_;
+      panel_  = (uint16_t*)calloc(n, sizeof(uint16_t));
+      buf_[0] = (uint16_t*)calloc(n, sizeof(uint16_t));
+      buf_[1] = (uint16_t*)calloc(n, sizeof(uint16_t));
+      return panel_ && buf_[0] && buf_[1];
+    }
+    const char* name() const override { return "framebuffer"; }
+    uint16_t*   backBuffer() override { return buf_[back_]; }
+    size_t      capacity() const override { return (size_t)w_ * h_; }
+    uint32_t    frames() const override { return frames_; }
+
+    bool present(int x, int y, int w, int h) override {
+      if (w <= 0 || h <= 0 || (size_t)(w * h) > capacity()) return false;
+      const int x0 = max(x, 0), x1 = min(x + w, w_), y0 = max(y, 0), y1 = min(y + h, h_);
+      if (x1 > x0 && y1 > y0)
+        Pixel::copyRect(panel_ + y0 * w_ + x0, w_, buf_[back_] + (y0 - y) * w + (x0 - x), w, x1 - x0, y1 - y0);
+      back_ ^= 1; ++frames_;
+      return true;
+    }
+    void yieldBus() override {}
+
+    const uint16_t* pixels() const { return panel_; }
+
+  private:
+    int       w_, h_;
+    uint16_t* panel_  = nullptr;
+    uint16_t* buf_[2] = { nullptr, nullptr };
+    uint8_t   back_   = 0;
+    uint32_t  frames_ = 0;
+  };
+  FramebufferBackend* sFb = nullptr;
+}
+
+DisplayBackend* Display::i80(size_t maxPixels){
+#if TRAKKR_HAVE_I80
+  static I80Backend* inst = nullptr;
+  if (!inst) inst = new I80Backend(maxPixels);
+  return inst;
+#else
+  (void)maxPixels;
+  return nullptr;
+#endif
+}
+
+DisplayBackend* Display::framebuffer(int w, int h){
+  if (!sFb) sFb = new FramebufferBackend(w, h);
+  return sFb;
+}
+const uint16_t* Display::framebufferPixels(){ return sFb ? sFb->pixels() : nullptr; }
+
+void            Display::setActive(DisplayBackend* b){ sActive = b; }
+DisplayBackend* Display::active(){ return sActive; }
+void            Display::yieldBus(){ if (sActive) sActive->yieldBus(); }
@@ -68,6 +68,38 @@ void Cfg::begin(){
   copySafe(g.ss_end,      sizeof(g.ss_end),      prefs.getString("ss2", DEF_SS_END  ).c_str(), DEF_SS_END);
   copySafe(g.tube_line,   sizeof(g.tube_line),   prefs.getString("line",DEF_TUBE_LINE).c_str(), DEF_TUBE_LINE);
   copySafe(g.tube_dir,    sizeof(g.tube_dir),    prefs.getString("dir", DEF_TUBE_DIR ).c_str(), DEF_TUBE_DIR);
+
+  // Board paging
+  g.board_rows = prefs.getUChar("rows", DEF_BOARD_ROWS);
+  if (g.board_rows < 1 || g.board_rows > MAX_BOARD_ROWS) g.board_rows = DEF_BOARD_ROWS;
+  g.page_secs  = prefs.getUChar("page", DEF_PAGE_SECS);
+  g.clock_style = prefs.getUChar("clk", DEF_CLOCK_STYLE);
+  if (g.clock_style > 2) g.clock_style = DEF_CLOCK_STYLE;
+  g.anim_ms    = prefs.getUShort("anim", DEF_ANIM_MS);
+  if (g.anim_ms > MAX_ANIM_MS) g.anim_ms = DEF_ANIM_MS;
+
+  // Darwin quota
+  g.quota_limit = prefs.getUInt("qlim", DEF_QUOTA_LIMIT);
+  g.quota_days  = prefs.getUChar("qday", DEF_QUOTA_DAYS);
+  g.fleet_size  = prefs.getUChar("fleet", DEF_FLEET_SIZE);
+  if (g.quota_days < 1 || g.quota_days > 31) g.quota_days = DEF_QUOTA_DAYS;
+  if (g.fleet_size < 1) g.fleet_size = DEF_FLEET_SIZE;
+
+  // MQTT
+  copySafe(g.mqtt_host,  sizeof(g.mqtt_host),  prefs.getString("mqh", DEF_MQTT_HOST).c_str(), DEF_MQTT_HOST);
+  g.mqtt_port = prefs.getUShort("mqp", DEF_MQTT_PORT);
+  if (!g.mqtt_port) g.mqtt_port = DEF_MQTT_PORT;
+  copySafe(g.mqtt_topic, sizeof(g.mqtt_topic), prefs.getString("mqt", DEF_MQTT_TOPIC).c_str(), DEF_MQTT_TOPIC);
+
+  // Peer sharing
+  g.peer_share = prefs.getBool("peer", DEF_PEER_SHARE);
+
+  // TLS
+  g.tls_mode = prefs.getUChar("tlsm", DEF_TLS_MODE);
+  if (g.tls_mode > 2) g.tls_mode = DEF_TLS_MODE;
+
+  // Firmware updates
+  copySafe(g.ota_url, sizeof(g.ota_url), prefs.getString("otau", DEF_OTA_URL).c_str(), DEF_OTA_URL);
 }
 
 const Cfg::Settings& Cfg::get(){ return g; }
@@ -153,6 +185,26 @@ const char* Cfg::ssStart()     { return g.ss_start; }
 const char* Cfg::ssEnd()       { return g.ss_end; }
 const char* Cfg::tubeLine()    { return g.tube_line; }
 const char* Cfg::tubeDir()     { return g.tube_dir; }
+uint8_t     Cfg::boardRows()   { return g.board_rows; }
+uint8_t     Cfg::pageSecs()    { return g.page_secs; }
+uint8_t     Cfg::clockStyle()  { return g.clock_style; }
+uint16_t    Cfg::animMs()      { return g.anim_ms; }
+uint32_t    Cfg::quotaLimit()  { return g.quota_limit; }
+uint8_t     Cfg::quotaDays()   { return g.quota_days; }
+uint8_t     Cfg::fleetSize()   { return g.fleet_size; }
+const char* Cfg::mqttHost()    { return g.mqtt_host; }
+uint16_t    Cfg::mqttPort()    { return g.mqtt_port; }
+const char* Cfg::mqttTopic()   { return g.mqtt_topic; }
+bool        Cfg::peerShare()   { return g.peer_share; }
+uint8_t     Cfg::tlsMode()     { return g.tls_mode; }
+const char* Cfg::otaUrl()      { return g.ota_url; }
+
+bool Cfg::screensaverWindow(int& startMin, int& endMin){
+  if (!isHHMM(g.ss_start) || !isHHMM(g.ss_end)) return false;
+  startMin = ((g.ss_start[0]-'0')*10 + (g.ss_start[1]-'0')) * 60 + (g.ss_start[3]-'0')*10 + (g.ss_start[4]-'0');
+  endMin   = ((g.ss_end[0]-'0')*10   + (g.ss_end[1]-'0'))   * 60 + (g.ss_end[3]-'0')*10   + (g.ss_end[4]-'0');
+  return startMin != endMin;
+}
 
 // Setters
 bool Cfg::setWifi(const char* ssid, const char* pass){
@@ -234,6 +286,68 @@ bool Cfg::setTubeDir(const char* dir){
   return prefs.putString("dir", g.tube_dir) >= 0;
 }
 
+bool Cfg::setBoardRows(uint8_t rows){
+  if (rows < 1) rows = 1;
+  if (rows > MAX_BOARD_ROWS) rows = MAX_BOARD_ROWS;
+  g.board_rows = rows;
+  return prefs.putUChar("rows", rows);
+}
+bool Cfg::setPageSecs(uint8_t sec){
+  g.page_secs = sec;
+  return prefs.putUChar("page", sec) > 0;
+}
+
+bool Cfg::setQuota(uint32_t limit, uint8_t days, uint8_t fleet){
+  if (days < 1)  days = 1;
+  if (days > 31) days = 31;
+  if (fleet < 1) fleet = 1;
+  g.quota_limit = limit;
+  g.quota_days  = days;
+  g.fleet_size  = fleet;
+  bool ok=true;
+  ok &= prefs.putUInt ("qlim",  limit) > 0;
+  ok &= prefs.putUChar("qday",  days)  > 0;
+  ok &= prefs.putUChar("fleet", fleet) > 0;
+  return ok;
+}
+
+bool Cfg::setMqtt(const char* host, uint16_t port, const char* topic){
+  // MQTT topic names can't carry wildcards
+  if (topic && (std::strchr(topic, '+') || std::strchr(topic, '#'))) return false;
+  copySafe(g.mqtt_host,  sizeof(g.mqtt_host),  host ? host : "");
+  copySafe(g.mqtt_topic, sizeof(g.mqtt_topic), topic, DEF_MQTT_TOPIC);
+  g.mqtt_port = port ? port : DEF_MQTT_PORT;
+  bool ok=true;
+  ok &= prefs.putString("mqh", g.mqtt_host)  >= 0;
+  ok &= prefs.putUShort("mqp", g.mqtt_port)  > 0;
+  ok &= prefs.putString("mqt", g.mqtt_topic) > 0;
+  return ok;
+}
+
+bool Cfg::setClockStyle(uint8_t style){
+  if (style > 2) return false;
+  g.clock_style = style;
+  return prefs.putUChar("clk", style) > 0;
+}
+bool Cfg::setAnimMs(uint16_t ms){
+  if (ms > MAX_ANIM_MS) return false;
+  g.anim_ms = ms;
+  return prefs.putUShort("anim", ms) > 0;
+}
+bool Cfg::setPeerShare(bool v){ g.peer_share=v; return prefs.putBool("peer", v); }
+bool Cfg::setTlsMode(uint8_t m){
+  if (m > 2) return false;
+  g.tls_mode = m;
+  return prefs.putUChar("tlsm", m) > 0;
+}
+bool Cfg::setOtaUrl(const char* url){
+  // HTTPClient does plain http here. The .trkd hashes only catch corruption,
+  // which is why a pull is operator-started, never automatic (Ota.h).
+  if (url && *url && std::strncmp(url, "http://", 7) != 0) return false;
+  copySafe(g.ota_url, sizeof(g.ota_url), url ? url : "");
+  return prefs.putString("otau", g.ota_url) >= 0;
+}
+
 bool Cfg::save(){
   bool ok=true;
   ok &= prefs.putString("ssid", g.wifi_ssid) > 0;
@@ -256,6 +370,19 @@ bool Cfg::save(){
   ok &= prefs.putString("ss2",  g.ss_end)   > 0;
   ok &= prefs.putString("line", g.tube_line) >= 0;
   ok &= prefs.putString("dir",  g.tube_dir)  >= 0;
+  ok &= prefs.putUChar ("rows", g.board_rows) > 0;
+  ok &= prefs.putUChar ("page", g.page_secs)  > 0;
+  ok &= prefs.putUChar ("clk",  g.clock_style) > 0;
+  ok &= prefs.putUShort("anim", g.anim_ms)    > 0;
+  ok &= prefs.putUInt  ("qlim", g.quota_limit) > 0;
+  ok &= prefs.putUChar ("qday", g.quota_days)  > 0;
+  ok &= prefs.putUChar ("fleet",g.fleet_size)  > 0;
+  ok &= prefs.putString("mqh",  g.mqtt_host)  >= 0;
+  ok &= prefs.putUShort("mqp",  g.mqtt_port)  > 0;
+  ok &= prefs.putString("mqt",  g.mqtt_topic) > 0;
+  ok &= prefs.putBool  ("peer", g.peer_share);
+  ok &= prefs.putUChar ("tlsm", g.tls_mode) > 0;
+  ok &= prefs.putString("otau", g.ota_url)  >= 0;
   return ok;
 }
 
@@ -282,5 +409,18 @@ void Cfg::resetToDefaults(){
   copySafe(g.ss_end,      sizeof(g.ss_end),      DEF_SS_END);
   copySafe(g.tube_line,   sizeof(g.tube_line),   DEF_TUBE_LINE);
   copySafe(g.tube_dir,    sizeof(g.tube_dir),    DEF_TUBE_DIR);
+  g.board_rows      = DEF_BOARD_ROWS;
+  g.page_secs       = DEF_PAGE_SECS;
+  g.clock_style     = DEF_CLOCK_STYLE;
+  g.anim_ms         = DEF_ANIM_MS;
+  g.quota_limit     = DEF_QUOTA_LIMIT;
+  g.quota_days      = DEF_QUOTA_DAYS;
+  g.fleet_size      = DEF_FLEET_SIZE;
+  copySafe(g.mqtt_host,   sizeof(g.mqtt_host),   DEF_MQTT_HOST);
+  g.mqtt_port       = DEF_MQTT_PORT;
+  copySafe(g.mqtt_topic,  sizeof(g.mqtt_topic),  DEF_MQTT_TOPIC);
+  g.peer_share      = DEF_PEER_SHARE;
+  g.tls_mode        = DEF_TLS_MODE;
+  copySafe(g.ota_url,     sizeof(g.ota_url),     DEF_OTA_URL);
   save();
 }
@@ -0,0 +1,435 @@
+#include "HeapTrace.h"
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_spi_flash.h>
+
+// [TRAKKR] Tagged allocation tracing (see HeapTrace.h)
+
+#if TRAKKR_HEAPTRACE
+
+namespace {
+  // 12 bytes per live block; p == nullptr is an empty slot.
+  struct Entry {
+    void*    p;
+    uint32_t size;
+    uint8_t  tag;
+    uint8_t  _pad;
+    uint16_t mark;         // leak window the block was allocated in
+  };
+
+  constexpr uint8_t  MAX_TAGS     = 24;          // id 0 = "other"
+  constexpr int      MAX_TASKS    = 24;
+  constexpr int      MAX_DEPTH    = 6;
+  constexpr int      HIST_BUCKETS = 12;          // <=16, <=32 ... <=16K, bigger
+  constexpr uint32_t BITS_PSRAM    = 13;         // 8192 blocks, 96 KB
+  constexpr uint32_t BITS_INTERNAL = 10;         // 1024 blocks, 12 KB
+  constexpr uint32_t DIFF_CHUNK    = 256;        // entries copied per critical section
+  constexpr int      DIFF_TOP      = 8;
+
+  struct TagStat {
+    uint32_t liveBytes, live, peakBytes, allocs, frees;
+    uint32_t markBytes, markLive;                // at mark()
+    uint32_t hist[HIST_BUCKETS];
+  };
+
+  struct TaskTags { void* handle; uint8_t depth; uint8_t stack[MAX_DEPTH]; };
+
+  const char*   gTagName[MAX_TAGS] = { "other" };
+  volatile int  gTagCount  = 1;
+  TagStat       gStat[MAX_TAGS];
+  TaskTags      gTasks[MAX_TASKS];
+  volatile int  gTaskCount = 0;
+
+  Entry*        gTab   = nullptr;
+  uint32_t      gBits  = 0, gMask = 0, gUsed = 0, gLimit = 0;
+  uint32_t      gUntracked = 0;                  // table full at alloc time
+  uint16_t      gMark  = 0;
+  uint32_t      gMarkMs = 0;
+  portMUX_TYPE  gMux   = portMUX_INITIALIZER_UNLOCKED;
+  DRAM_ATTR volatile bool gOn = false;           // read by the IRAM wrappers
+  DRAM_ATTR volatile uint32_t gCacheOff = 0;     // calls passed over with the flash cache off
+
+  // The bookkeeping below runs from flash and the table may sit in PSRAM,
+  // both behind the cache. A flash write disables the cache, and IRAM code
+  // can allocate meanwhile: such calls are passed over (counted) rather
+  // than faulting. A free missed that way leaves its block in the table.
+  __attribute__((always_inline)) inline bool tracing(){
+    if (!gOn) return false;
+    if (spi_flash_cache_enabled()) return true;
+    gCacheOff = gCacheOff + 1;
+    return false;
+  }
+
+  inline uint32_t home(const void* p){ return ((uint32_t)(uintptr_t)p >> 2) * 2654435769u >> (32 - gBits); }
+
+  inline uint8_t bucket(uint32_t n){
+    uint8_t b = 0;
+    for (uint32_t lim = 16; b < HIST_BUCKETS - 1 && n > lim; lim <<= 1) ++b;
+    return b;
+  }
+
+  // Slot of the calling task, registering it if `add`; -1 if none.
+  int taskSlot(bool add){
+    if (xPortInIsrContext()) return -1;
+    void* h = (void*)xTaskGetCurrentTaskHandle();
+    if (!h) return -1;
+    const int n = gTaskCount;
+    for (int i = 0; i < n; ++i) if (gTasks[i].handle == h) return i;
+    if (!add) return -1;
+    int id = -1;
+    portENTER_CRITICAL(&gMux);
+    int i = 0;
+    for (; i < gTaskCount; ++i) if (gTasks[i].handle == h) break;
+    if (i < gTaskCount) id = i;
+    else if (gTaskCount < MAX_TASKS){
+      gTasks[gTaskCount].handle = h;
+      gTasks[gTaskCount].depth  = 0;
+      id = gTaskCount++;
+    }
+    portEXIT_CRITICAL(&gMux);
+    return id;
+  }
+
+  uint8_t currentTag(){
+    const int t = taskSlot(false);
+    if (t < 0) return 0;
+    const TaskTags& tt = gTasks[t];
+    if (!tt.depth) return 0;
+    return tt.stack[(tt.depth < MAX_DEPTH ? tt.depth : MAX_DEPTH) - 1];
+  }
+
+  uint8_t tagId(const char* name){
+    const int n = gTagCount;
+    for (int i = 0; i < n; ++i) if (gTagName[i] == name) return (uint8_t)i;
+    uint8_t id = 0;
+    portENTER_CRITICAL(&gMux);
+    int i = 0;
+    for (; i < gTagCount; ++i) if (gTagName[i] == name || !strcmp(gTagName[i], name)) break;
+    if (i < gTagCount) id = (uint8_t)i;
+    else if (gTagCount < MAX_TAGS){ gTagName[gTagCount] = name; id = (uint8_t)gTagCount++; }
+    portEXIT_CRITICAL(&gMux);
+    return id;
+  }
+
+  // Callers hold gMux.
+  int32_t find(const void* p){
+    for (uint32_t i = home(p), k = 0; k <= gMask; i = (i + 1) & gMask, ++k){
+      if (gTab[i].p == p) return (int32_t)i;
+      if (!gTab[i].p) return -1;
+    }
+    return -1;
+  }
+
+  // Linear probing with backward-shift deletion, so there are no tombstones.
+  void erase(uint32_t i){
+    for (uint32_t j = i;;){
+      j = (j + 1) & gMask;
+      if (!gTab[j].p) break;
+      const uint32_t k = home(gTab[j].p);
+      const bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+      if (stays) continue;
+      gTab[i] = gTab[j];
+      i = j;
+    }
+    gTab[i].p = nullptr;
+    gUsed--;
+  }
+
+  void onAlloc(void* p, size_t n){
+    const uint8_t tag = currentTag();
+    portENTER_CRITICAL_SAFE(&gMux);
+    if (gTab && find(p) < 0){                    // already there: malloc -> heap_caps_* seen twice
+      if (gUsed >= gLimit) gUntracked++;
+      else {
+        uint32_t i = home(p);
+        while (gTab[i].p) i = (i + 1) & gMask;
+        gTab[i].p = p; gTab[i].size = (uint32_t)n; gTab[i].tag = tag; gTab[i].mark = gMark;
+        gUsed++;
+        TagStat& s = gStat[tag];
+        s.liveBytes += (uint32_t)n; s.live++; s.allocs++;
+        if (s.liveBytes > s.peakBytes) s.peakBytes = s.liveBytes;
+        s.hist[bucket((uint32_t)n)]++;
+      }
+    }
+    portEXIT_CRITICAL_SAFE(&gMux);
+  }
+
+  // Removes p before the real free, so the address can't be reused under us.
+  bool onFree(void* p, Entry* out){
+    bool had = false;
+    portENTER_CRITICAL_SAFE(&gMux);
+    const int32_t i = gTab ? find(p) : -1;
+    if (i >= 0){
+      const Entry e = gTab[i];
+      TagStat& s = gStat[e.tag];
+      s.liveBytes -= e.size; s.live--; s.frees++;
+      erase((uint32_t)i);
+      if (out) *out = e;
+      had = true;
+    }
+    portEXIT_CRITICAL_SAFE(&gMux);
+    return had;
+  }
+
+  // realloc() failed: the old block is still live, put it back as it was.
+  void restore(const Entry& e){
+    portENTER_CRITICAL_SAFE(&gMux);
+    if (gTab && gUsed < gLimit && find(e.p) < 0){
+      uint32_t i = home(e.p);
+      while (gTab[i].p) i = (i + 1) & gMask;
+      gTab[i] = e;
+      gUsed++;
+      TagStat& s = gStat[e.tag];
+      s.liveBytes += e.size; s.live++; s.frees--;
+    }
+    portEXIT_CRITICAL_SAFE(&gMux);
+  }
+
+  // Callers checked tracing().
+  void* traceRealloc(void* p, size_t n, void* (*real)(void*, size_t, void*), void* ctx){
+    if (!p){
+      void* q = real(p, n, ctx);
+      if (q) onAlloc(q, n);
+      return q;
+    }
+    Entry old;
+    const bool had = onFree(p, &old);
+    void* q = real(p, n, ctx);
+    if (q) onAlloc(q, n);
+    else if (n && had) restore(old);
+    return q;
+  }
+
+  void jsonTag(String& j, uint8_t id){ j += "{\"tag\":\""; j += gTagName[id]; j += '"'; }
+}
+
+extern "C" {
+  void* __real_malloc(size_t n);
+  void* __real_calloc(size_t n, size_t sz);
+  void* __real_realloc(void* p, size_t n);
+  void  __real_free(void* p);
+  void* __real_heap_caps_malloc(size_t n, uint32_t caps);
+  void* __real_heap_caps_calloc(size_t n, size_t sz, uint32_t caps);
+  void* __real_heap_caps_realloc(void* p, size_t n, uint32_t caps);
+  void* __real_heap_caps_aligned_alloc(size_t align, size_t n, uint32_t caps);
+  void  __real_heap_caps_free(void* p);
+
+  // The off path is one flag test and stays in IRAM, like the allocator itself;
+  // so does the cache check in tracing().
+  IRAM_ATTR void* __wrap_malloc(size_t n){
+    void* p = __real_malloc(n);
+    if (p && tracing()) onAlloc(p, n);
+    return p;
+  }
+  IRAM_ATTR void* __wrap_calloc(size_t n, size_t sz){
+    void* p = __real_calloc(n, sz);
+    if (p && tracing()) onAlloc(p, n * sz);
+    return p;
+  }
+  IRAM_ATTR void* __wrap_realloc(void* p, size_t n){
+    if (!tracing()) return __real_realloc(p, n);
+    return traceRealloc(p, n, [](void* q, size_t m, void*){ return __real_realloc(q, m); }, nullptr);
+  }
+  IRAM_ATTR void __wrap_free(void* p){
+    if (p && tracing()) onFree(p, nullptr);
+    __real_free(p);
+  }
+  IRAM_ATTR void* __wrap_heap_caps_malloc(size_t n, uint32_t caps){
+    void* p = __real_heap_caps_malloc(n, caps);
+    if (p && tracing()) onAlloc(p, n);
+    return p;
+  }
+  IRAM_ATTR void* __wrap_heap_caps_calloc(size_t n, size_t sz, uint32_t caps){
+    void* p = __real_heap_caps_calloc(n, sz, caps);
+    if (p && tracing()) onAlloc(p, n * sz);
+    return p;
+  }
+  IRAM_ATTR void* __wrap_heap_caps_realloc(void* p, size_t n, uint32_t caps){
+    if (!tracing()) return __real_heap_caps_realloc(p, n, caps);
+    return traceRealloc(p, n, [](void* q, size_t m, void* c){ return __real_heap_caps_realloc(q, m, *(uint32_t*)c); }, &caps);
+  }
+  IRAM_ATTR void* __wrap_heap_caps_aligned_alloc(size_t align, size_t n, uint32_t caps){
+    void* p = __real_heap_caps_aligned_alloc(align, n, caps);
+    if (p && tracing()) onAlloc(p, n);
+    return p;
+  }
+  IRAM_ATTR void __wrap_heap_caps_free(void* p){
+    if (p && tracing()) onFree(p, nullptr);
+    __real_heap_caps_free(p);
+  }
+}
+
+bool HeapTrace::begin(){
+  if (gTab) return true;
+  uint32_t bits = BITS_PSRAM;
+  Entry* t = (Entry*)__real_heap_caps_calloc((size_t)1 << bits, sizeof(Entry), MALLOC_CAP_SPIRAM);
+  if (!t){
+    bits = BITS_INTERNAL;
+    t = (Entry*)__real_heap_caps_calloc((size_t)1 << bits, sizeof(Entry), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  if (!t){ Serial.println("[HEAP] no memory for the block table"); return false; }
+  portENTER_CRITICAL(&gMux);
+  gTab = t; gBits = bits; gMask = (1u << bits) - 1; gLimit = (1u << bits) * 3 / 4; gUsed = 0;
+  portEXIT_CRITICAL(&gMux);
+  Serial.printf("[HEAP] tracing table: %u blocks\n", (unsigned)(1u << bits));
+  return true;
+}
+
+void HeapTrace::setEnabled(bool on){
+  if (on && !begin()) return;
+  if (on == gOn) return;
+  if (on){
+    // Still off, so the wrappers leave the table alone: clear it (96 KB in
+    // PSRAM) outside the critical section, with interrupts on.
+    memset(gTab, 0, (size_t)(gMask + 1) * sizeof(Entry));
+    memset(gStat, 0, sizeof(gStat));
+  }
+  portENTER_CRITICAL(&gMux);
+  if (on){ gUsed = 0; gUntracked = 0; gMark = 0; gCacheOff = 0; }
+  gOn = on;
+  portEXIT_CRITICAL(&gMux);
+  gMarkMs = millis();
+}
+
+bool HeapTrace::enabled(){ return gOn; }
+
+void HeapTrace::push(const char* tag){
+  const int t = taskSlot(true);
+  if (t < 0) return;
+  TaskTags& tt = gTasks[t];
+  if (tt.depth < MAX_DEPTH) tt.stack[tt.depth] = tagId(tag);
+  if (tt.depth < 255) tt.depth++;
+}
+
+void HeapTrace::pop(){
+  const int t = taskSlot(false);
+  if (t >= 0 && gTasks[t].depth) gTasks[t].depth--;
+}
+
+void HeapTrace::mark(){
+  portENTER_CRITICAL(&gMux);
+  gMark++;
+  for (int i = 0; i < MAX_TAGS; ++i){ gStat[i].markBytes = gStat[i].liveBytes; gStat[i].markLive = gStat[i].live; }
+  portEXIT_CRITICAL(&gMux);
+  gMarkMs = millis();
+}
+
+String HeapTrace::statsJSON(){
+  TagStat s[MAX_TAGS];
+  portENTER_CRITICAL(&gMux);
+  memcpy(s, gStat, sizeof(s));
+  const uint32_t used = gUsed, untracked = gUntracked;
+  portEXIT_CRITICAL(&gMux);
+
+  String j; j.reserve(1024);
+  j += "{\"compiled\":true,\"enabled\":"; j += gOn ? "true" : "false";
+  j += ",\"capacity\":";  j += gTab ? (gMask + 1) : 0;
+  j += ",\"tracked\":";   j += used;
+  j += ",\"untracked\":"; j += untracked;
+  j += ",\"cacheOff\":";  j += (uint32_t)gCacheOff;
+  j += ",\"histUpTo\":[";
+  for (int b = 0; b < HIST_BUCKETS - 1; ++b){ if (b) j += ','; j += (16u << b); }
+  j += ",null],\"tags\":[";
+  bool first = true;
+  for (int i = 0; i < gTagCount; ++i){
+    if (!s[i].allocs) continue;
+    if (!first) j += ',';
+    first = false;
+    jsonTag(j, (uint8_t)i);
+    j += ",\"liveBytes\":"; j += s[i].liveBytes;
+    j += ",\"live\":";      j += s[i].live;
+    j += ",\"peakBytes\":"; j += s[i].peakBytes;
+    j += ",\"allocs\":";    j += s[i].allocs;
+    j += ",\"frees\":";     j += s[i].frees;
+    j += ",\"hist\":[";
+    for (int b = 0; b < HIST_BUCKETS; ++b){ if (b) j += ','; j += s[i].hist[b]; }
+    j += "]}";
+  }
+  j += "]}";
+  return j;
+}
+
+String HeapTrace::diffJSON(){
+  if (!gOn) return "{\"err\":\"tracing is off\"}";
+  uint32_t newLive[MAX_TAGS] = {}, newBytes[MAX_TAGS] = {};
+  Entry top[DIFF_TOP] = {};
+  Entry chunk[32];
+  const uint16_t m = gMark;
+  // The table is walked a few entries per lock so the other core keeps allocating.
+  for (uint32_t base = 0; base <= gMask; base += DIFF_CHUNK){
+    for (uint32_t i = base; i < base + DIFF_CHUNK && i <= gMask; i += 32){
+      const uint32_t n = (gMask + 1 - i) < 32 ? (gMask + 1 - i) : 32;
+      portENTER_CRITICAL(&gMux);
+      memcpy(chunk, gTab + i, n * sizeof(Entry));
+      portEXIT_CRITICAL(&gMux);
+      for (uint32_t k = 0; k < n; ++k){
+        const Entry& e = chunk[k];
+        if (!e.p || e.mark != m) continue;
+        newLive[e.tag]++; newBytes[e.tag] += e.size;
+        int at = DIFF_TOP;
+        while (at > 0 && (!top[at - 1].p || top[at - 1].size < e.size)) --at;
+        if (at < DIFF_TOP){
+          for (int s = DIFF_TOP - 1; s > at; --s) top[s] = top[s - 1];
+          top[at] = e;
+        }
+      }
+    }
+  }
+
+  String j; j.reserve(768);
+  j += "{\"sinceMs\":"; j += (uint32_t)(millis() - gMarkMs);
+  j += ",\"tags\":[";
+  bool first = true;
+  for (int i = 0; i < gTagCount; ++i){
+    const int32_t dBytes = (int32_t)(gStat[i].liveBytes - gStat[i].markBytes);
+    const int32_t dLive  = (int32_t)(gStat[i].live - gStat[i].markLive);
+    if (!dBytes && !dLive && !newLive[i]) continue;
+    if (!first) j += ',';
+    first = false;
+    jsonTag(j, (uint8_t)i);
+    j += ",\"liveBytesDelta\":"; j += dBytes;
+    j += ",\"liveDelta\":";      j += dLive;
+    j += ",\"newLive\":";        j += newLive[i];
+    j += ",\"newLiveBytes\":";   j += newBytes[i];
+    j += '}';
+  }
+  j += "],\"largest\":[";
+  for (int i = 0; i < DIFF_TOP && top[i].p; ++i){
+    if (i) j += ',';
+    jsonTag(j, top[i].tag);
+    j += ",\"size\":"; j += top[i].size;
+    j += ",\"addr\":\"0x"; j += String((uint32_t)(uintptr_t)top[i].p, HEX); j += "\"}";
+  }
+  j += "]}";
+  return j;
+}
+
+void HeapTrace::logTop(const char* where, uint8_t n){
+  if (!gOn) return;
+  uint8_t order[MAX_TAGS];
+  const int count = gTagCount;
+  for (int i = 0; i < count; ++i) order[i] = (uint8_t)i;
+  for (int i = 1; i < count; ++i)                    // few tags: insertion sort
+    for (int k = i; k > 0 && gStat[order[k]].liveBytes > gStat[order[k - 1]].liveBytes; --k){
+      const uint8_t t = order[k]; order[k] = order[k - 1]; order[k - 1] = t;
+    }
+  for (int i = 0; i < count && i < n && gStat[order[i]].liveBytes; ++i){
+    const TagStat& s = gStat[order[i]];
+    Serial.printf("[HEAP] %-18s | %-12s live=%uB in %u peak=%uB\n", where, gTagName[order[i]],
+                  (unsigned)s.liveBytes, (unsigned)s.live, (unsigned)s.peakBytes);
+  }
+}
+
+#else   // !TRAKKR_HEAPTRACE
+
+bool   HeapTrace::begin(){ return false; }
+void   HeapTrace::setEnabled(bool){}
+bool   HeapTrace::enabled(){ return false; }
+void   HeapTrace::mark(){}
+String HeapTrace::statsJSON(){ return "{\"compiled\":false,\"enabled\":false}"; }
+String HeapTrace::diffJSON(){ return "{\"err\":\"built without TRAKKR_HEAPTRACE\"}"; }
+void   HeapTrace::logTop(const char*, uint8_t){}
+void   HeapTrace::push(const char*){}
+void   HeapTrace::pop(){}
+
+#endif
@@ -0,0 +1,559 @@
+#include "History.h"
+#include <LittleFS.h>
+#include <algorithm>
+#include <time.h>
+#include <ctype.h>
+#include <freertos/semphr.h>
+#include "TimeSvc.h"
+#include "Global.h"
+
+// [TRAKKR] Departure history (see History.h)
+//
+// Segment file: "TKH1", then blocks:
+//   'B' | nRec u8 | nDict u8 | payloadLen u16 | payload | fnv1a32(all before it)
+//   payload: nDict × (len u8, bytes)                    new dictionary entries
+//            day    varint first, then zigzag deltas
+//            sched  zigzag deltas (minute of day, from 0)
+//            delay  zigzag (minutes)
+//            flags  one byte each
+//            dest   varint dictionary index
+//            plat0  varint index + 1 (0 = none)
+//            plat1  varint index + 1, 0 = same as plat0
+
+namespace {
+  const char*    DIR          = "/hist";
+  const uint8_t  MAGIC[4]     = { 'T', 'K', 'H', '1' };
+  const size_t   OPEN_MAX     = Cfg::MAX_BOARD_ROWS;   // services tracked at once: a whole board
+  const size_t   BLOCK_RECS   = 48;
+  const uint32_t FLUSH_MS     = 2UL * 3600UL * 1000UL;
+  const size_t   SEG_BYTES    = 24 * 1024;
+  const size_t   MAX_SEGS     = 8;
+  const size_t   FS_MIN_FREE  = 64 * 1024;
+  const size_t   DICT_MAX     = 120;
+  const size_t   AGG_MAX      = 96;
+  const int      GRACE_MIN    = 2;               // leaving this close to expected = departed
+  const int      EARLY_MIN    = 10;              // last seen further out than this = left early
+  const uint16_t RECENT_MAX   = 50;
+
+  enum : uint8_t { F_CANCEL = 1, F_PLAT = 2, F_UNKNOWN = 4, F_EARLY = 8, F_ARR = 16 };
+
+  struct Open {
+    uint32_t key;
+    int32_t  schedAbs;                           // minutes since epoch (local)
+    int16_t  delay;
+    uint8_t  flags;
+    int32_t  lastSeenAbs;
+    bool     seen;                               // on this poll's board
+    String   dest, plat0, plat1;
+  };
+
+  struct Rec {
+    uint16_t day, sched;                         // local days since 1970, minute of day
+    int16_t  delay;
+    uint8_t  flags;
+    uint16_t dest, plat0, plat1;                 // dictionary; plat + 1, 0 = none
+  };
+
+  struct Agg {
+    uint32_t n, nDelay, onTime, ppm, late15, cancel, platChg;
+    int32_t  sumDelay;
+  };
+  struct SvcAgg { uint16_t sched; String dest; Agg a; };
+
+  SemaphoreHandle_t    gMutex = nullptr;
+  std::vector<Open>    gOpen;
+  std::vector<Rec>     gPend;
+  uint32_t             gPendSince = 0;
+  std::vector<String>  gDict;                    // current segment's dictionary
+  size_t               gDictOnFlash = 0;         // entries already written
+  std::vector<uint32_t> gSegs;                   // sequence numbers, oldest first
+  uint32_t             gSeq = 0;                 // segment being appended to
+
+  Agg                  gTotal = {};
+  Agg                  gHour[24] = {};
+  std::vector<SvcAgg>  gSvc;
+
+  struct {
+    uint32_t onFlash, blocks, bytes, badBlocks, evicted, dropped;
+  } gStat = {};
+
+  // ---- Calendar (days since 1970-01-01, proleptic Gregorian)
+  int32_t daysFromCivil(int y, unsigned m, unsigned d){
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+  }
+  void civilFromDays(int32_t z, int& y, unsigned& m, unsigned& d){
+    z += 719468;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int)yoe + era * 400 + (m <= 2);
+  }
+
+  int parseHHMM(const String& s){                // minute of day, -1 if not "HH:MM"
+    if (s.length() < 5 || !isdigit((uint8_t)s[0]) || !isdigit((uint8_t)s[1]) || s[2] != ':' ||
+        !isdigit((uint8_t)s[3]) || !isdigit((uint8_t)s[4])) return -1;
+    const int h = (s[0] - '0') * 10 + (s[1] - '0'), m = (s[3] - '0') * 10 + (s[4] - '0');
+    return (h < 24 && m < 60) ? h * 60 + m : -1;
+  }
+  int wrapMin(int d){ return d > 720 ? d - 1440 : (d < -720 ? d + 1440 : d); }
+
+  uint32_t fnv1a(const uint8_t* p, size_t n, uint32_t h = 2166136261u){
+    for (size_t i = 0; i < n; ++i){ h ^= p[i]; h *= 16777619u; }
+    return h;
+  }
+  uint32_t keyOf(const History::Row& r){
+    if (r.id.length()) return fnv1a((const uint8_t*)r.id.c_str(), r.id.length());
+    return fnv1a((const uint8_t*)r.dest.c_str(), r.dest.length(),
+                 fnv1a((const uint8_t*)r.time.c_str(), r.time.length()) ^ 0x7c);
+  }
+
+  // ---- Aggregates
+  void aggApply(Agg& a, const Rec& r, int sign){
+    auto bump = [sign](uint32_t& v){ v = (sign > 0) ? v + 1 : (v ? v - 1 : 0); };
+    bump(a.n);
+    if (r.flags & F_CANCEL){ bump(a.cancel); return; }
+    if (r.flags & F_PLAT) bump(a.platChg);
+    if (r.flags & F_UNKNOWN) return;
+    bump(a.nDelay);
+    a.sumDelay += sign * r.delay;
+    if (r.delay <= 0)  bump(a.onTime);
+    if (r.delay < 5)   bump(a.ppm);                // UK PPM: within 4:59
+    if (r.delay >= 15) bump(a.late15);
+  }
+  void aggRecord(const Rec& r, const String& dest, int sign){
+    aggApply(gTotal, r, sign);
+    aggApply(gHour[(r.sched / 60) % 24], r, sign);
+    size_t i = 0;
+    for (; i < gSvc.size(); ++i) if (gSvc[i].sched == r.sched && gSvc[i].dest == dest) break;
+    if (i == gSvc.size()){
+      if (sign < 0) return;                        // evicted earlier: nothing to take back
+      if (gSvc.size() >= AGG_MAX){                 // bounded: the least-seen service makes room
+        size_t lo = 0;
+        for (size_t k = 1; k < gSvc.size(); ++k) if (gSvc[k].a.n < gSvc[lo].a.n) lo = k;
+        gSvc.erase(gSvc.begin() + lo);
+        gStat.evicted++;
+      }
+      SvcAgg s; s.sched = r.sched; s.dest = dest; s.a = Agg();
+      gSvc.push_back(s);
+      i = gSvc.size() - 1;
+    }
+    aggApply(gSvc[i].a, r, sign);
+    if (!gSvc[i].a.n) gSvc.erase(gSvc.begin() + i);
+  }
+
+  // ---- Varints
+  void putVar(std::vector<uint8_t>& o, uint32_t v){
+    while (v >= 0x80){ o.push_back((uint8_t)(v | 0x80)); v >>= 7; }
+    o.push_back((uint8_t)v);
+  }
+  uint32_t zig(int32_t v){ return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+  int32_t  unzig(uint32_t v){ return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+  struct Reader {
+    const uint8_t* p; const uint8_t* end; bool ok;
+    uint32_t var(){
+      uint32_t v = 0; int sh = 0;
+      while (p < end && sh < 35){ const uint8_t b = *p++; v |= (uint32_t)(b & 0x7f) << sh; if (!(b & 0x80)) return v; sh += 7; }
+      ok = false; return 0;
+    }
+  };
+
+  String segPath(uint32_t seq){ char b[24]; snprintf(b, sizeof(b), "%s/%08lu.seg", DIR, (unsigned long)seq); return String(b); }
+
+  // ---- Block codec
+  void encodeBlock(std::vector<uint8_t>& out){
+    std::vector<uint8_t> pl; pl.reserve(gPend.size() * 8 + 64);
+    const size_t nDict = gDict.size() - gDictOnFlash;
+    for (size_t i = gDictOnFlash; i < gDict.size(); ++i){
+      const String& s = gDict[i];
+      const size_t n = s.length() < 255 ? s.length() : 255;
+      pl.push_back((uint8_t)n); pl.insert(pl.end(), (const uint8_t*)s.c_str(), (const uint8_t*)s.c_str() + n);
+    }
+    int32_t prev = 0;
+    for (size_t i = 0; i < gPend.size(); ++i){
+      if (i == 0) putVar(pl, gPend[0].day); else putVar(pl, zig((int32_t)gPend[i].day - prev));
+      prev = gPend[i].day;
+    }
+    prev = 0;
+    for (const Rec& r : gPend){ putVar(pl, zig((int32_t)r.sched - prev)); prev = r.sched; }
+    for (const Rec& r : gPend) putVar(pl, zig(r.delay));
+    for (const Rec& r : gPend) pl.push_back(r.flags);
+    for (const Rec& r : gPend) putVar(pl, r.dest);
+    for (const Rec& r : gPend) putVar(pl, r.plat0);
+    for (const Rec& r : gPend) putVar(pl, r.plat1 == r.plat0 ? 0 : r.plat1);
+
+    out.clear();
+    out.push_back('B'); out.push_back((uint8_t)gPend.size()); out.push_back((uint8_t)nDict);
+    out.push_back((uint8_t)(pl.size() & 0xff)); out.push_back((uint8_t)(pl.size() >> 8));
+    out.insert(out.end(), pl.begin(), pl.end());
+    const uint32_t h = fnv1a(out.data(), out.size());
+    for (int k = 0; k < 4; ++k) out.push_back((uint8_t)(h >> (8 * k)));
+  }
+
+  typedef void (*RecFn)(const Rec& r, const std::vector<String>& dict, void* ctx);
+
+  // Decode one segment in order; dict ends up as the segment's dictionary.
+  // False if it ends in a torn or corrupt block (everything before is used).
+  bool readSegment(uint32_t seq, std::vector<String>& dict, RecFn fn, void* ctx){
+    dict.clear();
+    File f = LittleFS.open(segPath(seq), "r");
+    if (!f) return false;
+    uint8_t m[4];
+    if (f.read(m, 4) != 4 || memcmp(m, MAGIC, 4) != 0){ f.close(); return false; }
+    std::vector<uint8_t> blk;
+    std::vector<Rec> recs;
+    bool clean = true;
+    while (f.available()){
+      uint8_t hd[5];
+      if (f.read(hd, 5) != 5 || hd[0] != 'B'){ clean = false; break; }
+      const size_t nRec = hd[1], nDict = hd[2], len = hd[3] | (hd[4] << 8);
+      blk.assign(hd, hd + 5); blk.resize(5 + len + 4);
+      if (f.read(blk.data() + 5, len + 4) != len + 4){ clean = false; break; }
+      uint32_t want = 0; for (int k = 0; k < 4; ++k) want |= (uint32_t)blk[5 + len + k] << (8 * k);
+      if (fnv1a(blk.data(), 5 + len) != want){ clean = false; break; }
+
+      Reader rd{ blk.data() + 5, blk.data() + 5 + len, true };
+      for (size_t i = 0; i < nDict && rd.ok; ++i){
+        if (rd.p >= rd.end){ rd.ok = false; break; }
+        const size_t n = *rd.p++;
+        if ((size_t)(rd.end - rd.p) < n){ rd.ok = false; break; }
+        String s; s.reserve(n); for (size_t k = 0; k < n; ++k) s += (char)rd.p[k];
+        rd.p += n; dict.push_back(s);
+      }
+      recs.assign(nRec, Rec());
+      int32_t prev = 0;
+      for (size_t i = 0; i < nRec; ++i){ prev = i ? prev + unzig(rd.var()) : (int32_t)rd.var(); recs[i].day = (uint16_t)prev; }
+      prev = 0;
+      for (size_t i = 0; i < nRec; ++i){ prev += unzig(rd.var()); recs[i].sched = (uint16_t)prev; }
+      for (size_t i = 0; i < nRec; ++i) recs[i].delay = (int16_t)unzig(rd.var());
+      for (size_t i = 0; i < nRec; ++i){ if (rd.p < rd.end) recs[i].flags = *rd.p++; else rd.ok = false; }
+      for (size_t i = 0; i < nRec; ++i) recs[i].dest  = (uint16_t)rd.var();
+      for (size_t i = 0; i < nRec; ++i) recs[i].plat0 = (uint16_t)rd.var();
+      for (size_t i = 0; i < nRec; ++i){ const uint32_t v = rd.var(); recs[i].plat1 = (uint16_t)(v ? v : recs[i].plat0); }
+      if (!rd.ok){ clean = false; break; }
+      for (const Rec& r : recs) if (r.dest < dict.size() && fn) fn(r, dict, ctx);
+    }
+    f.close();
+    if (!clean) gStat.badBlocks++;
+    return clean;
+  }
+
+  void countRec(const Rec& r, const std::vector<String>& dict, void* sign){
+    aggRecord(r, dict[r.dest], (int)(intptr_t)sign);
+    if ((intptr_t)sign > 0) gStat.onFlash++; else if (gStat.onFlash) gStat.onFlash--;
+  }
+
+  // ---- Segments
+  size_t segBytes(uint32_t seq){
+    File f = LittleFS.open(segPath(seq), "r");
+    const size_t n = f ? f.size() : 0;
+    if (f) f.close();
+    return n;
+  }
+  void dropOldest(){
+    if (gSegs.size() <= 1) return;                 // never the one being appended to
+    const uint32_t seq = gSegs.front();
+    std::vector<String> dict;
+    readSegment(seq, dict, countRec, (void*)(intptr_t)-1);
+    LittleFS.remove(segPath(seq));
+    gSegs.erase(gSegs.begin());
+    gStat.dropped++;
+  }
+  void rotate(){
+    gSeq++;
+    gSegs.push_back(gSeq);
+    gDict.clear(); gDictOnFlash = 0;
+    while (gSegs.size() > MAX_SEGS) dropOldest();
+  }
+
+  void writeBlock(){
+    if (gPend.empty()) return;
+    while (gSegs.size() > 1 && LittleFS.totalBytes() - LittleFS.usedBytes() < FS_MIN_FREE) dropOldest();
+    std::vector<uint8_t> blk; encodeBlock(blk);
+    const String path = segPath(gSeq);
+    File f = LittleFS.open(path, "a");
+    if (!f){ Serial.println("[HIST][ERR] open segment failed"); return; }   // keep them; retry next time
+    bool ok = true;
+    if (f.size() == 0) ok = f.write(MAGIC, 4) == 4;
+    ok = ok && f.write(blk.data(), blk.size()) == blk.size();
+    const size_t size = f.size();
+    f.close();
+    if (!ok){ Serial.println("[HIST][ERR] segment write failed"); return; }
+    gStat.blocks++; gStat.bytes += blk.size(); gStat.onFlash += gPend.size();
+    gPend.clear(); gDictOnFlash = gDict.size();
+    if (size >= SEG_BYTES) rotate();
+  }
+
+  int dictIndex(const String& s){
+    for (size_t i = 0; i < gDict.size(); ++i) if (gDict[i] == s) return (int)i;
+    if (gDict.size() >= DICT_MAX) return -1;
+    gDict.push_back(s);
+    return (int)gDict.size() - 1;
+  }
+
+  // Open entry → record (pending block), aggregates updated right away
+  void close(const Open& o, bool arrivals){
+    Rec r;
+    r.day   = (uint16_t)(o.schedAbs / 1440);
+    r.sched = (uint16_t)(o.schedAbs % 1440);
+    r.delay = o.delay;
+    r.flags = o.flags | (arrivals ? F_ARR : 0);
+    if (o.plat0.length() && o.plat1.length() && o.plat0 != o.plat1) r.flags |= F_PLAT;
+    if (o.lastSeenAbs < o.schedAbs + o.delay - EARLY_MIN) r.flags |= F_EARLY;
+
+    for (int pass = 0; pass < 2; ++pass){
+      const size_t mark = gDict.size();
+      const int d  = dictIndex(o.dest);
+      const int p0 = o.plat0.length() ? dictIndex(o.plat0) : -1;
+      const int p1 = o.plat1.length() ? dictIndex(o.plat1) : p0;
+      if (d >= 0 && (p0 >= 0 || !o.plat0.length()) && (p1 >= 0 || !o.plat1.length())){
+        r.dest = (uint16_t)d; r.plat0 = (uint16_t)(p0 + 1); r.plat1 = (uint16_t)(p1 + 1);
+        break;
+      }
+      gDict.resize(mark);                          // dictionary full: close this segment first
+      if (pass) return;
+      writeBlock();
+      if (!gPend.empty()) return;                  // couldn't write: the pending block still needs this dictionary
+      rotate();
+    }
+    if (gPend.empty()) gPendSince = millis();
+    gPend.push_back(r);
+    aggRecord(r, o.dest, +1);
+    if (gPend.size() >= BLOCK_RECS) writeBlock();
+  }
+
+  void addAggJSON(String& j, const Agg& a){
+    j += "\"n\":"; j += a.n;
+    j += ",\"cancelled\":"; j += a.cancel;
+    j += ",\"platformChanges\":"; j += a.platChg;
+    if (a.nDelay){
+      j += ",\"avgDelay\":"; j += String((float)a.sumDelay / a.nDelay, 1);
+      j += ",\"onTimePct\":"; j += String(100.0f * a.onTime / a.nDelay, 1);
+      j += ",\"ppmPct\":";    j += String(100.0f * a.ppm / a.nDelay, 1);
+      j += ",\"late15Pct\":"; j += String(100.0f * a.late15 / a.nDelay, 1);
+    }
+  }
+  String esc(const String& s){
+    String o; o.reserve(s.length() + 2);
+    for (size_t i = 0; i < s.length(); ++i){ const char c = s[i]; if (c == '"' || c == '\\') o += '\\'; if ((uint8_t)c >= 0x20) o += c; }
+    return o;
+  }
+  String hhmm(uint16_t m){ char b[6]; snprintf(b, sizeof(b), "%02u:%02u", (unsigned)(m / 60), (unsigned)(m % 60)); return String(b); }
+  String dateOf(uint16_t day){
+    int y; unsigned mo, d; civilFromDays(day, y, mo, d);
+    char b[12]; snprintf(b, sizeof(b), "%04d-%02u-%02u", y, mo, d); return String(b);
+  }
+  bool destMatch(const String& dest, const char* prefix){
+    if (!prefix || !*prefix) return true;
+    for (size_t i = 0; prefix[i]; ++i)
+      if (i >= dest.length() || tolower((uint8_t)dest[i]) != tolower((uint8_t)prefix[i])) return false;
+    return true;
+  }
+
+  // Newest records for /api/history, bounded ring
+  struct Recent {
+    int sched; const char* dest; uint16_t max;
+    std::vector<String> rows; size_t head;
+  };
+  void recentRec(const Rec& r, const std::vector<String>& dict, void* ctx){
+    Recent& q = *(Recent*)ctx;
+    if (q.sched >= 0 && r.sched != q.sched) return;
+    const String& dest = dict[r.dest];
+    if (!destMatch(dest, q.dest)) return;
+    String j; j.reserve(128);
+    j += "{\"date\":\""; j += dateOf(r.day); j += "\",\"time\":\""; j += hhmm(r.sched);
+    j += "\",\"dest\":\""; j += esc(dest); j += '"';
+    if (r.flags & F_CANCEL) j += ",\"cancelled\":true";
+    else if (r.flags & F_UNKNOWN) j += ",\"delay\":null";
+    else { j += ",\"delay\":"; j += r.delay; }
+    if (r.plat1 && r.plat1 <= dict.size()){ j += ",\"plat\":\""; j += esc(dict[r.plat1 - 1]); j += '"'; }
+    if ((r.flags & F_PLAT) && r.plat0 && r.plat0 <= dict.size()){ j += ",\"platWas\":\""; j += esc(dict[r.plat0 - 1]); j += '"'; }
+    if (r.flags & F_EARLY) j += ",\"leftEarly\":true";
+    if (r.flags & F_ARR)   j += ",\"arrival\":true";
+    j += '}';
+    if (q.rows.size() < q.max) q.rows.push_back(j);
+    else { q.rows[q.head] = j; q.head = (q.head + 1) % q.max; }
+  }
+}
+
+void History::begin(){
+  if (!gMutex) gMutex = xSemaphoreCreateMutex();
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  if (!LittleFS.exists(DIR)) LittleFS.mkdir(DIR);
+  gSegs.clear();
+  File dir = LittleFS.open(DIR);
+  if (dir && dir.isDirectory()){
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()){
+      const char* n = f.name(); const char* base = strrchr(n, '/'); base = base ? base + 1 : n;
+      if (strstr(base, ".seg")) gSegs.push_back((uint32_t)strtoul(base, nullptr, 10));
+      f.close();
+    }
+    dir.close();
+  }
+  std::sort(gSegs.begin(), gSegs.end());
+
+  gTotal = Agg(); for (Agg& h : gHour) h = Agg(); gSvc.clear(); gStat = {};
+  bool tailClean = true;
+  for (uint32_t seq : gSegs) tailClean = readSegment(seq, gDict, countRec, (void*)(intptr_t)1);
+
+  if (gSegs.empty()){ gSeq = 1; gSegs.push_back(gSeq); gDict.clear(); }
+  else {
+    gSeq = gSegs.back();
+    if (!tailClean){ gDict.clear(); rotate(); }    // never append after a torn block
+  }
+  gDictOnFlash = gDict.size();
+  gOpen.reserve(std::min<size_t>(OPEN_MAX, Cfg::boardRows() + 8u));
+  xSemaphoreGive(gMutex);
+  Serial.printf("[HIST] %u segment(s), %lu record(s)\n", (unsigned)gSegs.size(), (unsigned long)gStat.onFlash);
+}
+
+void History::record(const std::vector<Row>& rows, bool arrivals){
+  if (!gMutex || !TimeSvc::valid()) return;        // no clock, no dates
+  time_t t = time(nullptr); struct tm tm{}; localtime_r(&t, &tm);
+  const int32_t today  = daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+  const int32_t nowAbs = today * 1440 + tm.tm_hour * 60 + tm.tm_min;
+
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  // Mark what is still listed first, so making room below never closes a
+  // service that is on this board.
+  for (Open& o : gOpen) o.seen = false;
+  for (const Row& r : rows){
+    if (parseHHMM(r.time) < 0) continue;
+    const uint32_t key = keyOf(r);
+    for (Open& e : gOpen) if (e.key == key){ e.seen = true; break; }
+  }
+
+  for (const Row& r : rows){
+    const int sched = parseHHMM(r.time);
+    if (sched < 0) continue;
+    const uint32_t key = keyOf(r);
+    Open* o = nullptr;
+    for (Open& e : gOpen) if (e.key == key){ o = &e; break; }
+    if (!o){
+      if (gOpen.size() >= OPEN_MAX){               // full: the unlisted one due soonest goes now
+        size_t lo = gOpen.size();
+        for (size_t k = 0; k < gOpen.size(); ++k)
+          if (!gOpen[k].seen && (lo == gOpen.size() || gOpen[k].schedAbs < gOpen[lo].schedAbs)) lo = k;
+        if (lo == gOpen.size()) continue;          // all listed (can't outgrow a board): not tracked
+        close(gOpen[lo], arrivals);
+        gOpen.erase(gOpen.begin() + lo);
+      }
+      Open e;
+      e.key = key; e.delay = 0; e.flags = 0;
+      e.schedAbs = nowAbs + wrapMin(sched - (int)(nowAbs % 1440));   // 00:10 seen at 23:50 is tomorrow
+      e.dest = r.dest; e.plat0 = r.plat;
+      gOpen.push_back(e);
+      o = &gOpen.back();
+    }
+    o->seen = true;
+    o->lastSeenAbs = nowAbs;
+    if (r.plat.length()) o->plat1 = r.plat;
+    if (!o->plat0.length()) o->plat0 = r.plat;
+
+    String est = r.est; est.toLowerCase();
+    const int e = parseHHMM(r.est);
+    if (e >= 0){ o->delay = (int16_t)wrapMin(e - sched); o->flags &= ~F_UNKNOWN; }
+    else if (est.indexOf("on time") >= 0){ o->delay = 0; o->flags &= ~F_UNKNOWN; }
+    else if (est.indexOf("cancel") >= 0) o->flags |= F_CANCEL;
+    else if (est.indexOf("delay") >= 0)  o->flags |= F_UNKNOWN;
+    if (est.indexOf("cancel") < 0) o->flags &= ~F_CANCEL;    // reinstated
+  }
+
+  // Gone from the board: departed if it was due (or cancelled), otherwise it
+  // may just have slipped past the row limit and can come back.
+  for (size_t i = 0; i < gOpen.size();){
+    const Open& o = gOpen[i];
+    if (!o.seen && ((o.flags & F_CANCEL) || nowAbs >= o.schedAbs + o.delay - GRACE_MIN)){
+      close(o, arrivals);
+      gOpen.erase(gOpen.begin() + i);
+    } else ++i;
+  }
+
+  if (!gPend.empty() && millis() - gPendSince >= FLUSH_MS) writeBlock();
+  xSemaphoreGive(gMutex);
+}
+
+void History::flush(){
+  if (!gMutex) return;
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  writeBlock();
+  xSemaphoreGive(gMutex);
+}
+
+void History::clear(){
+  if (!gMutex) return;
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  for (uint32_t seq : gSegs) LittleFS.remove(segPath(seq));
+  gSegs.clear(); gPend.clear(); gOpen.clear(); gDict.clear(); gDictOnFlash = 0;
+  gTotal = Agg(); for (Agg& h : gHour) h = Agg(); gSvc.clear(); gStat = {};
+  gSeq++; gSegs.push_back(gSeq);
+  xSemaphoreGive(gMutex);
+}
+
+String History::queryJSON(const char* time, const char* dest, uint16_t recent){
+  if (!gMutex) return "{\"err\":\"not started\"}";
+  const int sched = (time && *time) ? parseHHMM(String(time)) : -1;
+  if (time && *time && sched < 0) return "{\"err\":\"time must be HH:MM\"}";
+  recent = min(recent, RECENT_MAX);
+
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  String j; j.reserve(1024);
+  j += "{\"records\":"; j += (unsigned long)(gStat.onFlash + gPend.size());
+  j += ",\"onFlash\":"; j += gStat.onFlash;
+  j += ",\"pending\":"; j += (unsigned)gPend.size();
+  j += ",\"open\":";    j += (unsigned)gOpen.size();
+  j += ",\"segments\":"; j += (unsigned)gSegs.size();
+  j += ",\"blocksWritten\":"; j += gStat.blocks;
+  if (gStat.blocks){ j += ",\"bytesPerRecord\":"; j += String((float)gStat.bytes / max<uint32_t>(1, gStat.onFlash), 1); }
+  j += ",\"badBlocks\":"; j += gStat.badBlocks;
+  j += ",\"segmentsDropped\":"; j += gStat.dropped;
+  j += ",\"servicesEvicted\":"; j += gStat.evicted;
+
+  if (sched < 0){
+    j += ",\"total\":{"; addAggJSON(j, gTotal); j += '}';
+    j += ",\"byHour\":[";
+    bool first = true;
+    for (int h = 0; h < 24; ++h){
+      if (!gHour[h].n) continue;
+      if (!first) j += ','; first = false;
+      j += "{\"hour\":"; j += h; j += ','; addAggJSON(j, gHour[h]); j += '}';
+    }
+    j += "],\"services\":"; j += (unsigned)gSvc.size();
+  } else {
+    j += ",\"time\":\""; j += hhmm((uint16_t)sched); j += "\",\"matches\":[";
+    bool first = true;
+    for (const SvcAgg& s : gSvc){
+      if (s.sched != sched || !destMatch(s.dest, dest)) continue;
+      if (!first) j += ','; first = false;
+      j += "{\"dest\":\""; j += esc(s.dest); j += "\","; addAggJSON(j, s.a); j += '}';
+    }
+    j += ']';
+  }
+
+  if (recent){
+    Recent q{ sched, dest, recent, {}, 0 };
+    q.rows.reserve(recent);
+    std::vector<String> dict;
+    if (!gSegs.empty()) readSegment(gSegs.back(), dict, recentRec, &q);
+    for (const Rec& r : gPend) recentRec(r, gDict, &q);
+    j += ",\"recent\":[";
+    for (size_t k = 0; k < q.rows.size(); ++k){     // newest first
+      const size_t idx = (q.head + q.rows.size() - 1 - k) % q.rows.size();
+      if (k) j += ',';
+      j += q.rows[idx];
+    }
+    j += ']';
+  }
+  xSemaphoreGive(gMutex);
+  j += '}';
+  return j;
+}
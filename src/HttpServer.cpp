@@ -5,6 +5,14 @@
 #include <LittleFS.h>
 #include <ESPmDNS.h>
 #include "Api.h"       // your API glue (adds /api/* routes)
+#include "Trace.h"
+#include "Assets.h"
+#include "Quota.h"
+#include "History.h"
+#include "TimeSvc.h"
+#include "HeapTrace.h"
+#include "Supervisor.h"
+#include <esp_timer.h>
 
 //
 // [TRAKKR] Reboot scheduling (used by /api/settings and /reboot)
@@ -17,6 +25,26 @@ void scheduleReboot(uint32_t delayMs){
   sRebootAtMs    = millis() + (delayMs ? delayMs : 1);
 }
 
+void rebootNow(const char* why){
+  Serial.printf("[TRAKKR] Rebooting: %s\n", why);
+  Supervisor::noteReboot(why);
+  Quota::flush();
+  History::flush();
+  TimeSvc::persist();
+  Serial.flush();
+  delay(50);
+  ESP.restart();
+}
+
+// [TRAKKR] Supervisor restart of the web server: WebServer isn't thread-safe,
+// so the loop task does it on its next pass.
+static volatile bool sRestartPending = false;
+
+bool http_restart(){
+  sRestartPending = true;
+  return true;
+}
+
 // [TRAKKR] Single global server on port 80
 static WebServer server(80);
 
@@ -37,7 +65,27 @@ static String contentType(const String& path){
   return "application/octet-stream";
 }
 
+// [TRAKKR] Mapped asset bundle first: body goes to the socket straight from flash.
+static bool tryServeAsset(const String& path){
+  Assets::Entry a;
+  if (!Assets::find(path.c_str(), a)) return false;
+  const bool gz = a.flags & Assets::FLAG_GZIP;
+  if (gz && server.header("Accept-Encoding").indexOf("gzip") < 0) return false;   // LittleFS has the plain copy
+
+  char etag[12]; snprintf(etag, sizeof(etag), "\"%08x\"", (unsigned)a.etag);
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");   // always revalidate; 304s are cheap
+  if (server.header("If-None-Match") == etag){
+    server.send(304);
+    return true;
+  }
+  if (gz) server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, a.ctype, (PGM_P)a.data, a.size);
+  return true;
+}
+
 static bool tryServeFile(const String& path){
+  if (tryServeAsset(path)) return true;
   if (!LittleFS.exists(path)) return false;
   File f = LittleFS.open(path, "r");
   if (!f) return false;
@@ -80,18 +128,30 @@ void http_setup(){
   // API routes (index.htm + token.htm talk to these)
   Api_attach(server);
 
+  // Request headers the asset server looks at
+  static const char* kHdrs[] = { "If-None-Match", "Accept-Encoding" };
+  server.collectHeaders(kHdrs, 2);
+
   server.begin();
+  Supervisor::setRestart(Supervisor::P_HTTP, http_restart);
 }
 
 void http_loop(){
-  server.handleClient();
+  Supervisor::beat(Supervisor::P_LOOP);
+  if (sRestartPending){
+    sRestartPending = false;
+    server.stop();
+    server.begin();
+    Serial.println("[HTTP] server restarted");
+  }
+
+  const uint32_t t0 = (uint32_t)esp_timer_get_time();
+  { HeapTrace::Scope hs("http"); server.handleClient(); }
+  Trace::spanSince("http", t0, 500);   // idle polls stay out of the trace
 
   // [TRAKKR] Execute any scheduled reboot AFTER we've had a chance to send responses
   if (sRebootPending && (int32_t)(millis() - sRebootAtMs) >= 0){
     sRebootPending = false;
-    Serial.println("[TRAKKR] Rebooting to apply settings…");
-    Serial.flush();
-    delay(50);
-    ESP.restart();
+    rebootNow("scheduled");           // settings, firmware or /reboot
   }
 }
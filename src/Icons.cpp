@@ -0,0 +1,154 @@
+#include "Icons.h"
+#include <vector>
+#include <ctype.h>
+#include <esp_heap_caps.h>
+#include "Assets.h"
+#include "Pixel.h"
+#include "HeapTrace.h"
+
+// [TRAKKR] Operator icon cache (see Icons.h)
+//
+// .tki: "TKI1" | w u8 | h u8 | colours u8 | 0 | 16 × (RGB565 u16, alpha u8 0..32)
+//       | (w*h + 1) / 2 bytes of 4 bpp indices, high nibble first
+
+namespace {
+  const int      MAX_W = 96, MAX_H = 22;         // scripts/mkicons.py refuses anything bigger
+  const size_t   SLOTS_PSRAM    = 24;            // ~100 KB: every operator on a busy board, both row colours
+  const size_t   SLOTS_INTERNAL = 4;
+  const size_t   MISSING_MAX    = 64;
+  const size_t   HDR = 8, PAL = 16 * 3;
+
+  struct Slot {
+    uint16_t  code, bg;                          // code 0 = free
+    uint8_t   w, h;
+    uint32_t  used;                              // LRU tick
+    uint16_t* px;                                // MAX_W x MAX_H
+  };
+
+  std::vector<Slot>     gSlot;
+  std::vector<uint16_t> gMissing;                // codes with no (valid) icon in the bundle
+  uint16_t*             gArena = nullptr;
+  uint32_t              gTick = 0;
+
+  struct {
+    uint32_t hits, decodes, evictions, bad, maxDecodeUs;
+    bool     psram;
+  } gStat = {};
+
+  uint16_t codeOf(const char* toc){
+    if (!toc || !isalnum((uint8_t)toc[0]) || !isalnum((uint8_t)toc[1]) || toc[2]) return 0;
+    return (uint16_t)(((uint8_t)toc[0] << 8) | (uint8_t)toc[1]);
+  }
+
+  // a over b, alpha 0..32, plain RGB565 in and out
+  uint16_t blend565(uint16_t a, uint16_t b, uint8_t al){
+    const uint32_t ia = 32 - al;
+    const uint32_t r = (((a >> 11) & 31) * al + ((b >> 11) & 31) * ia) >> 5;
+    const uint32_t g = (((a >> 5) & 63) * al + ((b >> 5) & 63) * ia) >> 5;
+    const uint32_t bl = ((a & 31) * al + (b & 31) * ia) >> 5;
+    return (uint16_t)((r << 11) | (g << 5) | bl);
+  }
+
+  bool decode(const Assets::Entry& e, uint16_t bg, Slot& s){
+    const uint8_t* d = e.data;
+    if (e.size < HDR + PAL || memcmp(d, "TKI1", 4)) return false;
+    const uint8_t w = d[4], h = d[5], n = d[6];
+    if (!w || !h || w > MAX_W || h > MAX_H || !n || n > 16) return false;
+    if (e.size != HDR + PAL + ((size_t)w * h + 1) / 2) return false;
+
+    uint16_t pal[16];
+    for (int i = 0; i < 16; ++i){
+      const uint8_t* p = d + HDR + i * 3;
+      const uint8_t al = p[2] > 32 ? 32 : p[2];
+      pal[i] = Pixel::panel(blend565((uint16_t)(p[0] | (p[1] << 8)), bg, al));
+    }
+    Pixel::expand4(s.px, d + HDR + PAL, (size_t)w * h, pal);
+    s.w = w; s.h = h;
+    return true;
+  }
+
+  bool missing(uint16_t code){
+    for (uint16_t m : gMissing) if (m == code) return true;
+    return false;
+  }
+}
+
+void Icons::begin(){
+  if (gArena || !Assets::ready()) return;
+  HeapTrace::Scope hs("sprites");
+  const size_t slotPx = (size_t)MAX_W * MAX_H;
+  size_t n = SLOTS_PSRAM;
+  gArena = (uint16_t*)heap_caps_malloc(n * slotPx * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+  gStat.psram = gArena != nullptr;
+  if (!gArena){
+    n = SLOTS_INTERNAL;
+    gArena = (uint16_t*)heap_caps_malloc(n * slotPx * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!gArena){ Serial.println("[ICONS] no memory for the cache; operators stay text"); return; }
+  }
+  gSlot.resize(n);
+  for (size_t i = 0; i < n; ++i){
+    Slot& s = gSlot[i];
+    s.code = 0; s.bg = 0; s.w = s.h = 0; s.used = 0;
+    s.px = gArena + i * slotPx;
+  }
+  gMissing.reserve(MISSING_MAX);
+  Serial.printf("[ICONS] %u slots (%s)\n", (unsigned)n, gStat.psram ? "PSRAM" : "internal");
+}
+
+bool Icons::get(const char* toc, uint16_t bg, Icon& out){
+  const uint16_t code = codeOf(toc);
+  if (!code || gSlot.empty()) return false;
+
+  Slot* lru = &gSlot[0];
+  for (Slot& s : gSlot){
+    if (s.code == code && s.bg == bg){
+      s.used = ++gTick; gStat.hits++;
+      out.px = s.px; out.w = s.w; out.h = s.h;
+      return true;
+    }
+    if (s.used < lru->used) lru = &s;            // free slots have used = 0
+  }
+  if (missing(code)) return false;
+
+  char path[16];
+  snprintf(path, sizeof(path), "/icons/%s.tki", toc);
+  Assets::Entry e;
+  const uint32_t t0 = micros();
+  const bool found = Assets::find(path, e);
+  if (!found || !decode(e, bg, *lru)){
+    if (gMissing.size() < MISSING_MAX) gMissing.push_back(code);
+    if (found){                                  // a failed decode may have half-written it
+      gStat.bad++;
+      lru->code = 0; lru->used = 0;
+    }
+    return false;
+  }
+  const uint32_t us = micros() - t0;
+  if (us > gStat.maxDecodeUs) gStat.maxDecodeUs = us;
+  if (lru->code) gStat.evictions++;
+  gStat.decodes++;
+  lru->code = code; lru->bg = bg; lru->used = ++gTick;
+  out.px = lru->px; out.w = lru->w; out.h = lru->h;
+  return true;
+}
+
+String Icons::statsJSON(){
+  String j; j.reserve(256);
+  size_t used = 0;
+  for (const Slot& s : gSlot) if (s.code) used++;
+  j += "{\"slots\":";      j += String((unsigned)gSlot.size());
+  j += ",\"used\":";       j += String((unsigned)used);
+  j += ",\"psram\":";      j += gStat.psram ? "true" : "false";
+  j += ",\"hits\":";       j += String(gStat.hits);
+  j += ",\"decodes\":";    j += String(gStat.decodes);
+  j += ",\"evictions\":";  j += String(gStat.evictions);
+  j += ",\"maxDecodeUs\":"; j += String(gStat.maxDecodeUs);
+  j += ",\"missing\":[";
+  for (size_t i = 0; i < gMissing.size(); ++i){
+    if (i) j += ',';
+    j += '"'; j += (char)(gMissing[i] >> 8); j += (char)(gMissing[i] & 0xFF); j += '"';
+  }
+  j += "],\"bad\":";       j += String(gStat.bad);
+  j += '}';
+  return j;
+}
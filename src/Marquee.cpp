@@ -0,0 +1,155 @@
+#include "Marquee.h"
+#include <vector>
+#include <esp_heap_caps.h>
+#include "TFT.h"
+#include "Display.h"
+#include "Pixel.h"
+#include "HeapTrace.h"
+
+// [TRAKKR] Cell marquees (see Marquee.h)
+
+namespace {
+  const size_t   MAX_CELLS   = 16;
+  const int      GAP_PX      = 48;               // between the end of the text and its repeat
+  const uint32_t SPEED_PX_S  = 30;
+  const uint32_t HOLD_MS     = 2000;             // start of the text stays put this long
+
+  struct Cell {
+    int16_t        x, y, w, h;
+    uint16_t       fg, bg;
+    const GFXfont* font;
+    String         text;                         // until the strip is built
+    uint16_t*      strip;                        // stripW x h, panel byte order
+    int            stripW;
+    uint32_t       t0;
+    int            lastOff;
+    bool           skip;                         // no memory for the strip: stays truncated
+  };
+
+  std::vector<Cell> gCells;
+  size_t    gNext = 0;                           // round-robin position
+  uint16_t* gOut = nullptr;                      // window buffer without a DMA backend
+  size_t    gOutCap = 0;
+
+  struct {
+    uint32_t built, skipped, frames, pushes, shortFrames, maxFrameUs;
+  } gStat = {};
+
+  // Rasterise through a scratch sprite, keep only the pixels
+  bool build(Cell& c){
+    HeapTrace::Scope hs("sprites");
+    tft.setFreeFont(c.font);
+    c.stripW = (int)tft.textWidth(c.text) + GAP_PX;
+    const size_t px = (size_t)c.stripW * c.h;
+    c.strip = Pixel::alloc(px);
+    TFT_eSprite spr(&tft);
+    spr.setColorDepth(16);
+    if (!c.strip || !spr.createSprite(c.stripW, c.h)){
+      if (c.strip){ heap_caps_free(c.strip); c.strip = nullptr; }
+      c.skip = true; gStat.skipped++; return false;
+    }
+    spr.fillSprite(c.bg);
+    spr.setFreeFont(c.font);
+    spr.setTextDatum(ML_DATUM);
+    spr.setTextColor(TFT_BLACK); spr.drawString(c.text, 1, c.h / 2 + 1);   // shadow
+    spr.setTextColor(c.fg);      spr.drawString(c.text, 0, c.h / 2);
+    Pixel::copy16(c.strip, (const uint16_t*)spr.getPointer(), px);
+    spr.deleteSprite();
+    c.text = String();
+    c.t0 = millis();
+    c.lastOff = -1;                              // first frame replaces the ellipsised text
+    gStat.built++;
+    return true;
+  }
+
+  int offsetAt(const Cell& c, uint32_t now){
+    const uint32_t scrollMs = (uint32_t)c.stripW * 1000u / SPEED_PX_S;
+    const uint32_t u = (now - c.t0) % (HOLD_MS + scrollMs);
+    return u < HOLD_MS ? 0 : (int)((u - HOLD_MS) * SPEED_PX_S / 1000u);
+  }
+
+  void push(Cell& c, int off){
+    const size_t px = (size_t)c.w * c.h;
+    DisplayBackend* d = Display::active();
+    if (d && d->capacity() < px) d = nullptr;
+    if (!d && gOutCap < px){
+      if (gOut) heap_caps_free(gOut);
+      gOut = (uint16_t*)heap_caps_malloc(px * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+      gOutCap = gOut ? px : 0;
+      if (!gOut) return;
+    }
+    uint16_t* buf = d ? d->backBuffer() : gOut;
+    const uint16_t* src = c.strip;
+    const int first = min((int)c.w, c.stripW - off);
+    for (int r = 0; r < c.h; ++r){
+      const uint16_t* line = src + (size_t)r * c.stripW;
+      uint16_t* o = buf + (size_t)r * c.w;
+      Pixel::copy16(o, line + off, first);
+      if (first < c.w) Pixel::copy16(o + first, line, c.w - first);
+    }
+    if (!d || !d->present(c.x, c.y, c.w, c.h)){
+      Display::yieldBus();
+      tft.pushImage(c.x, c.y, c.w, c.h, buf);
+    }
+    c.lastOff = off;
+    gStat.pushes++;
+  }
+}
+
+bool Marquee::add(int x, int y, int w, int h, const String& text, const GFXfont* font, uint16_t fg, uint16_t bg){
+  if (gCells.size() >= MAX_CELLS || w <= 0 || h <= 0) return false;
+  if (gCells.capacity() < MAX_CELLS) gCells.reserve(MAX_CELLS);
+  Cell c;
+  c.x = (int16_t)x; c.y = (int16_t)y; c.w = (int16_t)w; c.h = (int16_t)h;
+  c.fg = fg; c.bg = bg; c.font = font; c.text = text;
+  c.strip = nullptr; c.stripW = 0; c.t0 = 0; c.lastOff = 0; c.skip = false;
+  gCells.push_back(c);
+  return true;
+}
+
+void Marquee::clear(){
+  for (Cell& c : gCells) if (c.strip) heap_caps_free(c.strip);
+  gCells.clear();
+  gNext = 0;
+  if (gOut){ heap_caps_free(gOut); gOut = nullptr; gOutCap = 0; }
+}
+
+size_t Marquee::count(){ return gCells.size(); }
+
+void Marquee::frame(uint32_t budgetUs){
+  if (gCells.empty()) return;
+  const uint32_t t0 = micros();
+
+  for (Cell& c : gCells) if (!c.strip && !c.skip){ build(c); break; }   // one strip per frame
+
+  const uint32_t now = millis();
+  const size_t n = gCells.size();
+  size_t seen = 0;
+  while (seen < n && micros() - t0 < budgetUs){
+    Cell& c = gCells[gNext];
+    gNext = (gNext + 1) % n;
+    ++seen;
+    if (!c.strip) continue;
+    const int off = offsetAt(c, now);
+    if (off != c.lastOff) push(c, off);
+  }
+  if (seen < n) gStat.shortFrames++;
+  gStat.frames++;
+  gStat.maxFrameUs = max(gStat.maxFrameUs, (uint32_t)(micros() - t0));
+}
+
+String Marquee::statsJSON(){
+  size_t live = 0;
+  for (const Cell& c : gCells) if (c.strip) ++live;
+  String j; j.reserve(160);
+  j += "{\"cells\":";       j += (unsigned)gCells.size();
+  j += ",\"scrolling\":";   j += (unsigned)live;
+  j += ",\"built\":";       j += gStat.built;
+  j += ",\"skipped\":";     j += gStat.skipped;
+  j += ",\"frames\":";      j += gStat.frames;
+  j += ",\"pushes\":";      j += gStat.pushes;
+  j += ",\"shortFrames\":"; j += gStat.shortFrames;
+  j += ",\"maxFrameUs\":";  j += gStat.maxFrameUs;
+  j += '}';
+  return j;
+}
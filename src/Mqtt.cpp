@@ -0,0 +1,418 @@
+#include "Mqtt.h"
+#include "Async.h"
+#include "Global.h"
+#include <WiFi.h>
+#include <time.h>
+#include <freertos/semphr.h>
+
+namespace {
+  constexpr uint16_t KEEPALIVE_S    = 60;
+  constexpr uint32_t RETRY_MIN_MS   = 2000;
+  constexpr uint32_t RETRY_MAX_MS   = 60000;
+  constexpr uint32_t IO_DEADLINE_MS = 10000;
+  constexpr uint32_t POLL_MS        = 250;               // offer() → wire latency
+  constexpr uint32_t SUB_GRACE_MS   = 5000;              // svc/+ kept this long after connect to collect retained rows
+
+  // Latest board from offer(), waiting for the publisher
+  SemaphoreHandle_t      gMutex = nullptr;
+  String                 gTitle;
+  uint32_t               gGen   = 0;
+  std::vector<Mqtt::Row> gRows;
+  bool                   gFresh = false;
+
+  // Broker, topic and station, copied from Cfg by Mqtt::configure() on the
+  // task that writes Cfg; the publisher only reads this copy (also gMutex).
+  struct Conf { char host[64]; uint16_t port; char topic[48]; char crs[4]; char mode[12]; };
+  Conf                   gConf  = {};
+
+  struct {
+    bool        connected;
+    uint32_t    connects, drops, bytes, deltas, cleared, services;
+    const char* lastErr;
+  } gStats = { false, 0, 0, 0, 0, 0, 0, "" };
+
+  uint32_t fnv1a(const String& s, uint32_t h = 2166136261u){
+    for (size_t i = 0; i < s.length(); ++i){ h ^= (uint8_t)s[i]; h *= 16777619u; }
+    return h;
+  }
+
+  void jsonStr(String& o, const String& s){
+    o += '"';
+    for (size_t i = 0; i < s.length(); ++i){
+      char c = s[i];
+      if (c == '"' || c == '\\'){ o += '\\'; o += c; }
+      else if ((uint8_t)c < 0x20) o += ' ';
+      else o += c;
+    }
+    o += '"';
+  }
+
+  String rowJSON(const Mqtt::Row& r){
+    String j; j.reserve(128);
+    j += "{\"id\":";    jsonStr(j, r.id);
+    j += ",\"time\":";  jsonStr(j, r.time);
+    j += ",\"est\":";   jsonStr(j, r.est);
+    j += ",\"place\":"; jsonStr(j, r.dest);
+    j += ",\"plat\":";  jsonStr(j, r.plat);
+    j += ",\"op\":";    jsonStr(j, r.oper);
+    j += ",\"bus\":";   j += r.bus ? "true" : "false";
+    j += '}';
+    return j;
+  }
+
+  // Topic level for a service: no wildcards or extra levels; rows without an id get a stable stand-in.
+  String topicId(const Mqtt::Row& r){
+    if (!r.id.length()){
+      char b[12]; snprintf(b, sizeof(b), "x%08x", (unsigned)fnv1a(r.dest, fnv1a(r.time)));
+      return String(b);
+    }
+    String t = r.id;
+    t.replace('/', '_'); t.replace('+', '-'); t.replace('#', '~');
+    return t;
+  }
+
+  Conf conf(){
+    Conf c;
+    xSemaphoreTake(gMutex, portMAX_DELAY);
+    c = gConf;
+    xSemaphoreGive(gMutex);
+    return c;
+  }
+  String baseOf(const Conf& c){ return String(c.topic) + '/' + c.crs; }
+
+  // ---- MQTT 3.1.1 encoding ----
+  typedef std::vector<uint8_t> Buf;
+  void putLen(Buf& o, uint32_t n){
+    do { uint8_t b = n & 0x7F; n >>= 7; if (n) b |= 0x80; o.push_back(b); } while (n);
+  }
+  void putStr(Buf& o, const char* s, size_t n){
+    o.push_back((uint8_t)(n >> 8)); o.push_back((uint8_t)n);
+    o.insert(o.end(), (const uint8_t*)s, (const uint8_t*)s + n);
+  }
+  void putSubscribe(Buf& o, uint8_t type, uint16_t pid, const String& filter){
+    const bool sub = type == 0x82;
+    o.push_back(type);                                     // SUBSCRIBE / UNSUBSCRIBE (flags 0010)
+    putLen(o, 2 + 2 + filter.length() + (sub ? 1 : 0));
+    o.push_back((uint8_t)(pid >> 8)); o.push_back((uint8_t)pid);
+    putStr(o, filter.c_str(), filter.length());
+    if (sub) o.push_back(0);                               // QoS 0
+  }
+  void putPublish(Buf& o, const String& topic, const String& payload){
+    o.push_back(0x31);                                     // PUBLISH, QoS 0, retain
+    putLen(o, 2 + topic.length() + payload.length());
+    putStr(o, topic.c_str(), topic.length());
+    o.insert(o.end(), (const uint8_t*)payload.c_str(), (const uint8_t*)payload.c_str() + payload.length());
+  }
+
+  class Publisher : public Async::Task {
+  public:
+    Publisher() : Async::Task("mqtt") {}
+    bool step() override;
+
+  private:
+    struct Sent { String id; uint32_t h; };
+
+    bool takeOffer(){
+      bool got = false;
+      xSemaphoreTake(gMutex, portMAX_DELAY);
+      if (gFresh){ cur_.swap(gRows); gRows.clear(); title_ = gTitle; gen_ = gGen; gFresh = false; got = true; }
+      xSemaphoreGive(gMutex);
+      return got;
+    }
+
+    void buildConnect(){
+      uint8_t mac[6]; WiFi.macAddress(mac);
+      char id[24]; snprintf(id, sizeof(id), "trakkr-%02x%02x%02x", mac[3], mac[4], mac[5]);
+      const String will = base_ + "/status";
+      Buf body;
+      putStr(body, "MQTT", 4);
+      body.push_back(4);                                   // protocol level 3.1.1
+      body.push_back(0x02 | 0x04 | 0x20);                  // clean session, will, will retain (QoS 0)
+      body.push_back(KEEPALIVE_S >> 8); body.push_back(KEEPALIVE_S & 0xFF);
+      putStr(body, id, strlen(id));
+      putStr(body, will.c_str(), will.length());
+      putStr(body, "offline", 7);
+      out_.clear();
+      out_.push_back(0x10);                                // CONNECT
+      putLen(out_, body.size());
+      out_.insert(out_.end(), body.begin(), body.end());
+    }
+
+    // Everything that differs from what the broker retains from us (all of it when `full`).
+    void buildUpdates(bool full){
+      out_.clear();
+      if (full) putPublish(out_, base_ + "/status", "online");
+
+      std::vector<Sent> now; now.reserve(cur_.size());
+      String ids; ids.reserve(cur_.size() * 18);
+      for (const auto& r : cur_){
+        Sent s = { topicId(r), 0 };
+        const String payload = rowJSON(r);
+        s.h = fnv1a(payload);
+        const Sent* was = nullptr;
+        for (const auto& o : retained_) if (o.id == s.id){ was = &o; break; }
+        if (full || !was || was->h != s.h){ putPublish(out_, base_ + "/svc/" + s.id, payload); gStats.deltas++; }
+        if (ids.length()) ids += ',';
+        jsonStr(ids, s.id);
+        now.push_back(s);
+      }
+      for (const auto& o : retained_){
+        bool still = false;
+        for (const auto& n : now) if (n.id == o.id){ still = true; break; }
+        if (!still){ putPublish(out_, base_ + "/svc/" + o.id, String()); gStats.cleared++; }
+      }
+      retained_.swap(now);
+      gStats.services = retained_.size();
+
+      // First real board this session: ask for what the broker retains under
+      // svc/ so rows left over from before a reboot can be cleared.
+      if (gen_ && !subAt_){ putSubscribe(out_, 0x82, 1, base_ + "/svc/+"); subAt_ = millis(); }
+
+      const uint32_t bh = fnv1a(ids, fnv1a(title_));
+      if (full || bh != boardHash_){
+        String j; j.reserve(96 + ids.length());
+        j += "{\"crs\":";   jsonStr(j, conf_.crs);
+        j += ",\"mode\":";  jsonStr(j, conf_.mode);
+        j += ",\"title\":"; jsonStr(j, title_);
+        j += ",\"gen\":";   j += String(gen_);
+        j += ",\"at\":";    j += String((uint32_t)time(nullptr));
+        j += ",\"ids\":[";  j += ids; j += "]}";
+        putPublish(out_, base_ + "/board", j);
+        boardHash_ = bh;
+      }
+    }
+
+    // Leaving this broker or topic: clear what we retained there (moved) or mark offline, then DISCONNECT.
+    void buildGoodbye(bool clear){
+      out_.clear();
+      if (clear){
+        for (const auto& o : retained_){ putPublish(out_, base_ + "/svc/" + o.id, String()); gStats.cleared++; }
+        putPublish(out_, base_ + "/board", String());
+        putPublish(out_, base_ + "/status", String());
+        retained_.clear();
+      } else {
+        putPublish(out_, base_ + "/status", "offline");
+      }
+      out_.push_back(0xE0); out_.push_back(0x00);          // DISCONNECT (no last will)
+    }
+
+    // Next thing to send on a live session, into out_ (left empty if nothing is due).
+    void plan(){
+      const Conf now = conf();
+      if (base_ != baseOf(now) || strcmp(conf_.host, now.host) || conf_.port != now.port){
+        buildGoodbye(base_ != baseOf(now)); leaving_ = true; why_ = "reconfigured";
+      }
+      else if (takeOffer() || full_){ conf_ = now; buildUpdates(full_); full_ = false; }
+      else if (!stale_.empty()){
+        out_.clear();
+        for (const auto& id : stale_){
+          bool back = false;                             // listed again since it was seen
+          for (const auto& o : retained_) if (o.id == id){ back = true; break; }
+          if (!back){ putPublish(out_, base_ + "/svc/" + id, String()); gStats.cleared++; }
+        }
+        stale_.clear();
+      }
+      else if (subAt_ && !unsub_ && millis() - subAt_ >= SUB_GRACE_MS){
+        out_.clear(); putSubscribe(out_, 0xA2, 2, base_ + "/svc/+"); unsub_ = true;   // or every publish of ours echoes back
+      }
+      else if (!pingAt_ && millis() - lastTx_ >= KEEPALIVE_S * 500UL){
+        out_.assign(2, 0); out_[0] = 0xC0; pingAt_ = millis();   // PINGREQ
+      }
+    }
+
+    // Retained svc/<id> from the broker (QoS 0 PUBLISH; `have` of `len` body
+    // bytes buffered). Not on the board and not already cleared: stale.
+    void notePublish(const uint8_t* p, size_t len, size_t have){
+      if (have < 2) return;
+      const size_t tlen = ((size_t)p[0] << 8) | p[1];
+      const String prefix = base_ + "/svc/";
+      if (2 + tlen > have || tlen <= prefix.length() || len == 2 + tlen) return;   // empty = already gone
+      if (memcmp(p + 2, prefix.c_str(), prefix.length())) return;
+      char id[48];
+      const size_t n = min<size_t>(tlen - prefix.length(), sizeof(id) - 1);
+      memcpy(id, p + 2 + prefix.length(), n); id[n] = 0;
+      for (const auto& o : retained_) if (o.id == id) return;
+      for (const auto& o : stale_)    if (o == id) return;
+      if (stale_.size() < 64) stale_.push_back(String(id));
+    }
+
+    // Read whatever is waiting and handle complete packets: CONNACK, PINGRESP,
+    // and while subscribed SUBACK/UNSUBACK and retained PUBLISHes. Those carry a
+    // whole service and may not fit rx_; only the topic is kept, the rest skipped.
+    Async::Io readPackets(){
+      int got = 0;
+      Async::Io r = conn_.read(rx_ + rxLen_, sizeof(rx_) - rxLen_, got);
+      if (r != Async::IO_DONE){ if (r == Async::IO_ERR) why_ = conn_.error(); return r; }
+      if (got == 0){ why_ = "closed by broker"; return Async::IO_ERR; }
+      rxLen_ += got;
+      if (skip_){
+        const size_t n = min<size_t>(skip_, rxLen_);
+        memmove(rx_, rx_ + n, rxLen_ - n);
+        rxLen_ -= n; skip_ -= n;
+      }
+      while (rxLen_ >= 2){
+        uint32_t len = 0; size_t i = 1;
+        for (int shift = 0; i < rxLen_; ++i, shift += 7){
+          len |= (uint32_t)(rx_[i] & 0x7F) << shift;
+          if (!(rx_[i] & 0x80)) break;
+        }
+        if (i >= rxLen_) break;                            // length not complete yet
+        const size_t total = i + 1 + len;
+        const uint8_t type = rx_[0] >> 4;
+        if (total > sizeof(rx_)){
+          if (type != 3){ why_ = "oversized packet"; return Async::IO_ERR; }
+          if (rxLen_ < sizeof(rx_)) break;                 // fill rx_ first: the topic is at the front
+          notePublish(rx_ + i + 1, len, rxLen_ - i - 1);
+          skip_ = total - rxLen_; rxLen_ = 0;
+          break;
+        }
+        if (rxLen_ < total) break;
+        if (type == 3) notePublish(rx_ + i + 1, len, len);
+        else if (type == 2 && len >= 2) connack_ = rx_[i + 2];  // CONNACK: flags, return code
+        else if (type == 13) pingAt_ = 0;                  // PINGRESP
+        memmove(rx_, rx_ + total, rxLen_ - total);
+        rxLen_ -= total;
+      }
+      return Async::IO_DONE;
+    }
+
+    void drop(const char* why, bool backoff){
+      conn_.close();
+      if (gStats.connected) gStats.drops++;
+      gStats.connected = false;
+      gStats.lastErr = why;
+      retryMs_ = !backoff ? 0 : retryMs_ ? min<uint32_t>(retryMs_ * 2, RETRY_MAX_MS) : RETRY_MIN_MS;
+      Serial.printf("[MQTT] %s; retry in %ums\n", why, (unsigned)retryMs_);
+    }
+
+    Async::Conn       conn_;
+    Buf               out_;
+    size_t            wrote_     = 0;
+    uint8_t           rx_[160];
+    size_t            rxLen_     = 0;
+    size_t            skip_      = 0;                      // rest of an oversized PUBLISH
+    int               connack_   = -1;
+    Conf              conf_      = {};                     // as connected
+    String            base_;
+    const char*       why_       = "";
+    bool              full_      = true;
+    bool              leaving_   = false;
+    uint32_t          retryMs_   = 0;
+    uint32_t          lastTx_    = 0;
+    uint32_t          pingAt_    = 0;                      // 0 = no PINGREQ outstanding
+    uint32_t          subAt_     = 0;                      // svc/+ subscribed (0 = not this session)
+    bool              unsub_     = false;
+    std::vector<String> stale_;                            // retained ids to clear
+    std::vector<Mqtt::Row> cur_;
+    String            title_;
+    uint32_t          gen_       = 0;
+    std::vector<Sent> retained_;                           // what the broker holds from us
+    uint32_t          boardHash_ = 0;
+  };
+
+  bool Publisher::step(){
+    ASYNC_BEGIN();
+    for(;;){
+      if (retryMs_) ASYNC_SLEEP(retryMs_);
+      for (conf_ = conf(); !conf_.host[0] || WiFi.status() != WL_CONNECTED; conf_ = conf()) ASYNC_SLEEP(2000);
+
+      base_ = baseOf(conf_);
+      conn_.close();
+      conn_.setDeadline(IO_DEADLINE_MS);
+      ASYNC_AWAIT(conn_, conn_.connect(conf_.host, conf_.port, false));
+      if (io_ != Async::IO_DONE){ drop(conn_.error(), true); continue; }
+
+      buildConnect();
+      wrote_ = 0;
+      ASYNC_AWAIT(conn_, conn_.write(out_.data(), out_.size(), wrote_));
+      if (io_ != Async::IO_DONE){ drop(conn_.error(), true); continue; }
+      out_.clear();
+
+      rxLen_ = 0; skip_ = 0; connack_ = -1;
+      while (connack_ < 0){
+        ASYNC_AWAIT(conn_, readPackets());
+        if (io_ != Async::IO_DONE) break;
+      }
+      if (connack_ != 0){ drop(connack_ < 0 ? "no CONNACK" : "connection refused", true); continue; }
+
+      gStats.connected = true; gStats.connects++;
+      Serial.printf("[MQTT] connected %s:%u, topics %s/...\n", conf_.host, (unsigned)conf_.port, base_.c_str());
+      retryMs_ = 0; full_ = true; leaving_ = false; pingAt_ = 0; lastTx_ = millis();
+      subAt_ = 0; unsub_ = false; stale_.clear();
+      why_ = "lost";
+
+      for(;;){
+        plan();
+
+        if (!out_.empty()){
+          wrote_ = 0;
+          conn_.setDeadline(IO_DEADLINE_MS);
+          ASYNC_AWAIT(conn_, conn_.write(out_.data(), out_.size(), wrote_));
+          if (io_ != Async::IO_DONE){ why_ = conn_.error(); break; }
+          gStats.bytes += out_.size();
+          out_.clear();
+          lastTx_ = millis();
+          if (leaving_) break;
+        }
+
+        ASYNC_WAIT_READ(conn_, POLL_MS);
+        conn_.setDeadline(IO_DEADLINE_MS);
+        if (readPackets() == Async::IO_ERR) break;
+        if (pingAt_ && millis() - pingAt_ > KEEPALIVE_S * 1000UL){ why_ = "ping timeout"; break; }
+      }
+      drop(why_, !leaving_);
+    }
+    ASYNC_END();
+  }
+
+  bool gStarted = false;
+}
+
+void Mqtt::begin(){
+  if (gStarted) return;
+  gMutex = xSemaphoreCreateMutex();
+  configure();
+  Async::begin();
+  gStarted = Async::spawn(new Publisher());
+}
+
+void Mqtt::configure(){
+  if (!gMutex) return;
+  Conf c = {};
+  strncpy(c.host,  Cfg::mqttHost(),  sizeof(c.host)  - 1);
+  strncpy(c.topic, Cfg::mqttTopic(), sizeof(c.topic) - 1);
+  strncpy(c.crs,   Cfg::crs(),       sizeof(c.crs)   - 1);
+  strncpy(c.mode,  Cfg::mode(),      sizeof(c.mode)  - 1);
+  c.port = Cfg::mqttPort();
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  gConf = c;
+  xSemaphoreGive(gMutex);
+}
+
+void Mqtt::offer(const String& title, uint32_t gen, std::vector<Row>& rows){
+  if (!gMutex) return;
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  gRows.swap(rows);
+  gTitle = title;
+  gGen   = gen;
+  gFresh = true;
+  xSemaphoreGive(gMutex);
+}
+
+String Mqtt::statsJSON(){
+  String j; j.reserve(256);
+  j += "{\"enabled\":";   j += Cfg::mqttHost()[0] ? "true" : "false";
+  j += ",\"connected\":"; j += gStats.connected ? "true" : "false";
+  j += ",\"host\":";      jsonStr(j, Cfg::mqttHost());
+  j += ",\"port\":";      j += String((unsigned)Cfg::mqttPort());
+  j += ",\"base\":";      jsonStr(j, String(Cfg::mqttTopic()) + '/' + Cfg::crs());
+  j += ",\"services\":";  j += String(gStats.services);
+  j += ",\"connects\":";  j += String(gStats.connects);
+  j += ",\"drops\":";     j += String(gStats.drops);
+  j += ",\"deltas\":";    j += String(gStats.deltas);
+  j += ",\"cleared\":";   j += String(gStats.cleared);
+  j += ",\"bytes\":";     j += String(gStats.bytes);
+  j += ",\"lastErr\":";   jsonStr(j, gStats.lastErr);
+  j += '}';
+  return j;
+}
@@ -0,0 +1,492 @@
+#include "Ota.h"
+#include <Preferences.h>
+#include <HTTPClient.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <mbedtls/sha256.h>
+#include <rom/miniz.h>
+#include <freertos/semphr.h>
+#include "Global.h"
+#include "Rail.h"
+#include "HttpServer.h"
+
+// [TRAKKR] Delta OTA (see Ota.h)
+
+// Arduino's initArduino() would otherwise mark a pending image valid before
+// setup() runs; keep that decision for Ota::loop().
+extern "C" bool verifyRollbackLater(){ return true; }
+
+namespace {
+  const uint32_t MAGIC          = 0x444B5254;       // "TRKD"
+  const uint16_t VERSION        = 1;
+  const uint16_t FLAG_FULL      = 1 << 0;           // no base image: DATA ops only
+  const size_t   HDR_SIZE       = 80;
+  const size_t   PAGE           = 4096;             // flash write unit
+  const size_t   DICT           = TINFL_LZ_DICT_SIZE;
+  const uint8_t  MAX_TRIAL_BOOTS = 3;
+  const uint32_t CONFIRM_MIN_MS = 60UL * 1000;      // up this long and a board fetched...
+  const uint32_t CONFIRM_MAX_MS = 15UL * 60 * 1000; // ...or this long regardless
+  const uint32_t STALL_MS       = 15000;            // pull: no bytes for this long
+  const char*    NVS_NS         = "trakkrota";
+
+  enum Op : uint8_t { OP_END = 0, OP_COPY = 1, OP_ADD = 2, OP_DATA = 3 };
+  enum State : uint8_t { IDLE, RECEIVING, READY, FAILED };
+  const char* const kStateNames[] = { "idle", "receiving", "ready", "failed" };
+
+  struct Hdr {
+    uint32_t magic;
+    uint16_t version, flags;
+    uint32_t baseSize, targetSize;
+    uint8_t  baseSha[32];                           // the image's own appended SHA-256
+    uint8_t  targetSha[32];                         // SHA-256 of the whole new image file
+  };
+
+  // One update in flight
+  struct Apply {
+    uint8_t                hdrRaw[HDR_SIZE];
+    size_t                 hdrHave;
+    Hdr                    hdr;
+    const esp_partition_t* base;
+    const esp_partition_t* target;
+    esp_ota_handle_t       handle;
+    bool                   otaOpen;
+    tinfl_decompressor*    inf;
+    uint8_t*               dict;
+    size_t                 dictOfs;
+    bool                   inflated;
+    uint8_t                opBuf[9];
+    uint8_t                opHave, opNeed;
+    Op                     op;                      // body being read (ADD / DATA)
+    uint32_t               remain, baseOff;
+    bool                   ended;
+    uint8_t*               page;
+    size_t                 pageHave;
+    mbedtls_sha256_context sha;
+  };
+
+  // The update and its status are under gLock: an upload (HTTP task) and a
+  // pull (its own task) can both try. open() hands out a session id and only
+  // that id may write, finish or abort, so neither can touch the other's.
+  SemaphoreHandle_t gLock = nullptr;
+  uint32_t       gSession = 0, gLastSession = 0;
+  Apply*         gA = nullptr;
+  volatile State gState = IDLE;
+  String         gErr;
+  uint32_t       gIn = 0, gOut = 0, gTotal = 0, gT0 = 0, gMs = 0;
+  bool           gDelta = false;
+  TaskHandle_t   gPull = nullptr;
+  String         gPullUrl;
+
+  // Trial boot (NVS)
+  bool           gTrial = false;                    // running image not confirmed yet
+  uint8_t        gBoots = 0;
+  bool           gRolledBack = false;
+
+  uint8_t        gRunSha[32];
+  bool           gRunShaOk = false;
+
+  inline uint32_t rd32(const uint8_t* p){ return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+  inline uint16_t rd16(const uint8_t* p){ return (uint16_t)(p[0] | p[1] << 8); }
+
+  void hex(String& j, const uint8_t* b, size_t n){
+    static const char* d = "0123456789abcdef";
+    for (size_t i = 0; i < n; ++i){ j += d[b[i] >> 4]; j += d[b[i] & 15]; }
+  }
+
+  void lock()  { if (gLock) xSemaphoreTake(gLock, portMAX_DELAY); }
+  void unlock(){ if (gLock) xSemaphoreGive(gLock); }
+
+  // Caller holds gLock.
+  bool owns(uint32_t id){ return id && id == gSession && gState == RECEIVING && gA; }
+
+  const uint8_t* runningSha(){
+    if (!gRunShaOk) gRunShaOk = esp_partition_get_sha256(esp_ota_get_running_partition(), gRunSha) == ESP_OK;
+    return gRunShaOk ? gRunSha : nullptr;
+  }
+
+  void release(){
+    if (!gA) return;
+    if (gA->otaOpen) esp_ota_abort(gA->handle);
+    mbedtls_sha256_free(&gA->sha);
+    if (gA->inf)  heap_caps_free(gA->inf);
+    if (gA->dict) heap_caps_free(gA->dict);
+    if (gA->page) heap_caps_free(gA->page);
+    heap_caps_free(gA);
+    gA = nullptr;
+  }
+
+  bool fail(const char* why){
+    gErr = why;
+    gState = FAILED;
+    gMs = millis() - gT0;
+    Serial.printf("[OTA] failed: %s (%u in, %u out)\n", why, (unsigned)gIn, (unsigned)gOut);
+    release();
+    return false;
+  }
+
+  void* allocPrefer(size_t n, bool psram){
+    void* p = psram ? heap_caps_malloc(n, MALLOC_CAP_SPIRAM) : nullptr;
+    return p ? p : heap_caps_malloc(n, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+
+  // ---- Output: hash, then flash a page at a time ----
+  bool emit(const uint8_t* p, size_t n){
+    if (gOut + n > gA->hdr.targetSize) return fail("output longer than the header says");
+    mbedtls_sha256_update_ret(&gA->sha, p, n);
+    gOut += n;
+    while (n){
+      size_t k = PAGE - gA->pageHave; if (k > n) k = n;
+      memcpy(gA->page + gA->pageHave, p, k);
+      gA->pageHave += k; p += k; n -= k;
+      if (gA->pageHave == PAGE){
+        if (esp_ota_write(gA->handle, gA->page, PAGE) != ESP_OK) return fail("flash write");
+        gA->pageHave = 0;
+      }
+    }
+    return true;
+  }
+
+  bool baseRange(uint32_t off, uint32_t len){
+    return gA->base && off <= gA->hdr.baseSize && len <= gA->hdr.baseSize - off;
+  }
+
+  bool copyBase(uint32_t off, uint32_t len){
+    uint8_t tmp[256];
+    while (len){
+      const uint32_t k = len < sizeof(tmp) ? len : sizeof(tmp);
+      if (esp_partition_read(gA->base, off, tmp, k) != ESP_OK) return fail("base read");
+      if (!emit(tmp, k)) return false;
+      off += k; len -= k;
+    }
+    return true;
+  }
+
+  // ---- Op stream (inflated bytes, any split) ----
+  bool ops(const uint8_t* p, size_t n){
+    while (n){
+      if (gA->ended) return fail("bytes after END");
+      if (gA->remain){                              // ADD / DATA body
+        uint32_t k = gA->remain < n ? gA->remain : (uint32_t)n;
+        if (gA->op == OP_DATA){
+          if (!emit(p, k)) return false;
+        } else {
+          uint8_t tmp[256];
+          if (k > sizeof(tmp)) k = sizeof(tmp);
+          if (esp_partition_read(gA->base, gA->baseOff, tmp, k) != ESP_OK) return fail("base read");
+          for (uint32_t i = 0; i < k; ++i) tmp[i] += p[i];
+          if (!emit(tmp, k)) return false;
+          gA->baseOff += k;
+        }
+        gA->remain -= k; p += k; n -= k;
+        continue;
+      }
+
+      gA->opBuf[gA->opHave++] = *p++; n--;
+      if (gA->opHave == 1){
+        const uint8_t o = gA->opBuf[0];
+        gA->opNeed = o == OP_END ? 1 : o == OP_DATA ? 5 : (o == OP_COPY || o == OP_ADD) ? 9 : 0;
+        if (!gA->opNeed) return fail("bad op");
+      }
+      if (gA->opHave < gA->opNeed) continue;
+      gA->opHave = 0;
+
+      const Op o = (Op)gA->opBuf[0];
+      if (o == OP_END){ gA->ended = true; continue; }
+      if (o == OP_DATA){ gA->op = OP_DATA; gA->remain = rd32(gA->opBuf + 1); continue; }
+      const uint32_t off = rd32(gA->opBuf + 1), len = rd32(gA->opBuf + 5);
+      if (!baseRange(off, len)) return fail("op outside the base image");
+      if (o == OP_COPY){ if (!copyBase(off, len)) return false; continue; }
+      gA->op = OP_ADD; gA->baseOff = off; gA->remain = len;
+    }
+    return true;
+  }
+
+  bool header(){
+    const uint8_t* h = gA->hdrRaw;
+    Hdr& d = gA->hdr;
+    d.magic = rd32(h); d.version = rd16(h + 4); d.flags = rd16(h + 6);
+    d.baseSize = rd32(h + 8); d.targetSize = rd32(h + 12);
+    memcpy(d.baseSha, h + 16, 32); memcpy(d.targetSha, h + 48, 32);
+    if (d.magic != MAGIC)     return fail("not a .trkd file");
+    if (d.version != VERSION) return fail("unsupported .trkd version");
+    if (!d.targetSize || d.targetSize > gA->target->size) return fail("image doesn't fit the OTA slot");
+
+    gTotal = d.targetSize;
+    gDelta = !(d.flags & FLAG_FULL);
+    if (gDelta){
+      const uint8_t* run = runningSha();
+      if (!run) return fail("can't hash the running image");
+      if (memcmp(run, d.baseSha, 32) != 0) return fail("delta is for a different base image");
+      gA->base = esp_ota_get_running_partition();
+      if (d.baseSize > gA->base->size) return fail("base size");
+    }
+    if (esp_ota_begin(gA->target, OTA_WITH_SEQUENTIAL_WRITES, &gA->handle) != ESP_OK) return fail("esp_ota_begin");
+    gA->otaOpen = true;
+    Serial.printf("[OTA] %s update -> %s, %u bytes\n", gDelta ? "delta" : "full",
+                  gA->target->label, (unsigned)d.targetSize);
+    return true;
+  }
+
+  // ---- Trial boot ----
+  void trialSave(bool pending, uint8_t boots, const char* prev, const char* next){
+    Preferences nv;
+    if (!nv.begin(NVS_NS, false)) return;
+    nv.putBool("pend", pending);
+    nv.putUChar("boots", boots);
+    if (prev) nv.putString("prev", prev);
+    if (next) nv.putString("new", next);
+    nv.end();
+  }
+
+  void confirm(){
+    esp_ota_mark_app_valid_cancel_rollback();      // no-op without the IDF rollback option
+    trialSave(false, 0, nullptr, nullptr);
+    gTrial = false;
+    Serial.printf("[OTA] image confirmed after %u boot(s)\n", (unsigned)gBoots);
+  }
+
+  // ---- One session: open / write / finish (gLock held) ----
+  uint32_t start(){
+    if (gState == RECEIVING || gState == READY) return 0;
+    gState = RECEIVING;
+    if (!++gLastSession) ++gLastSession;            // 0 means "not yours"
+    gSession = gLastSession;
+    gErr = ""; gIn = gOut = gTotal = 0; gT0 = millis(); gMs = 0; gDelta = false;
+    gA = (Apply*)heap_caps_calloc(1, sizeof(Apply), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!gA){ fail("no memory"); return 0; }
+    mbedtls_sha256_init(&gA->sha);
+    mbedtls_sha256_starts_ret(&gA->sha, 0);
+    gA->inf  = (tinfl_decompressor*)allocPrefer(sizeof(tinfl_decompressor), true);
+    gA->dict = (uint8_t*)allocPrefer(DICT, true);
+    gA->page = (uint8_t*)allocPrefer(PAGE, false);   // flash writes come from internal RAM
+    if (!gA->inf || !gA->dict || !gA->page){ fail("no memory"); return 0; }
+    tinfl_init(gA->inf);
+    gA->target = esp_ota_get_next_update_partition(nullptr);
+    if (!gA->target){ fail("no OTA slot"); return 0; }
+    return gSession;
+  }
+
+  bool feed(const uint8_t* p, size_t n){
+    gIn += n;
+    if (gA->hdrHave < HDR_SIZE){
+      size_t k = HDR_SIZE - gA->hdrHave; if (k > n) k = n;
+      memcpy(gA->hdrRaw + gA->hdrHave, p, k);
+      gA->hdrHave += k; p += k; n -= k;
+      if (gA->hdrHave == HDR_SIZE && !header()) return false;
+    }
+    // HAS_MORE_OUTPUT: the window end cut the output short. Go round again, with
+    // no input if it is all used, until tinfl wants more input.
+    tinfl_status st = TINFL_STATUS_NEEDS_MORE_INPUT;
+    while (!gA->inflated && (n || st == TINFL_STATUS_HAS_MORE_OUTPUT)){
+      size_t inN = n, outN = DICT - gA->dictOfs;
+      st = tinfl_decompress(gA->inf, p, &inN, gA->dict, gA->dict + gA->dictOfs, &outN,
+                            TINFL_FLAG_HAS_MORE_INPUT);
+      p += inN; n -= inN;
+      if (outN && !ops(gA->dict + gA->dictOfs, outN)) return false;
+      gA->dictOfs = (gA->dictOfs + outN) & (DICT - 1);
+      if (st < 0) return fail("corrupt stream");
+      if (st == TINFL_STATUS_DONE) gA->inflated = true;
+      else if (!inN && !outN) break;
+    }
+    return true;
+  }
+
+  bool complete(){
+    if (gA->hdrHave < HDR_SIZE || !gA->inflated || !gA->ended || gA->remain) return fail("truncated");
+    if (gOut != gA->hdr.targetSize) return fail("size mismatch");
+    if (gA->pageHave && esp_ota_write(gA->handle, gA->page, gA->pageHave) != ESP_OK) return fail("flash write");
+    gA->pageHave = 0;
+    uint8_t sha[32];
+    mbedtls_sha256_finish_ret(&gA->sha, sha);
+    if (memcmp(sha, gA->hdr.targetSha, 32) != 0) return fail("SHA-256 mismatch");
+    gA->otaOpen = false;
+    if (esp_ota_end(gA->handle) != ESP_OK) return fail("image doesn't verify");
+    if (esp_ota_set_boot_partition(gA->target) != ESP_OK) return fail("can't select the new slot");
+
+    trialSave(true, 0, esp_ota_get_running_partition()->label, gA->target->label);
+    Preferences nv;
+    if (nv.begin(NVS_NS, false)){ nv.putBool("rb", false); nv.end(); }
+    gMs = millis() - gT0;
+    Serial.printf("[OTA] %s ready: %u bytes in -> %u out in %lu ms\n", gA->target->label,
+                  (unsigned)gIn, (unsigned)gOut, (unsigned long)gMs);
+    release();
+    gState = READY;
+    return true;
+  }
+
+  // ---- Pull ----
+  void pullNote(const String& why){ lock(); gErr = why; unlock(); }
+
+  void pullTask(void*){
+    lock();
+    String url = gPullUrl;
+    unlock();
+    while (url.endsWith("/")) url.remove(url.length() - 1);
+    url += "/update?from=";
+    const uint8_t* run = runningSha();
+    if (run) hex(url, run, 32);
+
+    HTTPClient http;
+    http.setConnectTimeout(8000);
+    http.setTimeout(STALL_MS);
+    bool ok = false;
+    if (!http.begin(url)) pullNote("bad url");
+    else {
+      const int code = http.GET();
+      if (code == 204){ pullNote("up to date"); Serial.println("[OTA] up to date"); }
+      else if (code != 200){ pullNote(String("server said ") + code); Serial.printf("[OTA] check: HTTP %d\n", code); }
+      else if (const uint32_t id = Ota::open()){
+        WiFiClient* s = http.getStreamPtr();
+        int left = http.getSize();                  // -1 = until close
+        uint8_t buf[1024];
+        uint32_t last = millis();
+        bool live = true;
+        while (live && (left > 0 || left == -1) && millis() - last < STALL_MS){
+          const int avail = s->available();
+          if (avail <= 0){
+            if (!http.connected()) break;
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+          }
+          const int r = s->readBytes(buf, avail < (int)sizeof(buf) ? avail : (int)sizeof(buf));
+          if (r <= 0) continue;
+          last = millis();
+          live = Ota::write(id, buf, (size_t)r);
+          if (left > 0) left -= r;
+        }
+        if (live){
+          if (millis() - last >= STALL_MS) Ota::abort(id, "download stalled");
+          else ok = Ota::finish(id);
+        }
+      }
+      http.end();
+    }
+    if (ok) scheduleReboot(1500);
+    lock();
+    gPull = nullptr;
+    unlock();
+    vTaskDelete(nullptr);
+  }
+}
+
+void Ota::begin(){
+  if (!gLock) gLock = xSemaphoreCreateMutex();
+  const esp_partition_t* run = esp_ota_get_running_partition();
+  Preferences nv;
+  if (!nv.begin(NVS_NS, false)) return;
+  const bool pend = nv.getBool("pend", false);
+  gBoots = nv.getUChar("boots", 0);
+  const String prev = nv.getString("prev", ""), next = nv.getString("new", "");
+  gRolledBack = nv.getBool("rb", false);
+
+  esp_ota_img_states_t st;
+  const bool idfPending = esp_ota_get_state_partition(run, &st) == ESP_OK && st == ESP_OTA_IMG_PENDING_VERIFY;
+
+  if (pend && next != run->label){
+    // The bootloader already went back (image failed to verify or IDF rollback)
+    nv.putBool("pend", false);
+    nv.putBool("rb", true);
+    gRolledBack = true;
+    Serial.printf("[OTA] %s didn't boot; running %s\n", next.c_str(), run->label);
+  } else if (pend || idfPending){
+    const esp_reset_reason_t why = esp_reset_reason();
+    const bool crashed = why == ESP_RST_PANIC || why == ESP_RST_INT_WDT || why == ESP_RST_TASK_WDT || why == ESP_RST_WDT;
+    gBoots++;
+    const esp_partition_t* back = prev.length()
+      ? esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, prev.c_str()) : nullptr;
+    if ((gBoots > 1 && crashed) || gBoots > MAX_TRIAL_BOOTS){
+      if (back && esp_ota_set_boot_partition(back) == ESP_OK){
+        nv.putBool("pend", false);
+        nv.putBool("rb", true);
+        nv.end();
+        Serial.printf("[OTA] trial image failed (boot %u, reset %d); rolling back to %s\n",
+                      (unsigned)gBoots, (int)why, back->label);
+        Serial.flush();
+        ESP.restart();
+      }
+    }
+    nv.putUChar("boots", gBoots);
+    gTrial = true;
+    Serial.printf("[OTA] trial boot %u of %s\n", (unsigned)gBoots, run->label);
+  }
+  nv.end();
+}
+
+// No scheduled pulls: an image is only as trusted as the channel it came
+// over, and a pull is plain http with nothing but the header's own SHA-256
+// to check it against. Pulls stay operator-started (/api/firmware/check)
+// until images are signed.
+void Ota::loop(){
+  const uint32_t up = millis();
+  if (gTrial && ((up > CONFIRM_MIN_MS && Rail::lastFetchOk()) || up > CONFIRM_MAX_MS)) confirm();
+}
+
+uint32_t Ota::open(){
+  lock();
+  const uint32_t id = start();
+  unlock();
+  return id;
+}
+
+bool Ota::write(uint32_t id, const uint8_t* p, size_t n){
+  lock();
+  const bool ok = owns(id) && feed(p, n);
+  unlock();
+  return ok;
+}
+
+bool Ota::finish(uint32_t id){
+  lock();
+  const bool ok = owns(id) && complete();
+  unlock();
+  return ok;
+}
+
+void Ota::abort(uint32_t id, const char* why){
+  lock();
+  if (owns(id)) fail(why);
+  unlock();
+}
+
+bool Ota::check(const char* url){
+  if (!url || !*url) return false;
+  lock();
+  const bool busy = gPull || gState == RECEIVING || gState == READY;
+  if (!busy){
+    gPullUrl = url;
+    if (xTaskCreate(pullTask, "ota", 8192, nullptr, 1, &gPull) != pdPASS) gPull = nullptr;
+  }
+  const bool started = gPull != nullptr && !busy;
+  unlock();
+  return started;
+}
+
+String Ota::statusJSON(){
+  const esp_partition_t* run = esp_ota_get_running_partition();
+  const esp_partition_t* nxt = esp_ota_get_next_update_partition(nullptr);
+  const esp_app_desc_t* app = esp_ota_get_app_description();
+  String j; j.reserve(384);
+  lock();
+  j += "{\"state\":\"";   j += kStateNames[gState];
+  j += "\",\"running\":\""; j += run ? run->label : "?";
+  j += "\",\"next\":\"";    j += nxt ? nxt->label : "?";
+  j += "\",\"version\":\""; j += app->version;
+  j += "\",\"built\":\"";   j += app->date; j += ' '; j += app->time;
+  j += "\",\"trial\":";     j += gTrial ? "true" : "false";
+  j += ",\"boots\":";       j += gBoots;
+  j += ",\"rolledBack\":";  j += gRolledBack ? "true" : "false";
+  j += ",\"checking\":";    j += gPull ? "true" : "false";
+  if (gState != IDLE){
+    j += ",\"delta\":";     j += gDelta ? "true" : "false";
+    j += ",\"in\":";        j += gIn;
+    j += ",\"out\":";       j += gOut;
+    if (gTotal){ j += ",\"total\":"; j += gTotal; }
+    j += ",\"ms\":";        j += gState == RECEIVING ? (uint32_t)(millis() - gT0) : gMs;
+  }
+  if (gErr.length()){ j += ",\"err\":\""; j += gErr; j += '"'; }
+  unlock();
+  j += '}';
+  return j;
+}
@@ -0,0 +1,370 @@
+#include "Peer.h"
+#include "Async.h"
+#include "Global.h"
+#include "Rail.h"
+#include <WiFi.h>
+#include <ESPmDNS.h>
+#include <vector>
+#include <lwip/sockets.h>
+
+namespace {
+  constexpr uint32_t MAGIC       = 0x424B5254;     // "TRKB"
+  constexpr uint8_t  VERSION     = 3;              // 3: leader HELLO carries its next poll
+  constexpr char     GROUP[]     = "239.255.84.75";
+
+  constexpr uint32_t HELLO_MS    = 2000;
+  constexpr uint32_t PEER_TTL_MS = 7000;           // silent this long = gone
+  constexpr uint32_t LISTEN_MS   = 3000;           // hear the group before claiming
+  constexpr uint32_t WANT_MS     = 5000;           // follower re-asks for a board
+  constexpr uint32_t RESEND_MS   = 1000;           // leader answers WANT at most this often
+  constexpr uint32_t DUE_MARGIN_MS = 30000;        // leader's poll + a slow fetch + lost HELLOs
+  constexpr uint32_t NEXT_NONE   = 0xFFFFFFFFUL;   // HELLO: leader is not polling (idle)
+  constexpr size_t   FRAG        = 1200;           // snapshot bytes per datagram
+  constexpr size_t   MAX_FRAGS   = 32;
+  constexpr size_t   MAX_PEERS   = 8;
+
+  enum : uint8_t { MSG_HELLO = 1, MSG_BOARD = 2, MSG_WANT = 3 };
+  enum : uint8_t { F_LEADER = 1 << 0, F_REFRESH = 1 << 1 };
+
+  // Wire header, little-endian (ESP32 and x86 hosts alike)
+  struct __attribute__((packed)) Hdr {
+    uint32_t magic;
+    uint8_t  ver, type, flags, frag, frags, rsv[3];
+    uint32_t id;       // sender
+    uint32_t key;      // board identity (see boardKey)
+    uint32_t gen;      // BOARD: leader's snapshot version
+    uint32_t total;    // BOARD: whole snapshot bytes
+    uint32_t sum;      // BOARD: FNV-1a of the whole snapshot
+    uint32_t next;     // HELLO from the leader: ms until its next poll, or NEXT_NONE
+  };
+
+  struct PeerRec { uint32_t id, key, ip, seen, gen; bool leader; };
+
+  enum Role : uint8_t { ROLE_FOLLOWER, ROLE_LEADER };
+
+  Peer::BoardFn     gOnBoard   = nullptr;
+  bool              gOn        = false;
+  uint32_t          gMyId      = 0;
+  volatile uint8_t  gRole      = ROLE_FOLLOWER;
+  volatile uint32_t gLeaderId  = 0;
+  volatile uint32_t gLastBoard = 0;                // millis() of last snapshot from the leader
+  volatile bool     gWantFresh = false;            // askRefresh() → next pass
+  volatile uint32_t gKey       = 0;                // boardKey(), set by Peer::configure()
+
+  // Our own timer, from the loop task (setSchedule): the leader advertises it.
+  volatile uint32_t gNextPollAt = 0;
+  volatile bool     gIdle       = false;           // not polling (quiet hours on a budget)
+  volatile bool     gBudgeted   = false;           // polls are planned by Quota
+
+  // Follower: the leader's next board is due by this millis() (set from its
+  // HELLO, cleared by each board). Past it, the leader's boards are stale.
+  volatile uint32_t gDueAt     = 0;
+  volatile bool     gDue       = false;
+
+  struct {
+    uint32_t sentBoards, rxBoards, rxBad, elections, stepDowns, asks;
+  } gStats = {};
+
+  uint32_t fnv1a(const uint8_t* p, size_t n, uint32_t h = 2166136261u){
+    while (n--){ h ^= *p++; h *= 16777619u; }
+    return h;
+  }
+  uint32_t fnv1a(const char* s, uint32_t h){ return fnv1a((const uint8_t*)s, strlen(s), h); }
+
+  // Everything that changes the Darwin request; only boards with the same key share.
+  // Reads Cfg, so only Peer::configure() calls it; the node reads gKey.
+  uint32_t boardKey(){
+    uint32_t h = fnv1a(Cfg::crs(), 2166136261u);
+    h = fnv1a(Cfg::mode(), h);
+    h = fnv1a(Cfg::callingAtCrs(), h);
+    const uint8_t rows = Cfg::boardRows();
+    return fnv1a(&rows, 1, h);
+  }
+
+  bool leaderStale(){ return gDue && (int32_t)(millis() - gDueAt) > 0; }
+
+  class Node : public Async::Task {
+  public:
+    Node() : Async::Task("peer") {}
+    ~Node(){ closeSocket(); }
+
+    bool step() override {
+      ASYNC_BEGIN();
+      for(;;){
+        while (WiFi.status() != WL_CONNECTED) ASYNC_SLEEP(1000);
+        if (!openSocket()){ ASYNC_SLEEP(5000); continue; }
+        listenFrom_ = millis();
+        while (fd_ >= 0 && WiFi.status() == WL_CONNECTED){
+          tick();
+          ASYNC_WAIT_FD(fd_, 200);
+          drain();
+        }
+        closeSocket();
+        becomeFollower(0);
+      }
+      ASYNC_END();
+    }
+
+    // Leader side: keep the latest snapshot for late joiners and send it now.
+    void share(const uint8_t* data, size_t len){
+      if (len > FRAG * MAX_FRAGS) return;
+      blob_.assign(data, data + len);
+      ++blobGen_;
+      sendBoard();
+    }
+
+  private:
+    bool openSocket(){
+      fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      if (fd_ < 0) return false;
+      int one = 1;
+      setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      struct sockaddr_in sa; memset(&sa, 0, sizeof(sa));
+      sa.sin_family = AF_INET; sa.sin_port = htons(Peer::PORT); sa.sin_addr.s_addr = htonl(INADDR_ANY);
+      if (bind(fd_, (struct sockaddr*)&sa, sizeof(sa)) < 0){ closeSocket(); return false; }
+      struct ip_mreq mr;
+      mr.imr_multiaddr.s_addr = inet_addr(GROUP);
+      mr.imr_interface.s_addr = htonl(INADDR_ANY);
+      if (setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mr, sizeof(mr)) < 0){ closeSocket(); return false; }
+      uint8_t ttl = 1, loop = 1;                    // stay on the LAN; hear same-host instances
+      setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL,  &ttl,  sizeof(ttl));
+      setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+      fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+      return true;
+    }
+    void closeSocket(){ if (fd_ >= 0){ ::close(fd_); fd_ = -1; } }
+
+    void header(Hdr& h, uint8_t type){
+      memset(&h, 0, sizeof(h));
+      h.magic = MAGIC; h.ver = VERSION; h.type = type;
+      h.flags = (gRole == ROLE_LEADER) ? F_LEADER : 0;
+      h.id = gMyId; h.key = key_; h.gen = blobGen_;
+    }
+    void send(const uint8_t* p, size_t n){
+      struct sockaddr_in to; memset(&to, 0, sizeof(to));
+      to.sin_family = AF_INET; to.sin_port = htons(Peer::PORT); to.sin_addr.s_addr = inet_addr(GROUP);
+      sendto(fd_, p, n, MSG_DONTWAIT, (struct sockaddr*)&to, sizeof(to));
+    }
+    void sendSmall(uint8_t type, uint8_t extraFlags){
+      Hdr h; header(h, type); h.flags |= extraFlags;
+      if (type == MSG_HELLO){
+        const int32_t in = (int32_t)(gNextPollAt - millis());
+        h.next = gIdle ? NEXT_NONE : (uint32_t)max<int32_t>(0, in);
+      }
+      send((const uint8_t*)&h, sizeof(h));
+    }
+    void sendBoard(){
+      if (fd_ < 0 || gRole != ROLE_LEADER || blob_.empty()) return;
+      const size_t frags = (blob_.size() + FRAG - 1) / FRAG;
+      const uint32_t sum = fnv1a(blob_.data(), blob_.size());
+      for (size_t i = 0; i < frags; ++i){
+        const size_t off = i * FRAG, n = min(FRAG, blob_.size() - off);
+        Hdr h; header(h, MSG_BOARD);
+        h.frag = (uint8_t)i; h.frags = (uint8_t)frags; h.total = blob_.size(); h.sum = sum;
+        memcpy(pkt_, &h, sizeof(h));
+        memcpy(pkt_ + sizeof(h), blob_.data() + off, n);
+        send(pkt_, sizeof(h) + n);
+      }
+      resentAt_ = millis();
+      gStats.sentBoards++;
+    }
+
+    PeerRec* note(const Hdr& h, uint32_t ip, bool& isNew){
+      PeerRec* free = nullptr; PeerRec* oldest = nullptr;
+      isNew = false;
+      for (auto& p : peers_){
+        if (p.id == h.id){ free = &p; break; }
+        if (!p.id){ if (!free) free = &p; continue; }
+        if (!oldest || p.seen < oldest->seen) oldest = &p;
+      }
+      PeerRec* r = free ? free : oldest;
+      if (r->id != h.id){ isNew = true; r->gen = 0; }
+      r->id = h.id; r->key = h.key; r->ip = ip; r->seen = millis(); r->leader = h.flags & F_LEADER;
+      return r;
+    }
+
+    void becomeFollower(uint32_t leader){
+      if (gRole == ROLE_LEADER) gStats.stepDowns++;
+      gRole = ROLE_FOLLOWER;
+      if (gLeaderId != leader){ gLeaderId = leader; askedAt_ = 0; gotFromLeader_ = false; gDue = false; }
+    }
+
+    void tick(){
+      const uint32_t now = millis();
+      const uint32_t key = gKey;
+      if (key != key_){                             // settings changed: new group
+        key_ = key; blob_.clear(); rxMask_ = 0;
+        becomeFollower(0);
+        listenFrom_ = now; gLastBoard = 0; gDue = false;
+      }
+
+      uint32_t lead = 0, lowest = gMyId;
+      for (auto& p : peers_){
+        if (p.id && now - p.seen > PEER_TTL_MS) p.id = 0;
+        if (!p.id || p.key != key_) continue;
+        if (p.leader && (!lead || p.id < lead)) lead = p.id;
+        if (p.id < lowest) lowest = p.id;
+      }
+
+      if (gRole == ROLE_LEADER){
+        if (lead && lead < gMyId){
+          Serial.printf("[PEER] %08x leads; stepping down\n", (unsigned)lead);
+          becomeFollower(lead);
+        }
+      } else if (lead){
+        if (lead != gLeaderId) Serial.printf("[PEER] following %08x\n", (unsigned)lead);
+        becomeFollower(lead);
+      } else {
+        if (gLeaderId){ gLeaderId = 0; listenFrom_ = now; }
+        // Lowest live id claims once the group has had a chance to speak.
+        if (now - listenFrom_ >= LISTEN_MS && lowest == gMyId){
+          Serial.printf("[PEER] leading %08x as %08x\n", (unsigned)key_, (unsigned)gMyId);
+          gRole = ROLE_LEADER; gStats.elections++;
+          Rail::requestRefresh(Rail::TRIG_PEER);
+        }
+      }
+
+      if (now - helloAt_ >= HELLO_MS){ sendSmall(MSG_HELLO, 0); helloAt_ = now; }
+
+      if (gRole == ROLE_FOLLOWER && gLeaderId){
+        if (gWantFresh){ gWantFresh = false; sendSmall(MSG_WANT, F_REFRESH); askedAt_ = now; gStats.asks++; }
+        else if (!gotFromLeader_ && (!askedAt_ || now - askedAt_ >= WANT_MS)){ sendSmall(MSG_WANT, 0); askedAt_ = now; }
+      }
+      if (gRole == ROLE_FOLLOWER){
+        // Leader's boards stopped coming: poll for ourselves until they do. On a
+        // budget, our own planned timer does that (it also keeps quiet hours);
+        // unmetered boards fetch at once.
+        const bool stale = leaderStale();
+        if (stale && !staleKicked_ && !gBudgeted) Rail::requestRefresh(Rail::TRIG_PEER);
+        staleKicked_ = stale;
+      }
+      if (gRole == ROLE_LEADER && resend_ && now - resentAt_ >= RESEND_MS){ resend_ = false; sendBoard(); }
+    }
+
+    void drain(){
+      for(;;){
+        struct sockaddr_in from; socklen_t fl = sizeof(from);
+        const int n = recvfrom(fd_, pkt_, sizeof(pkt_), MSG_DONTWAIT, (struct sockaddr*)&from, &fl);
+        if (n <= 0) return;
+        if ((size_t)n < sizeof(Hdr)) continue;
+        Hdr h; memcpy(&h, pkt_, sizeof(h));
+        if (h.magic != MAGIC || h.ver != VERSION || h.id == gMyId) continue;   // own loopback
+        bool isNew; note(h, from.sin_addr.s_addr, isNew);
+        if (h.key != key_) continue;
+
+        switch (h.type){
+          case MSG_HELLO:
+            if (isNew && gRole == ROLE_LEADER) resend_ = true;
+            if (gRole == ROLE_FOLLOWER && h.id == gLeaderId) noteDue(h.next);
+            break;
+          case MSG_WANT:
+            if (gRole != ROLE_LEADER) break;
+            if (h.flags & F_REFRESH) Rail::requestRefresh(Rail::TRIG_PEER);
+            else resend_ = true;
+            break;
+          case MSG_BOARD:
+            if (gRole == ROLE_FOLLOWER && h.id == gLeaderId) fragment(h, pkt_ + sizeof(h), n - sizeof(h));
+            break;
+        }
+      }
+    }
+
+    // The leader says when it polls next. Keep the earliest promise until a
+    // board meets it, so a leader that keeps rescheduling still goes stale.
+    void noteDue(uint32_t next){
+      if (next == NEXT_NONE) return;
+      const uint32_t due = millis() + min<uint32_t>(next, 0x7FFFFFFFUL - DUE_MARGIN_MS) + DUE_MARGIN_MS;
+      if (!gDue || (int32_t)(due - gDueAt) < 0){ gDueAt = due; gDue = true; }
+    }
+
+    void fragment(const Hdr& h, const uint8_t* p, size_t n){
+      if (!h.frags || h.frags > MAX_FRAGS || h.frag >= h.frags || h.total > FRAG * MAX_FRAGS ||
+          (size_t)h.frag * FRAG + n > h.total){ gStats.rxBad++; return; }
+      if (h.id == doneFrom_ && h.gen == doneGen_ && h.sum == doneSum_) return;   // already delivered
+      if (h.id != rxFrom_ || h.gen != rxGen_ || h.sum != rxSum_){   // new snapshot: start over
+        rxFrom_ = h.id; rxGen_ = h.gen; rxSum_ = h.sum; rxMask_ = 0;
+        rx_.assign(h.total, 0);
+      }
+      memcpy(rx_.data() + (size_t)h.frag * FRAG, p, n);
+      rxMask_ |= 1UL << h.frag;
+      const uint32_t all = (h.frags == 32) ? 0xFFFFFFFFUL : ((1UL << h.frags) - 1);
+      if (rxMask_ != all) return;
+      if (fnv1a(rx_.data(), rx_.size()) != rxSum_){ gStats.rxBad++; rxMask_ = 0; return; }
+      doneFrom_ = rxFrom_; doneGen_ = rxGen_; doneSum_ = rxSum_;
+      gotFromLeader_ = true;
+      gLastBoard = millis();
+      gDue = false;                                 // next HELLO sets the next deadline
+      gStats.rxBoards++;
+      if (gOnBoard) gOnBoard(rx_.data(), rx_.size());
+    }
+
+    int                  fd_          = -1;
+    uint32_t             key_         = 0;
+    uint32_t             listenFrom_  = 0;
+    uint32_t             helloAt_     = 0;
+    uint32_t             askedAt_     = 0;
+    uint32_t             resentAt_    = 0;
+    bool                 resend_      = false;
+    bool                 staleKicked_ = false;
+    bool                 gotFromLeader_ = false;
+    PeerRec              peers_[MAX_PEERS] = {};
+    std::vector<uint8_t> blob_;                    // leader: last snapshot shared
+    uint32_t             blobGen_     = 0;
+    std::vector<uint8_t> rx_;                      // follower: reassembly
+    uint32_t             rxFrom_ = 0, rxGen_ = 0, rxSum_ = 0, rxMask_ = 0;
+    uint32_t             doneFrom_ = 0, doneGen_ = 0, doneSum_ = 0;
+    uint8_t              pkt_[sizeof(Hdr) + FRAG];
+  };
+
+  Node* gNode = nullptr;
+}
+
+void Peer::begin(BoardFn onBoard){
+  if (gOn || !Cfg::peerShare()) return;
+  gOnBoard = onBoard;
+  gMyId    = (uint32_t)(ESP.getEfuseMac() >> 16);  // MAC bytes 2..5; unique per board
+  configure();
+  Async::begin();
+  gNode = new Node();
+  gOn   = Async::spawn(gNode);
+  if (!gOn){ gNode = nullptr; return; }
+  MDNS.addService("trakkr", "udp", PORT);
+  MDNS.addServiceTxt("trakkr", "udp", "crs", Cfg::crs());
+}
+
+void Peer::configure(){ gKey = boardKey(); }        // one 32-bit store: atomic
+
+bool Peer::shouldPoll(){
+  if (!gOn || gRole == ROLE_LEADER) return true;
+  return leaderStale();
+}
+
+void Peer::share(const uint8_t* data, size_t len){
+  if (gOn && gRole == ROLE_LEADER) gNode->share(data, len);
+}
+
+void Peer::askRefresh(){ if (gOn) gWantFresh = true; }
+
+void Peer::setSchedule(uint32_t nextPollAt, bool idle, bool budgeted){
+  gNextPollAt = nextPollAt; gIdle = idle; gBudgeted = budgeted;
+}
+
+String Peer::statsJSON(){
+  char id[10]; snprintf(id, sizeof(id), "%08x", (unsigned)gMyId);
+  char ld[10]; snprintf(ld, sizeof(ld), "%08x", (unsigned)gLeaderId);
+  String j; j.reserve(256);
+  j += "{\"enabled\":";   j += gOn ? "true" : "false";
+  j += ",\"id\":\"";      j += id; j += '"';
+  j += ",\"role\":\"";    j += (gRole == ROLE_LEADER) ? "leader" : "follower"; j += '"';
+  j += ",\"leader\":";    if (gLeaderId){ j += '"'; j += ld; j += '"'; } else j += "null";
+  j += ",\"polling\":";   j += shouldPoll() ? "true" : "false";
+  j += ",\"boardAgeMs\":"; j += gLastBoard ? String(millis() - gLastBoard) : String("null");
+  j += ",\"sent\":";      j += String(gStats.sentBoards);
+  j += ",\"received\":";  j += String(gStats.rxBoards);
+  j += ",\"bad\":";       j += String(gStats.rxBad);
+  j += ",\"elections\":"; j += String(gStats.elections);
+  j += ",\"stepDowns\":"; j += String(gStats.stepDowns);
+  j += ",\"asks\":";      j += String(gStats.asks);
+  j += '}';
+  return j;
+}
@@ -0,0 +1,225 @@
+#include "Pixel.h"
+#include "Bench.h"
+#include <esp_heap_caps.h>
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && defined(__XTENSA__)
+  #define PIXEL_PIE 1
+#else
+  #define PIXEL_PIE 0
+#endif
+
+namespace {
+  enum Kernel : uint8_t { K_FILL, K_COPY, K_SWAP, K_COUNT };
+  const char* const kKernelNames[K_COUNT] = { "fill16", "copy16", "swap16" };
+
+  constexpr size_t MIN_VEC = 16;                      // shorter runs aren't worth the head/tail split
+  bool gVec[K_COUNT]    = {};                         // vector kernel enabled (passed the self-check)
+  bool gFailed[K_COUNT] = {};
+
+  inline bool aligned16(const void* p){ return ((uintptr_t)p & 15) == 0; }
+  inline bool sameAlign(const void* a, const void* b){ return (((uintptr_t)a ^ (uintptr_t)b) & 15) == 0; }
+
+#if PIXEL_PIE
+  // Bodies work on whole 16-byte blocks at 16-byte aligned addresses; callers do head/tail.
+  void fillBlocks(uint16_t* d, uint16_t v, size_t blocks){
+    asm volatile(
+      "ee.vldbc.16    q0, %[c]        \n"     // v in all eight lanes
+      "1:                             \n"
+      "ee.vst.128.ip  q0, %[d], 16    \n"
+      "addi           %[n], %[n], -1  \n"
+      "bnez           %[n], 1b        \n"
+      : [d] "+r"(d), [n] "+r"(blocks) : [c] "r"(&v) : "memory");
+  }
+  void copyBlocks(uint16_t* d, const uint16_t* s, size_t blocks){
+    asm volatile(
+      "1:                             \n"
+      "ee.vld.128.ip  q0, %[s], 16    \n"
+      "ee.vst.128.ip  q0, %[d], 16    \n"
+      "addi           %[n], %[n], -1  \n"
+      "bnez           %[n], 1b        \n"
+      : [d] "+r"(d), [s] "+r"(s), [n] "+r"(blocks) :: "memory");
+  }
+  // 32 bytes per pass: unzip splits low/high bytes, zip re-interleaves them high first.
+  void swapPairs(uint16_t* d, const uint16_t* s, size_t pairs){
+    asm volatile(
+      "1:                             \n"
+      "ee.vld.128.ip  q0, %[s], 16    \n"
+      "ee.vld.128.ip  q1, %[s], 16    \n"
+      "ee.vunzip.8    q0, q1          \n"     // q0 = low bytes, q1 = high bytes
+      "ee.vzip.8      q1, q0          \n"     // q1 = px 0..7 swapped, q0 = px 8..15
+      "ee.vst.128.ip  q1, %[d], 16    \n"
+      "ee.vst.128.ip  q0, %[d], 16    \n"
+      "addi           %[n], %[n], -1  \n"
+      "bnez           %[n], 1b        \n"
+      : [d] "+r"(d), [s] "+r"(s), [n] "+r"(pairs) :: "memory");
+  }
+
+  void fillVec(uint16_t* d, uint16_t v, size_t n){
+    while (n && !aligned16(d)){ *d++ = v; --n; }
+    if (n >= 8){ fillBlocks(d, v, n >> 3); d += n & ~(size_t)7; n &= 7; }
+    while (n--) *d++ = v;
+  }
+  void copyVec(uint16_t* d, const uint16_t* s, size_t n){
+    while (n && !aligned16(d)){ *d++ = *s++; --n; }
+    if (n >= 8){ copyBlocks(d, s, n >> 3); d += n & ~(size_t)7; s += n & ~(size_t)7; n &= 7; }
+    while (n--) *d++ = *s++;
+  }
+  void swapVec(uint16_t* d, const uint16_t* s, size_t n){
+    while (n && !aligned16(d)){ *d++ = Pixel::panel(*s++); --n; }
+    if (n >= 16){ swapPairs(d, s, n >> 4); d += n & ~(size_t)15; s += n & ~(size_t)15; n &= 15; }
+    while (n--) *d++ = Pixel::panel(*s++);
+  }
+#endif
+
+  // ---- Self-check: dispatch (vector on) vs ref on odd lengths and offsets, with guard words ----
+  constexpr size_t CHECK_N = 160;
+  bool checkKernel(Kernel k, uint16_t* a, uint16_t* b, uint16_t* src){
+#if PIXEL_PIE
+    static const uint16_t lens[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 64, 127, 130 };
+    gVec[k] = true;
+    for (int so = 0; so < 8; ++so) for (int dof = 0; dof < 8; ++dof) for (uint16_t n : lens){
+      for (size_t i = 0; i < CHECK_N; ++i){ a[i] = b[i] = (uint16_t)(0xA5A5 ^ (i * 0x9E37)); }
+      switch (k){
+        case K_FILL: Pixel::fill16(a + dof, src[so], n);   Pixel::ref::fill16(b + dof, src[so], n); break;
+        case K_COPY: Pixel::copy16(a + dof, src + so, n);  Pixel::ref::copy16(b + dof, src + so, n); break;
+        case K_SWAP: Pixel::swap16(a + dof, src + so, n);  Pixel::ref::swap16(b + dof, src + so, n); break;
+        default: break;
+      }
+      if (memcmp(a, b, CHECK_N * 2) != 0){
+        Serial.printf("[PIXEL][WARN] %s mismatch (n=%u src+%d dst+%d); using scalar\n", kKernelNames[k], n, so, dof);
+        return false;
+      }
+    }
+    return true;
+#else
+    (void)k; (void)a; (void)b; (void)src;
+    return false;
+#endif
+  }
+
+  // ---- /api/bench cases on a ticker-sized buffer ----
+  constexpr size_t BENCH_N = 480 * 28;
+  uint16_t* gBa = nullptr; uint16_t* gBb = nullptr; uint8_t* gB4 = nullptr;
+  uint16_t  gPal[16];
+
+  bool benchBegin(void*){
+    gBa = (uint16_t*)heap_caps_aligned_alloc(16, BENCH_N * 2, MALLOC_CAP_8BIT);
+    gBb = (uint16_t*)heap_caps_aligned_alloc(16, BENCH_N * 2, MALLOC_CAP_8BIT);
+    gB4 = (uint8_t*)malloc(BENCH_N / 2);
+    if (!gBa || !gBb || !gB4) return false;
+    for (size_t i = 0; i < BENCH_N; ++i) gBb[i] = (uint16_t)(i * 0x9E37);
+    for (size_t i = 0; i < BENCH_N / 2; ++i) gB4[i] = (uint8_t)(i * 37);
+    for (int i = 0; i < 16; ++i) gPal[i] = Pixel::panel((uint16_t)(i * 0x1111));
+    return true;
+  }
+  void benchEnd(void*){ heap_caps_free(gBa); heap_caps_free(gBb); free(gB4); gBa = gBb = nullptr; gB4 = nullptr; }
+
+  void benchFill(void*)    { Pixel::fill16(gBa, 0x1A33, BENCH_N); }
+  void benchFillRef(void*) { Pixel::ref::fill16(gBa, 0x1A33, BENCH_N); }
+  void benchCopy(void*)    { Pixel::copy16(gBa, gBb, BENCH_N); }
+  void benchCopyRef(void*) { Pixel::ref::copy16(gBa, gBb, BENCH_N); }
+  void benchSwap(void*)    { Pixel::swap16(gBa, gBb, BENCH_N); }
+  void benchSwapRef(void*) { Pixel::ref::swap16(gBa, gBb, BENCH_N); }
+  void benchExpand(void*)  { Pixel::expand4(gBa, gB4, BENCH_N, gPal); }
+  void benchBlend(void*)   { Pixel::blend(gBa, gBa, gBb, BENCH_N, 12, true); }
+}
+
+// =================== Scalar reference ===============================
+void Pixel::ref::fill16(uint16_t* d, uint16_t v, size_t n){ while (n--) *d++ = v; }
+void Pixel::ref::copy16(uint16_t* d, const uint16_t* s, size_t n){ while (n--) *d++ = *s++; }
+void Pixel::ref::swap16(uint16_t* d, const uint16_t* s, size_t n){ while (n--) *d++ = panel(*s++); }
+
+// =================== Dispatch =======================================
+void Pixel::fill16(uint16_t* d, uint16_t v, size_t n){
+#if PIXEL_PIE
+  if (gVec[K_FILL] && n >= MIN_VEC && !((uintptr_t)d & 1)){ fillVec(d, v, n); return; }
+#endif
+  ref::fill16(d, v, n);
+}
+
+void Pixel::copy16(uint16_t* d, const uint16_t* s, size_t n){
+#if PIXEL_PIE
+  if (gVec[K_COPY] && n >= MIN_VEC && sameAlign(d, s) && !((uintptr_t)d & 1)){ copyVec(d, s, n); return; }
+#endif
+  memcpy(d, s, n * 2);                                // already word-wide; beats the plain loop
+}
+
+void Pixel::copyRect(uint16_t* d, int dstStride, const uint16_t* s, int srcStride, int w, int h){
+  if (w <= 0 || h <= 0) return;
+  if (dstStride == w && srcStride == w){ copy16(d, s, (size_t)w * h); return; }
+  for (int r = 0; r < h; ++r, d += dstStride, s += srcStride) copy16(d, s, (size_t)w);
+}
+
+void Pixel::swap16(uint16_t* d, const uint16_t* s, size_t n){
+#if PIXEL_PIE
+  if (gVec[K_SWAP] && n >= MIN_VEC && sameAlign(d, s) && !((uintptr_t)d & 1)){ swapVec(d, s, n); return; }
+#endif
+  ref::swap16(d, s, n);
+}
+
+uint16_t* Pixel::alloc(size_t n){
+  const size_t bytes = n * sizeof(uint16_t);
+  void* p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+  if (p) return (uint16_t*)p;
+  if (heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) < bytes + RESERVE) return nullptr;
+  return (uint16_t*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void Pixel::expand4(uint16_t* d, const uint8_t* s, size_t n, const uint16_t pal[16]){
+  for (; n >= 2; n -= 2){ const uint8_t b = *s++; *d++ = pal[b >> 4]; *d++ = pal[b & 15]; }
+  if (n) *d = pal[*s >> 4];
+}
+
+// One multiply per pixel for all three channels: G is moved to the high half
+// (0x07E0F81F), leaving 5-6 spare bits above each field for the product.
+void Pixel::blend(uint16_t* d, const uint16_t* a, const uint16_t* b, size_t n, uint8_t alpha, bool panelOrder){
+  if (alpha > 32) alpha = 32;
+  const uint32_t ia = 32 - alpha;
+  while (n--){
+    uint32_t x = *a++, y = *b++;
+    if (panelOrder){ x = panel((uint16_t)x); y = panel((uint16_t)y); }
+    x = (x | (x << 16)) & 0x07E0F81F;
+    y = (y | (y << 16)) & 0x07E0F81F;
+    uint32_t r = ((x * alpha + y * ia) >> 5) & 0x07E0F81F;
+    const uint16_t p = (uint16_t)(r | (r >> 16));
+    *d++ = panelOrder ? panel(p) : p;
+  }
+}
+
+// =================== Setup / stats ==================================
+void Pixel::begin(){
+  static bool done = false;
+  if (done) return;
+  done = true;
+#if PIXEL_PIE
+  uint16_t* a = (uint16_t*)heap_caps_aligned_alloc(16, CHECK_N * 2, MALLOC_CAP_8BIT);
+  uint16_t* b = (uint16_t*)heap_caps_aligned_alloc(16, CHECK_N * 2, MALLOC_CAP_8BIT);
+  uint16_t* s = (uint16_t*)heap_caps_aligned_alloc(16, CHECK_N * 2, MALLOC_CAP_8BIT);
+  if (a && b && s){
+    for (size_t i = 0; i < CHECK_N; ++i) s[i] = (uint16_t)(i * 0x3B1D + 0x0F0F);
+    for (int k = 0; k < K_COUNT; ++k){ gVec[k] = checkKernel((Kernel)k, a, b, s); gFailed[k] = !gVec[k]; }
+  }
+  heap_caps_free(a); heap_caps_free(b); heap_caps_free(s);
+#endif
+
+  Bench::add({ "pixel.fill16",     &benchFill,    nullptr, 50, (uint32_t)BENCH_N * 2, &benchBegin, &benchEnd });
+  Bench::add({ "pixel.fill16.ref", &benchFillRef, nullptr, 50, (uint32_t)BENCH_N * 2, &benchBegin, &benchEnd });
+  Bench::add({ "pixel.copy16",     &benchCopy,    nullptr, 50, (uint32_t)BENCH_N * 2, &benchBegin, &benchEnd });
+  Bench::add({ "pixel.copy16.ref", &benchCopyRef, nullptr, 50, (uint32_t)BENCH_N * 2, &benchBegin, &benchEnd });
+  Bench::add({ "pixel.swap16",     &benchSwap,    nullptr, 50, (uint32_t)BENCH_N * 2, &benchBegin, &benchEnd });
+  Bench::add({ "pixel.swap16.ref", &benchSwapRef, nullptr, 50, (uint32_t)BENCH_N * 2, &benchBegin, &benchEnd });
+  Bench::add({ "pixel.expand4",    &benchExpand,  nullptr, 50, (uint32_t)BENCH_N / 2, &benchBegin, &benchEnd });
+  Bench::add({ "pixel.blend",      &benchBlend,   nullptr, 50, (uint32_t)BENCH_N * 4, &benchBegin, &benchEnd });
+}
+
+String Pixel::statsJSON(){
+  String j; j.reserve(128);
+  j += "{\"pie\":"; j += PIXEL_PIE ? "true" : "false";
+  for (int k = 0; k < K_COUNT; ++k){
+    j += ",\""; j += kKernelNames[k]; j += "\":\"";
+    j += gVec[k] ? "pie" : (gFailed[k] ? "scalar (self-check failed)" : "scalar");
+    j += '"';
+  }
+  j += '}';
+  return j;
+}
@@ -0,0 +1,334 @@
+#include "Profile.h"
+#include <new>
+#include <esp_heap_caps.h>
+#include <esp_ipc.h>
+#include <esp_debug_helpers.h>
+#include <freertos/xtensa_context.h>
+#include "SpscRing.h"
+
+// [TRAKKR] PC sampler + run-time stats (see Profile.h)
+
+extern "C" void* volatile pxCurrentTCB[];      // FreeRTOS: running TCB per core; pxTopOfStack is its first field
+
+namespace {
+  constexpr int      MAX_DEPTH     = 8;
+  constexpr size_t   RING          = 256;       // per core; drained every DRAIN_MS
+  constexpr uint32_t DRAIN_MS      = 20;
+  constexpr uint8_t  TIMER_BASE    = 2;         // hw timers 2 and 3 (0 and 1 left for sketches)
+  constexpr int      MAX_TASKS     = 40;        // id 0 = "[isr]"
+  constexpr uint32_t BITS_PSRAM    = 11;        // 2048 unique stacks, 88 KB
+  constexpr uint32_t BITS_INTERNAL = 8;         // 256, 11 KB
+
+  struct Sample {
+    void*    task;                              // TCB, nullptr = interrupted another ISR
+    uint8_t  depth;
+    uint32_t pc[MAX_DEPTH];                     // leaf first
+  };
+  typedef SpscRing<Sample, RING> Ring;
+
+  struct Stack {
+    uint32_t count;                             // 0 = empty slot
+    uint32_t hash;
+    uint8_t  task, depth;
+    uint32_t pc[MAX_DEPTH];
+  };
+
+  struct TaskInfo {
+    void*    handle;
+    char     name[16];
+    int8_t   core;                              // where it was last sampled, -1 = never
+    bool     has0, has1;
+    uint32_t samples;
+    uint32_t rt0, rt1;                          // run-time counter at start / end
+  };
+
+  Ring*             gRing[portNUM_PROCESSORS] = {};
+  hw_timer_t*       gTimer[portNUM_PROCESSORS] = {};
+  volatile uint32_t gDropped[portNUM_PROCESSORS];
+  uint32_t          gCoreSamples[portNUM_PROCESSORS];
+
+  Stack*            gTab = nullptr;
+  uint32_t          gMask = 0, gUsed = 0, gLost = 0;
+  TaskInfo          gTasks[MAX_TASKS];
+  int               gTaskCount = 0;
+  uint32_t          gTotal0 = 0, gTotal1 = 0;
+
+  SemaphoreHandle_t gLock = nullptr;            // table + task list: prof task vs HTTP readers
+  TaskHandle_t      gTask = nullptr;
+  volatile bool     gRunning = false;
+  uint16_t          gHz = 0;
+  uint32_t          gDurMs = 0, gStartMs = 0, gEndMs = 0;
+
+  // Return addresses carry the window increment in their top bits and point
+  // past the call; map back to the call instruction.
+  inline uint32_t callPc(uint32_t ra){ return ((ra & 0x3fffffffu) | 0x40000000u) - 3; }
+
+  // Timer ISR on each core. The port saved the interrupted task's registers
+  // in an exception frame on its stack and left pxTopOfStack pointing at it.
+  void sampleIsr(){
+    const int core = xPortGetCoreID();
+    Sample s;
+    s.task = nullptr; s.depth = 0;
+    if (!xPortInterruptedFromISRContext()){
+      void* tcb = pxCurrentTCB[core];
+      const XtExcFrame* f = tcb ? *(XtExcFrame* const*)tcb : nullptr;
+      if (f && esp_stack_ptr_is_sane((uint32_t)(uintptr_t)f)){
+        s.task = tcb;
+        esp_backtrace_frame_t fr;
+        fr.pc = (uint32_t)f->pc; fr.sp = (uint32_t)f->a1; fr.next_pc = (uint32_t)f->a0; fr.exc_frame = f;
+        s.pc[s.depth++] = fr.pc;
+        while (s.depth < MAX_DEPTH && fr.next_pc && esp_stack_ptr_is_sane(fr.sp)){
+          if (!esp_backtrace_get_next_frame(&fr)) break;
+          s.pc[s.depth++] = callPc(fr.pc);
+        }
+      }
+    }
+    if (!gRing[core]->push(s)) gDropped[core]++;
+  }
+
+  // Both run on the core they're for (esp_ipc), so the interrupt lands there.
+  void timerOn(void* arg){
+    const int core = (int)(intptr_t)arg;
+    hw_timer_t* t = timerBegin(TIMER_BASE + core, 80, true);   // 1 MHz
+    if (!t) return;
+    timerAttachInterrupt(t, &sampleIsr, true);
+    timerAlarmWrite(t, 1000000u / gHz, true);
+    timerAlarmEnable(t);
+    gTimer[core] = t;
+  }
+  void timerOff(void* arg){
+    const int core = (int)(intptr_t)arg;
+    hw_timer_t* t = gTimer[core];
+    if (!t) return;
+    timerAlarmDisable(t);
+    timerDetachInterrupt(t);
+    timerEnd(t);
+    gTimer[core] = nullptr;
+  }
+
+  // Callers hold gLock.
+  int taskIndex(void* h, const char* name){
+    for (int i = 0; i < gTaskCount; ++i) if (gTasks[i].handle == h) return i;
+    if (gTaskCount >= MAX_TASKS) return MAX_TASKS - 1;
+    TaskInfo& t = gTasks[gTaskCount];
+    memset(&t, 0, sizeof(t));
+    t.handle = h;
+    t.core = -1;
+    strncpy(t.name, name ? name : "?", sizeof(t.name) - 1);
+    return gTaskCount++;
+  }
+
+  // Run-time counters (and names) of every live task. Callers hold gLock.
+  void snapshot(bool first, void* want = nullptr){
+#if configUSE_TRACE_FACILITY
+    UBaseType_t n = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t* st = (TaskStatus_t*)malloc(n * sizeof(TaskStatus_t));
+    if (!st) return;
+    uint32_t total = 0;
+    n = uxTaskGetSystemState(st, n, &total);
+    for (UBaseType_t i = 0; i < n; ++i){
+      if (want && (void*)st[i].xHandle != want) continue;
+      TaskInfo& t = gTasks[taskIndex((void*)st[i].xHandle, st[i].pcTaskName)];
+  #if configGENERATE_RUN_TIME_STATS
+      if (want) break;
+      if (first){ t.rt0 = st[i].ulRunTimeCounter; t.has0 = true; }
+      else      { t.rt1 = st[i].ulRunTimeCounter; t.has1 = true; }
+  #endif
+    }
+    if (!want){ if (first) gTotal0 = total; else gTotal1 = total; }
+    free(st);
+#else
+    (void)first; (void)want;
+#endif
+  }
+
+  uint8_t sampleTask(void* h){
+    if (!h) return 0;
+    for (int i = 1; i < gTaskCount; ++i) if (gTasks[i].handle == h) return (uint8_t)i;
+    snapshot(false, h);                         // started after start(): look its name up
+    for (int i = 1; i < gTaskCount; ++i) if (gTasks[i].handle == h) return (uint8_t)i;
+    return (uint8_t)taskIndex(h, "?");
+  }
+
+  bool insert(uint8_t task, uint8_t depth, const uint32_t* pc){
+    uint32_t h = 2166136261u ^ task;
+    for (uint8_t d = 0; d < depth; ++d){ h ^= pc[d]; h *= 16777619u; }
+    h ^= depth;
+    for (uint32_t i = h & gMask, k = 0; k <= gMask; i = (i + 1) & gMask, ++k){
+      Stack& s = gTab[i];
+      if (!s.count){
+        if (gUsed >= (gMask + 1) * 3 / 4) return false;
+        s.hash = h; s.task = task; s.depth = depth;
+        memcpy(s.pc, pc, depth * sizeof(uint32_t));
+        s.count = 1;
+        gUsed++;
+        return true;
+      }
+      if (s.hash == h && s.task == task && s.depth == depth && !memcmp(s.pc, pc, depth * sizeof(uint32_t))){
+        s.count++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void drain(){
+    xSemaphoreTake(gLock, portMAX_DELAY);
+    Sample s;
+    for (int c = 0; c < portNUM_PROCESSORS; ++c){
+      if (!gRing[c]) continue;
+      while (gRing[c]->pop(s)){
+        gCoreSamples[c]++;
+        const uint8_t t = sampleTask(s.task);
+        gTasks[t].samples++;
+        gTasks[t].core = (int8_t)c;
+        // Table full: keep the sample, minus its stack
+        if (!insert(t, s.depth, s.pc) && !insert(t, 0, s.pc)) gLost++;
+      }
+    }
+    xSemaphoreGive(gLock);
+  }
+
+  void profTask(void*){
+    for (int c = 0; c < portNUM_PROCESSORS; ++c) esp_ipc_call_blocking(c, &timerOn, (void*)(intptr_t)c);
+    while (gRunning && millis() - gStartMs < gDurMs){
+      vTaskDelay(pdMS_TO_TICKS(DRAIN_MS));
+      drain();
+    }
+    for (int c = 0; c < portNUM_PROCESSORS; ++c) esp_ipc_call_blocking(c, &timerOff, (void*)(intptr_t)c);
+    drain();
+    xSemaphoreTake(gLock, portMAX_DELAY);
+    snapshot(false);
+    xSemaphoreGive(gLock);
+    gEndMs = millis();
+    gRunning = false;
+    Serial.printf("[PROF] done: %lu samples, %u stacks\n",
+                  (unsigned long)(gCoreSamples[0] + (portNUM_PROCESSORS > 1 ? gCoreSamples[portNUM_PROCESSORS - 1] : 0)),
+                  (unsigned)gUsed);
+    gTask = nullptr;
+    vTaskDelete(nullptr);
+  }
+
+  void jsonName(String& j, const char* s){
+    j += '"';
+    for (; s && *s; ++s){
+      if (*s == '"' || *s == '\\') j += '\\';
+      j += *s;
+    }
+    j += '"';
+  }
+}
+
+bool Profile::start(uint16_t hz, uint32_t ms){
+  if (gRunning || gTask) return false;          // gTask: last run still winding down
+  if (!gLock) gLock = xSemaphoreCreateMutex();
+  if (!gLock) return false;
+  for (int c = 0; c < portNUM_PROCESSORS; ++c){
+    if (!gRing[c]) gRing[c] = new (std::nothrow) Ring();
+    if (!gRing[c]) return false;
+    Sample s;
+    while (gRing[c]->pop(s)) {}
+  }
+  if (!gTab){
+    uint32_t bits = BITS_PSRAM;
+    gTab = (Stack*)heap_caps_calloc((size_t)1 << bits, sizeof(Stack), MALLOC_CAP_SPIRAM);
+    if (!gTab){
+      bits = BITS_INTERNAL;
+      gTab = (Stack*)heap_caps_calloc((size_t)1 << bits, sizeof(Stack), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!gTab) return false;
+    gMask = (1u << bits) - 1;
+  }
+
+  xSemaphoreTake(gLock, portMAX_DELAY);
+  memset(gTab, 0, (size_t)(gMask + 1) * sizeof(Stack));
+  gUsed = 0; gLost = 0;
+  gTaskCount = 0;
+  taskIndex(nullptr, "[isr]");
+  for (int c = 0; c < portNUM_PROCESSORS; ++c){ gDropped[c] = 0; gCoreSamples[c] = 0; }
+  snapshot(true);
+  xSemaphoreGive(gLock);
+
+  gHz = (uint16_t)constrain((int)hz, 10, 2000);
+  gDurMs = ms;
+  gStartMs = millis();
+  gRunning = true;
+  if (xTaskCreate(profTask, "prof", 4096, nullptr, 1, &gTask) != pdPASS){
+    gRunning = false; gTask = nullptr;
+    return false;
+  }
+  Serial.printf("[PROF] sampling at %u Hz for %lu ms\n", (unsigned)gHz, (unsigned long)ms);
+  return true;
+}
+
+void Profile::stop(){ gRunning = false; }
+
+bool Profile::running(){ return gRunning; }
+
+String Profile::statsJSON(){
+  String j; j.reserve(1536);
+  j += "{\"running\":"; j += gRunning ? "true" : "false";
+  j += ",\"hz\":";      j += gHz;
+  j += ",\"elapsedMs\":"; j += (uint32_t)(gHz ? ((gRunning ? millis() : gEndMs) - gStartMs) : 0);
+  if (!gLock){ j += '}'; return j; }
+
+  xSemaphoreTake(gLock, portMAX_DELAY);
+  if (gRunning) snapshot(false);                // share so far
+  j += ",\"samples\":[";
+  for (int c = 0; c < portNUM_PROCESSORS; ++c){ if (c) j += ','; j += gCoreSamples[c]; }
+  j += "],\"dropped\":[";
+  for (int c = 0; c < portNUM_PROCESSORS; ++c){ if (c) j += ','; j += (uint32_t)gDropped[c]; }
+  j += "],\"stacks\":"; j += gUsed;
+  j += ",\"lost\":";    j += gLost;
+  const uint32_t total = gTotal1 - gTotal0;
+  j += ",\"runTimeStats\":"; j += (configGENERATE_RUN_TIME_STATS && total) ? "true" : "false";
+
+  // Busiest first
+  uint8_t order[MAX_TASKS];
+  for (int i = 0; i < gTaskCount; ++i) order[i] = (uint8_t)i;
+  for (int i = 1; i < gTaskCount; ++i)
+    for (int k = i; k > 0 && gTasks[order[k]].samples > gTasks[order[k - 1]].samples; --k){
+      const uint8_t t = order[k]; order[k] = order[k - 1]; order[k - 1] = t;
+    }
+  j += ",\"tasks\":[";
+  for (int i = 0; i < gTaskCount; ++i){
+    const TaskInfo& t = gTasks[order[i]];
+    if (i) j += ',';
+    j += "{\"name\":"; jsonName(j, t.name);
+    j += ",\"core\":";    j += (int)t.core;
+    j += ",\"samples\":"; j += t.samples;
+    const uint32_t coreN = t.core >= 0 ? gCoreSamples[t.core] : 0;
+    j += ",\"samplePct\":"; j += String(coreN ? 100.0f * t.samples / coreN : 0.0f, 1);
+    if (total && t.has0 && t.has1){
+      j += ",\"cpuPct\":"; j += String(100.0f * (t.rt1 - t.rt0) / total, 1);   // of one core
+    }
+    j += '}';
+  }
+  j += "]}";
+  xSemaphoreGive(gLock);
+  return j;
+}
+
+void Profile::writeCollapsed(void (*emit)(const String& chunk, void* ctx), void* ctx){
+  if (!gTab || !gLock) return;
+  // Slots never move while a run adds to the table, so it can be walked a
+  // chunk per lock.
+  String j; j.reserve(1200);
+  char hex[12];
+  for (uint32_t i = 0; i <= gMask; ){
+    xSemaphoreTake(gLock, portMAX_DELAY);
+    for (; i <= gMask && j.length() < 1024; ++i){
+      const Stack& s = gTab[i];
+      if (!s.count) continue;
+      j += gTasks[s.task].name;
+      if (s.depth == MAX_DEPTH) j += ";[deeper]";
+      for (int d = s.depth - 1; d >= 0; --d){     // root first
+        snprintf(hex, sizeof(hex), ";0x%08lx", (unsigned long)s.pc[d]);
+        j += hex;
+      }
+      j += ' '; j += s.count; j += '\n';
+    }
+    xSemaphoreGive(gLock);
+    if (j.length()){ emit(j, ctx); j = String(); j.reserve(1200); }
+  }
+}
@@ -0,0 +1,191 @@
+#include "Quota.h"
+#include "Global.h"
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <time.h>
+
+namespace {
+  constexpr const char* NS            = "trakkrq";
+  constexpr uint32_t    FLUSH_EVERY   = 25;               // requests per NVS write
+  constexpr uint32_t    FLUSH_MAX_MS  = 15UL * 60 * 1000; // ...or this long, whichever first
+  constexpr uint32_t    ERR_BASE_MS   = 2000;
+  constexpr uint32_t    EMPTY_RECHECK = 3600;             // s; budget gone: look again hourly
+  constexpr time_t      EPOCH_VALID   = 1600000000;       // anything earlier = clock not set
+
+  struct Rec { uint32_t periodStart; uint32_t used; };    // as stored in NVS
+
+  // Everything below is under gLock: the loop (planner), net (noteRequest/
+  // noteResult) and HTTP (stats, reset) tasks all get here. The helpers in
+  // this namespace assume the caller holds it.
+  SemaphoreHandle_t gLock      = nullptr;
+  Preferences       gPrefs;
+  uint32_t          gTokHash   = 0;
+  Rec               gRec       = { 0, 0 };
+  uint32_t          gUnsaved   = 0;
+  uint32_t          gSavedAt   = 0;
+  uint32_t          gFails     = 0;
+  uint32_t          gLastPlan  = 0;
+  bool              gOpen      = false;
+
+  void lock()  { if (gLock) xSemaphoreTake(gLock, portMAX_DELAY); }
+  void unlock(){ if (gLock) xSemaphoreGive(gLock); }
+
+  uint32_t fnv1a(const char* s){
+    uint32_t h = 2166136261u;
+    while (s && *s){ h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+  }
+  void keyFor(uint32_t h, char* out){ snprintf(out, 10, "t%08x", (unsigned)h); }
+
+  void save(){
+    if (!gOpen) return;
+    char k[10]; keyFor(gTokHash, k);
+    gUnsaved = 0;
+    gPrefs.putBytes(k, &gRec, sizeof(gRec));
+    gSavedAt = millis();
+  }
+
+  // Switch the live record to token `h` (flushing the old one).
+  void selectToken(uint32_t h){
+    if (h == gTokHash && gOpen) return;
+    if (gOpen && gUnsaved) save();
+    Rec r = { 0, 0 };
+    char k[10]; keyFor(h, k);
+    if (gOpen && gPrefs.getBytesLength(k) == sizeof(r)) gPrefs.getBytes(k, &r, sizeof(r));
+    gTokHash = h; gRec = r; gUnsaved = 0;
+  }
+
+  uint32_t periodSecs(){ return (uint32_t)Cfg::quotaDays() * 86400UL; }
+
+  // Anchor the period once the clock is known; roll over when it ends.
+  void rollPeriod(){
+    const time_t now = time(nullptr);
+    if (now < EPOCH_VALID) return;
+    bool changed = false;
+    if (!gRec.periodStart){ gRec.periodStart = (uint32_t)now; changed = true; }
+    const uint32_t len = periodSecs();
+    if ((uint32_t)now - gRec.periodStart >= len){
+      gRec.periodStart += (((uint32_t)now - gRec.periodStart) / len) * len;
+      gRec.used = 0;
+      changed = true;
+    }
+    if (changed) save();
+  }
+
+  // Seconds left in the period (whole period if the clock isn't set yet).
+  uint32_t secondsLeft(){
+    const time_t now = time(nullptr);
+    if (now < EPOCH_VALID || !gRec.periodStart) return periodSecs();
+    const uint32_t end = gRec.periodStart + periodSecs();
+    return (uint32_t)now < end ? end - (uint32_t)now : 0;
+  }
+
+  // Minutes per day outside the screensaver window.
+  uint32_t activeMinutesPerDay(){
+    int a, b;
+    if (!Cfg::screensaverWindow(a, b)) return 1440;
+    return 1440 - (uint32_t)((b - a + 1440) % 1440);
+  }
+
+  uint32_t share(){ return Cfg::quotaLimit() / max<uint32_t>(1, Cfg::fleetSize()); }
+}
+
+void Quota::begin(){
+  if (!gLock) gLock = xSemaphoreCreateMutex();
+  lock();
+  gOpen = gPrefs.begin(NS, false);
+  selectToken(fnv1a(Cfg::darwinToken()));        // setup, before any fetch
+  rollPeriod();
+  gSavedAt = millis();
+  unlock();
+}
+
+uint32_t Quota::tokenKey(const char* token){ return fnv1a(token); }
+
+void Quota::noteRequest(uint32_t tokKey){
+  lock();
+  selectToken(tokKey);
+  rollPeriod();
+  gRec.used++;
+  if (++gUnsaved >= FLUSH_EVERY || millis() - gSavedAt >= FLUSH_MAX_MS) save();
+  unlock();
+}
+
+void Quota::noteResult(bool ok){
+  lock();
+  gFails = ok ? 0 : gFails + 1;
+  unlock();
+}
+
+void Quota::flush(){ lock(); if (gUnsaved) save(); unlock(); }
+
+void Quota::resetPeriod(){
+  const time_t now = time(nullptr);
+  lock();
+  gRec.periodStart = now >= EPOCH_VALID ? (uint32_t)now : 0;
+  gRec.used = 0;
+  save();
+  unlock();
+}
+
+uint32_t Quota::used(){ lock(); const uint32_t u = gRec.used; unlock(); return u; }
+
+bool Quota::metered(){ return Cfg::quotaLimit() != 0; }
+
+uint32_t Quota::nextPollMs(bool lastOk){
+  lock();
+  rollPeriod();
+  const uint32_t floorMs = (uint32_t)max<uint16_t>(5, Cfg::updateEvery()) * 1000UL;
+  uint32_t planned = floorMs;
+
+  if (Cfg::quotaLimit()){
+    const uint32_t s    = share();
+    const uint32_t left = s > gRec.used ? s - gRec.used : 0;
+    if (!left){
+      planned = min<uint32_t>(max<uint32_t>(secondsLeft(), 60), EMPTY_RECHECK) * 1000UL;
+    } else {
+      // Keep 10% back for manual refreshes and error retries.
+      const uint32_t budget = max<uint32_t>(1, left - left / 10);
+      const uint64_t activeMs = (uint64_t)secondsLeft() * 1000ULL * activeMinutesPerDay() / 1440;
+      const uint64_t spread   = activeMs / budget;
+      planned = (uint32_t)max<uint64_t>(floorMs, min<uint64_t>(spread, 0xFFFFFFFFULL));
+    }
+  }
+
+  uint32_t ms = planned;
+  if (!lastOk){
+    // Exponential backoff from 2 s, never faster than the budget allows,
+    // never slower than normal polling.
+    const uint32_t shift   = gFails ? min<uint32_t>(gFails - 1, 7) : 0;
+    const uint32_t backoff = min<uint32_t>(ERR_BASE_MS << shift, floorMs);
+    ms = (planned > floorMs) ? planned : backoff;
+  }
+  gLastPlan = ms;
+  unlock();
+  return ms;
+}
+
+String Quota::statsJSON(){
+  lock();
+  rollPeriod();
+  char tok[10]; snprintf(tok, sizeof(tok), "%08x", (unsigned)gTokHash);
+  const uint32_t s = share();
+  String j; j.reserve(320);
+  j += "{\"token\":\"";     j += tok; j += '"';
+  j += ",\"limit\":";       j += String(Cfg::quotaLimit());
+  j += ",\"fleet\":";       j += String((unsigned)Cfg::fleetSize());
+  j += ",\"share\":";       j += String(s);
+  j += ",\"used\":";        j += String(gRec.used);
+  j += ",\"remaining\":";   j += Cfg::quotaLimit() ? String(s > gRec.used ? s - gRec.used : 0) : String("null");
+  j += ",\"periodDays\":";  j += String((unsigned)Cfg::quotaDays());
+  j += ",\"periodStart\":"; j += String(gRec.periodStart);
+  j += ",\"secondsLeft\":"; j += String(secondsLeft());
+  j += ",\"activeMinPerDay\":"; j += String(activeMinutesPerDay());
+  j += ",\"fails\":";       j += String(gFails);
+  j += ",\"nextPollMs\":";  j += String(gLastPlan);
+  j += ",\"unsaved\":";     j += String(gUnsaved);
+  j += '}';
+  unlock();
+  return j;
+}
@@ -0,0 +1,258 @@
+#include "RowAnim.h"
+#include <esp_heap_caps.h>
+#include "TFT.h"
+#include "Display.h"
+#include "Pixel.h"
+#include "Trace.h"
+
+// [TRAKKR] Board transitions (see RowAnim.h)
+
+namespace {
+  // Draw order: folding rows underneath, sliding / unfolding rows on top
+  enum Kind : uint8_t { K_FOLD, K_STAY, K_SLIDE, K_UNFOLD };
+
+  struct Item {
+    uint8_t   kind;
+    bool      old;                    // bitmap comes from the old board
+    int16_t   idx, slot;              // board row, slot it's painted for
+    int16_t   y0, y1;                 // start / end top edge, relative to the row area
+    uint16_t* bmp;
+  };
+
+  const int      MAX_ITEMS   = 48;
+  const uint32_t FRAME_MS    = 33;                 // ~30 fps, same cadence as the ticker
+  const int      OWN_LINES   = 16;                 // strip height without a DMA backend
+
+  enum State : uint8_t { IDLE, PREP, PLAY };
+
+  RowAnim::Geometry gG;
+  RowAnim::Source   gS;
+  Item      gItem[MAX_ITEMS];
+  int       gN = 0, gNewVis = 0;
+  State     gState = IDLE;
+  int       gPrep = 0;                             // next bitmap to render
+  uint32_t  gT0 = 0, gDur = 1, gDue = 0, gFrameAt = 0;
+  int       gP = 0;                                // progress of the frame being pushed, 0..1024
+  int       gLine = -1;                            // next line of that frame (-1 = none)
+  int       gSpan0 = 0, gSpan1 = 0;                // lines that can change
+  uint16_t* gStrip = nullptr;                      // own strip (no backend)
+  uint16_t* gDark  = nullptr;                      // one black line, for flap shading
+
+  struct {
+    uint32_t runs, unchanged, fallbacks, aborted, frames, lastFrames, lastMs, maxStepUs;
+    bool     psram;
+  } gStat = {};
+
+  int find(const uint32_t* keys, int n, uint32_t k){
+    for (int i = 0; i < n; ++i) if (keys[i] == k) return i;
+    return -1;
+  }
+
+  void add(uint8_t kind, bool old, int idx, int slot, int y0, int y1){
+    if (gN >= MAX_ITEMS) return;
+    Item& it = gItem[gN++];
+    it.kind = kind; it.old = old; it.idx = (int16_t)idx; it.slot = (int16_t)slot;
+    it.y0 = (int16_t)y0; it.y1 = (int16_t)y1; it.bmp = nullptr;
+  }
+
+  void release(){
+    for (int i = 0; i < gN; ++i) if (gItem[i].bmp){ heap_caps_free(gItem[i].bmp); gItem[i].bmp = nullptr; }
+    if (gStrip){ heap_caps_free(gStrip); gStrip = nullptr; }
+    if (gDark) { heap_caps_free(gDark);  gDark  = nullptr; }
+    gN = 0; gState = IDLE; gLine = -1;
+  }
+
+  int ease(int p){                                 // smoothstep, 0..1024
+    const float u = p / 1024.0f;
+    return (int)(u * u * (3.0f - 2.0f * u) * 1024.0f + 0.5f);
+  }
+
+  // One output line (relative to the row area) of the frame at progress gP
+  void composeLine(uint16_t* out, int y){
+    const int rh = gG.rowH, w = gG.w;
+    const int s = y / rh;
+    Pixel::fill16(out, s < gNewVis ? gG.bg[s & 1] : gG.tailBg, w);
+
+    for (int i = 0; i < gN; ++i){
+      const Item& it = gItem[i];
+      if (!it.bmp) continue;
+      int top, h = rh;
+      int scale = 1024;                            // vertical scale, 1024 = flat
+      switch (it.kind){
+        case K_STAY:   top = it.y1; break;
+        case K_SLIDE:  top = it.y0 + (it.y1 - it.y0) * ease(gP) / 1024; break;
+        case K_FOLD:   scale = 1024 - min(1024, gP * 2);    top = it.y0; break;
+        default:       scale = max(0, gP * 2 - 1024);       top = it.y1; break;
+      }
+      if (scale < 1024){
+        h = rh * scale / 1024;
+        if (h <= 0) continue;
+        top += (rh - h) / 2;
+      }
+      if (y < top || y >= top + h) continue;
+      const int src = (y - top) * rh / h;
+      if (scale < 1024){
+        // The flap darkens as it turns edge-on
+        const uint8_t alpha = (uint8_t)(12 + 20 * scale / 1024);
+        Pixel::blend(out, it.bmp + (size_t)src * w, gDark, w, alpha, true);
+      } else {
+        Pixel::copy16(out, it.bmp + (size_t)src * w, w);
+      }
+    }
+  }
+
+  void finish(){
+    gStat.lastMs = millis() - gT0;
+    release();
+  }
+}
+
+RowAnim::Start RowAnim::begin(const Geometry& g, const Source& s, uint16_t durMs){
+  release();
+  gStat.runs++;
+  gG = g; gS = s;
+  const int rh = g.rowH, areaH = g.slots * rh;
+  auto clampY = [&](int y){ return y < -rh ? -rh : (y > areaH ? areaH : y); };
+
+  gNewVis = max(0, min(s.nNew - s.newFirst, g.slots));
+  const int oldVis = max(0, min(s.nOld - s.oldFirst, g.slots));
+
+  // ---- Diff: every visible new row, then the old rows that lost their slot
+  for (int j = s.newFirst; j < s.newFirst + gNewVis; ++j){
+    const int slot = j - s.newFirst, y1 = slot * rh;
+    const int i = find(s.oldKeys, s.nOld, s.newKeys[j]);
+    if (i < 0){ add(K_UNFOLD, false, j, slot, y1, y1); continue; }
+    const int oldSlot = i - s.oldFirst;
+    if (oldSlot == slot){
+      if (s.same(i, j, s.ctx)) add(K_STAY, false, j, slot, y1, y1);
+      else { add(K_FOLD, true, i, oldSlot, y1, y1); add(K_UNFOLD, false, j, slot, y1, y1); }
+    } else {
+      add(K_SLIDE, false, j, slot, clampY(oldSlot * rh), y1);   // from off-page: enters at the edge
+    }
+  }
+  for (int i = s.oldFirst; i < s.oldFirst + oldVis; ++i){
+    const int j = find(s.newKeys, s.nNew, s.oldKeys[i]);
+    if (j >= s.newFirst && j < s.newFirst + gNewVis) continue;   // placed above
+    const int slot = i - s.oldFirst, y0 = slot * rh;
+    if (j < 0) add(K_FOLD, true, i, slot, y0, y0);
+    else       add(K_SLIDE, true, i, slot, y0, clampY((j - s.newFirst) * rh));   // leaves the page
+  }
+
+  // ---- Span: only rows that move or turn change pixels
+  gSpan0 = areaH; gSpan1 = 0;
+  for (int k = 0; k < gN; ++k){
+    const Item& it = gItem[k];
+    if (it.kind == K_STAY) continue;
+    gSpan0 = min(gSpan0, (int)min(it.y0, it.y1));
+    gSpan1 = max(gSpan1, (int)max(it.y0, it.y1) + rh);
+  }
+  gSpan0 = max(0, gSpan0); gSpan1 = min(areaH, gSpan1);
+  if (gSpan0 >= gSpan1){ gStat.unchanged++; release(); return NOTHING; }
+  if (!durMs || gN >= MAX_ITEMS){ gStat.fallbacks++; release(); return REPAINT; }
+
+  // Draw order (stable): folds, stays, slides, unfolds
+  for (int a = 1; a < gN; ++a){
+    Item t = gItem[a]; int b = a - 1;
+    while (b >= 0 && gItem[b].kind > t.kind){ gItem[b + 1] = gItem[b]; --b; }
+    gItem[b + 1] = t;
+  }
+
+  // ---- Memory: a bitmap for every row that reaches into the span, plus a strip
+  const size_t rowPx = (size_t)g.w * rh;
+  bool ok = true;
+  for (int k = 0; k < gN && ok; ++k){
+    Item& it = gItem[k];
+    const int lo = min(it.y0, it.y1), hi = max(it.y0, it.y1) + rh;
+    if (hi <= gSpan0 || lo >= gSpan1) continue;
+    ok = (it.bmp = Pixel::alloc(rowPx)) != nullptr;
+  }
+  gStat.psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
+  gDark = ok ? (uint16_t*)heap_caps_calloc(g.w, sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) : nullptr;
+  ok = ok && gDark;
+  DisplayBackend* d = Display::active();
+  if (ok && !(d && d->capacity() >= (size_t)g.w * 4)){
+    gStrip = (uint16_t*)heap_caps_malloc((size_t)g.w * OWN_LINES * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ok = gStrip != nullptr;
+  }
+  if (!ok){ gStat.fallbacks++; release(); return REPAINT; }
+
+  gDur = durMs; gPrep = 0; gLine = -1; gStat.lastFrames = 0;
+  gState = PREP;
+  return PLAYING;
+}
+
+bool RowAnim::active(){ return gState != IDLE; }
+uint32_t RowAnim::dueMs(){ return gDue; }
+
+void RowAnim::abort(){
+  if (gState == IDLE) return;
+  gStat.aborted++;
+  release();
+}
+
+bool RowAnim::step(uint32_t budgetUs){
+  if (gState == IDLE) return false;
+  const uint32_t t0 = micros();
+  bool more = true;
+
+  if (gState == PREP){
+    Trace::Span sp("anim.prep");
+    do {
+      while (gPrep < gN && !gItem[gPrep].bmp) ++gPrep;
+      if (gPrep >= gN) break;
+      Item& it = gItem[gPrep++];
+      if (!gS.render(it.bmp, it.old, it.idx, it.slot, gS.ctx)){ gStat.fallbacks++; release(); return false; }
+    } while (micros() - t0 < budgetUs);
+    while (gPrep < gN && !gItem[gPrep].bmp) ++gPrep;
+    if (gPrep < gN) more = true;
+    else { gState = PLAY; gT0 = gDue = millis(); more = false; }   // first frame due now
+  } else {
+    Trace::Span sp("anim.frame");
+    if (gLine < 0){
+      gFrameAt = millis();
+      gP = (int)min<uint32_t>(1024, (gFrameAt - gT0) * 1024u / gDur);
+      gLine = gSpan0;
+    }
+    DisplayBackend* d = gStrip ? nullptr : Display::active();
+    do {
+      uint16_t* buf = d ? d->backBuffer() : gStrip;
+      const int cap = d ? (int)(d->capacity() / gG.w) : OWN_LINES;
+      const int n = min(cap, gSpan1 - gLine);
+      for (int k = 0; k < n; ++k) composeLine(buf + (size_t)k * gG.w, gLine + k);
+      if (!d || !d->present(gG.x, gG.y + gLine, gG.w, n)){
+        Display::yieldBus();
+        tft.pushImage(gG.x, gG.y + gLine, gG.w, n, buf);
+      }
+      gLine += n;
+    } while (gLine < gSpan1 && micros() - t0 < budgetUs);
+
+    if (gLine >= gSpan1){
+      gStat.frames++; gStat.lastFrames++;
+      if (gP >= 1024){ finish(); more = false; }
+      else {
+        gLine = -1;
+        gDue = gFrameAt + FRAME_MS;
+        if ((int32_t)(millis() - gDue) > 0) gDue = millis();    // fell behind: drop frames, not time
+        more = false;
+      }
+    }
+  }
+  gStat.maxStepUs = max(gStat.maxStepUs, (uint32_t)(micros() - t0));
+  return more;
+}
+
+String RowAnim::statsJSON(){
+  String j; j.reserve(200);
+  j += "{\"active\":";     j += gState != IDLE ? "true" : "false";
+  j += ",\"runs\":";       j += gStat.runs;
+  j += ",\"unchanged\":";  j += gStat.unchanged;
+  j += ",\"fallbacks\":";  j += gStat.fallbacks;
+  j += ",\"aborted\":";    j += gStat.aborted;
+  j += ",\"frames\":";     j += gStat.frames;
+  j += ",\"lastFrames\":"; j += gStat.lastFrames;
+  j += ",\"lastMs\":";     j += gStat.lastMs;
+  j += ",\"maxStepUs\":";  j += gStat.maxStepUs;
+  j += ",\"psram\":";      j += gStat.psram ? "true" : "false";
+  j += '}';
+  return j;
+}
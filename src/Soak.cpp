@@ -0,0 +1,243 @@
+#include "Soak.h"
+#include <vector>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+namespace {
+  constexpr uint32_t MAX_HOURS      = 24 * 7 * 8;        // eight virtual weeks
+  constexpr uint32_t MAX_WINDOWS    = 96;                // samples kept per run
+  constexpr uint32_t YIELD_EVERY    = 64;                // ticks between 1-tick sleeps (WDT, HTTP)
+
+  // Verdict thresholds (after the warm-up windows)
+  constexpr int32_t  LEAK_B_PER_DAY = 512;               // free heap trend
+  constexpr int32_t  LEAK_MIN_DROP  = 2048;              // ...and it really went down this much
+  constexpr uint32_t LARGEST_FLOOR  = 12 * 1024;         // same as rail.cpp checkHeap()
+  constexpr float    FRAG_RISE      = 0.15f;             // 1 - largest/free, end vs warm-up
+  constexpr float    LAT_RATIO      = 1.5f;              // step mean, end vs warm-up...
+  constexpr uint32_t LAT_MIN_US     = 500;               // ...and by at least this much
+
+  struct Sample { uint32_t vS, freeB, largest, minFree; };
+
+  struct StepRun {
+    const Soak::Step*     s;
+    bool                  on;
+    uint32_t              runs, maxUs;
+    uint64_t              sumUs, winUs;
+    uint32_t              winRuns;
+    std::vector<uint32_t> winMean;                       // per window; 0 = no runs
+  };
+
+  std::vector<Soak::Step> gSteps;
+  SemaphoreHandle_t       gLock    = nullptr;            // samples + results (soak task vs HTTP)
+  TaskHandle_t            gTask    = nullptr;
+  volatile bool           gStop    = false;
+
+  // Current / last run
+  enum : uint8_t { ST_IDLE, ST_RUNNING, ST_DONE };
+  volatile uint8_t        gState   = ST_IDLE;
+  uint32_t                gHours   = 0, gSeed = 0, gWindowS = 3600;
+  volatile uint32_t       gVnow    = 0;
+  uint32_t                gWall0   = 0, gWallMs = 0;
+  uint32_t                gRng     = 1;
+  String                  gPrefix;
+  std::vector<Sample>     gSamples;
+  std::vector<StepRun>    gRuns;
+
+  void lock()  { xSemaphoreTake(gLock, portMAX_DELAY); }
+  void unlock(){ xSemaphoreGive(gLock); }
+
+  Sample sampleNow(uint32_t v){
+    return { v, (uint32_t)ESP.getFreeHeap(), (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (uint32_t)ESP.getMinFreeHeap() };
+  }
+  float frag(const Sample& s){ return s.freeB ? 1.0f - (float)s.largest / s.freeB : 0; }
+
+  // Least-squares slope of y over x, per virtual day.
+  template <typename F> float slopePerDay(size_t from, F y){
+    const size_t n = gSamples.size() - from;
+    if (n < 2) return 0;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = from; i < gSamples.size(); ++i){
+      const double x = gSamples[i].vS / 86400.0, v = y(gSamples[i]);
+      sx += x; sy += v; sxx += x * x; sxy += x * v;
+    }
+    const double d = n * sxx - sx * sx;
+    return d > 0 ? (float)((n * sxy - sx * sy) / d) : 0;
+  }
+
+  void closeWindow(uint32_t v){
+    lock();
+    gSamples.push_back(sampleNow(v));
+    for (auto& r : gRuns){
+      r.winMean.push_back(r.winRuns ? (uint32_t)(r.winUs / r.winRuns) : 0);
+      r.winUs = 0; r.winRuns = 0;
+    }
+    unlock();
+  }
+
+  void soakTask(void*){
+    for (auto& r : gRuns) r.on = !r.s->before || r.s->before(r.s->ctx);
+    closeWindow(0);                                      // baseline
+
+    const uint32_t total = gHours * 3600;
+    uint32_t v = 0;
+    for (; v < total && !gStop; ++v){
+      gVnow = v;
+      for (auto& r : gRuns){
+        if (!r.on || v % r.s->everyS) continue;
+        const int64_t t0 = esp_timer_get_time();
+        r.s->run(r.s->ctx);
+        const uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        r.runs++; r.sumUs += us; r.winUs += us; r.winRuns++;
+        if (us > r.maxUs) r.maxUs = us;
+      }
+      if ((v + 1) % gWindowS == 0) closeWindow(v + 1);
+      if (v % YIELD_EVERY == 0) vTaskDelay(1);
+    }
+    if (v % gWindowS) closeWindow(v);
+    gVnow = v;
+
+    for (auto& r : gRuns) if (r.on && r.s->after) r.s->after(r.s->ctx);
+    gWallMs = millis() - gWall0;
+    Serial.printf("[SOAK] done: %u virtual s in %ums\n", (unsigned)v, (unsigned)gWallMs);
+    gState = ST_DONE;
+    gTask = nullptr;
+    vTaskDelete(nullptr);
+  }
+
+  String verdictJSON(){
+    // Warm-up: first window, or the first 10% of a long run (first-use allocations, caches).
+    const size_t n = gSamples.size();
+    const size_t warm = n > 20 ? n / 10 : (n > 2 ? 1 : 0);
+    const size_t tail = n > 20 ? n - n / 10 : (n ? n - 1 : 0);
+    std::vector<String> fails;
+
+    const Sample& w = gSamples[warm];
+    const Sample& e = gSamples.back();
+    const float freeSlope    = slopePerDay(warm, [](const Sample& s){ return (double)s.freeB; });
+    const float largestSlope = slopePerDay(warm, [](const Sample& s){ return (double)s.largest; });
+    uint32_t lowLargest = UINT32_MAX;
+    for (size_t i = warm; i < n; ++i) if (gSamples[i].largest < lowLargest) lowLargest = gSamples[i].largest;
+
+    if (freeSlope < -LEAK_B_PER_DAY && (int32_t)w.freeB - (int32_t)e.freeB > LEAK_MIN_DROP)
+      fails.push_back(String("leak: free heap ") + String(freeSlope, 0) + " B/day");
+    if (lowLargest < LARGEST_FLOOR)
+      fails.push_back(String("fragmentation: largest block ") + String(lowLargest) + " B");
+    if (frag(e) - frag(w) > FRAG_RISE)
+      fails.push_back(String("fragmentation: ") + String(frag(w), 2) + " -> " + String(frag(e), 2));
+
+    String steps; steps.reserve(gRuns.size() * 140);
+    for (const auto& r : gRuns){
+      uint64_t a = 0, b = 0; uint32_t na = 0, nb = 0;
+      for (size_t i = warm; i < r.winMean.size() && i < tail; ++i) if (r.winMean[i]){ a += r.winMean[i]; na++; }
+      for (size_t i = tail; i < r.winMean.size(); ++i)            if (r.winMean[i]){ b += r.winMean[i]; nb++; }
+      const uint32_t early = na ? (uint32_t)(a / na) : 0, late = nb ? (uint32_t)(b / nb) : 0;
+      if (early && late > early * LAT_RATIO && late - early > LAT_MIN_US)
+        fails.push_back(String("latency: ") + r.s->name + ' ' + String(early) + " -> " + String(late) + " us");
+      if (steps.length()) steps += ',';
+      steps += "{\"name\":\""; steps += r.s->name; steps += '"';
+      if (!r.on){ steps += ",\"skipped\":true}"; continue; }
+      steps += ",\"everyS\":";  steps += String(r.s->everyS);
+      steps += ",\"runs\":";    steps += String(r.runs);
+      steps += ",\"meanUs\":";  steps += String(r.runs ? (uint32_t)(r.sumUs / r.runs) : 0);
+      steps += ",\"maxUs\":";   steps += String(r.maxUs);
+      steps += ",\"earlyUs\":"; steps += String(early);
+      steps += ",\"lateUs\":";  steps += String(late);
+      steps += '}';
+    }
+
+    String j; j.reserve(512 + steps.length());
+    j += "\"pass\":"; j += fails.empty() ? "true" : "false";
+    j += ",\"failures\":[";
+    for (size_t i = 0; i < fails.size(); ++i){ if (i) j += ','; j += '"'; j += fails[i]; j += '"'; }
+    j += "],\"heap\":{";
+    j += "\"warmFree\":";       j += String(w.freeB);
+    j += ",\"endFree\":";       j += String(e.freeB);
+    j += ",\"minFree\":";       j += String(e.minFree);
+    j += ",\"warmLargest\":";   j += String(w.largest);
+    j += ",\"endLargest\":";    j += String(e.largest);
+    j += ",\"lowLargest\":";    j += String(lowLargest);
+    j += ",\"freeSlopePerDay\":";    j += String(freeSlope, 1);
+    j += ",\"largestSlopePerDay\":"; j += String(largestSlope, 1);
+    j += ",\"fragWarm\":";      j += String(frag(w), 3);
+    j += ",\"fragEnd\":";       j += String(frag(e), 3);
+    j += "},\"steps\":["; j += steps; j += ']';
+    return j;
+  }
+}
+
+void Soak::add(const Step& s){
+  Step c = s; if (!c.everyS) c.everyS = 1;
+  for (auto& e : gSteps) if (strcmp(e.name, c.name) == 0){ e = c; return; }
+  gSteps.push_back(c);
+}
+
+// xorshift32
+uint32_t Soak::rand(){ uint32_t x = gRng; x ^= x << 13; x ^= x >> 17; x ^= x << 5; return gRng = x; }
+uint32_t Soak::now(){ return gVnow; }
+
+bool Soak::start(uint32_t hours, uint32_t seed, const char* prefix){
+  if (!gLock) gLock = xSemaphoreCreateMutex();
+  if (gState == ST_RUNNING) return false;
+  if (!hours) hours = 1;
+  if (hours > MAX_HOURS) hours = MAX_HOURS;
+  gPrefix = prefix ? prefix : "";
+
+  lock();
+  gSamples.clear(); gRuns.clear();
+  for (const auto& s : gSteps){
+    if (gPrefix.length() && strncmp(s.name, gPrefix.c_str(), gPrefix.length()) != 0) continue;
+    StepRun r{}; r.s = &s; r.on = false;
+    gRuns.push_back(r);
+  }
+  gWindowS = max<uint32_t>(3600, (hours * 3600 + MAX_WINDOWS - 1) / MAX_WINDOWS);
+  gSamples.reserve(hours * 3600 / gWindowS + 2);
+  for (auto& r : gRuns) r.winMean.reserve(gSamples.capacity());
+  unlock();
+
+  gHours = hours; gSeed = seed ? seed : 1; gRng = gSeed;
+  gVnow = 0; gStop = false; gWall0 = millis(); gWallMs = 0;
+  gState = ST_RUNNING;
+  Serial.printf("[SOAK] start: %u h virtual, seed %u, %u steps\n", (unsigned)hours, (unsigned)gSeed, (unsigned)gRuns.size());
+  if (xTaskCreatePinnedToCore(soakTask, "soak", 8192, nullptr, 1, &gTask, 1) != pdPASS){
+    gState = ST_IDLE;
+    return false;
+  }
+  return true;
+}
+
+void Soak::stop(){ gStop = true; }
+
+String Soak::reportJSON(){
+  if (!gLock) gLock = xSemaphoreCreateMutex();
+  static const char* const kStates[] = { "idle", "running", "done" };
+  const uint8_t st = gState;
+  String j; j.reserve(1024);
+  j += "{\"state\":\""; j += kStates[st]; j += '"';
+  if (st == ST_IDLE){
+    j += ",\"steps\":[";
+    for (size_t i = 0; i < gSteps.size(); ++i){ if (i) j += ','; j += '"'; j += gSteps[i].name; j += '"'; }
+    j += "]}";
+    return j;
+  }
+  j += ",\"hours\":";    j += String(gHours);
+  j += ",\"seed\":";     j += String(gSeed);
+  j += ",\"step\":\"";   j += gPrefix; j += '"';
+  j += ",\"windowS\":";  j += String(gWindowS);
+  j += ",\"virtualS\":"; j += String((uint32_t)gVnow);
+  j += ",\"wallMs\":";   j += String(st == ST_DONE ? gWallMs : millis() - gWall0);
+  lock();
+  if (st == ST_DONE && !gSamples.empty()){ j += ','; j += verdictJSON(); }
+  // [vS, free, largest] per window, for plotting the trend
+  j += ",\"windows\":[";
+  for (size_t i = 0; i < gSamples.size(); ++i){
+    if (i) j += ',';
+    j += '['; j += String(gSamples[i].vS); j += ','; j += String(gSamples[i].freeB); j += ','; j += String(gSamples[i].largest); j += ']';
+  }
+  unlock();
+  j += "]}";
+  return j;
+}
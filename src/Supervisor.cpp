@@ -0,0 +1,306 @@
+#include "Supervisor.h"
+#include <atomic>
+#include <WiFi.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_heap_caps.h>
+#include <lwip/sockets.h>
+#include "Global.h"
+#include "Tls.h"
+#include "HttpServer.h"
+
+// [TRAKKR] Subsystem supervisor (see Supervisor.h)
+
+namespace {
+  using namespace Supervisor;
+
+  constexpr uint32_t TICK_MS     = 1000;
+  constexpr uint8_t  MAX_TRIES   = 3;
+  constexpr uint8_t  MAX_BACKOFF = 4;              // self-healing parts: grace x16 at most
+  constexpr size_t   HEAP_FLOOR  = 12 * 1024;      // same as rail.cpp checkHeap()
+  constexpr uint32_t PROBE_MS    = 30000;
+  constexpr uint32_t PROBE_IO_MS = 3000;
+  constexpr uint8_t  PROBE_FAILS = 3;
+  constexpr uint32_t TLS_STREAK  = 4;
+  constexpr uint32_t RTC_MAGIC   = 0x54524b53;     // 'TRKS'
+
+  struct Spec {
+    const char* name;
+    uint32_t    staleMs;                           // beat parts: silent this long = failing
+    uint32_t    confirmMs;                         // condition parts: failing once it lasts this long
+    uint32_t    graceMs;                           // after a restart, before trying again
+    bool        reboots;                           // escalate to a reboot (else back off and retry)
+    bool        onAsk;                             // restart() allowed: the hook is safe on a healthy part
+  };
+  const Spec kSpec[P_COUNT] = {
+    { "net",     30000,     0,  20000, true,  false },
+    { "wifi",        0, 30000,  30000, false, true  },
+    { "tls",         0,     0, 300000, false, true  },
+    { "loop",    60000,     0,      0, true,  false },
+    { "http",        0,     0,  30000, true,  true  },
+    { "display", 10000,     0,  10000, true,  false },
+    { "heap",        0, 10000,  30000, true,  false },
+  };
+
+  struct State {
+    bool     raw, bad;
+    uint8_t  tries;
+    uint32_t rawSince, badSince, restartAt;
+    uint32_t failures, restarts, recovered, lastMs, maxMs, totalMs;
+    char     why[48];
+  };
+
+  // Survives ESP.restart() and panics (not power loss); checked before use.
+  struct RtcBoot { uint32_t magic, reboots, check; char why[48]; };
+  RTC_NOINIT_ATTR RtcBoot gRtc;
+
+  State                 gSt[P_COUNT] = {};
+  RestartFn             gFn[P_COUNT] = {};
+  volatile uint32_t     gBeat[P_COUNT] = {};
+  volatile bool         gHeld[P_COUNT] = {};
+  std::atomic<uint32_t> gAsk{0};                   // restart() requests, one bit per part
+  const char* volatile  gAskWhy[P_COUNT] = {};
+  TaskHandle_t          gTask      = nullptr;
+  const char* volatile  gHeapWhere = "";
+  volatile uint32_t     gHeapLows  = 0;
+  uint32_t              gProbeAt   = 0;
+  uint8_t               gProbeBad  = 0;
+  uint32_t              gProbes    = 0;
+  char                  gBootWhy[48] = "";
+  uint32_t              gReboots   = 0;
+
+  // Wi-Fi credentials, copied from Cfg by Supervisor::configure() on the task
+  // that writes Cfg; wifiRestart() connects with this copy (gWifiMux).
+  struct WifiConf { char ssid[33]; char pass[65]; };
+  WifiConf              gWifi      = {};
+  portMUX_TYPE          gWifiMux   = portMUX_INITIALIZER_UNLOCKED;
+
+  const char* resetName(esp_reset_reason_t r){
+    switch (r){
+      case ESP_RST_POWERON:  return "power on";
+      case ESP_RST_EXT:      return "reset pin";
+      case ESP_RST_SW:       return "restart";
+      case ESP_RST_PANIC:    return "panic";
+      case ESP_RST_INT_WDT: case ESP_RST_TASK_WDT: case ESP_RST_WDT: return "watchdog";
+      case ESP_RST_BROWNOUT: return "brownout";
+      case ESP_RST_DEEPSLEEP:return "deep sleep";
+      default:               return "unknown";
+    }
+  }
+
+  // One GET /api/health over loopback; true = a status line came back.
+  bool probeHttp(){
+    const int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) return false;
+    struct timeval tv = { (long)(PROBE_IO_MS / 1000), 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in sa; memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET; sa.sin_port = htons(80); sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    static const char req[] = "GET /api/health HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n";
+    char buf[12] = {0};
+    const bool ok = connect(fd, (struct sockaddr*)&sa, sizeof(sa)) == 0 &&
+                    send(fd, req, sizeof(req) - 1, 0) == (int)(sizeof(req) - 1) &&
+                    recv(fd, buf, sizeof(buf) - 1, 0) >= 9 && !memcmp(buf, "HTTP/1.", 7);
+    ::close(fd);
+    gProbes++;
+    return ok;
+  }
+
+  // After setup this is the only WiFi.begin(): fetches wait for the link
+  // rather than reconnecting themselves.
+  bool wifiRestart(){
+    WifiConf c;
+    portENTER_CRITICAL(&gWifiMux);
+    c = gWifi;
+    portEXIT_CRITICAL(&gWifiMux);
+    WiFi.disconnect();
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(c.ssid, c.pass);
+    return true;
+  }
+  bool tlsRestart(){ Tls::reset(); return true; }
+
+  void reboot(Part p, const char* why){
+    char r[sizeof(gRtc.why)];
+    snprintf(r, sizeof(r), "%s: %s", kSpec[p].name, why);
+    rebootNow(r);                                  // records r, flushes, never returns
+  }
+
+  bool runHook(Part p, const char* why){
+    State& s = gSt[p];
+    s.restarts++; s.restartAt = millis();
+    Serial.printf("[SUPER] restarting %s (%s)\n", kSpec[p].name, why);
+    return gFn[p] && gFn[p]();
+  }
+
+  void judge(Part p, bool raw, const char* why, uint32_t now){
+    State& s = gSt[p];
+    const Spec& k = kSpec[p];
+    if (raw && !s.raw) s.rawSince = now;
+    s.raw = raw;
+    if (!raw || now - s.rawSince < k.confirmMs){
+      if (!s.bad) return;
+      const uint32_t ms = now - s.badSince;         // healthy again: the episode is over
+      s.bad = false; s.tries = 0;
+      s.recovered++; s.lastMs = ms; s.totalMs += ms;
+      if (ms > s.maxMs) s.maxMs = ms;
+      Serial.printf("[SUPER] %s recovered after %lu ms\n", k.name, (unsigned long)ms);
+      return;
+    }
+    if (!s.bad){
+      s.bad = true; s.badSince = now; s.tries = 0; s.failures++;
+      strncpy(s.why, why, sizeof(s.why) - 1); s.why[sizeof(s.why) - 1] = '\0';
+      Serial.printf("[SUPER] %s failing: %s\n", k.name, s.why);
+    }
+    if (s.tries){
+      uint32_t grace = k.graceMs;
+      if (!k.reboots) grace <<= (s.tries - 1 < MAX_BACKOFF ? s.tries - 1 : MAX_BACKOFF);
+      if (now - s.restartAt < grace) return;        // give the last restart time to take
+    }
+    if (k.reboots && (s.tries >= MAX_TRIES || !gFn[p])) reboot(p, s.why);
+    s.tries++;
+    if (!runHook(p, s.why) && k.reboots) reboot(p, s.why);
+  }
+
+  uint32_t beatAge(Part p, uint32_t now){ return now - gBeat[p]; }
+
+  void tick(){
+    const uint32_t now = millis();
+
+    uint32_t ask = gAsk.exchange(0);
+    while (ask){
+      const Part p = (Part)__builtin_ctz(ask);
+      ask &= ask - 1;
+      runHook(p, gAskWhy[p] ? gAskWhy[p] : "requested");
+    }
+
+    judge(P_NET, beatAge(P_NET, now) > kSpec[P_NET].staleMs, "net loop stalled", now);
+    judge(P_LOOP, beatAge(P_LOOP, now) > kSpec[P_LOOP].staleMs, "loop stalled", now);
+    judge(P_DISPLAY, !gHeld[P_DISPLAY] && beatAge(P_DISPLAY, now) > kSpec[P_DISPLAY].staleMs,
+          "no ticker frames", now);
+
+    const bool wifiUp = WiFi.status() == WL_CONNECTED;
+    judge(P_WIFI, !wifiUp, "not connected", now);
+    if (wifiUp) judge(P_TLS, Tls::failStreak() >= TLS_STREAK, "handshakes failing", now);
+
+    // HTTP only counts against itself while the loop kept cycling through the probe
+    if (now - gProbeAt >= PROBE_MS && beatAge(P_LOOP, now) < TICK_MS){
+      gProbeAt = now;
+      const uint32_t t0 = millis();
+      if (probeHttp()) gProbeBad = 0;
+      else if ((int32_t)(gBeat[P_LOOP] - t0) > 0 && gProbeBad < 255) gProbeBad++;
+    }
+    judge(P_HTTP, gProbeBad >= PROBE_FAILS, "loopback probe failed", millis());
+
+    char why[48];
+    snprintf(why, sizeof(why), "largest block low (%s)", gHeapWhere[0] ? gHeapWhere : "tick");
+    judge(P_HEAP, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) < HEAP_FLOOR, why, millis());
+  }
+
+  void superTask(void*){
+    for(;;){
+      vTaskDelay(pdMS_TO_TICKS(TICK_MS));
+      tick();
+    }
+  }
+}
+
+void Supervisor::begin(){
+  if (gTask) return;
+  const esp_reset_reason_t rr = esp_reset_reason();
+  const bool kept = gRtc.magic == RTC_MAGIC && gRtc.check == ~gRtc.reboots;
+  if (!kept){ memset(&gRtc, 0, sizeof(gRtc)); gRtc.magic = RTC_MAGIC; gRtc.check = ~0u; }
+  gReboots = gRtc.reboots;
+  if (rr == ESP_RST_SW && gRtc.why[0]) strncpy(gBootWhy, gRtc.why, sizeof(gBootWhy) - 1);
+  else                                  strncpy(gBootWhy, resetName(rr), sizeof(gBootWhy) - 1);
+  gRtc.why[0] = '\0';                                // an unplanned restart shows its reset reason
+
+  configure();
+  if (!gFn[P_WIFI]) gFn[P_WIFI] = wifiRestart;
+  if (!gFn[P_TLS])  gFn[P_TLS]  = tlsRestart;
+  const uint32_t now = millis();
+  for (int p = 0; p < P_COUNT; ++p) gBeat[p] = now;
+  gProbeAt = now;
+  if (xTaskCreate(superTask, "super", 6144, nullptr, 1, &gTask) != pdPASS){
+    gTask = nullptr;
+    Serial.println("[SUPER] task not started; failures mean reboots");
+    return;
+  }
+  Serial.printf("[SUPER] watching %d parts; last boot: %s\n", (int)P_COUNT, gBootWhy);
+}
+
+void Supervisor::configure(){
+  WifiConf c = {};
+  strncpy(c.ssid, Cfg::wifiSsid(), sizeof(c.ssid) - 1);
+  strncpy(c.pass, Cfg::wifiPass(), sizeof(c.pass) - 1);
+  portENTER_CRITICAL(&gWifiMux);
+  gWifi = c;
+  portEXIT_CRITICAL(&gWifiMux);
+}
+
+void Supervisor::beat(Part p){ if (p < P_COUNT) gBeat[p] = millis(); }
+
+void Supervisor::hold(Part p, bool on){
+  if (p >= P_COUNT) return;
+  gBeat[p] = millis();
+  gHeld[p] = on;
+}
+
+void Supervisor::setRestart(Part p, RestartFn fn){ if (p < P_COUNT) gFn[p] = fn; }
+
+void Supervisor::heapLow(const char* where){ gHeapWhere = where ? where : ""; gHeapLows = gHeapLows + 1; }
+
+bool Supervisor::restart(Part p, const char* why){
+  if (p >= P_COUNT || !gTask || !gFn[p] || !kSpec[p].onAsk) return false;
+  gAskWhy[p] = why;
+  gAsk.fetch_or(1u << p);
+  return true;
+}
+
+int Supervisor::partByName(const char* name){
+  for (int p = 0; p < P_COUNT; ++p) if (name && strcmp(name, kSpec[p].name) == 0) return p;
+  return -1;
+}
+
+void Supervisor::noteReboot(const char* why){
+  if (gRtc.magic != RTC_MAGIC || gRtc.check != ~gRtc.reboots){ memset(&gRtc, 0, sizeof(gRtc)); gRtc.magic = RTC_MAGIC; }
+  gRtc.reboots++; gRtc.check = ~gRtc.reboots;
+  strncpy(gRtc.why, why ? why : "", sizeof(gRtc.why) - 1); gRtc.why[sizeof(gRtc.why) - 1] = '\0';
+}
+
+String Supervisor::healthJSON(){
+  String j; j.reserve(1280);
+  const uint32_t now = millis();
+  j += "{\"running\":";    j += gTask ? "true" : "false";
+  j += ",\"uptimeMs\":";   j += String(now);
+  j += ",\"boot\":{\"why\":\""; j += gBootWhy;
+  j += "\",\"reboots\":";  j += String(gReboots);
+  j += "},\"heap\":{\"largest\":"; j += String((unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  j += ",\"floor\":";      j += String((unsigned)HEAP_FLOOR);
+  j += ",\"lows\":";       j += String(gHeapLows);
+  j += ",\"lastLow\":\"";  j += gHeapWhere;
+  j += "\"},\"probes\":";  j += String(gProbes);
+  j += ",\"parts\":[";
+  for (int p = 0; p < P_COUNT; ++p){
+    const State& s = gSt[p];
+    const Spec& k = kSpec[p];
+    if (p) j += ',';
+    j += "{\"name\":\"";     j += k.name;
+    j += "\",\"ok\":";       j += s.bad ? "false" : "true";
+    if (k.staleMs){ j += ",\"beatAgeMs\":"; j += String(now - gBeat[p]); }
+    if (gHeld[p])   j += ",\"held\":true";
+    j += ",\"hook\":";       j += gFn[p] ? "true" : "false";
+    j += ",\"failures\":";   j += String(s.failures);
+    j += ",\"restarts\":";   j += String(s.restarts);
+    j += ",\"recovered\":";  j += String(s.recovered);
+    j += ",\"downMs\":";     j += String(s.bad ? now - s.badSince : 0);
+    j += ",\"lastMs\":";     j += String(s.lastMs);
+    j += ",\"maxMs\":";      j += String(s.maxMs);
+    j += ",\"totalMs\":";    j += String(s.totalMs);
+    j += ",\"why\":\"";      j += s.why;
+    j += "\"}";
+  }
+  j += "]}";
+  return j;
+}
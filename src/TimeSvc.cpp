@@ -0,0 +1,157 @@
+#include "TimeSvc.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_sntp.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ctype.h>
+
+namespace {
+  constexpr const char* NTP_1       = "pool.ntp.org";
+  constexpr const char* NTP_2       = "time.nist.gov";
+  constexpr const char* TZ_UK       = "GMT0BST,M3.5.0/1,M10.5.0/2";   // UK timezone with BST rules
+  constexpr uint32_t    RTC_MAGIC   = 0x54524b54;                     // 'TRKT'
+  constexpr uint32_t    PERSIST_MS  = 10000;
+  constexpr int64_t     STEP_MS     = 4000;                           // larger errors are stepped, not slewed
+  constexpr time_t      EPOCH_VALID = 1704067200;                     // 2024-01-01: anything earlier = garbage
+
+  // Survives ESP.restart() and panics (not power loss); checked before use.
+  struct RtcTime { uint32_t magic, epoch, check; };
+  RTC_NOINIT_ATTR RtcTime gRtc;
+
+  portMUX_TYPE      gMux       = portMUX_INITIALIZER_UNLOCKED;
+  volatile uint8_t  gSrc       = TimeSvc::SRC_NONE;
+  uint32_t          gErrMs     = 0;                 // estimated error when last set
+  int32_t           gLastOffMs = 0;                 // correction applied by the last source
+  uint32_t          gSetAt     = 0;                 // millis()
+  uint32_t          gSteps     = 0, gSlews = 0, gIgnored = 0;
+  uint32_t          gPersistAt = 0;
+  bool              gSntp      = false;
+  uint32_t          gHttpRttMs = 0;
+
+  const char* const kSourceNames[] = { "none", "rtc", "http", "sntp" };
+
+  int64_t nowUs(){ struct timeval tv; gettimeofday(&tv, nullptr); return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec; }
+
+  // Civil date (UTC) → days since 1970-01-01 (Howard Hinnant's days_from_civil).
+  int32_t daysFromCivil(int y, unsigned m, unsigned d){
+    y -= m <= 2;
+    const int32_t  era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+  }
+
+  // Set or correct the clock from `src`, `us` being its idea of now.
+  void apply(TimeSvc::Source src, int64_t us, uint32_t errMs){
+    portENTER_CRITICAL(&gMux);
+    const uint8_t cur = gSrc;
+    const bool take = cur == TimeSvc::SRC_NONE || src == TimeSvc::SRC_SNTP || src > cur;
+    if (!take) gIgnored++;
+    portEXIT_CRITICAL(&gMux);
+    if (!take) return;
+
+    const int64_t off = (us - nowUs()) / 1000;
+    const bool step = cur == TimeSvc::SRC_NONE || off > STEP_MS || off < -STEP_MS;
+    if (step){
+      struct timeval tv = { (time_t)(us / 1000000), (suseconds_t)(us % 1000000) };
+      settimeofday(&tv, nullptr);
+    } else if (off){
+      struct timeval d = { (time_t)(off / 1000), (suseconds_t)((off % 1000) * 1000) };
+      adjtime(&d, nullptr);
+    }
+
+    portENTER_CRITICAL(&gMux);
+    gSrc = src; gErrMs = errMs; gLastOffMs = (int32_t)off; gSetAt = millis();
+    if (step) gSteps++; else gSlews++;
+    portEXIT_CRITICAL(&gMux);
+    Serial.printf("[TIME] %s: %s %+ldms (±%ums)\n", kSourceNames[src], step ? "step" : "slew", (long)off, (unsigned)errMs);
+    TimeSvc::persist();
+  }
+
+  bool restartKeepsRtc(){
+    switch (esp_reset_reason()){
+      case ESP_RST_SW: case ESP_RST_PANIC: case ESP_RST_INT_WDT: case ESP_RST_TASK_WDT: case ESP_RST_WDT: return true;
+      default: return false;
+    }
+  }
+}
+
+// lwIP calls this with each SNTP result (weak in IDF); replaces its step-or-smooth handling.
+extern "C" void sntp_sync_time(struct timeval* tv){
+  apply(TimeSvc::SRC_SNTP, (int64_t)tv->tv_sec * 1000000 + tv->tv_usec, 50);
+  sntp_set_sync_status(SNTP_SYNC_STATUS_COMPLETED);
+}
+
+void TimeSvc::begin(){
+  setenv("TZ", TZ_UK, 1); tzset();
+  const bool ok = restartKeepsRtc() && gRtc.magic == RTC_MAGIC && gRtc.check == ~gRtc.epoch &&
+                  (time_t)gRtc.epoch >= EPOCH_VALID;
+  if (!ok){ gRtc.magic = 0; return; }
+  // IDF keeps the system clock across a software reset on most chips; if it did, just adopt it.
+  const time_t kept = time(nullptr);
+  if (kept >= (time_t)gRtc.epoch){
+    portENTER_CRITICAL(&gMux); gSrc = SRC_RTC; gErrMs = 1000; gSetAt = millis(); portEXIT_CRITICAL(&gMux);
+    Serial.println("[TIME] rtc: clock kept across reset");
+    return;
+  }
+  // Otherwise resume from the last save: off by up to PERSIST_MS plus the reboot itself.
+  apply(SRC_RTC, ((int64_t)gRtc.epoch + 1) * 1000000, PERSIST_MS + 2000);
+}
+
+void TimeSvc::startSntp(){
+  if (gSntp) return;
+  gSntp = true;
+  configTzTime(TZ_UK, NTP_1, NTP_2);   // also re-applies TZ
+}
+
+void TimeSvc::loop(){
+  if (gSrc != SRC_NONE && millis() - gPersistAt >= PERSIST_MS) persist();
+}
+
+void TimeSvc::persist(){
+  if (gSrc == SRC_NONE) return;
+  const time_t t = time(nullptr);
+  if (t < EPOCH_VALID) return;
+  gRtc.epoch = (uint32_t)t; gRtc.check = ~gRtc.epoch; gRtc.magic = RTC_MAGIC;
+  gPersistAt = millis();
+}
+
+// "Sun, 06 Nov 1994 08:49:37 GMT"; one-second resolution, stamped before the response left the server.
+void TimeSvc::offerHttpDate(const char* value, uint32_t rttMs){
+  if (gSrc >= SRC_HTTP || !value) return;
+  char mon[4] = {0}; int d = 0, y = 0, hh = 0, mm = 0, ss = 0;
+  if (sscanf(value, " %*3s, %d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss) != 6) return;
+  static const char* const kMon = "janfebmaraprmayjunjulaugsepoctnovdec";
+  for (char* p = mon; *p; ++p) *p = tolower(*p);
+  const char* at = strstr(kMon, mon);
+  if (strlen(mon) != 3 || !at || (at - kMon) % 3 || y < 2024 || d < 1 || d > 31 || hh > 23 || mm > 59 || ss > 60) return;
+  const int64_t secs = (int64_t)daysFromCivil(y, (unsigned)((at - kMon) / 3 + 1), (unsigned)d) * 86400 + hh * 3600 + mm * 60 + ss;
+  gHttpRttMs = rttMs;
+  apply(SRC_HTTP, secs * 1000000 + 500000 + (int64_t)rttMs * 500, 500 + rttMs / 2);
+}
+
+bool                TimeSvc::valid(){ return gSrc != SRC_NONE; }
+TimeSvc::Source     TimeSvc::source(){ return (Source)gSrc; }
+const char*         TimeSvc::sourceName(Source s){ return s <= SRC_SNTP ? kSourceNames[s] : "?"; }
+
+String TimeSvc::statsJSON(){
+  portENTER_CRITICAL(&gMux);
+  const uint8_t src = gSrc; const uint32_t err = gErrMs, setAt = gSetAt, steps = gSteps, slews = gSlews, ign = gIgnored;
+  const int32_t off = gLastOffMs;
+  portEXIT_CRITICAL(&gMux);
+  String j; j.reserve(256);
+  j += "{\"source\":\"";   j += kSourceNames[src]; j += '"';
+  j += ",\"now\":";        j += String((uint32_t)time(nullptr));
+  j += ",\"errMs\":";      j += String(err);
+  j += ",\"lastOffsetMs\":"; j += String(off);
+  j += ",\"setAgoS\":";    j += src ? String((millis() - setAt) / 1000) : String("null");
+  j += ",\"steps\":";      j += String(steps);
+  j += ",\"slews\":";      j += String(slews);
+  j += ",\"ignored\":";    j += String(ign);
+  j += ",\"httpRttMs\":";  j += String(gHttpRttMs);
+  j += ",\"sntp\":";       j += gSntp ? "true" : "false";
+  j += '}';
+  return j;
+}
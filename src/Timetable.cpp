@@ -0,0 +1,204 @@
+#include "Timetable.h"
+#include <algorithm>
+#include <time.h>
+#include <ctype.h>
+#include <freertos/semphr.h>
+#include "TimeSvc.h"
+
+// [TRAKKR] Look-ahead timetable (see Timetable.h)
+// Times are UTC minutes internally (a DST change mid-table can't shift rows);
+// "HH:MM" only at the edges, interpreted around the local time of the fetch.
+
+namespace {
+  const size_t   MAX_ROWS    = 300;              // two full 150-row responses
+  const uint8_t  NONE        = 255;              // dictionary index: empty / dictionary full
+  const int      PAST_MIN    = 60;               // late-listed rows kept (base = fetch - this)
+  const int      AHEAD_MIN   = 180;              // stop asking once this far ahead is covered
+  const int      MAX_OFFSET  = 119;              // Darwin timeOffset ceiling
+  const uint32_t REFRESH_MS  = 60UL * 60UL * 1000UL;
+  const uint32_t RETRY_MS    = 10UL * 60UL * 1000UL;
+
+  enum : uint8_t { F_BUS = 1 };
+
+  struct Ent { uint16_t dep; uint8_t dest, plat, oper, toc, flags; };   // dep: minutes after base
+
+  struct Table {
+    String              key, title;
+    int32_t             base = 0;                // UTC minute of dep 0
+    int32_t             coverEnd = 0;            // UTC minute the rows are complete up to
+    uint32_t            fetchedAt = 0;           // millis() of the commit
+    uint8_t             parts = 0;
+    std::vector<Ent>    rows;
+    std::vector<String> dict;                    // destinations, platforms, operators, codes
+  };
+
+  SemaphoreHandle_t gMutex   = nullptr;
+  Table             gLive;                       // guarded by gMutex
+  Table             gStage;                      // refresh in progress (net task only)
+  bool              gTried   = false;
+  uint32_t          gTriedAt = 0;
+
+  struct {
+    uint32_t refreshes, failed, parts, dropped, projections;
+  } gStat = {};
+
+  int32_t nowMin(){ return (int32_t)(time(nullptr) / 60); }
+
+  int localMinOfDay(int32_t utcMin){
+    time_t t = (time_t)utcMin * 60; struct tm tm{}; localtime_r(&t, &tm);
+    return tm.tm_hour * 60 + tm.tm_min;
+  }
+
+  int parseHHMM(const String& s){
+    if (s.length() != 5 || s[2] != ':') return -1;
+    const int h = s.substring(0, 2).toInt(), m = s.substring(3).toInt();
+    return (h < 24 && m < 60 && isdigit((unsigned char)s[0])) ? h * 60 + m : -1;
+  }
+
+  // Minute-of-day difference to the nearest instant: 00:10 seen at 23:50 is +20
+  int wrapMin(int d){
+    d %= 1440;
+    if (d < -720) d += 1440; else if (d >= 720) d -= 1440;
+    return d;
+  }
+
+  uint8_t intern(std::vector<String>& dict, const String& s){
+    if (!s.length()) return NONE;
+    for (size_t i = 0; i < dict.size(); ++i) if (dict[i] == s) return (uint8_t)i;
+    if (dict.size() >= NONE) return NONE;
+    dict.push_back(s);
+    return (uint8_t)(dict.size() - 1);
+  }
+
+  const String& word(const Table& t, uint8_t i){
+    static const String empty;
+    return i < t.dict.size() ? t.dict[i] : empty;
+  }
+}
+
+void Timetable::begin(){
+  if (!gMutex) gMutex = xSemaphoreCreateMutex();
+}
+
+bool Timetable::due(const char* key){
+  if (!gMutex || !TimeSvc::valid()) return false;   // rows can't be placed without a clock
+  if (gTried && millis() - gTriedAt < RETRY_MS) return false;
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  const bool d = !gLive.fetchedAt || gLive.key != key || millis() - gLive.fetchedAt >= REFRESH_MS;
+  xSemaphoreGive(gMutex);
+  return d;
+}
+
+void Timetable::start(const char* key){
+  gStage = Table();
+  gStage.key      = key;
+  gStage.coverEnd = nowMin();
+  gStage.base     = gStage.coverEnd - PAST_MIN;
+  gStage.rows.reserve(MAX_ROWS);
+  gTried = true; gTriedAt = millis();
+}
+
+int Timetable::addPart(const String& title, const std::vector<Row>& rows, int offset, int window, bool full){
+  Table& t = gStage;
+  if (!t.title.length()) t.title = title;
+  const int32_t now = nowMin();
+  const int nowLocal = localMinOfDay(now);
+  int32_t last = now + offset;
+  for (const Row& r : rows){
+    const int sched = parseHHMM(r.time);
+    if (sched < 0) continue;
+    const int32_t at = now + wrapMin(sched - nowLocal);
+    if (at > last) last = at;
+    String est = r.est; est.toLowerCase();
+    if (est.indexOf("cancel") >= 0) continue;
+    const int32_t rel = at - t.base;
+    if (rel < 0 || rel > 0xFFFF) continue;
+    if (t.rows.size() >= MAX_ROWS){ gStat.dropped++; continue; }
+
+    Ent e;
+    e.dep   = (uint16_t)rel;
+    e.dest  = intern(t.dict, r.dest);
+    e.plat  = intern(t.dict, r.plat);
+    e.oper  = intern(t.dict, r.oper);
+    e.toc   = intern(t.dict, r.toc);
+    e.flags = r.bus ? F_BUS : 0;
+    bool dup = false;                              // parts overlap by a minute or so
+    for (const Ent& o : t.rows) if (o.dep == e.dep && o.dest == e.dest && o.plat == e.plat){ dup = true; break; }
+    if (!dup) t.rows.push_back(e);
+  }
+  t.parts++; gStat.parts++;
+
+  // A full response ends at its last row, not at the window: anything after it is unknown.
+  const int32_t end = full ? last : now + offset + window;
+  if (end > t.coverEnd) t.coverEnd = end;
+  const int next = (int)(t.coverEnd - now);
+  if (next >= AHEAD_MIN || next <= offset) return -1;
+  return next > MAX_OFFSET ? MAX_OFFSET : next;
+}
+
+void Timetable::commit(){
+  if (!gStage.parts){ gStat.failed++; gStage = Table(); return; }
+  std::stable_sort(gStage.rows.begin(), gStage.rows.end(),
+                   [](const Ent& a, const Ent& b){ return a.dep < b.dep; });
+  gStage.rows.shrink_to_fit();
+  gStage.fetchedAt = millis();
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  std::swap(gLive, gStage);
+  xSemaphoreGive(gMutex);
+  gStage = Table();
+  gStat.refreshes++;
+  Serial.printf("[TT] %u rows, %u strings, %d min ahead\n", (unsigned)gLive.rows.size(),
+                (unsigned)gLive.dict.size(), (int)(gLive.coverEnd - nowMin()));
+}
+
+bool Timetable::project(const char* key, size_t maxRows, std::vector<Row>& out, String& title){
+  out.clear();
+  if (!gMutex || !TimeSvc::valid()) return false;
+  const int32_t now = nowMin();
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  if (gLive.fetchedAt && gLive.key == key){
+    for (const Ent& e : gLive.rows){
+      const int32_t at = gLive.base + e.dep;
+      if (at < now) continue;
+      if (out.size() >= maxRows) break;
+      const int m = localMinOfDay(at);
+      char hhmm[6]; snprintf(hhmm, sizeof(hhmm), "%02d:%02d", m / 60, m % 60);
+      Row r;
+      r.time = hhmm; r.est = "Scheduled";
+      r.dest = word(gLive, e.dest); r.plat = word(gLive, e.plat); r.oper = word(gLive, e.oper);
+      r.toc  = word(gLive, e.toc);
+      r.bus  = (e.flags & F_BUS) != 0;
+      out.push_back(r);
+    }
+    title = gLive.title;
+  }
+  xSemaphoreGive(gMutex);
+  if (!out.empty()) gStat.projections++;
+  return !out.empty();
+}
+
+String Timetable::statsJSON(){
+  String j; j.reserve(256);
+  if (!gMutex) return "{}";
+  const int32_t now = nowMin();
+  xSemaphoreTake(gMutex, portMAX_DELAY);
+  size_t bytes = gLive.rows.size() * sizeof(Ent);
+  for (const String& s : gLive.dict) bytes += s.length() + 1;
+  size_t ahead = 0;
+  for (const Ent& e : gLive.rows) if (gLive.base + e.dep >= now) ahead++;
+  j += "{\"board\":\"";  j += gLive.key; j += '"';
+  j += ",\"rows\":";     j += String((unsigned)gLive.rows.size());
+  j += ",\"ahead\":";    j += String((unsigned)ahead);
+  j += ",\"strings\":";  j += String((unsigned)gLive.dict.size());
+  j += ",\"bytes\":";    j += String((unsigned)bytes);
+  j += ",\"coverMin\":"; j += String(gLive.fetchedAt && gLive.coverEnd > now ? (int)(gLive.coverEnd - now) : 0);
+  j += ",\"ageMs\":";    j += String(gLive.fetchedAt ? millis() - gLive.fetchedAt : 0);
+  xSemaphoreGive(gMutex);
+  j += ",\"refreshes\":";   j += String(gStat.refreshes);
+  j += ",\"failed\":";      j += String(gStat.failed);
+  j += ",\"parts\":";       j += String(gStat.parts);
+  j += ",\"dropped\":";     j += String(gStat.dropped);
+  j += ",\"projections\":"; j += String(gStat.projections);
+  j += '}';
+  return j;
+}
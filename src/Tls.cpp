@@ -0,0 +1,290 @@
+#include "Tls.h"
+#include "Global.h"
+#include "Assets.h"
+#include "TimeSvc.h"
+#include "Api.h"
+#include <Preferences.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/base64.h>
+#include <freertos/semphr.h>
+
+namespace {
+  constexpr const char* NS    = "trakkrtls";
+  constexpr size_t      HOSTS = 4;                  // hosts with pins / anchors / sessions
+  constexpr size_t      PINS  = 4;                  // per host (leaf + intermediates, or backups)
+
+  struct HostPins { char host[48]; uint8_t n; uint8_t pin[PINS][32]; };   // as stored in NVS
+  struct Seen     { char host[48]; uint8_t n; uint8_t spki[PINS][32]; uint32_t at; };
+  struct Anchor   { char host[48]; mbedtls_x509_crt crt; bool ok; };
+  struct Sess     { char host[48]; uint8_t mode; uint32_t epoch, at; bool used; mbedtls_ssl_session s; };
+
+  Preferences       gPrefs;
+  bool              gOpen  = false;
+  SemaphoreHandle_t gLock  = nullptr;               // everything below: net task vs API readers
+  HostPins          gPins[HOSTS];
+  Seen              gSeen[HOSTS];
+  Anchor            gAnchors[HOSTS];                // written by the net task only
+  Sess              gSess[HOSTS];                   // written by the net task only
+  volatile uint32_t gEpoch = 1;                     // bumped on pin changes; older sessions are not offered
+
+  struct ModeStats { uint32_t ok, fail, resumed, fullMs, resumedMs, lastMs; };
+  ModeStats gStats[Tls::MODE_COUNT] = {};
+  volatile uint32_t gFailStreak = 0;                // reset by the next good handshake
+
+  const char* const kModeNames[Tls::MODE_COUNT] = { "insecure", "pin", "anchor" };
+
+  void lock()  { if (gLock) xSemaphoreTake(gLock, portMAX_DELAY); }
+  void unlock(){ if (gLock) xSemaphoreGive(gLock); }
+
+  void setHost(char* dst, const char* host){ strncpy(dst, host, 47); dst[47] = '\0'; }
+
+  bool spki(const mbedtls_x509_crt* c, uint8_t out[32]){
+    return c->pk_raw.p && mbedtls_sha256_ret(c->pk_raw.p, c->pk_raw.len, out, 0) == 0;
+  }
+
+  String b64(const uint8_t in[32]){
+    unsigned char o[48]; size_t n = 0;
+    if (mbedtls_base64_encode(o, sizeof(o), &n, in, 32) != 0) return String();
+    String s; s.concat((const char*)o, n);
+    return s;
+  }
+
+  template <typename T, size_t N> T* slotFor(T (&arr)[N], const char* host, bool create){
+    T* freeSlot = nullptr;
+    for (auto& e : arr){
+      if (e.host[0] && strcmp(e.host, host) == 0) return &e;
+      if (!e.host[0] && !freeSlot) freeSlot = &e;
+    }
+    if (!create) return nullptr;
+    if (!freeSlot) freeSlot = &arr[N - 1];
+    memset(freeSlot->host, 0, sizeof(freeSlot->host));
+    setHost(freeSlot->host, host);
+    return freeSlot;
+  }
+
+  bool savePins(size_t i){
+    if (!gOpen) return false;
+    char k[4] = { 'h', (char)('0' + i), 0, 0 };
+    if (!gPins[i].host[0]){ gPrefs.remove(k); return true; }
+    return gPrefs.putBytes(k, &gPins[i], sizeof(HostPins)) == sizeof(HostPins);
+  }
+}
+
+void Tls::begin(){
+  if (gLock) return;
+  gLock = xSemaphoreCreateMutex();
+  memset(gPins, 0, sizeof(gPins));
+  memset(gSeen, 0, sizeof(gSeen));
+  gOpen = gPrefs.begin(NS, false);
+  for (size_t i = 0; gOpen && i < HOSTS; ++i){
+    char k[4] = { 'h', (char)('0' + i), 0, 0 };
+    if (gPrefs.getBytesLength(k) == sizeof(HostPins)) gPrefs.getBytes(k, &gPins[i], sizeof(HostPins));
+    gPins[i].host[47] = '\0';
+    if (gPins[i].n > PINS) gPins[i].n = PINS;
+  }
+  for (auto& a : gAnchors){ a.host[0] = '\0'; a.ok = false; mbedtls_x509_crt_init(&a.crt); }
+  for (auto& s : gSess){ s.host[0] = '\0'; s.used = false; mbedtls_ssl_session_init(&s.s); }
+}
+
+Tls::Mode   Tls::mode(){ return (Mode)min<uint8_t>(Cfg::tlsMode(), MODE_COUNT - 1); }
+const char* Tls::modeName(Mode m){ return m < MODE_COUNT ? kModeNames[m] : "?"; }
+
+// Parsed in place from the mapped bundle; the certificate is never copied to RAM.
+// A slot, once filled, is never freed, so the pointer stays good after unlock.
+mbedtls_x509_crt* Tls::anchor(const char* host){
+  lock();
+  Anchor* a = nullptr;
+  for (auto& e : gAnchors) if (e.host[0] && strcmp(e.host, host) == 0){ a = &e; break; }
+  if (a){ unlock(); return a->ok ? &a->crt : nullptr; }
+  for (auto& e : gAnchors) if (!e.host[0]){ a = &e; break; }
+  if (!a){ unlock(); return nullptr; }
+  setHost(a->host, host);
+  String path = String("/certs/") + host + ".der";
+  Assets::Entry e;
+  if (Assets::find(path.c_str(), e) && !(e.flags & Assets::FLAG_GZIP))
+    a->ok = mbedtls_x509_crt_parse_der_nocopy(&a->crt, e.data, e.size) == 0;
+  unlock();
+  Serial.printf("[TLS] anchor %s: %s\n", path.c_str(), a->ok ? "loaded" : "missing/bad");
+  return a->ok ? &a->crt : nullptr;
+}
+
+// The handshake ran with VERIFY_NONE, so the served chain proves nothing by
+// itself: only the leaf's key is bound to the session. A pinned leaf is
+// enough. A pinned intermediate or root must also sign its way down to the
+// leaf, for this host; mbedTLS checks that with the pinned cert, alone, as
+// the trust anchor.
+bool Tls::pinMatch(const char* host, const mbedtls_x509_crt* chain){
+  const mbedtls_x509_crt* hit = nullptr;
+  lock();
+  const HostPins* p = nullptr;
+  for (const auto& e : gPins) if (e.host[0] && strcmp(e.host, host) == 0){ p = &e; break; }
+  for (const mbedtls_x509_crt* c = chain; p && c && !hit; c = c->next){
+    uint8_t h[32];
+    if (!spki(c, h)) continue;
+    for (uint8_t i = 0; i < p->n && !hit; ++i) if (memcmp(h, p->pin[i], 32) == 0) hit = c;
+  }
+  unlock();
+  if (!hit) return false;
+  if (hit == chain) return true;
+
+  mbedtls_x509_crt ca;                              // a copy: hit->next is whatever the server sent
+  mbedtls_x509_crt_init(&ca);
+  bool ok = false;
+  if (mbedtls_x509_crt_parse_der(&ca, hit->raw.p, hit->raw.len) == 0){
+    uint32_t flags = 0;
+    mbedtls_x509_crt_verify(const_cast<mbedtls_x509_crt*>(chain), &ca, nullptr, host, &flags, nullptr, nullptr);
+    if (!TimeSvc::valid()) flags &= ~(uint32_t)(MBEDTLS_X509_BADCERT_EXPIRED | MBEDTLS_X509_BADCERT_FUTURE);
+    ok = flags == 0;
+  }
+  mbedtls_x509_crt_free(&ca);
+  return ok;
+}
+
+void Tls::observe(const char* host, const mbedtls_x509_crt* chain){
+  uint8_t h[PINS][32]; uint8_t n = 0;
+  for (const mbedtls_x509_crt* c = chain; c && n < PINS; c = c->next) if (spki(c, h[n])) ++n;
+  if (!n) return;
+  lock();
+  Seen* s = slotFor(gSeen, host, true);
+  memcpy(s->spki, h, sizeof(h)); s->n = n; s->at = millis();
+  unlock();
+}
+
+bool Tls::offerSession(const char* host, Mode m, mbedtls_ssl_context* ssl){
+  lock();
+  Sess* s = slotFor(gSess, host, false);
+  const bool ok = s && s->used && s->mode == m && s->epoch == gEpoch && mbedtls_ssl_set_session(ssl, &s->s) == 0;
+  unlock();
+  return ok;
+}
+
+bool Tls::keepSession(const char* host, Mode m, const mbedtls_ssl_context* ssl){
+  lock();
+  Sess* s = slotFor(gSess, host, false);
+  if (!s){
+    s = &gSess[0];                                   // free slot, else least recently used
+    for (auto& e : gSess){ if (!e.host[0]){ s = &e; break; } if (e.at < s->at) s = &e; }
+    setHost(s->host, host); s->used = false;
+  }
+  const mbedtls_ssl_session* now = mbedtls_ssl_get_session_pointer(ssl);
+  const bool resumed = s->used && s->mode == m && s->epoch == gEpoch && now && now->id_len &&
+                       now->id_len == s->s.id_len && memcmp(now->id, s->s.id, now->id_len) == 0;
+  s->at = millis();
+  if (!resumed){
+    mbedtls_ssl_session_free(&s->s);
+    mbedtls_ssl_session_init(&s->s);
+    s->used  = mbedtls_ssl_get_session(ssl, &s->s) == 0;
+    s->mode  = m;
+    s->epoch = gEpoch;
+  }
+  unlock();
+  return resumed;
+}
+
+void Tls::dropSession(const char* host){
+  lock();
+  Sess* s = slotFor(gSess, host, false);
+  if (s) s->used = false;
+  unlock();
+}
+
+void Tls::noteHandshake(Mode m, bool ok, bool resumed, uint32_t ms){
+  if (m >= MODE_COUNT) return;
+  ModeStats& st = gStats[m];
+  if (!ok){ st.fail++; gFailStreak = gFailStreak + 1; return; }
+  gFailStreak = 0;
+  st.ok++; st.lastMs = ms;
+  if (resumed){ st.resumed++; st.resumedMs += ms; } else st.fullMs += ms;
+}
+
+uint32_t Tls::failStreak(){ return gFailStreak; }
+
+// A session that keeps failing to resume shouldn't be offered again: bumping
+// the epoch retires every cached one (the next connect does a full handshake).
+void Tls::reset(){
+  lock();
+  gEpoch = gEpoch + 1;
+  unlock();
+}
+
+bool Tls::setPins(const char* host, const String& csv){
+  if (!host || !*host) return false;
+  uint8_t pins[PINS][32]; uint8_t n = 0;
+  for (int from = 0; from < (int)csv.length() && n < PINS;){
+    int comma = csv.indexOf(',', from); if (comma < 0) comma = csv.length();
+    String item = csv.substring(from, comma); item.trim();
+    from = comma + 1;
+    if (!item.length()) continue;
+    size_t got = 0; uint8_t raw[48];
+    if (mbedtls_base64_decode(raw, sizeof(raw), &got, (const unsigned char*)item.c_str(), item.length()) != 0 || got != 32)
+      return false;
+    memcpy(pins[n++], raw, 32);
+  }
+  bool ok;
+  lock();
+  HostPins* p = slotFor(gPins, host, n > 0);
+  if (p){
+    if (n){ memcpy(p->pin, pins, sizeof(pins)); p->n = n; }
+    else   memset(p, 0, sizeof(*p));
+    ok = savePins(p - gPins);
+  } else ok = true;
+  gEpoch = gEpoch + 1;
+  unlock();
+  return ok;
+}
+
+bool Tls::pinObserved(const char* host){
+  bool ok = false;
+  lock();
+  Seen* s = slotFor(gSeen, host, false);
+  if (s && s->n){
+    HostPins* p = slotFor(gPins, host, true);
+    memcpy(p->pin, s->spki, sizeof(p->pin)); p->n = s->n;
+    ok = savePins(p - gPins);
+    gEpoch = gEpoch + 1;
+  }
+  unlock();
+  return ok;
+}
+
+String Tls::statsJSON(){
+  String j; j.reserve(768);
+  j += "{\"mode\":\""; j += modeName(mode()); j += "\",\"modes\":{";
+  for (int m = 0; m < MODE_COUNT; ++m){
+    const ModeStats& st = gStats[m];
+    const uint32_t full = st.ok - st.resumed;
+    if (m) j += ',';
+    j += '"'; j += kModeNames[m]; j += "\":{";
+    j += "\"ok\":";           j += String(st.ok);
+    j += ",\"fail\":";        j += String(st.fail);
+    j += ",\"resumed\":";     j += String(st.resumed);
+    j += ",\"avgFullMs\":";   j += String(full ? st.fullMs / full : 0);
+    j += ",\"avgResumedMs\":";j += String(st.resumed ? st.resumedMs / st.resumed : 0);
+    j += ",\"lastMs\":";      j += String(st.lastMs);
+    j += '}';
+  }
+  j += "},\"failStreak\":"; j += String(gFailStreak);
+  j += ",\"hosts\":[";
+  lock();
+  bool first = true;
+  auto hostJSON = [&](const char* host){
+    if (!first) j += ','; first = false;
+    j += "{\"host\":"; j += jsonEscape(host); j += ",\"pins\":[";
+    const HostPins* p = slotFor(gPins, host, false);
+    for (uint8_t i = 0; p && i < p->n; ++i){ if (i) j += ','; j += '"'; j += b64(p->pin[i]); j += '"'; }
+    j += "],\"seen\":[";
+    const Seen* s = slotFor(gSeen, host, false);
+    for (uint8_t i = 0; s && i < s->n; ++i){ if (i) j += ','; j += '"'; j += b64(s->spki[i]); j += '"'; }
+    j += "],\"anchor\":";
+    const Anchor* a = slotFor(gAnchors, host, false);
+    j += a ? (a->ok ? "true" : "false") : "null";
+    const Sess* ss = slotFor(gSess, host, false);
+    j += ",\"session\":"; j += (ss && ss->used && ss->epoch == gEpoch) ? "true" : "false";
+    j += '}';
+  };
+  for (const auto& p : gPins) if (p.host[0]) hostJSON(p.host);
+  for (const auto& s : gSeen) if (s.host[0] && !slotFor(gPins, s.host, false)) hostJSON(s.host);
+  unlock();
+  j += "]}";
+  return j;
+}
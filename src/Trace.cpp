@@ -0,0 +1,184 @@
+#include "Trace.h"
+#include <atomic>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+
+namespace {
+  // 16 bytes per event. `seq` is written last; a reader only trusts a slot
+  // whose seq matches the index it expects (slot was not being rewritten).
+  // Timestamps are 48-bit esp_timer us (~8.9 years), so a long run never
+  // wraps and reorders.
+  struct Event {
+    uint32_t    tsLo;      // esp_timer us, bits 0..31
+    const char* name;
+    uint32_t    seq;       // claimed index + 1
+    uint8_t     tid;       // index into gTasks
+    char        ph;        // 'B' / 'E' / 'i'
+    uint16_t    tsHi;      // bits 32..47
+  };
+
+  struct Ring {
+    Event*                mem  = nullptr;
+    uint32_t              mask = 0;
+    std::atomic<uint32_t> head{0};
+  };
+
+  constexpr uint32_t RING_PSRAM    = 4096;   // per core, ~22 s of ticker at 30 fps (~6 events a frame)
+  constexpr uint32_t RING_INTERNAL = 512;
+  constexpr int      MAX_TASKS     = 24;
+
+  struct TaskName { void* handle; char name[16]; };
+
+  Ring          gRing[2];
+  TaskName      gTasks[MAX_TASKS];
+  volatile int  gTaskCount = 0;
+  portMUX_TYPE  gTaskMux   = portMUX_INITIALIZER_UNLOCKED;
+  volatile bool gOn        = false;
+
+  // Small stable id for the calling task; names are copied so dead tasks still label.
+  uint8_t taskId(){
+    void* h = (void*)xTaskGetCurrentTaskHandle();
+    const int n = gTaskCount;
+    for (int i = 0; i < n; ++i) if (gTasks[i].handle == h) return (uint8_t)i;
+
+    uint8_t id = MAX_TASKS - 1;                      // overflow bucket
+    portENTER_CRITICAL(&gTaskMux);
+    int i = 0;
+    for (; i < gTaskCount; ++i) if (gTasks[i].handle == h) break;
+    if (i < gTaskCount) id = (uint8_t)i;
+    else if (gTaskCount < MAX_TASKS - 1){
+      TaskName& t = gTasks[gTaskCount];
+      const char* nm = pcTaskGetName((TaskHandle_t)h);
+      strncpy(t.name, nm ? nm : "?", sizeof(t.name) - 1);
+      t.name[sizeof(t.name) - 1] = '\0';
+      t.handle = h;
+      id = (uint8_t)gTaskCount++;
+    }
+    portEXIT_CRITICAL(&gTaskMux);
+    return id;
+  }
+
+  inline void record(const char* name, char ph, uint64_t ts){
+    if (!gOn) return;
+    Ring& r = gRing[xPortGetCoreID() & 1];
+    if (!r.mem) return;
+    const uint32_t idx = r.head.fetch_add(1, std::memory_order_relaxed);
+    Event& e = r.mem[idx & r.mask];
+    e.seq  = 0;
+    e.tsLo = (uint32_t)ts;
+    e.tsHi = (uint16_t)(ts >> 32);
+    e.name = name;
+    e.tid  = taskId();
+    e.ph   = ph;
+    std::atomic_thread_fence(std::memory_order_release);
+    e.seq  = idx + 1;
+  }
+
+  void jsonName(String& j, const char* s){
+    j += '"';
+    for (; s && *s; ++s){
+      if (*s == '"' || *s == '\\') j += '\\';
+      j += *s;
+    }
+    j += '"';
+  }
+}
+
+// Rings are allocated on first enable, so a board that never traces keeps the RAM.
+static bool allocRings(){
+#if TRAKKR_TRACE
+  if (gRing[0].mem) return true;
+  const bool psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 2 * RING_PSRAM * sizeof(Event);
+  const uint32_t n = psram ? RING_PSRAM : RING_INTERNAL;
+  for (int c = 0; c < 2; ++c){
+    Event* m = (Event*)heap_caps_calloc(n, sizeof(Event), psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT);
+    if (!m){ Serial.println("[TRACE][ERR] ring alloc failed"); return false; }
+    gRing[c].mask = n - 1;
+    gRing[c].mem  = m;                               // record() checks mem, so set it last
+  }
+  Serial.printf("[TRACE] %u events/core in %s\n", (unsigned)n, psram ? "PSRAM" : "internal RAM");
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Trace::begin(){
+  gOn = false;                                       // off until /api/trace?on=1
+}
+
+void Trace::setEnabled(bool on){ gOn = on && allocRings() && gRing[1].mem; }
+bool Trace::enabled(){ return gOn; }
+
+void Trace::clear(){
+  const bool was = gOn; gOn = false;
+  for (auto& r : gRing){
+    if (!r.mem) continue;
+    memset(r.mem, 0, (r.mask + 1) * sizeof(Event));
+    r.head.store(0);
+  }
+  gOn = was;
+}
+
+#if TRAKKR_TRACE
+static inline uint64_t nowUs(){ return (uint64_t)esp_timer_get_time(); }
+void Trace::spanBegin(const char* name){ record(name, 'B', nowUs()); }
+void Trace::spanEnd(const char* name){   record(name, 'E', nowUs()); }
+void Trace::instant(const char* name){   record(name, 'i', nowUs()); }
+void Trace::spanSince(const char* name, uint32_t t0Us, uint32_t minUs){
+  const uint64_t t1 = nowUs();
+  const uint32_t d  = (uint32_t)t1 - t0Us;           // callers pass the low 32 bits
+  if (!gOn || d < minUs) return;
+  record(name, 'B', t1 - d);
+  record(name, 'E', t1);
+}
+#else
+void Trace::spanBegin(const char*){}
+void Trace::spanEnd(const char*){}
+void Trace::instant(const char*){}
+void Trace::spanSince(const char*, uint32_t, uint32_t){}
+#endif
+
+uint32_t Trace::held(){
+  uint32_t n = 0;
+  for (auto& r : gRing) if (r.mem) n += min(r.head.load(), r.mask + 1);
+  return n;
+}
+uint32_t Trace::recorded(){ return gRing[0].head.load() + gRing[1].head.load(); }
+
+void Trace::writeJSON(void (*emit)(const String&, void*), void* ctx){
+  // Pause recording so the dump is one consistent window.
+  const bool was = gOn; gOn = false;
+
+  String j; j.reserve(1280);
+  j += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  j += "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"TRAKKR\"}}";
+  const int nt = gTaskCount;
+  for (int i = 0; i < nt; ++i){
+    j += ",{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"; j += String(i);
+    j += ",\"args\":{\"name\":"; jsonName(j, gTasks[i].name); j += "}}";
+  }
+
+  for (int c = 0; c < 2; ++c){
+    Ring& r = gRing[c];
+    if (!r.mem) continue;
+    const uint32_t head = r.head.load();
+    const uint32_t size = r.mask + 1;
+    const uint32_t from = head > size ? head - size : 0;
+    for (uint32_t i = from; i < head; ++i){
+      const Event& e = r.mem[i & r.mask];
+      if (e.seq != i + 1 || !e.name) continue;      // torn or overwritten
+      j += ",{\"ph\":\""; j += e.ph; j += "\",\"name\":"; jsonName(j, e.name);
+      char ts[24];
+      snprintf(ts, sizeof(ts), "%llu", (unsigned long long)(((uint64_t)e.tsHi << 32) | e.tsLo));
+      j += ",\"pid\":1,\"tid\":"; j += String((unsigned)e.tid);
+      j += ",\"ts\":"; j += ts;
+      if (e.ph == 'i') j += ",\"s\":\"t\"";
+      j += ",\"args\":{\"core\":"; j += String(c); j += "}}";
+      if (j.length() >= 1024){ emit(j, ctx); j = ""; }
+    }
+  }
+  j += "]}";
+  emit(j, ctx);
+  gOn = was;
+}
@@ -13,9 +13,16 @@
 #include <JPEGDecoder.h>
 #include "NationalRail.h"
 #include "fonts_compat.h"
+#include "Trace.h"
+#include "Assets.h"
+#include "Icons.h"
 #include <WiFi.h>
 #include <time.h>
 #include "HttpServer.h"
+#include "TimeSvc.h"
+#include "Pixel.h"
+#include "Ota.h"
+#include "Supervisor.h"
 
 extern void rail_setup();
 extern void rail_loop();
@@ -24,11 +31,6 @@ extern void rail_loop();
 static const int SCREEN_W = 480;
 static const int SCREEN_H = 320;
 
-// Time config
-static const char* NTP_1 = "pool.ntp.org";                //  Primary NTP server
-static const char* NTP_2 = "time.nist.gov";               //  Secondary NTP server
-static const char* TZ_UK = "GMT0BST,M3.5.0/1,M10.5.0/2";  //  UK timezone with BST rules
-
 // [TRAKKR] Match rail.cpp body background (#0b1020)
 static inline uint16_t bodyBgMain() {
   return tft.color565(0x0b, 0x10, 0x20);
@@ -75,32 +77,38 @@ static void renderJPEG(int xpos, int ypos) {
     int win_h = (mcu_y + JpegDec.MCUHeight <= ypos + JpegDec.height) ? JpegDec.MCUHeight : (JpegDec.height % JpegDec.MCUHeight);
 
     if (win_w && win_h) {
+      // [TRAKKR-NOTE] JPEGDecoder writes native RGB565; put the whole MCU in panel byte
+      // order in one vector pass instead of setSwapBytes() swapping per pixel on push.
+      Pixel::swap16(JpegDec.pImage, JpegDec.pImage, (size_t)JpegDec.MCUWidth * JpegDec.MCUHeight);
       tft.pushImage(mcu_x, mcu_y, win_w, win_h, JpegDec.pImage);
     }
   }
 }
 
-// Decode and draw a JPG from LittleFS at (x,y)
+// Decode and draw a JPG at (x,y): from the mapped asset bundle if present, else LittleFS
 static bool drawJpgFile(const char *path, int x, int y) {
+  Assets::Entry a;
+  if (Assets::find(path, a) && !(a.flags & Assets::FLAG_GZIP)) {
+    bool ok = JpegDec.decodeArray(a.data, a.size);
+    if (ok) { tft.startWrite(); renderJPEG(x, y); tft.endWrite(); }
+    else Serial.printf("[TRAKKR] JPEG decode failed (asset): %s\n", path);
+    if (ok) return true;
+  }
+
   File f = LittleFS.open(path, "r");
   if (!f) { Serial.printf("[TRAKKR] File not found: %s\n", path); return false; }
   size_t sz = f.size(); f.close();
   if (sz < 1024) { Serial.printf("[TRAKKR] File too small (%u bytes): %s\n", (unsigned)sz, path); return false; }
 
-  // [TRAKKR-NOTE] JPEGDecoder outputs big-endian RGB565; enable swap for TFT_eSPI.
-  tft.setSwapBytes(true);
-
+  // [TRAKKR-NOTE] renderJPEG() does the byte swap; TFT_eSPI pushes the buffer as is.
   if (!JpegDec.decodeFsFile(path)) {
     Serial.printf("[TRAKKR] JPEG decode failed: %s\n", path);
-    tft.setSwapBytes(false);
     return false;
   }
 
   tft.startWrite();
   renderJPEG(x, y);
   tft.endWrite();
-
-  tft.setSwapBytes(false);
   return true;
 }
 
@@ -159,68 +167,19 @@ static void splashWifiConnect(uint32_t timeoutMs = 15000) {
   }
 }
 
-// [TRAKKR] Check if system time is valid (i.e. has been set via NTP)
-static bool timeIsValid() {
-  time_t now = time(nullptr);
-  return (now >= 1704067200UL); // 2024-01-01 00:00:00 UTC
-}
-
-// [TRAKKR] Ensure time is set via NTP; safe to call repeatedly
-void ensureTime() {
-  setenv("TZ", TZ_UK, 1); tzset();      // always set UK rules
-  if (timeIsValid()) return;            // but avoid unnecessary NTP
-  configTime(0, 0, NTP_1, NTP_2);
-}
-
-// [TRAKKR] Animated "Setting clock…" splash with success/fail outcome
-static void splashTimeSync(uint32_t timeoutMs = 15000) {
-  const char* title = "Setting clock";
-  const char* lines0[2] = { title, "" };
-  showSplash(lines0, 2, 0);
-
-  // Begin sync (idempotent)
-  ensureTime();
-
-  // Animate dots while waiting for valid time
-  uint32_t t0 = millis();
-  uint8_t dots = 0;
-  char line2[8] = {0};
-
-  while (!timeIsValid() && (millis() - t0) < timeoutMs) {
-    dots = (dots % 3) + 1;    // 1..3 dots
-    memset(line2, 0, sizeof(line2));
-    for (uint8_t i = 0; i < dots; i++) line2[i] = '.';
-    const char* lines[2] = { title, line2 };
-    showSplash(lines, 2, 0);
-    delay(250);
-  }
-
-  if (timeIsValid()) {
-    // Format local time for display
-    time_t now = time(nullptr);
-    struct tm lt; localtime_r(&now, &lt);
-    char buf[48];
-    strftime(buf, sizeof(buf), "%d %b %Y %H:%M", &lt);
-    String msg = String("Time: ") + buf;
-    const char* ok[2] = { "Clock set", msg.c_str() };
-    showSplash(ok, 2, 2000);
-    Serial.printf("[TRAKKR] Clock set to %s\n", buf);
-  } else {
-    const char* fail[2] = { "Time sync failed", "Will retry later" };
-    showSplash(fail, 2, 1500);
-    Serial.println("[TRAKKR] Time sync failed");
-  }
-}
-
 // -----------------------------------------------------------------------------
 // Main application entry points
 // -----------------------------------------------------------------------------
 
 void setup() {
   Serial.begin(115200);
+  Ota::begin();     // [TRAKKR] trial boot of a new image: count it, roll back if it keeps failing
+  Trace::begin();   // [TRAKKR] span recorder for /api/trace (off until ?on=1)
+  Pixel::begin();   // [TRAKKR] pixel kernels: self-check vector paths
 
   // [TRAKKR] Load NVS-backed config (Wi-Fi, CRS, mode, tokens, etc.)
   Cfg::begin();
+  TimeSvc::begin();   // [TRAKKR] TZ + clock kept in RTC memory across restarts
 
   // ---- Init display ----
   tft.init();
@@ -228,22 +187,23 @@ void setup() {
   tft.fillScreen(bodyBgMain());
 
   // ---- Init filesystem ----
-  if (!LittleFS.begin()) {
-    Serial.println("[TRAKKR] LittleFS mount failed!");
-  } else {
-    listFS();
-
-    // Try to show splash image if present
-    if (LittleFS.exists("/TRAKKR.jpg")) {
-      if (drawJpgFile("/TRAKKR.jpg", 0, 0)) {
-        Serial.println("[TRAKKR] Splash loaded OK");
-        delay(5000);
-      } else {
-        Serial.println("[TRAKKR] Splash image present but failed to draw");
-      }
+  Assets::begin();   // [TRAKKR] mapped bundle; LittleFS stays the fallback
+  Icons::begin();    // [TRAKKR] operator logo cache (needs the bundle)
+  const bool fsOk = LittleFS.begin();
+  if (!fsOk) Serial.println("[TRAKKR] LittleFS mount failed!");
+  else       listFS();
+
+  // Try to show splash image if present
+  Assets::Entry splash;
+  if (Assets::find("/TRAKKR.jpg", splash) || (fsOk && LittleFS.exists("/TRAKKR.jpg"))) {
+    if (drawJpgFile("/TRAKKR.jpg", 0, 0)) {
+      Serial.println("[TRAKKR] Splash loaded OK");
+      delay(5000);
     } else {
-      Serial.println("[TRAKKR] Splash image not found, skipping");
+      Serial.println("[TRAKKR] Splash image present but failed to draw");
     }
+  } else {
+    Serial.println("[TRAKKR] Splash image not found, skipping");
   }
 /*
   // Optional text splash sequence
@@ -260,9 +220,9 @@ void setup() {
   Serial.println("[TRAKKR] Connecting Wi-Fi from main.cpp…");
   splashWifiConnect();
 
-  // Time splash
-  Serial.println("[TRAKKR] Setting Time from main.cpp…");
-  splashTimeSync();
+  // [TRAKKR-NOTE] No time splash: SNTP runs in the background and the first
+  // Darwin response's Date header usually sets the clock before it answers.
+  TimeSvc::startSntp();
 /*
   // Control Panel info
   const char* scr5[] = { "Control Panel", "http://trakkr.local" };
@@ -274,9 +234,12 @@ void setup() {
   // ---- Hand-off to main app ----
   http_setup();
   rail_setup();
+  Supervisor::begin();   // [TRAKKR] restart failing parts instead of rebooting
 }
 
 void loop() {
   http_loop();
   rail_loop();
+  TimeSvc::loop();
+  Ota::loop();
 }
@@ -7,49 +7,40 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
-#include <HTTPClient.h>
 #include <vector>
 #include <time.h>
+#include <sys/time.h>
 #include "Global.h"
 #include "TFT.h"
 #include "NationalRail.h"
+#include "Display.h"
+#include "Pixel.h"
+#include "Bench.h"
+#include "Soak.h"
+#include "BenchFixtures.h"
+#include "Rail.h"
+#include "Trace.h"
+#include "SpscRing.h"
+#include "Quota.h"
+#include "Async.h"
+#include "Mqtt.h"
+#include "Peer.h"
+#include "Tls.h"
+#include "TimeSvc.h"
+#include "ClockFace.h"
+#include "RowAnim.h"
+#include "Marquee.h"
+#include "History.h"
+#include "HeapTrace.h"
+#include "Timetable.h"
+#include "Icons.h"
+#include "Supervisor.h"
 
 extern void ensureWiFi();
-extern void ensureTime();
 extern const char* cfgCallingAtCrs();  // returns "" when unset
 
-// === [TRAKKR][BEGIN:fetch_guard] ===
-static SemaphoreHandle_t gFetchSem = nullptr;
-static uint32_t gLastFetchMs = 0;
-static bool beginFetchGuard(uint32_t debounceMs = 800){
-  if (!gFetchSem){
-    gFetchSem = xSemaphoreCreateBinary();
-    if (gFetchSem) xSemaphoreGive(gFetchSem);
-  }
-  if (!gFetchSem) return true;
-  const uint32_t now = millis();
-  if (now - gLastFetchMs < debounceMs) return false;
-  if (xSemaphoreTake(gFetchSem, 0) != pdTRUE) return false;
-  gLastFetchMs = now;
-  return true;
-}
-static void endFetchGuard(){ if (gFetchSem) xSemaphoreGive(gFetchSem); }
-struct FetchScope { bool active; explicit FetchScope(bool ok):active(ok){} ~FetchScope(){ if(active) endFetchGuard(); } };
-// === [TRAKKR][END:fetch_guard] ===
-
-static SemaphoreHandle_t gTftMutex = nullptr;
 static void drawTicker_FS();
-static void drawBusIcon(int xLeft, int yTop, int h, uint16_t fg, uint16_t bg);
-static void tickerTask(void*){
-  for(;;){
-    if (xSemaphoreTake(gTftMutex, portMAX_DELAY) == pdTRUE){
-      drawTicker_FS();
-      xSemaphoreGive(gTftMutex);
-    }
-    vTaskDelay(pdMS_TO_TICKS(33)); // ~30 fps
-  }
-}
+static void drawBusIcon(TFT_eSPI& g, int xLeft, int yTop, int h, uint16_t fg, uint16_t bg);
 
 // ===== FILESYSTEM SELECT =====
 #define USE_SD_TICKER 0
@@ -86,11 +77,14 @@ static bool checkHeap(const char* where){
   if (largest < PERF_WARN_LARGEST_MIN){
     Serial.printf("[MEM][WARN] Largest 8-bit block low at %-18s => %uB (< %uB)\n",
                   where, (unsigned)largest, (unsigned)PERF_WARN_LARGEST_MIN);
+    HeapTrace::logTop(where, 5);   // who holds it (when /api/heap tracing is on)
+    Supervisor::heapLow(where);
     return false;
   }
   return true;
 }
-struct ScopeTimer { const char* n; uint32_t t0; ScopeTimer(const char* s):n(s),t0(millis()){} ~ScopeTimer(){ if(PERF_VERBOSE) Serial.printf("[TIME] %-18s %lums\n", n, (unsigned long)(millis()-t0)); } };
+// [TRAKKR] Also recorded as a trace span (see /api/trace)
+struct ScopeTimer { const char* n; uint32_t t0; ScopeTimer(const char* s):n(s),t0(millis()){ Trace::spanBegin(n); } ~ScopeTimer(){ Trace::spanEnd(n); if(PERF_VERBOSE) Serial.printf("[TIME] %-18s %lums\n", n, (unsigned long)(millis()-t0)); } };
 
 // ===== CONFIG =====
 static const char* DARWIN_HOST = "lite.realtime.nationalrail.co.uk";
@@ -101,10 +95,12 @@ static const char* LDB_NS      = "http://thalesgroup.com/RTTI/2016-02-16/ldb/";
 static const char* TOK_NS      = "http://thalesgroup.com/RTTI/2013-11-28/Token/types";
 
 // [TRAKKR] Switch to arrivals mode as requested
-static const int   ROWS = 8;                // Number of rows to show (max 16, limited by screen height)
+static const int   ROWS = 8;                // Rows per page (limited by screen height); fetch count is Cfg::boardRows()
 static const int   TIME_WINDOW_MINS = 120;  // Look for services within this many minutes of now
-static const uint32_t POLL_MS_OK  = 30000;  // 30s between successful polls
-static const uint32_t POLL_MS_ERR = 2000;   // 2s between failed polls/
+static const int      LOOK_PARTS       = 2;             // look-ahead requests per timetable refresh
+static const uint32_t PROJECT_AFTER_MS = 3UL * 60UL * 1000UL;   // failing this long: project from the timetable
+static const char*    OFFLINE_MSG = "Live departures are unavailable. Showing scheduled times.";
+// [TRAKKR] Poll cadence comes from Quota::nextPollMs() (updateEvery, token budget, error backoff)
 
 static const bool   DEBUG_NET       = true;
 static const bool   DEBUG_BODY_SNIP = false;
@@ -122,13 +118,29 @@ static const int  TICKER_H=28, TICKER_SPEED=2;
 static const int  ROW_VPAD = 6;
 
 // ===== STATE =====
-struct Svc { String time, place, est, plat, oper; bool bus = false; };
+struct Svc {
+  String id;                            // Darwin serviceID (MQTT topic key)
+  String time, place, est, plat, oper; bool bus = false;
+  String toc;                           // Darwin operatorCode (operator icon)
+  // [TRAKKR] Render cache: filled the first time the row is painted, so page
+  // flips and repaints never re-measure text (fitByWordsPx is the hot part).
+  String   fitPlace;
+  int16_t  fitPx  = -1;
+  uint16_t estCol = 0;
+};
 std::vector<Svc>   services;
 std::vector<String> nrccMsgs;
 
 static String stationTitle="Board";
 static uint32_t nextPoll=0, nextClockTick=0;
 static uint32_t nextPerfBeat=0;
+static uint32_t gSeenGen=0;            // last fetch generation the loop task re-armed nextPoll for
+
+// [TRAKKR] Paging: services holds up to Cfg::boardRows(); only one page is ever drawn.
+static int      gPage = 0;
+static int      gRowsPerPage = ROWS;   // refined by drawRows() from font metrics
+static uint32_t nextPageFlip = 0;
+static int pageCount(){ return max(1, ((int)services.size() + gRowsPerPage - 1) / gRowsPerPage); }
 
 // header metrics (using NationalRailTiny)
 static int  clockX=0, clockBaseY=28, clockBoxX=0, clockBoxY=0, clockBoxW=0, clockBoxH=0;
@@ -198,11 +210,15 @@ static String keepFirstSentence(const String& in){
 }
 
 // [TRAKKR] Draw legible text: 1-px drop shadow (no background fill).
+// Onto the panel or into a sprite (board transitions paint rows off-screen).
+static void drawShadowedOn(TFT_eSPI& g, const String& s, int x, int y, uint16_t fg, uint8_t datum){
+  g.setTextDatum(datum);
+  g.setTextColor(TFT_BLACK);  g.drawString(s, x+1, y+1);   // shadow
+  g.setTextColor(fg);         g.drawString(s, x,   y);     // main
+  g.setTextDatum(TL_DATUM);
+}
 static void drawShadowed(const String& s, int x, int y, uint16_t fg, uint8_t datum){
-  tft.setTextDatum(datum);
-  tft.setTextColor(TFT_BLACK);  tft.drawString(s, x+1, y+1);   // shadow
-  tft.setTextColor(fg);         tft.drawString(s, x,   y);     // main
-  tft.setTextDatum(TL_DATUM);
+  drawShadowedOn(tft, s, x, y, fg, datum);
 }
 
 // ===== BOOT BOX =====
@@ -233,16 +249,28 @@ static void showLoadingBoardFull() {
 }
 
 // ===== CLOCK =====
-// [TRAKKR-NOTE] Time is initialised in main.cpp via ensureTime(). Old NTP helpers removed.
-static bool timeValid(){ time_t t=time(nullptr); struct tm tm{}; localtime_r(&t,&tm); return tm.tm_year>=120; }
-static void nowHHMM(char* out,size_t n){
-  if(!timeValid()){ strncpy(out,"--:--",n); return; }
-  time_t t=time(nullptr); struct tm tm{}; localtime_r(&t,&tm); strftime(out,n,"%H:%M",&tm);
+// [TRAKKR-NOTE] Time comes from TimeSvc (RTC memory, HTTP Date or SNTP, whichever is first).
+// Cfg::clockStyle(): 0 = HH:MM, 1 = HH:MM with a ticking colon, 2 = HH:MM:SS.
+// The face is a pre-rendered glyph atlas; each tick pushes only the cells that changed.
+static ClockFace gClockFace;
+static uint8_t   gClockStyle = 0xFF;     // style the face / geometry were built for
+
+static bool timeValid(){ return TimeSvc::valid(); }
+static void nowClock(char* out, size_t n, struct tm* tmOut){
+  const bool secs = (gClockStyle == 2);
+  if(!timeValid()){ strncpy(out, secs ? "--:--:--" : "--:--", n); out[n-1]='\0'; return; }
+  time_t t=time(nullptr); localtime_r(&t,tmOut); strftime(out,n, secs ? "%H:%M:%S" : "%H:%M", tmOut);
 }
 static void headerInit(){
+  gClockStyle = Cfg::clockStyle();
   tft.setFreeFont(&NationalRailSmall);
-  int ww = tft.textWidth("88:88");
-  int hh = tft.fontHeight();
+  int ww = 0, hh = tft.fontHeight();
+  if (gClockFace.begin(&NationalRailSmall, TFT_WHITE, TFT_BLACK, headBg(), gClockStyle == 2)){
+    ww = gClockFace.width();
+  } else {
+    tft.setFreeFont(&NationalRailSmall);
+    ww = tft.textWidth(gClockStyle == 2 ? "88:88:88" : "88:88");
+  }
   if (ww <= 0) ww = 60; if (hh <= 0) hh = 16;
   clockX = W - PAD - ww;
   int topPad = (HEADER_H - hh) / 2;
@@ -250,27 +278,55 @@ static void headerInit(){
 }
 
 // [TRAKKR] Draw clock with the SAME vertical centring as the title
+static void setTitle(const String& station);
 static void drawClockIfChanged(){
-  static char last[8] = "";
-  char buf[8]; nowHHMM(buf, sizeof(buf));
-  if (strcmp(buf,last)==0) return;
+  static char last[12] = "";
+  static bool lastColon = true;
+
+  // Style changed from the web UI: the box changes width, so re-lay out and
+  // let the title re-fit against the new box.
+  if (Cfg::clockStyle() != gClockStyle){
+    tft.fillRect(clockBoxX, clockBoxY, clockBoxW, clockBoxH, headBg());
+    headerInit();
+    last[0] = '\0';
+    setTitle(stationTitle);
+  }
+
+  struct tm tm{};
+  char buf[12]; nowClock(buf, sizeof(buf), &tm);
+  const bool colon = (gClockStyle != 1) || !timeValid() || (tm.tm_sec & 1) == 0;
+  if (strcmp(buf,last)==0 && colon == lastColon) return;
 
   tft.setFreeFont(&NationalRailSmall);
   int fh = (int)tft.fontHeight(); if (fh < 16) fh = 16;
   const int yTop = (HEADER_H - fh) / 2;
-
-  tft.fillRect(clockBoxX, clockBoxY, clockBoxW, clockBoxH, headBg());
-
   const int xPad = 7;
-  drawShadowed(String(buf), clockBoxX + xPad, yTop, TFT_WHITE, TL_DATUM);
+
+  if (gClockFace.ready()){
+    if (last[0] == '\0'){
+      tft.fillRect(clockBoxX, clockBoxY, clockBoxW, clockBoxH, headBg());
+      gClockFace.invalidate();
+    }
+    gClockFace.draw(clockBoxX + xPad, yTop, buf, colon);
+  } else {
+    tft.fillRect(clockBoxX, clockBoxY, clockBoxW, clockBoxH, headBg());
+    drawShadowed(String(buf), clockBoxX + xPad, yTop, TFT_WHITE, TL_DATUM);
+  }
 
   strncpy(last,buf,sizeof(last)-1); last[sizeof(last)-1]='\0';
+  lastColon = colon;
 }
 
-static void scheduleNextMinute(){
+// Next minute boundary for HH:MM; next second boundary for the ticking styles.
+static void scheduleNextClockTick(){
   if(!timeValid()){ nextClockTick=millis()+1000; return; }
-  time_t t=time(nullptr); struct tm tm{}; localtime_r(&t,&tm);
-  uint32_t ms=(60-tm.tm_sec)*1000u; nextClockTick=millis()+(ms?ms:60000);
+  struct timeval tv; gettimeofday(&tv, nullptr);
+  uint32_t ms = 1000u - (uint32_t)(tv.tv_usec / 1000);
+  if (Cfg::clockStyle() == 0){
+    struct tm tm{}; localtime_r(&tv.tv_sec,&tm);
+    ms += (59 - tm.tm_sec) * 1000u;
+  }
+  nextClockTick = millis() + ms;
 }
 
 // ===== HEADER TITLE =====
@@ -306,6 +362,14 @@ static void drawColHeader(){
   drawShadowed("ETA",      X_ETD,  y, tft.color565(0x9f,0xb3,0xff), ML_DATUM);
   drawShadowed("Plt",      X_PLAT, y, tft.color565(0x9f,0xb3,0xff), ML_DATUM);
   drawShadowed("Operator", X_OPER, y, tft.color565(0x9f,0xb3,0xff), ML_DATUM);
+
+  // [TRAKKR] Page indicator ("2/5") at the right end of the bar
+  const int pages = pageCount();
+  if (gPage >= pages) gPage = 0;
+  if (pages > 1){
+    char pg[12]; snprintf(pg, sizeof(pg), "%d/%d", gPage + 1, pages);
+    drawShadowed(pg, W - PAD, y, tft.color565(0x9f,0xb3,0xff), MR_DATUM);
+  }
 }
 static String normalizeOper(String op){
   op.trim();
@@ -319,22 +383,25 @@ static String normalizeOper(String op){
 }
 
 // Tiny bus icon helper
-static void drawBusIcon(int xLeft, int yTop, int h, uint16_t fg, uint16_t bg){
+static void drawBusIcon(TFT_eSPI& g, int xLeft, int yTop, int h, uint16_t fg, uint16_t bg){
   if (h < 10) h = 10;
   int bodyH = h - 4;
   if (bodyH < 6) bodyH = 6;
   int w = bodyH * 2;
-  tft.fillRoundRect(xLeft, yTop, w, bodyH, 3, fg);
+  g.fillRoundRect(xLeft, yTop, w, bodyH, 3, fg);
   int winH = max(2, bodyH / 2 - 1);
-  tft.fillRect(xLeft + 3, yTop + 2, max(0, w - 6), winH, bg);
-  tft.drawFastVLine(xLeft + w - 6, yTop + 2, bodyH - 4, bg);
+  g.fillRect(xLeft + 3, yTop + 2, max(0, w - 6), winH, bg);
+  g.drawFastVLine(xLeft + w - 6, yTop + 2, bodyH - 4, bg);
   int wy = yTop + bodyH + 1;
-  tft.fillCircle(xLeft + 5, wy, 2, fg);
-  tft.fillCircle(xLeft + w - 5, wy, 2, fg);
+  g.fillCircle(xLeft + 5, wy, 2, fg);
+  g.fillCircle(xLeft + w - 5, wy, 2, fg);
 }
 
-static void drawRows() {
-  ScopeTimer T("drawRows");
+// [TRAKKR] Row painting is split so the display task can interleave ticker
+// frames between rows (see DISPLAY TASK).
+struct RowLayout { int rowH, maxVis, first, painted, pxToMax; };
+
+static RowLayout rowsLayout(){
   tft.setFreeFont(&NationalRailTiny);
 
   const int fh = (int)tft.fontHeight();
@@ -348,50 +415,78 @@ static void drawRows() {
   if (_rowH > maxRowH) _rowH = maxRowH;
   if (_rowH < minRowH) _rowH = minRowH;
 
-  const int maxVis  = min(ROWS, availH / _rowH);
-  const int painted = min((int)services.size(), maxVis);
+  RowLayout L;
+  L.rowH   = _rowH;
+  L.maxVis = min(ROWS, availH / _rowH);
+  gRowsPerPage = max(1, L.maxVis);
+  if (gPage >= pageCount()) gPage = 0;
+
+  // [TRAKKR] Virtualised: only the rows on the current page are touched
+  L.first   = gPage * gRowsPerPage;
+  L.painted = max(0, min((int)services.size() - L.first, L.maxVis));
 
   // [TRAKKR] Compute pixel width for each column span
-  const int pxToMax = (X_ETD - X_TO) - 6;   // small gutter before ETA
+  L.pxToMax = (X_ETD - X_TO) - 6;   // small gutter before ETA
+  return L;
+}
 
-  for (int i = 0; i < painted; i++) {
-    const auto& s = services[i];
-    uint16_t bg   = (i % 2 == 0) ? bodyBg() : rowAlt();
+// Paint service s as slot `slot` with its top edge at rowTop, on the panel or into a sprite.
+static void paintRow(TFT_eSPI& g, const RowLayout& L, Svc& s, int slot, int rowTop){
+  const int _rowH = L.rowH;
+  uint16_t bg   = (slot % 2 == 0) ? bodyBg() : rowAlt();
+  g.setFreeFont(&NationalRailTiny);
 
-    tft.fillRect(0, ROW_TOP + i*_rowH, W, _rowH, bg);
+  if (s.fitPx != L.pxToMax){
+    // [TRAKKR] Word-safe pixel ellipsis for "From" column (cached per row)
+    s.fitPlace = fitByWordsPx(s.place, L.pxToMax);
+    s.fitPx    = L.pxToMax;
+    String low = s.est; low.toLowerCase();
+    s.estCol = TFT_WHITE;
+    if (low.indexOf("cancel") >= 0 || low.indexOf("delay") >= 0) s.estCol = badCol();
+    else if (low.indexOf("late") >= 0 || low.indexOf(':') >= 0)   s.estCol = warnCol();
+  }
 
-    int by = ROW_TOP + i*_rowH + _rowH/2;
+  g.fillRect(0, rowTop, W, _rowH, bg);
 
-    drawShadowed(ellipsize(s.time,  CH_TIME),  X_STD,  by, TFT_YELLOW, ML_DATUM);
+  int by = rowTop + _rowH/2;
 
-    // [TRAKKR] Word-safe pixel ellipsis for "From" column
-    String fromFit = fitByWordsPx(s.place, pxToMax);
-    drawShadowed(fromFit, X_TO, by, TFT_WHITE, ML_DATUM);
+  drawShadowedOn(g, ellipsize(s.time,  CH_TIME),  X_STD,  by, TFT_YELLOW, ML_DATUM);
+  drawShadowedOn(g, s.fitPlace,                   X_TO,   by, TFT_WHITE,  ML_DATUM);
+  drawShadowedOn(g, ellipsize(s.est, CH_ETD),     X_ETD,  by, s.estCol,   ML_DATUM);
 
-    String low = s.est; low.toLowerCase();
-    uint16_t c = TFT_WHITE;
-    if (low.indexOf("cancel") >= 0 || low.indexOf("delay") >= 0) c = badCol();
-    else if (low.indexOf("late") >= 0 || low.indexOf(':') >= 0)   c = warnCol();
-    drawShadowed(ellipsize(s.est, CH_ETD),     X_ETD,  by, c,       ML_DATUM);
-
-    if (s.bus) {
-      int rowTop = ROW_TOP + i * _rowH;
-      int iconH  = min(16, max(12, _rowH - 6));
-      int yTop   = rowTop + ( _rowH - iconH) / 2;
-      tft.fillRect(X_PLAT - 2, rowTop + 1, 26, _rowH - 2, bg);
-      drawBusIcon(X_PLAT, yTop, iconH, TFT_WHITE, bg);
-    } else {
-      drawShadowed(ellipsize(s.plat, CH_PLAT), X_PLAT, by, TFT_WHITE, ML_DATUM);
-    }
-    drawShadowed(ellipsize(s.oper, CH_OPER),   X_OPER, by, TFT_WHITE, ML_DATUM);
+  if (s.bus) {
+    int iconH  = min(16, max(12, _rowH - 6));
+    int yTop   = rowTop + ( _rowH - iconH) / 2;
+    g.fillRect(X_PLAT - 2, rowTop + 1, 26, _rowH - 2, bg);
+    drawBusIcon(g, X_PLAT, yTop, iconH, TFT_WHITE, bg);
+  } else {
+    drawShadowedOn(g, ellipsize(s.plat, CH_PLAT), X_PLAT, by, TFT_WHITE, ML_DATUM);
   }
+  // [TRAKKR] Operator logo from the icon cache when there is one, else the name
+  Icons::Icon ic;
+  if (s.toc.length() && Icons::get(s.toc.c_str(), bg, ic) && ic.h <= _rowH)
+    g.pushImage(X_OPER, rowTop + (_rowH - ic.h) / 2, ic.w, ic.h, ic.px);
+  else
+    drawShadowedOn(g, ellipsize(s.oper, CH_OPER), X_OPER, by, TFT_WHITE, ML_DATUM);
+}
 
-  if (painted < maxVis) {
-    int y = ROW_TOP + painted*_rowH;
-    int h = (maxVis - painted)*_rowH;
+static void drawRow(const RowLayout& L, int i){
+  paintRow(tft, L, services[L.first + i], i, ROW_TOP + i*L.rowH);
+}
+
+static void drawRowsTail(const RowLayout& L){
+  if (L.painted < L.maxVis) {
+    int y = ROW_TOP + L.painted*L.rowH;
+    int h = (L.maxVis - L.painted)*L.rowH;
     tft.fillRect(0, y, W, h, bodyBg());
   }
+}
 
+static void drawRows() {
+  ScopeTimer T("drawRows");
+  const RowLayout L = rowsLayout();
+  for (int i = 0; i < L.painted; i++) drawRow(L, i);
+  drawRowsTail(L);
   checkHeap("after drawRows");
 }
 
@@ -471,6 +566,24 @@ static bool writeTickerFileIfChanged(){
 static bool openTicker(){ if(tickFile) tickFile.close(); tickFile=FSNS.open(kTickerPath,"r"); if(!tickFile){ Serial.println("[TICK][ERR] open ticker.txt failed"); return false; } tickSize=tickFile.size(); return true; }
 static int  readByteAt(size_t off){ if(!tickFile||!tickSize) return -1; off%=tickSize; tickFile.seek(off); return tickFile.read(); }
 
+// [TRAKKR] Hand the finished ticker frame to the DMA backend (border is in the sprite).
+// Falls back to a blocking TFT_eSPI push when no backend is active.
+static void tickerPresent(int y){
+  DisplayBackend* d = Display::active();
+  if (d && d->capacity() >= (size_t)W * TICKER_H){
+    Pixel::copy16(d->backBuffer(), (const uint16_t*)tickSpr.getPointer(), (size_t)W * TICKER_H);
+    if (d->present(0, y, W, TICKER_H)) return;
+  }
+  tickSpr.pushSprite(0, y);
+}
+
+// Per-frame background: the sprite is 16-bit (panel byte order), so a vector fill.
+static void tickerClear(){
+  uint16_t* p = (uint16_t*)tickSpr.getPointer();
+  if (p) Pixel::fill16(p, Pixel::panel(headBg()), (size_t)W * TICKER_H);
+  else   tickSpr.fillSprite(headBg());
+}
+
 // -------------------- TICKER RENDERER --------------------
 static void drawTicker_FS(){
   const int y        = H - TICKER_H;
@@ -482,15 +595,15 @@ static void drawTicker_FS(){
 
   if (!gTickerHasNRCC){
     if (gTickerStaticDirty){
-      tickSpr.fillSprite(headBg());
+      tickerClear();
       tickSpr.setTextWrap(false);
       tickSpr.setTextDatum(MC_DATUM);
       tickSpr.setTextColor(TFT_BLACK, headBg());  tickSpr.drawString(POWERED_MSG, W/2+1, TICKER_H/2+1);
       tickSpr.setTextColor(TFT_WHITE, headBg());  tickSpr.drawString(POWERED_MSG, W/2,   TICKER_H/2);
+      tickSpr.drawRect(0, 0, W, TICKER_H, headBr());
       gTickerStaticDirty = false;
     }
-    tickSpr.pushSprite(0, y);
-    tft.drawRect(0, y, W, TICKER_H, headBr());
+    tickerPresent(y);
     return;
   }
 
@@ -536,7 +649,7 @@ static void drawTicker_FS(){
     sInit = true;
   }
 
-  tickSpr.fillSprite(headBg());
+  tickerClear();
   tickSpr.setTextDatum(BL_DATUM);
   tickSpr.setTextWrap(false);
 
@@ -576,8 +689,8 @@ static void drawTicker_FS(){
     }
   }
 
-  tickSpr.pushSprite(0, y);
-  tft.drawRect(0, y, W, TICKER_H, headBr());
+  tickSpr.drawRect(0, 0, W, TICKER_H, headBr());
+  tickerPresent(y);
 
   scrollPx += TICKER_SPEED;
   if (scrollPx >= sRenderPx) scrollPx -= sRenderPx;
@@ -626,10 +739,21 @@ static bool nextTagNS(const String& xml, const String& tag, int& pos, String& in
 }
 
 // ===== SOAP POST / FETCH / PARSE =====
-static bool postSoapOnce(String& outBody, int& outCode, const char* method, const char* reqTag){
-  ScopeTimer T("HTTP POST+recv"); 
-  logMem("pre-POST");
-
+// [TRAKKR] Darwin request settings, copied from Cfg by Rail::configure() on the
+// task that writes Cfg. A DarwinFetch takes its own copy at construction, so the
+// net task never reads Cfg while the HTTP task may be rewriting it.
+struct FetchConf {
+  char     token[40];        // as Cfg::Settings::darwin_token
+  char     crs[4];
+  char     filt[4];          // calling-at CRS, "" = none
+  bool     dep;
+  uint8_t  rows;
+  uint32_t tokKey;           // Quota::tokenKey(token)
+};
+
+// [TRAKKR] SOAP 1.2 envelope for one board request (offset/window in minutes from now),
+// built from the fetch's own copy of the settings (see FetchConf).
+static String buildSoap(const FetchConf& c, const char* reqTag, int offset, int window, int rows){
   String soap;
   soap.reserve(1800);
 
@@ -641,20 +765,20 @@ static bool postSoapOnce(String& outBody, int& outCode, const char* method, cons
 
   // [TRAKKR] Header with Darwin token
   soap += "<soap:Header><typ:AccessToken><typ:TokenValue>";
-  soap += Cfg::darwinToken();
+  soap += c.token;
   soap += "</typ:TokenValue></typ:AccessToken></soap:Header>";
 
   // [TRAKKR] Body + request tag
   soap += "<soap:Body><ldb:"; soap += reqTag; soap += ">";
 
   // Core board params
-  soap += "<ldb:numRows>";   soap += String(ROWS);     soap += "</ldb:numRows>";
-  soap += "<ldb:crs>";       soap += Cfg::crs();       soap += "</ldb:crs>";
+  soap += "<ldb:numRows>";   soap += String(rows);     soap += "</ldb:numRows>";
+  soap += "<ldb:crs>";       soap += c.crs;            soap += "</ldb:crs>";
 
   // [TRAKKR] Optional call-at filter from Control Panel
   {
-    const char* filt = Cfg::callingAtCrs();          // e.g. "CLJ", or "" if unset
-    if (filt && *filt){
+    const char* filt = c.filt;                       // e.g. "CLJ", or "" if unset
+    if (*filt){
       // Use 'from' for Arrivals boards, 'to' for Departures boards
       const char* ftype = (strstr(reqTag, "Arr") != nullptr) ? "from" : "to";
       soap += "<ldb:filterCrs>";   soap += filt;   soap += "</ldb:filterCrs>";
@@ -663,178 +787,1161 @@ static bool postSoapOnce(String& outBody, int& outCode, const char* method, cons
   }
 
   // Time window
-  soap += "<ldb:timeOffset>0</ldb:timeOffset>";
-  soap += "<ldb:timeWindow>"; soap += String(TIME_WINDOW_MINS); soap += "</ldb:timeWindow>";
+  soap += "<ldb:timeOffset>"; soap += String(offset); soap += "</ldb:timeOffset>";
+  soap += "<ldb:timeWindow>"; soap += String(window); soap += "</ldb:timeWindow>";
 
   // Close request + envelope
   soap += "</ldb:"; soap += reqTag; soap += ">";
   soap += "</soap:Body></soap:Envelope>";
 
-  // ===== HTTP POST =====
-  WiFiClientSecure client; client.setInsecure(); client.setTimeout(12000);
-  HTTPClient http; http.setReuse(false);
-  String url = String("https://") + DARWIN_HOST + DARWIN_PATH;
-  http.setConnectTimeout(12000);
-  if (!http.begin(client, url)){
-    outCode = -1;
-    Serial.println("[NET] http.begin() failed");
-    checkHeap("http.begin fail");
-    return false;
+  return soap;
+}
+
+static String extractFault(const String& body){
+  String s=get1ns(body,"faultstring"); if(s.length()) return s;
+  String reason=get1ns(body,"Reason"); String text=get1ns(reason,"Text");
+  return text;
+}
+
+// [TRAKKR] Parse one <service> element into a row. Returns false if it has nothing to show.
+static bool parseService(const String& svc, bool dep, Svc& v){
+  v.id   = get1ns(svc, "serviceID");
+  v.time = get1ns(svc, dep ? "std" : "sta");
+  v.est  = get1ns(svc, dep ? "etd" : "eta");
+  if (!v.est.length()) v.est = "On time";
+  v.plat = get1ns(svc, "platform");
+  v.oper = normalizeOper(get1ns(svc, "operator"));
+  v.toc  = get1ns(svc, "operatorCode");
+
+  String endBlk = get1ns(svc, dep ? "destination" : "origin");
+  String first  = get1ns(endBlk, "location");
+  v.place = get1ns(first, "locationName");
+
+  // [TRAKKR] Decode common HTML entities everywhere they might appear
+  htmlDecode(v.place);
+  htmlDecode(v.oper);
+  htmlDecode(v.plat);
+  htmlDecode(v.est);
+
+  String stype   = get1ns(svc, "serviceType");   stype.toLowerCase();
+  String isBus   = get1ns(svc, "isBus");         isBus.toLowerCase();
+  String cat     = get1ns(svc, "category");      cat.toLowerCase();
+  String plat = v.plat;  plat.toLowerCase();  plat.trim();
+  String oper = v.oper;  oper.toLowerCase();  oper.trim();
+
+  bool bus = false;
+  if (stype.indexOf("bus") >= 0)                         bus = true;
+  else if (isBus == "true" || isBus == "1")              bus = true;
+  else if (cat.indexOf("bus") >= 0)                      bus = true;
+  else if (plat == "bus" || plat == "coach")             bus = true;
+  else if (oper.indexOf("replacement") >= 0 ||
+           oper.indexOf("bus") >= 0 ||
+           oper.indexOf("coach") >= 0)                   bus = true;
+
+  v.bus = bus;
+  if (v.bus) v.plat = "";
+
+  return v.time.length() || v.place.length();
+}
+
+// [TRAKKR] Board header: station title + NRCC messages (everything before <trainServices>).
+static void parseBoardHeader(const String& head, std::vector<String>& msgOut, String& titleOut){
+  String loc = get1ns(head, "locationName");
+  htmlDecode(loc);                      // [TRAKKR] fix &amp; etc
+  titleOut = loc;                       // BoardStream::finish() falls back to the CRS
+
+  String ms = get1ns(head, "nrccMessages");
+  if (ms.length()){
+    int pos = 0; String inner;
+    while (nextTagNS(ms, "message", pos, inner)){
+      String txt = get1ns(inner, "text");
+      if (!txt.length()) txt = inner;
+
+      txt.replace("&nbsp;", " "); txt.replace("&amp;", "&");
+      txt.replace("&lt;",  "<");  txt.replace("&gt;",  ">");
+      txt.replace("&quot;","\""); txt.replace("&apos;","'");
+
+      for (;;){
+        int lt = txt.indexOf('<'); if (lt < 0) break;
+        int gt = txt.indexOf('>', lt + 1);
+        if (gt < 0){ txt.remove(lt); break; }
+        txt.remove(lt, gt - lt + 1);
+      }
+
+      for (int i = 0; i + 1 < (int)txt.length(); ){
+        if (txt[i] == ' ' && txt[i+1] == ' ') txt.remove(i, 1);
+        else ++i;
+      }
+      txt.trim();
+
+      txt = keepFirstSentence(txt);
+
+      if (txt.length()) msgOut.push_back(txt);
+    }
+  }
+}
+
+//
+// [TRAKKR] Incremental board parser. Fed the response body in network-sized
+// chunks; only the unparsed tail is buffered, so a 150-row board never has
+// to sit in RAM as one String. Async::Http::body() writes straight into it
+// (chunked framing already stripped).
+//
+class BoardStream : public Stream {
+public:
+  BoardStream(bool dep, int maxRows, const char* crs, std::vector<Svc>& svc, std::vector<String>& msgs, String& title)
+  : dep_(dep), maxRows_(maxRows), crs_(crs), svc_(svc), msgs_(msgs), title_(title) { buf_.reserve(2048); }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* p, size_t n) override {
+    if (done_) return n;                            // keep draining the socket
+    HeapTrace::Scope hs("rail.parse");
+    buf_.concat((const char*)p, n);
+    pump();
+    return n;
   }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+  // Flush whatever is left once the body has ended.
+  void finish(){
+    HeapTrace::Scope hs("rail.parse");
+    if (!done_){
+      if (!inServices_) parseBoardHeader(buf_, msgs_, title_);   // board with no services
+      else pump();
+    }
+    if (!title_.length()) title_ = crs_;
+    stop();
+  }
+  bool   overflowed()   const { return overflow_; }
+  size_t peakBuffered() const { return peak_; }
+
+private:
+  static constexpr size_t BUF_CAP = 24 * 1024;      // largest single element we accept
+
+  void pump(){
+    if (buf_.length() > peak_) peak_ = buf_.length();
+
+    // Header runs up to the first <..Services> list (train, bus or ferry).
+    if (!inServices_){
+      int k = buf_.indexOf("Services>");
+      if (k < 0){ checkCap(); return; }
+      int lt = buf_.lastIndexOf('<', k); if (lt < 0) lt = 0;
+      parseBoardHeader(buf_.substring(0, lt), msgs_, title_);
+      const bool train = buf_.substring(lt, k).endsWith("train");
+      buf_.remove(0, k + 9);                        // past the opening tag
+      inServices_ = true;
+      if (!train){ stop(); return; }                // [TRAKKR-NOTE] only trainServices are shown
+    }
 
-  String action = String(LDB_NS) + method;
-  http.addHeader("Content-Type", String("application/soap+xml; charset=utf-8; action=\"") + action + "\"");
-  http.addHeader("Accept", "text/xml");
-  http.addHeader("Connection", "close");
+    // Stop at </..trainServices>; bus/ferry lists that follow are ignored.
+    bool closed = false;
+    int end = buf_.indexOf("Services>");
+    if (end >= 0){ int lt = buf_.lastIndexOf('<', end); buf_.remove(lt < 0 ? 0 : lt); closed = true; }
 
-  if (DEBUG_NET){
-    Serial.println("\n===== Darwin POST =====");
-    Serial.printf("Method: %s  CRS:%s  Rows:%d\n", method, Cfg::crs(), ROWS);
-    const char* dbgFilt = Cfg::callingAtCrs();
-    if (dbgFilt && *dbgFilt){
-      const char* ftype = (strstr(reqTag, "Arr") != nullptr) ? "from" : "to";
-      Serial.printf("Filter: %s (%s)\n", dbgFilt, ftype);
+    int pos = 0; String inner;
+    while ((int)svc_.size() < maxRows_ && nextTagNS(buf_, "service", pos, inner)){
+      Svc v;
+      if (parseService(inner, dep_, v)) svc_.push_back(v);
     }
+    if (pos > 0) buf_.remove(0, pos);
+    if (closed || (int)svc_.size() >= maxRows_){ stop(); return; }
+    checkCap();
   }
+  void stop(){ done_ = true; buf_ = String(); }
+  void checkCap(){
+    if (buf_.length() > BUF_CAP){
+      Serial.printf("[PARSE][WARN] element larger than %uB; dropping tail\n", (unsigned)BUF_CAP);
+      overflow_ = true;
+      stop();
+    }
+  }
+
+  bool                  dep_;
+  int                   maxRows_;
+  const char*           crs_;                       // title when the board has none
+  std::vector<Svc>&     svc_;
+  std::vector<String>&  msgs_;
+  String&               title_;
+  String                buf_;
+  bool                  inServices_ = false;
+  bool                  done_       = false;
+  bool                  overflow_   = false;
+  size_t                peak_       = 0;
+};
+
+// [TRAKKR] Whole-body convenience wrapper (bench fixture); same path as the live stream.
+static void parseDarwinBoard(const String& body, bool dep, std::vector<Svc>& svcOut,
+                             std::vector<String>& msgOut, String& titleOut){
+  BoardStream bs(dep, Cfg::boardRows(), Cfg::crs(), svcOut, msgOut, titleOut);
+  const size_t CHUNK = 1436;                        // one TCP segment's worth
+  for (size_t off = 0; off < body.length(); off += CHUNK){
+    size_t n = body.length() - off; if (n > CHUNK) n = CHUNK;
+    bs.write((const uint8_t*)body.c_str() + off, n);
+  }
+  bs.finish();
+}
+
+// [TRAKKR] One board as produced by the fetch task and adopted by the loop task.
+struct BoardSnap {
+  std::vector<Svc>    services;
+  std::vector<String> msgs;
+  String              title;
+};
+
+// ===== FETCH COORDINATOR =====
+// [TRAKKR] Generations: gReqGen is the newest board anyone asked for,
+// gInflightGen the one being fetched (0 = idle), gPubGen the newest finished.
+static portMUX_TYPE       gCoordMux    = portMUX_INITIALIZER_UNLOCKED;
+static bool               gCoordUp     = false;
+static volatile uint32_t  gReqGen = 0, gInflightGen = 0, gPubGen = 0;
+
+// Tasks blocked in Rail::waitFor(), each on its own generation; publishFetch()
+// notifies the ones it satisfies. Guarded by gCoordMux.
+static const size_t       MAX_WAITERS  = 4;
+static struct { TaskHandle_t task; uint32_t gen; } gWaiters[MAX_WAITERS] = {};
+
+static SemaphoreHandle_t  gSnapMutex   = nullptr;
+static BoardSnap          gNextSnap;             // last good board, waiting for the loop task
+static bool               gNextFresh   = false;
+static volatile bool      gLastOk      = false;
+static uint32_t           gLastGoodAt  = 0;      // millis() of the last good board
+static uint32_t           gAdoptedGen  = 0;
+static volatile bool      gLookBusy    = false;  // look-ahead timetable refresh on the wire
+
+static FetchConf          gFetchConf   = {};   // see Rail::configure()
+
+static struct {
+  uint32_t requests[Rail::TRIG_COUNT];
+  uint32_t joinedInflight, mergedPending;
+  uint32_t fetches, ok, fail, peer, projected;
+  uint32_t lastMs, lastPubAt;
+} gFetchStats = {};
+
+static const char* const kTrigNames[Rail::TRIG_COUNT] = { "timer", "api", "settings", "resume", "boot", "peer" };
+
+static void startNextFetch();
+
+uint32_t Rail::requestRefresh(Trigger why){
+  uint32_t ticket;
+  portENTER_CRITICAL(&gCoordMux);
+  if (why < TRIG_COUNT) gFetchStats.requests[why]++;
+  if (gReqGen > gPubGen && gReqGen != gInflightGen){
+    ticket = gReqGen; gFetchStats.mergedPending++;          // queued, not started: share it
+  } else if (gInflightGen && why != TRIG_SETTINGS){
+    ticket = gInflightGen; gFetchStats.joinedInflight++;    // on the wire: share its result
+  } else {
+    gReqGen = (gInflightGen ? gInflightGen : gPubGen) + 1;  // needs a fresh request
+    ticket = gReqGen;
+  }
+  portEXIT_CRITICAL(&gCoordMux);
+  if (why == TRIG_API && !Peer::shouldPoll()) Peer::askRefresh();   // follower: the leader fetches
+  startNextFetch();                                  // no-op if one is on the wire or we're a follower
+  return ticket;
+}
 
-  outCode = http.POST((uint8_t*)soap.c_str(), soap.length());
-  outBody = http.getString();
-  http.end();
+// The notification is latched, so a publish between the check and the take
+// isn't lost; a stray one just re-checks. Waits in 1 s slices so the caller
+// (the loop task) still counts as alive for the supervisor.
+bool Rail::waitFor(uint32_t gen, uint32_t timeoutMs){
+  const TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  const uint32_t t0 = millis();
+  int slot = -1;
+  bool done = false;
+  for (;;){
+    portENTER_CRITICAL(&gCoordMux);
+    done = (int32_t)(gPubGen - gen) >= 0;
+    if (!done && slot < 0){
+      for (size_t i = 0; i < MAX_WAITERS; ++i)
+        if (!gWaiters[i].task){ gWaiters[i].task = me; gWaiters[i].gen = gen; slot = (int)i; break; }
+    }
+    if (done && slot >= 0){ if (gWaiters[slot].task == me) gWaiters[slot].task = nullptr; slot = -1; }
+    portEXIT_CRITICAL(&gCoordMux);
+    const uint32_t spent = millis() - t0;
+    if (done || spent >= timeoutMs) break;
+    Supervisor::beat(Supervisor::P_LOOP);
+    const uint32_t left = timeoutMs - spent;
+    if (slot >= 0) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(left < 1000 ? left : 1000));
+    else vTaskDelay(pdMS_TO_TICKS(10));                // every slot taken: poll
+  }
+  if (slot >= 0){                                    // timed out: a publish may have freed it already
+    portENTER_CRITICAL(&gCoordMux);
+    if (gWaiters[slot].task == me) gWaiters[slot].task = nullptr;
+    portEXIT_CRITICAL(&gCoordMux);
+  }
+  return done;
+}
 
-  if (DEBUG_NET) Serial.printf("[NET] HTTP %d  body=%uB\n", outCode, (unsigned)outBody.length());
-  logMem("post-POST"); 
-  checkHeap("post-POST");
-  return outCode == 200;
+uint32_t Rail::publishedGen(){ return gPubGen; }
+bool     Rail::lastFetchOk(){ return gLastOk; }
+
+String Rail::fetchStatsJSON(){
+  // One consistent snapshot: the net task updates these under gCoordMux.
+  uint32_t pub, inflight;
+  bool     lastOk;
+  portENTER_CRITICAL(&gCoordMux);
+  const auto st = gFetchStats;
+  pub = gPubGen; inflight = gInflightGen; lastOk = gLastOk;
+  portEXIT_CRITICAL(&gCoordMux);
+
+  String j; j.reserve(320);
+  j += "{\"published\":"; j += String(pub);
+  j += ",\"inflight\":";  j += inflight ? "true" : "false";
+  j += ",\"lastOk\":";    j += lastOk ? "true" : "false";
+  j += ",\"lastMs\":";    j += String(st.lastMs);
+  j += ",\"ageMs\":";     j += String(st.lastPubAt ? millis() - st.lastPubAt : 0);
+  j += ",\"fetches\":";   j += String(st.fetches);
+  j += ",\"ok\":";        j += String(st.ok);
+  j += ",\"fail\":";      j += String(st.fail);
+  j += ",\"fromPeer\":";  j += String(st.peer);
+  j += ",\"projected\":"; j += String(st.projected);
+  j += ",\"coalesced\":{\"inflight\":"; j += String(st.joinedInflight);
+  j += ",\"pending\":";   j += String(st.mergedPending); j += '}';
+  j += ",\"requests\":{";
+  for (int i = 0; i < Rail::TRIG_COUNT; ++i){
+    if (i) j += ',';
+    j += '"'; j += kTrigNames[i]; j += "\":"; j += String(st.requests[i]);
+  }
+  j += "},\"net\":"; j += Async::statsJSON();
+  j += '}';
+  return j;
 }
 
+// [TRAKKR] Copy the parsed rows out for the MQTT publisher (it diffs them itself).
+static void mqttOffer(const BoardSnap& snap, uint32_t gen){
+  if (!Cfg::mqttHost()[0]) return;
+  std::vector<Mqtt::Row> rows; rows.reserve(snap.services.size());
+  for (const auto& s : snap.services){
+    Mqtt::Row r;
+    r.id = s.id; r.time = s.time; r.dest = s.place; r.est = s.est; r.plat = s.plat; r.oper = s.oper; r.bus = s.bus;
+    rows.push_back(r);
+  }
+  Mqtt::offer(snap.title, gen, rows);
+}
 
+// ===== PEER SNAPSHOTS =====
+// [TRAKKR] Board as sent to peers (see Peer.h): title, services, NRCC messages.
+// Strings are length-prefixed (u8; u16 for messages), counts are u8.
+static void putStr8(std::vector<uint8_t>& o, const String& s){
+  const size_t n = min<size_t>(s.length(), 255);
+  o.push_back((uint8_t)n); o.insert(o.end(), (const uint8_t*)s.c_str(), (const uint8_t*)s.c_str() + n);
+}
+static void encodeBoard(const BoardSnap& b, std::vector<uint8_t>& o){
+  o.clear(); o.reserve(64 + b.services.size() * 72);
+  putStr8(o, b.title);
+  const size_t ns = min<size_t>(b.services.size(), 255);
+  o.push_back((uint8_t)ns);
+  for (size_t i = 0; i < ns; ++i){
+    const Svc& v = b.services[i];
+    putStr8(o, v.id); putStr8(o, v.time); putStr8(o, v.place);
+    putStr8(o, v.est); putStr8(o, v.plat); putStr8(o, v.oper);
+    putStr8(o, v.toc);
+    o.push_back(v.bus ? 1 : 0);
+  }
+  const size_t nm = min<size_t>(b.msgs.size(), 255);
+  o.push_back((uint8_t)nm);
+  for (size_t i = 0; i < nm; ++i){
+    const String& m = b.msgs[i];
+    const size_t n = min<size_t>(m.length(), 0xFFFF);
+    o.push_back((uint8_t)(n >> 8)); o.push_back((uint8_t)n);
+    o.insert(o.end(), (const uint8_t*)m.c_str(), (const uint8_t*)m.c_str() + n);
+  }
+}
 
+struct SnapReader {
+  const uint8_t* p; const uint8_t* e; bool ok = true;
+  SnapReader(const uint8_t* d, size_t n) : p(d), e(d + n) {}
+  uint8_t u8(){ if (p >= e){ ok = false; return 0; } return *p++; }
+  void str(String& s, size_t n){
+    if ((size_t)(e - p) < n){ ok = false; return; }
+    s = String(); s.concat((const char*)p, n); p += n;
+  }
+  void str8(String& s){ str(s, u8()); }
+  void str16(String& s){ size_t n = (size_t)u8() << 8; n |= u8(); str(s, n); }
+};
+static bool decodeBoard(const uint8_t* d, size_t n, BoardSnap& b){
+  SnapReader r(d, n);
+  r.str8(b.title);
+  const size_t ns = r.u8();
+  b.services.resize(ns);
+  for (size_t i = 0; i < ns && r.ok; ++i){
+    Svc& v = b.services[i];
+    r.str8(v.id); r.str8(v.time); r.str8(v.place);
+    r.str8(v.est); r.str8(v.plat); r.str8(v.oper);
+    r.str8(v.toc);
+    v.bus = r.u8() != 0;
+  }
+  const size_t nm = r.u8();
+  b.msgs.resize(nm);
+  for (size_t i = 0; i < nm && r.ok; ++i) r.str16(b.msgs[i]);
+  return r.ok && r.p == r.e;
+}
 
+// [TRAKKR] Every good board (ours or a peer's) feeds the on-device history
+static void historyOffer(const BoardSnap& snap){
+  std::vector<History::Row> rows; rows.reserve(snap.services.size());
+  for (const auto& s : snap.services){
+    History::Row r;
+    r.id = s.id; r.time = s.time; r.dest = s.place; r.est = s.est; r.plat = s.plat;
+    rows.push_back(r);
+  }
+  History::record(rows, Cfg::mode()[0] == 'a');
+}
 
+// [TRAKKR] Failed fetches publish a generation but never replace the last good board.
+// FROM_PEER: the board came from the peer leader rather than our own Darwin request.
+// FROM_TIMETABLE: projected from the look-ahead timetable while offline; it
+// replaces the board but is not a result (ok stays false, nothing is shared).
+enum Origin : uint8_t { FROM_DARWIN = 0, FROM_PEER, FROM_TIMETABLE };
+
+static void publishFetch(uint32_t gen, bool ok, BoardSnap& snap, uint32_t t0, Origin from = FROM_DARWIN){
+  if (from == FROM_DARWIN) Quota::noteResult(ok);
+  if (ok) mqttOffer(snap, gen);
+  if (ok) historyOffer(snap);
+  if (ok && from == FROM_DARWIN && Cfg::peerShare()){
+    std::vector<uint8_t> blob; encodeBoard(snap, blob);
+    Peer::share(blob.data(), blob.size());
+  }
 
-static String extractFault(const String& body){
-  String s=get1ns(body,"faultstring"); if(s.length()) return s;
-  String reason=get1ns(body,"Reason"); String text=get1ns(reason,"Text");
-  return text;
+  xSemaphoreTake(gSnapMutex, portMAX_DELAY);
+  if (ok || from == FROM_TIMETABLE){ std::swap(gNextSnap, snap); gNextFresh = true; }
+  xSemaphoreGive(gSnapMutex);
+
+  portENTER_CRITICAL(&gCoordMux);
+  if (from == FROM_PEER) gFetchStats.peer++;
+  else if (from == FROM_TIMETABLE) gFetchStats.projected++;
+  else { gFetchStats.fetches++; if (ok) gFetchStats.ok++; else gFetchStats.fail++; }
+  if (from != FROM_TIMETABLE){
+    gFetchStats.lastMs    = millis() - t0;
+    gFetchStats.lastPubAt = millis();
+  }
+  if (ok) gLastGoodAt = millis();
+  gLastOk      = ok;
+  gPubGen      = gen;
+  gInflightGen = 0;
+  TaskHandle_t wake[MAX_WAITERS]; size_t nWake = 0;
+  for (auto& w : gWaiters)
+    if (w.task && (int32_t)(gen - w.gen) >= 0){ wake[nWake++] = w.task; w.task = nullptr; }
+  portEXIT_CRITICAL(&gCoordMux);
+  for (size_t i = 0; i < nWake; ++i) xTaskNotifyGive(wake[i]);
+  logMem(ok ? "post-fetch OK" : "post-fetch ERR");
+
+  startNextFetch();                                  // anything asked for while we were on the wire
 }
 
-static bool fetchDarwinBoard(){
-  bool okToRun = beginFetchGuard(800);
-  if (!okToRun) return false;
-  FetchScope guard(okToRun);
+// [TRAKKR] SOAP faults are small; keep the first few KB for the log.
+class FaultSink : public Print {
+public:
+  String s;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* p, size_t n) override {
+    if (s.length() < 4096) s.concat((const char*)p, n);
+    return n;
+  }
+};
 
-  ScopeTimer T("fetch+parse");
-  services.clear();
-  nrccMsgs.clear();
+static void lookaheadDone(int part, int offset, int window, bool ok, const BoardSnap& snap);
 
-  const bool dep = (Cfg::mode()[0] != 'a');
-  const char* method = dep ? "GetDepartureBoard"        : "GetArrivalBoard";
-  const char* reqTag = dep ? "GetDepartureBoardRequest" : "GetArrivalBoardRequest";
+//
+// [TRAKKR] One Darwin board fetch as an Async task: the only place Darwin is called from.
+// Runs on the shared "net" task; the response is parsed as it arrives (see BoardStream).
+// part >= 0: one wide look-ahead request for the timetable (offset minutes from
+// now, full window and row limit); its result goes to lookaheadDone(), not the board.
+//
+class DarwinFetch : public Async::Task {
+public:
+  explicit DarwinFetch(uint32_t gen, int part = -1, int offset = 0)
+  : Async::Task(part < 0 ? "darwin" : "darwin.look"), gen_(gen), conf_(fetchConf()),
+    part_(part), offset_(part < 0 ? 0 : offset), window_(TIME_WINDOW_MINS),
+    rows_(part < 0 ? conf_.rows : Cfg::MAX_BOARD_ROWS),
+    sink_(conf_.dep, rows_, conf_.crs, snap_.services, snap_.msgs, snap_.title) {}
+
+  bool step() override {
+    HeapTrace::Scope hs("rail.fetch");
+    ASYNC_BEGIN();
+    t0_ = millis(); t0Us_ = micros();
+    logMem("pre-POST");
+
+    // WiFi: reconnecting is the supervisor's job (see Supervisor.h); give it
+    // the same 15 s budget as ensureWiFi(), without parking the CPU.
+    if (WiFi.status() != WL_CONNECTED){
+      while (WiFi.status() != WL_CONNECTED && millis() - t0_ < 15000) ASYNC_SLEEP(200);
+      if (WiFi.status() != WL_CONNECTED) return done(false, "wifi");
+    }
 
-  String body; int code = 0;
-  {
-    ScopeTimer Tpost("SOAP roundtrip");
-    if (!postSoapOnce(body, code, method, reqTag)){
-      String fault = extractFault(body);
+    conn_.setDeadline(12000);
+    ASYNC_AWAIT(conn_, conn_.connect(DARWIN_HOST, 443));
+    if (io_ != Async::IO_DONE) return done(false, conn_.error());
+
+    {
+      const char* method = conf_.dep ? "GetDepartureBoard"        : "GetArrivalBoard";
+      const char* reqTag = conf_.dep ? "GetDepartureBoardRequest" : "GetArrivalBoardRequest";
+      soap_ = buildSoap(conf_, reqTag, offset_, window_, rows_);
+      head_.reserve(320);
+      head_ += "POST "; head_ += DARWIN_PATH; head_ += " HTTP/1.1\r\n";
+      head_ += "Host: "; head_ += DARWIN_HOST; head_ += "\r\n";
+      head_ += "Content-Type: application/soap+xml; charset=utf-8; action=\""; head_ += LDB_NS; head_ += method; head_ += "\"\r\n";
+      head_ += "Accept: text/xml\r\n";
+      head_ += "Content-Length: "; head_ += String((unsigned)soap_.length()); head_ += "\r\n";
+      head_ += "Connection: close\r\n\r\n";
       if (DEBUG_NET){
-        Serial.printf("[SOAP] FAIL code=%d fault=\"%s\"\n", code, fault.c_str());
+        Serial.println("\n===== Darwin POST =====");
+        Serial.printf("Method: %s  CRS:%s  Rows:%d  Offset:%d\n", method, conf_.crs, rows_, offset_);
+        if (*conf_.filt) Serial.printf("Filter: %s (%s)\n", conf_.filt, conf_.dep ? "to" : "from");
       }
-      return false;
     }
-  }
 
-  {
-    ScopeTimer Tparse("parse XML");
-
-    String loc = get1ns(body, "locationName");
-    htmlDecode(loc);                      // [TRAKKR] fix &amp; etc
-    stationTitle = loc.length() ? loc : String(Cfg::crs());
-
-    String ts = get1ns(body, "trainServices");
-    if (ts.length()){
-      int pos = 0; String svc;
-      while ((int)services.size() < ROWS && nextTagNS(ts, "service", pos, svc)){
-        Svc v;
-
-        v.time = get1ns(svc, dep ? "std" : "sta");
-        v.est  = get1ns(svc, dep ? "etd" : "eta");
-        if (!v.est.length()) v.est = "On time";
-        v.plat = get1ns(svc, "platform");
-        v.oper = normalizeOper(get1ns(svc, "operator"));
-
-        String endBlk = get1ns(svc, dep ? "destination" : "origin");
-        String first  = get1ns(endBlk, "location");
-        v.place = get1ns(first, "locationName");
-
-        // [TRAKKR] Decode common HTML entities everywhere they might appear
-        htmlDecode(v.place);
-        htmlDecode(v.oper);
-        htmlDecode(v.plat);
-        htmlDecode(v.est);
-
-        String stype   = get1ns(svc, "serviceType");   stype.toLowerCase();
-        String isBus   = get1ns(svc, "isBus");         isBus.toLowerCase();
-        String cat     = get1ns(svc, "category");      cat.toLowerCase();
-        String plat = v.plat;  plat.toLowerCase();  plat.trim();
-        String oper = v.oper;  oper.toLowerCase();  oper.trim();
-
-        bool bus = false;
-        if (stype.indexOf("bus") >= 0)                         bus = true;
-        else if (isBus == "true" || isBus == "1")              bus = true;
-        else if (cat.indexOf("bus") >= 0)                      bus = true;
-        else if (plat == "bus" || plat == "coach")             bus = true;
-        else if (oper.indexOf("replacement") >= 0 ||
-                 oper.indexOf("bus") >= 0 ||
-                 oper.indexOf("coach") >= 0)                   bus = true;
-
-        v.bus = bus;
-        if (v.bus) v.plat = "";
-
-        if (v.time.length() || v.place.length()) services.push_back(v);
+    Quota::noteRequest(conf_.tokKey);
+    ASYNC_AWAIT(conn_, http_.request(conn_, head_, soap_));
+    if (io_ != Async::IO_DONE) return done(false, conn_.error());
+    soap_ = String(); head_ = String();
+
+    if (http_.status() != 200){
+      ASYNC_AWAIT(conn_, http_.body(conn_, fault_));
+      if (DEBUG_NET){
+        String fault = extractFault(fault_.s);
+        Serial.printf("[SOAP] FAIL code=%d fault=\"%s\"\n", http_.status(), fault.c_str());
       }
+      return done(false, "http");
+    }
+
+    ASYNC_AWAIT(conn_, http_.body(conn_, sink_));
+    if (io_ != Async::IO_DONE) return done(false, "body");
+    sink_.finish();
+
+    if (DEBUG_NET){
+      Serial.printf("[NET] HTTP %d  body=%uB  tls=%ums (%s%s)\n", http_.status(),
+        (unsigned)http_.bodyBytes(), (unsigned)conn_.handshakeMs(),
+        Tls::modeName(Tls::mode()), conn_.resumed() ? ", resumed" : "");
+      Serial.printf("[PARSE] %s  services=%u  nrcc=%u  peakBuf=%uB\n",
+        snap_.title.c_str(),
+        (unsigned)snap_.services.size(),
+        (unsigned)snap_.msgs.size(),
+        (unsigned)sink_.peakBuffered());
+    }
+    return done(true, "");
+    ASYNC_END();
+  }
+
+private:
+  static FetchConf fetchConf(){
+    portENTER_CRITICAL(&gCoordMux);
+    const FetchConf c = gFetchConf;
+    portEXIT_CRITICAL(&gCoordMux);
+    return c;
+  }
+
+  bool done(bool ok, const char* why){
+    conn_.close();
+    if (!ok) Serial.printf("[NET] fetch failed: %s\n", why);
+    Trace::spanSince("fetch+parse", t0Us_, 0);
+    checkHeap("post-POST");
+    if (part_ >= 0) lookaheadDone(part_, offset_, window_, ok, snap_);
+    else publishFetch(gen_, ok, snap_, t0_);
+    return true;
+  }
+
+  // Declaration order matters: sink_ binds to conf_, snap_ and rows_.
+  uint32_t      gen_;
+  FetchConf     conf_;
+  int           part_, offset_, window_, rows_;
+  BoardSnap     snap_;
+  BoardStream   sink_;
+  Async::Conn   conn_;
+  Async::Http   http_;
+  FaultSink     fault_;
+  String        head_, soap_;
+  uint32_t      t0_ = 0, t0Us_ = 0;
+};
+
+// [TRAKKR] Net task: a complete snapshot from the peer leader. Publishes it
+// as our next generation, so anyone waiting on a refresh is answered by it.
+static void onPeerBoard(const uint8_t* data, size_t len){
+  BoardSnap snap;
+  if (!decodeBoard(data, len, snap)){ Serial.println("[PEER] bad snapshot"); return; }
+  uint32_t gen;
+  portENTER_CRITICAL(&gCoordMux);
+  if (gInflightGen){ portEXIT_CRITICAL(&gCoordMux); return; }   // our own fetch will publish
+  gen = (gReqGen > gPubGen) ? gReqGen : gPubGen + 1;
+  gReqGen = gInflightGen = gen;
+  portEXIT_CRITICAL(&gCoordMux);
+  publishFetch(gen, true, snap, millis(), FROM_PEER);
+}
+
+// [TRAKKR] Start the oldest outstanding generation unless one is already on the
+// wire (ours or a look-ahead), or a peer leader is fetching for us.
+static void startNextFetch(){
+  if (!Peer::shouldPoll()) return;
+  uint32_t gen;
+  portENTER_CRITICAL(&gCoordMux);
+  if (!gCoordUp || gInflightGen || gLookBusy || gReqGen <= gPubGen){ portEXIT_CRITICAL(&gCoordMux); return; }
+  gen = gInflightGen = gReqGen;
+  portEXIT_CRITICAL(&gCoordMux);
+  if (!Async::spawn(new DarwinFetch(gen))){
+    BoardSnap none;
+    publishFetch(gen, false, none, millis());        // never leave a waiter hanging
+  }
+}
+
+// ===== LOOK-AHEAD TIMETABLE =====
+// [TRAKKR] Which board a timetable belongs to: every setting that changes its rows.
+static String boardKey(){
+  String k(Cfg::mode()); k += ':'; k += Cfg::crs(); k += ':'; k += Cfg::callingAtCrs();
+  return k;
+}
+
+// [TRAKKR] Loop task: refresh the timetable while Darwin answers (see Timetable.h).
+// Starts only with the coordinator idle, and board fetches queue behind it,
+// so there is still one Darwin request on the wire at a time.
+static void lookaheadMaybeStart(){
+  if (gLookBusy || !gLastOk || !Peer::shouldPoll()) return;
+  const String key = boardKey();
+  if (!Timetable::due(key.c_str())) return;
+  portENTER_CRITICAL(&gCoordMux);
+  const bool idle = gCoordUp && !gInflightGen && gReqGen <= gPubGen;
+  if (idle) gLookBusy = true;
+  portEXIT_CRITICAL(&gCoordMux);
+  if (!idle) return;
+  Timetable::start(key.c_str());
+  if (!Async::spawn(new DarwinFetch(0, 0, 0))) lookaheadDone(0, 0, 0, false, BoardSnap());
+}
+
+// [TRAKKR] Net task: one look-ahead part landed. Ask for the next one, or commit.
+static void lookaheadDone(int part, int offset, int window, bool ok, const BoardSnap& snap){
+  int next = -1;
+  if (ok){
+    std::vector<Timetable::Row> rows; rows.reserve(snap.services.size());
+    for (const auto& s : snap.services){
+      Timetable::Row r;
+      r.time = s.time; r.dest = s.place; r.est = s.est; r.plat = s.plat; r.oper = s.oper; r.toc = s.toc; r.bus = s.bus;
+      rows.push_back(r);
+    }
+    next = Timetable::addPart(snap.title, rows, offset, window, snap.services.size() >= Cfg::MAX_BOARD_ROWS);
+  }
+  if (next >= 0 && part + 1 < LOOK_PARTS && Async::spawn(new DarwinFetch(0, part + 1, next))) return;
+  Timetable::commit();
+  portENTER_CRITICAL(&gCoordMux);
+  gLookBusy = false;
+  portEXIT_CRITICAL(&gCoordMux);
+  startNextFetch();                                  // board requests that queued behind it
+}
+
+// [TRAKKR] Loop task: Darwin has been failing for a while, so rebuild the board
+// from the timetable, once a minute so departed trains drop off. Returns the
+// generation published (0 = none). It isn't a fetch result: the poll timer
+// and its error backoff carry on untouched.
+static uint32_t projectOffline(){
+  static int32_t lastMin = -1;
+  if (gLastOk || !gCoordUp || !timeValid() || millis() - gLastGoodAt < PROJECT_AFTER_MS){ lastMin = -1; return 0; }
+  if (gInflightGen || gLookBusy || gReqGen > gPubGen) return 0;   // a fetch is about to answer
+  const int32_t m = (int32_t)(time(nullptr) / 60);
+  if (m == lastMin) return 0;
+  lastMin = m;
+
+  std::vector<Timetable::Row> rows;
+  BoardSnap snap;
+  if (!Timetable::project(boardKey().c_str(), Cfg::boardRows(), rows, snap.title)) return 0;
+  snap.services.reserve(rows.size());
+  for (const auto& r : rows){
+    Svc v;
+    v.time = r.time; v.place = r.dest; v.est = r.est; v.plat = r.plat; v.oper = r.oper; v.toc = r.toc; v.bus = r.bus;
+    snap.services.push_back(v);
+  }
+  snap.msgs.push_back(OFFLINE_MSG);
+
+  uint32_t gen;
+  portENTER_CRITICAL(&gCoordMux);
+  if (gInflightGen || gLookBusy || gReqGen > gPubGen){ portEXIT_CRITICAL(&gCoordMux); lastMin = -1; return 0; }
+  gen = gReqGen = gInflightGen = gPubGen + 1;
+  portEXIT_CRITICAL(&gCoordMux);
+  publishFetch(gen, false, snap, millis(), FROM_TIMETABLE);
+  return gen;
+}
+
+void Rail::configure(){
+  FetchConf c = {};
+  strncpy(c.token, Cfg::darwinToken(),  sizeof(c.token) - 1);
+  strncpy(c.crs,   Cfg::crs(),          sizeof(c.crs)   - 1);
+  strncpy(c.filt,  Cfg::callingAtCrs(), sizeof(c.filt)  - 1);
+  c.dep    = Cfg::mode()[0] != 'a';
+  c.rows   = Cfg::boardRows();
+  c.tokKey = Quota::tokenKey(c.token);
+  portENTER_CRITICAL(&gCoordMux);
+  gFetchConf = c;
+  portEXIT_CRITICAL(&gCoordMux);
+}
+
+static void fetchCoordinatorBegin(){
+  if (gCoordUp) return;
+  Rail::configure();
+  gSnapMutex = xSemaphoreCreateMutex();
+  Timetable::begin();
+  Async::begin();
+  portENTER_CRITICAL(&gCoordMux);
+  gCoordUp = true;
+  portEXIT_CRITICAL(&gCoordMux);
+  startNextFetch();                                  // pick up requests made before we were up
+}
+
+// [TRAKKR] Display task (or setup): take a newly published board (if any) and make it current.
+// Returns true when a new generation was seen; `ok` says whether it carried data.
+// prevOut (optional) receives the board being replaced, for the transition
+// diff, and is left alone when the generation brought no board (a failed
+// fetch); freshOut says which it was.
+static bool adoptSnapshot(bool& ok, std::vector<Svc>* prevOut = nullptr, bool* freshOut = nullptr){
+  const uint32_t pub = gPubGen;
+  if (pub == gAdoptedGen) return false;
+  gAdoptedGen = pub;
+  ok = gLastOk;
+
+  bool fresh = false;
+  xSemaphoreTake(gSnapMutex, portMAX_DELAY);
+  if (gNextFresh){
+    services.swap(gNextSnap.services);
+    if (prevOut) prevOut->swap(gNextSnap.services);
+    nrccMsgs.swap(gNextSnap.msgs);
+    stationTitle = gNextSnap.title;
+    gNextSnap = BoardSnap();
+    gNextFresh = false;
+    fresh = true;
+  }
+  xSemaphoreGive(gSnapMutex);
+  if (freshOut) *freshOut = fresh;
+
+  if (fresh){
+    tickerSetHasNRCC(!nrccMsgs.empty());
+    tickerRefreshFilesAndOpen();
+  }
+  return true;
+}
+
+// [TRAKKR] Screensaver window from Cfg ("HH:MM".."HH:MM", may wrap midnight)
+static bool inQuietHours(){
+  int a, b;
+  if (!timeValid() || !Cfg::screensaverWindow(a, b)) return false;
+  time_t t = time(nullptr); struct tm tm{}; localtime_r(&t, &tm);
+  const int m = tm.tm_hour * 60 + tm.tm_min;
+  return (a < b) ? (m >= a && m < b) : (m >= a || m < b);
+}
+
+// ===== DISPLAY TASK =====
+// [TRAKKR-NOTE] After setup only this task touches tft, tickSpr and the board
+// (services / nrccMsgs / stationTitle / gPage). Everyone else posts commands.
+// The loop task (which also runs the HTTP handlers) is the only producer, so
+// the queue is a plain SPSC ring. Commands coalesce into a pending mask and
+// run highest-priority first; ticker frames are due on a fixed cadence and
+// preempt everything, including a board repaint between two rows. A board
+// transition (RowAnim) runs in budgeted steps that end before the next
+// ticker frame is due.
+enum DispCmd : uint8_t {   // lower value = higher priority
+  DISP_PAUSE = 0,          // park and hand the panel to the caller (bench)
+  DISP_ADOPT,              // swap in the newest board, then repaint it
+  DISP_PAGE,               // next page of a long board
+  DISP_CLOCK,
+  DISP_TITLE,
+  DISP_COLHDR,
+  DISP_ROWS,               // bulk repaint, one row per step
+  DISP_ANIM,               // board transition, one budgeted step at a time
+  DISP_SHED,               // heap low: drop the transition and marquee buffers
+  DISP_COUNT
+};
+static const uint32_t TICKER_FRAME_MS = 33;   // ~30 fps
+static const uint32_t MARQUEE_BUDGET_US = 4000;  // per ticker frame, all marquees together
+
+static SpscRing<uint8_t, 16>  gDispQ;
+static std::atomic<uint32_t>  gDispOverflow{0};  // commands that didn't fit in gDispQ
+static uint32_t               gDispPending = 0;  // display task only
+static TaskHandle_t           gDispTask    = nullptr;
+static SemaphoreHandle_t      gDispParked  = nullptr;
+static SemaphoreHandle_t      gDispResume  = nullptr;
+static RowLayout              gRowL;
+static int                    gRowNext     = -1;  // next row of an in-progress repaint
+static bool                   gRowsShown   = false; // panel shows services / gPage as laid out
+static uint32_t               gTickerDue   = 0;     // next ticker frame (millis)
+
+// Destinations cut short by fitByWordsPx() scroll in their cell while the
+// page is up; any repaint of the rows drops the marquees first.
+static void setRowsShown(bool shown){
+  gRowsShown = shown;
+  Marquee::clear();
+  if (!shown) return;
+  const RowLayout L = rowsLayout();
+  for (int i = 0; i < L.painted; i++){
+    const Svc& s = services[L.first + i];
+    if (s.fitPx != L.pxToMax || s.fitPlace == s.place) continue;
+    Marquee::add(X_TO, ROW_TOP + i*L.rowH, L.pxToMax, L.rowH, s.place, &NationalRailTiny,
+                 TFT_WHITE, (i % 2 == 0) ? bodyBg() : rowAlt());
+  }
+}
+
+// ----- Board transitions: diff the board being replaced against the new one
+static std::vector<Svc> gAnimPrev;       // old board, until its rows are painted off-screen
+static TFT_eSprite      gAnimSpr(&tft);  // scratch row for RowAnim bitmaps
+static bool             gAnimFailed = false;
+
+static uint32_t svcKey(const Svc& s){
+  if (s.id.length()) return fnv1a32((const uint8_t*)s.id.c_str(), s.id.length());
+  uint32_t h = fnv1a32((const uint8_t*)s.time.c_str(), s.time.length());
+  return fnv1a32((const uint8_t*)s.place.c_str(), s.place.length(), h ^ 0x7c);
+}
+static bool animSame(int i, int j, void*){
+  const Svc& a = gAnimPrev[i]; const Svc& b = services[j];
+  return a.time == b.time && a.place == b.place && a.est == b.est &&
+         a.plat == b.plat && a.oper == b.oper && a.bus == b.bus;
+}
+static bool animRender(uint16_t* dst, bool old, int idx, int slot, void*){
+  if (!gAnimSpr.created()){
+    HeapTrace::Scope hs("sprites");
+    gAnimSpr.setColorDepth(16);
+    if (!gAnimSpr.createSprite(W, gRowL.rowH)){ gAnimFailed = true; return false; }
+  }
+  paintRow(gAnimSpr, gRowL, old ? gAnimPrev[idx] : services[idx], slot, 0);
+  Pixel::copy16(dst, (const uint16_t*)gAnimSpr.getPointer(), (size_t)W * gRowL.rowH);
+  return true;
+}
+static void rowsAnimEnd(){
+  std::vector<Svc>().swap(gAnimPrev);
+  if (gAnimSpr.created()) gAnimSpr.deleteSprite();
+}
+
+// After an adopt: animate from the old page to the new one, or fall back to
+// the row-by-row repaint (animations off, panel not showing the old page,
+// no memory).
+static void rowsAnimBegin(int oldFirst){
+  const RowLayout L = rowsLayout();
+  if (!Cfg::animMs() || !gRowsShown){ rowsAnimEnd(); gDispPending |= 1u << DISP_ROWS; return; }
+
+  std::vector<uint32_t> oldKeys, newKeys;
+  oldKeys.reserve(gAnimPrev.size()); newKeys.reserve(services.size());
+  for (const Svc& v : gAnimPrev) oldKeys.push_back(svcKey(v));
+  for (const Svc& v : services)  newKeys.push_back(svcKey(v));
+
+  RowAnim::Geometry g = { 0, ROW_TOP, W, L.rowH, L.maxVis,
+                          { Pixel::panel(bodyBg()), Pixel::panel(rowAlt()) }, Pixel::panel(bodyBg()) };
+  RowAnim::Source src = { oldKeys.data(), (int)oldKeys.size(), oldFirst,
+                          newKeys.data(), (int)newKeys.size(), L.first,
+                          animSame, animRender, nullptr };
+  gRowL = L; gAnimFailed = false;
+  switch (RowAnim::begin(g, src, Cfg::animMs())){
+    case RowAnim::PLAYING: setRowsShown(false); gDispPending |= 1u << DISP_ANIM; break;
+    case RowAnim::NOTHING: rowsAnimEnd(); break;
+    default:               rowsAnimEnd(); gDispPending |= 1u << DISP_ROWS; break;
+  }
+}
+
+// Budget for one transition step: whatever is left before the next ticker frame.
+static uint32_t animBudgetUs(){
+  const int32_t left = (int32_t)(gTickerDue - millis()) - 2;
+  return (uint32_t)constrain(left, 2, 12) * 1000u;
+}
+
+static void dispPost(DispCmd c){
+  if (!gDispQ.push((uint8_t)c)) gDispOverflow.fetch_or(1u << c);
+  if (gDispTask) xTaskNotifyGive(gDispTask);
+}
+
+// From any other task (supervisor, soak): gDispQ has one producer, the loop.
+// dispDrain() merges both into the same pending bits, so nothing is lost.
+static void dispPostAny(DispCmd c){
+  gDispOverflow.fetch_or(1u << c);
+  if (gDispTask) xTaskNotifyGive(gDispTask);
+}
+
+static void dispDrain(){
+  uint8_t c;
+  uint32_t in = gDispOverflow.exchange(0);
+  while (gDispQ.pop(c)) in |= 1u << c;
+  if (in & ((1u << DISP_ADOPT) | (1u << DISP_PAGE) | (1u << DISP_ROWS))){
+    gRowNext = -1;                                      // restart repaint
+    if (RowAnim::active()){                             // a newer board / page wins
+      RowAnim::abort(); rowsAnimEnd();
+      gDispPending &= ~(1u << DISP_ANIM);
+      setRowsShown(false);
     }
+  }
+  gDispPending |= in;
+}
 
-    String ms = get1ns(body, "nrccMessages");
-    if (ms.length()){
-      int pos = 0; String inner;
-      while (nextTagNS(ms, "message", pos, inner)){
-        String txt = get1ns(inner, "text");
-        if (!txt.length()) txt = inner;
-
-        txt.replace("&nbsp;", " "); txt.replace("&amp;", "&");
-        txt.replace("&lt;",  "<");  txt.replace("&gt;",  ">");
-        txt.replace("&quot;","\""); txt.replace("&apos;","'");
-
-        for (;;){
-          int lt = txt.indexOf('<'); if (lt < 0) break;
-          int gt = txt.indexOf('>', lt + 1);
-          if (gt < 0){ txt.remove(lt); break; }
-          txt.remove(lt, gt - lt + 1);
-        }
-
-        for (int i = 0; i + 1 < (int)txt.length(); ){
-          if (txt[i] == ' ' && txt[i+1] == ' ') txt.remove(i, 1);
-          else ++i;
-        }
-        txt.trim();
-
-        txt = keepFirstSentence(txt);
-
-        if (txt.length()) nrccMsgs.push_back(txt);
+static void dispRun(DispCmd c){
+  Display::yieldBus();
+  switch (c){
+    case DISP_PAUSE:
+      Supervisor::hold(Supervisor::P_DISPLAY, true);   // parked for bench/soak, not stalled
+      xSemaphoreGive(gDispParked);
+      xSemaphoreTake(gDispResume, portMAX_DELAY);
+      Supervisor::hold(Supervisor::P_DISPLAY, false);
+      gTickerStaticDirty = true;
+      setRowsShown(false);                 // the borrower may have drawn over the board
+      break;
+    case DISP_ADOPT: {
+      Trace::Span sp("disp.adopt");
+      bool ok, fresh;
+      const int oldFirst = gPage * gRowsPerPage;
+      if (adoptSnapshot(ok, &gAnimPrev, &fresh)){
+        gDispPending |= (1u << DISP_TITLE) | (1u << DISP_COLHDR);
+        if (fresh) rowsAnimBegin(oldFirst);
+        else if (!gRowsShown) gDispPending |= 1u << DISP_ROWS;   // same rows; only redraw if hidden
       }
+      break;
     }
+    case DISP_PAGE:
+      if (pageCount() > 1){
+        gPage = (gPage + 1) % pageCount();
+        gDispPending |= (1u << DISP_COLHDR) | (1u << DISP_ROWS);
+      }
+      break;
+    case DISP_CLOCK:  { Trace::Span sp("disp.clock");  drawClockIfChanged(); break; }
+    case DISP_TITLE:  { Trace::Span sp("disp.title");  setTitle(stationTitle); break; }
+    case DISP_COLHDR: { Trace::Span sp("disp.colhdr"); drawColHeader(); break; }
+    case DISP_ROWS: {
+      Trace::Span sp("disp.row");
+      if (gRowNext < 0){ gRowL = rowsLayout(); gRowNext = 0; setRowsShown(false); }
+      if (gRowNext < gRowL.painted){ drawRow(gRowL, gRowNext++); return; }   // stay pending
+      drawRowsTail(gRowL);
+      gRowNext = -1;
+      setRowsShown(true);
+      break;
+    }
+    case DISP_ANIM: {
+      if (RowAnim::step(animBudgetUs())) return;       // more of this frame: stay pending
+      if (RowAnim::active()) break;                     // next frame re-armed at RowAnim::dueMs()
+      rowsAnimEnd();
+      if (gAnimFailed) gDispPending |= 1u << DISP_ROWS;
+      else             setRowsShown(true);
+      break;
+    }
+    case DISP_SHED:
+      // Cut-short destinations stop scrolling until the next repaint.
+      if (RowAnim::active()){
+        RowAnim::abort();
+        gDispPending = (gDispPending & ~(1u << DISP_ANIM)) | (1u << DISP_ROWS);
+      }
+      rowsAnimEnd();
+      Marquee::clear();
+      break;
+    default: break;
+  }
+  gDispPending &= ~(1u << c);
+}
+
+static void displayTask(void*){
+  HeapTrace::Scope hs("display");
+  uint32_t nextFrame = millis();
+  gTickerDue = nextFrame;
+  for(;;){
+    dispDrain();
+    const uint32_t now = millis();
+    if ((int32_t)(now - nextFrame) >= 0){
+      { Trace::Span sp("ticker.frame"); drawTicker_FS(); }
+      Supervisor::beat(Supervisor::P_DISPLAY);
+      if (gRowsShown){ Trace::Span sp("marquee.frame"); Marquee::frame(MARQUEE_BUDGET_US); }
+      nextFrame += TICKER_FRAME_MS;
+      if ((int32_t)(millis() - nextFrame) > 0) nextFrame = millis() + TICKER_FRAME_MS;   // fell behind: drop frames
+      gTickerDue = nextFrame;
+      continue;
+    }
+    uint32_t wake = nextFrame;
+    if (RowAnim::active() && !(gDispPending & (1u << DISP_ANIM))){
+      const uint32_t due = RowAnim::dueMs();
+      if ((int32_t)(now - due) >= 0) gDispPending |= 1u << DISP_ANIM;
+      else if ((int32_t)(due - wake) < 0) wake = due;
+    }
+    if (gDispPending){
+      dispRun((DispCmd)__builtin_ctz(gDispPending));
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wake - now));
   }
+}
+
+static void displayTaskBegin(){
+  gDispParked = xSemaphoreCreateBinary();
+  gDispResume = xSemaphoreCreateBinary();
+  xTaskCreatePinnedToCore(displayTask, "display", 8192, nullptr, 2, &gDispTask, 1);
+}
 
+// ===== SUPERVISOR HOOKS (see Supervisor.h) =====
+// Each runs on the supervisor task and restarts one part; the board data
+// (services, nrccMsgs, stationTitle) is left alone, so the last good board
+// stays on screen. The display has none: a task with no ticker frames is
+// blocked in a bus or DMA wait that has no timeout, so it can't be stopped
+// cleanly and the supervisor reboots.
+
+// Heap: the largest block stays low. Give back what the display can live
+// without; if that isn't enough the supervisor reboots (fragmentation
+// doesn't heal by itself).
+static bool heapShed(){
+  dispPostAny(DISP_SHED);
+  return true;
+}
+
+static void supervisorHooks(){
+  Supervisor::setRestart(Supervisor::P_HEAP, heapShed);
+}
+
+// Park the display task and borrow the panel from the calling task (HTTP loop
+// or soak task, hence dispPostAny()). Every display step is short (one row,
+// one frame), so this returns within ~1 frame.
+static bool dispPause(){
+  if (!gDispTask) return true;                      // still in setup: nothing else draws
+  dispPostAny(DISP_PAUSE);
+  return xSemaphoreTake(gDispParked, portMAX_DELAY) == pdTRUE;
+}
+static void dispResume(){
+  if (gDispTask) xSemaphoreGive(gDispResume);
+}
+
+// ===== BENCH CASES (/api/bench) =====
+// [TRAKKR-NOTE] Display cases park the display task and draw from the HTTP
+// loop, so the ticker freezes for the duration of a run.
+static const char* kBenchText = "07:42 London Waterloo via Hounslow  3  South Western";
+static String      gBenchXml;
+
+static bool benchTftBegin(void*){ return tickSpr.created() && dispPause(); }
+static void benchTftEnd(void*){ Display::yieldBus(); dispResume(); }
+static bool benchDmaBegin(void* p){ return Display::active() && benchTftBegin(p); }
+
+static void benchGlyph(void* font){
+  tickSpr.setFreeFont((const GFXfont*)font);
+  tickSpr.setTextDatum(TL_DATUM);
+  tickSpr.setTextColor(TFT_WHITE, headBg());
+  tickSpr.drawString(kBenchText, PAD, 0);
+}
+static void benchFillRect(void*){ tft.fillRect(0, H - TICKER_H, W, TICKER_H, headBg()); }
+static void benchPushSprite(void*){ tickSpr.pushSprite(0, H - TICKER_H); }
+static void benchPresent(void*){ tickerPresent(H - TICKER_H); Display::yieldBus(); }
+static void benchTickerFrame(void*){ drawTicker_FS(); Display::yieldBus(); }
+
+static bool benchXmlBegin(void*){ gBenchXml = BENCH_DARWIN_XML; return gBenchXml.length() > 0; }
+static void benchXmlEnd(void*){ gBenchXml = String(); }
+static void benchParseXml(void*){
+  std::vector<Svc> svc; std::vector<String> msgs; String title;
+  parseDarwinBoard(gBenchXml, true, svc, msgs, title);
+}
+
+static void registerBenchCases(){
+  const uint32_t tickBytes = (uint32_t)W * TICKER_H * 2;
+  Bench::add({ "glyph.tiny",     &benchGlyph, (void*)&NationalRailTiny,    50, 0, &benchTftBegin, &benchTftEnd });
+  Bench::add({ "glyph.small",    &benchGlyph, (void*)&NationalRailSmall,   50, 0, &benchTftBegin, &benchTftEnd });
+  Bench::add({ "glyph.regular",  &benchGlyph, (void*)&NationalRailRegular, 50, 0, &benchTftBegin, &benchTftEnd });
+  Bench::add({ "glyph.large",    &benchGlyph, (void*)&NationalRailLarge,   50, 0, &benchTftBegin, &benchTftEnd });
+  Bench::add({ "bus.fillRect",   &benchFillRect,    nullptr, 50, tickBytes, &benchTftBegin, &benchTftEnd });
+  Bench::add({ "bus.pushSprite", &benchPushSprite,  nullptr, 50, tickBytes, &benchTftBegin, &benchTftEnd });
+  Bench::add({ "bus.present",    &benchPresent,     nullptr, 50, tickBytes, &benchDmaBegin, &benchTftEnd });
+  Bench::add({ "ticker.frame",   &benchTickerFrame, nullptr, 60, 0,         &benchTftBegin, &benchTftEnd });
+  Bench::add({ "parse.xml",      &benchParseXml,    nullptr, 20, (uint32_t)strlen_P(BENCH_DARWIN_XML), &benchXmlBegin, &benchXmlEnd });
+}
+
+// ===== SOAK STEPS (/api/soak) =====
+// [TRAKKR-NOTE] A soak owns the panel and the board for its whole run: the
+// first step to start parks the display task and sets the live board aside,
+// the last one to finish puts it back and repaints. Boards are the bench
+// fixture, re-cut every poll (row count, etd, destination length, serviceID,
+// now and then the NRCC text) and parsed in random-sized chunks like a real
+// response, then round-tripped through the peer encoding.
+static int       gSoakUsers = 0;
+static BoardSnap gSoakSaved;
+static String    gSoakHead, gSoakTail;
+static std::vector<String> gSoakSvcs;
+
+static bool soakBoardBegin(void*){
+  if (gSoakUsers++) return true;
+  if (!dispPause()){ gSoakUsers = 0; return false; }
+  services.swap(gSoakSaved.services); nrccMsgs.swap(gSoakSaved.msgs); gSoakSaved.title = stationTitle;
+  const String xml = BENCH_DARWIN_XML;
+  const int a = xml.indexOf("<lt5:service>"), b = xml.indexOf("</lt5:trainServices>");
+  gSoakHead = xml.substring(0, a); gSoakTail = xml.substring(b);
+  gSoakSvcs.clear();
+  for (int p = a; p >= 0 && p < b;){
+    int e = xml.indexOf("</lt5:service>", p); if (e < 0) break;
+    e += 14; gSoakSvcs.push_back(xml.substring(p, e)); p = e;
+  }
+  return true;
+}
+static void soakBoardEnd(void*){
+  if (--gSoakUsers) return;
+  services.swap(gSoakSaved.services); nrccMsgs.swap(gSoakSaved.msgs); stationTitle = gSoakSaved.title;
+  gSoakSaved = BoardSnap();
+  gSoakHead = String(); gSoakTail = String(); gSoakSvcs.clear(); gSoakSvcs.shrink_to_fit();
+  gPage = 0;
   tickerSetHasNRCC(!nrccMsgs.empty());
   tickerRefreshFilesAndOpen();
+  dispResume();
+  dispPostAny(DISP_TITLE); dispPostAny(DISP_COLHDR); dispPostAny(DISP_ROWS);   // soak task
+}
 
-  if (DEBUG_NET){
-    Serial.printf("[PARSE] %s  services=%u  nrcc=%u\n",
-      stationTitle.c_str(),
-      (unsigned)services.size(),
-      (unsigned)nrccMsgs.size());
+static String soakWords(uint32_t len){
+  static const char* const kSyl[] = { "Ash", "ford", "ton", "bury", " ", "Wick", "ham", "&amp; ", "Cross", "ley", " via " };
+  String o; o.reserve(len + 8);
+  while (o.length() < len) o += kSyl[Soak::rand() % (sizeof(kSyl) / sizeof(kSyl[0]))];
+  return o;
+}
+// Replace the text between the nth `open` and the following `close`.
+static void soakSetInner(String& s, const char* open, const char* close, const String& with, int nth = 0){
+  int a = -1;
+  for (int i = 0; i <= nth; ++i){ a = s.indexOf(open, a + 1); if (a < 0) return; }
+  a += strlen(open);
+  const int b = s.indexOf(close, a); if (b < 0) return;
+  s = s.substring(0, a) + with + s.substring(b);
+}
+
+static void soakPoll(void*){
+  String xml; xml.reserve(gSoakHead.length() + gSoakTail.length() + 900 * (Cfg::boardRows() + 2));
+  xml = gSoakHead;
+  if (Soak::rand() % 20 == 0) soakSetInner(xml, "<lt:message>", "</lt:message>", soakWords(Soak::rand() % 600));
+  const uint32_t n = Soak::rand() % (Cfg::boardRows() + 3);
+  static const char* const kEtd[] = { "On time", "Delayed", "Cancelled", "07:49", "08:13" };
+  for (uint32_t i = 0; i < n && !gSoakSvcs.empty(); ++i){
+    String v = gSoakSvcs[Soak::rand() % gSoakSvcs.size()];
+    soakSetInner(v, "<lt4:etd>", "</lt4:etd>", kEtd[Soak::rand() % 5]);
+    soakSetInner(v, "<lt4:serviceID>", "</lt4:serviceID>", String(Soak::rand(), HEX));
+    soakSetInner(v, "<lt4:locationName>", "</lt4:locationName>", soakWords(3 + Soak::rand() % 60), 1);
+    xml += v;
   }
-  return true;
+  xml += gSoakTail;
+
+  BoardSnap snap;
+  {
+    BoardStream bs(true, Cfg::boardRows(), Cfg::crs(), snap.services, snap.msgs, snap.title);
+    for (size_t off = 0; off < xml.length();){
+      size_t c = 1 + Soak::rand() % 1436; if (c > xml.length() - off) c = xml.length() - off;
+      bs.write((const uint8_t*)xml.c_str() + off, c);
+      off += c;
+    }
+    bs.finish();
+  }
+  xml = String();
+  std::vector<uint8_t> wire; encodeBoard(snap, wire);
+  BoardSnap peer; decodeBoard(wire.data(), wire.size(), peer);
+
+  services.swap(peer.services); nrccMsgs.swap(peer.msgs); stationTitle = peer.title;
+  gPage = 0;
+  tickerSetHasNRCC(!nrccMsgs.empty());
+  tickerRefreshFilesAndOpen();
+}
+static void soakPaint(void*){
+  setTitle(stationTitle);
+  drawColHeader();
+  const RowLayout L = rowsLayout();
+  for (int i = 0; i < L.painted; i++) drawRow(L, i);
+  drawRowsTail(L);
+  Display::yieldBus();
+}
+static void soakPage(void* p){
+  if (pageCount() < 2) return;
+  gPage = (gPage + 1) % pageCount();
+  soakPaint(p);
+}
+static void soakTicker(void*){ drawTicker_FS(); Display::yieldBus(); }
+static void soakClock(void*){ drawClockIfChanged(); }
+
+static void registerSoakSteps(){
+  Soak::add({ "rail.poll",   &soakPoll,   nullptr, 60, &soakBoardBegin, &soakBoardEnd });
+  Soak::add({ "rail.paint",  &soakPaint,  nullptr, 60, &soakBoardBegin, &soakBoardEnd });
+  Soak::add({ "rail.page",   &soakPage,   nullptr, 20, &soakBoardBegin, &soakBoardEnd });
+  Soak::add({ "rail.ticker", &soakTicker, nullptr, 1,  &soakBoardBegin, &soakBoardEnd });
+  Soak::add({ "rail.clock",  &soakClock,  nullptr, 60, &soakBoardBegin, &soakBoardEnd });
 }
 
 // ===== APP SETUP / LOOP =====
@@ -862,11 +1969,11 @@ static void app_setup_impl(){
   Serial.println("[TRAKKR] Ensuring Wi-Fi…");
   ensureWiFi();
 
-  Serial.println("[TRAKKR] Ensuring time…");
-  ensureTime();
+  TimeSvc::startSntp();   // no-op if main.cpp already started it
   // (Do NOT draw the clock yet; header isn’t on screen.)
 
-  { size_t before=ESP.getFreeHeap();
+  { HeapTrace::Scope hs("sprites");
+    size_t before=ESP.getFreeHeap();
     tickSpr.setColorDepth(16);
     bool ok = tickSpr.createSprite(W, TICKER_H);
     size_t after=ESP.getFreeHeap();
@@ -875,30 +1982,52 @@ static void app_setup_impl(){
     checkHeap("after sprite alloc");
   }
 
+#if TRAKKR_LCD_DMA
+  { DisplayBackend* d = Display::i80((size_t)W * TICKER_H);
+    if (d && d->begin()) Display::setActive(d);
+    else Serial.println("[LCD] DMA backend unavailable; ticker uses TFT_eSPI pushes");
+    checkHeap("after LCD DMA init");
+  }
+#endif
+
+  registerBenchCases();
+  registerSoakSteps();
+
   // Fetch Darwin data while "Loading Board" is visible
-  bool okFetch = (WiFi.status()==WL_CONNECTED) ? fetchDarwinBoard() : false;
+  Quota::begin();
+  History::begin();              // after the FS mount: aggregates are rebuilt from /hist
+  Tls::begin();
+  fetchCoordinatorBegin();
+  Mqtt::begin();
+  Peer::begin(onPeerBoard);
+  bool okFetch = false;
+  Rail::waitFor(Rail::requestRefresh(Rail::TRIG_BOOT), 30000);
+  adoptSnapshot(okFetch);
+  gSeenGen = Rail::publishedGen();
   if (!tickFile) openTicker();
 
   // ===== Now build the header & paint the full board =====
-  if (!gTftMutex) gTftMutex = xSemaphoreCreateMutex();
-  if (xSemaphoreTake(gTftMutex, pdMS_TO_TICKS(200))){
+  // (display task isn't running yet, so setup draws directly)
+  {
     ScopeTimer Tpaint("first paint");
 
     bootInit();                    // draws header band
     headerInit();                  // compute clock geometry
     setTitle(stationTitle);        // title text
     drawClockIfChanged();          // safe now header exists
-    scheduleNextMinute();
+    scheduleNextClockTick();
 
     tft.fillRect(0, HEADER_H, W, H-HEADER_H, bodyBg());
     drawColHeader();
     drawRows();
-    xSemaphoreGive(gTftMutex);
+    setRowsShown(true);
   }
 
-  xTaskCreatePinnedToCore(tickerTask, "ticker", 4096, nullptr, 1, nullptr, 1);
-  nextPoll     = millis() + (okFetch ? POLL_MS_OK : POLL_MS_ERR);
+  displayTaskBegin();
+  supervisorHooks();
+  nextPoll     = millis() + Quota::nextPollMs(okFetch);
   nextPerfBeat = millis() + PERF_PERIOD_MS;
+  nextPageFlip = millis() + (uint32_t)Cfg::pageSecs() * 1000u;
 
   logMem("after first paint");
   Serial.println("[BOOT] setup complete.");
@@ -908,26 +2037,50 @@ static void app_loop_impl(){
   uint32_t now = millis();
   if (PERF_VERBOSE && now >= nextPerfBeat){ logMem("heartbeat"); checkHeap("heartbeat"); nextPerfBeat = now + PERF_PERIOD_MS; }
 
-  if (now >= nextPoll){
-    ScopeTimer Tp("poll+repaint");
-    ensureWiFi();
-    bool ok = (WiFi.status()==WL_CONNECTED) ? fetchDarwinBoard() : false;
-    if (xSemaphoreTake(gTftMutex, portMAX_DELAY) == pdTRUE){
-      setTitle(stationTitle);
-      drawColHeader();
-      drawRows();
-      xSemaphoreGive(gTftMutex);
-    }
-    nextPoll = now + (ok ? POLL_MS_OK : POLL_MS_ERR);
-    logMem(ok ? "post-poll OK" : "post-poll ERR");
+  // [TRAKKR] Fresh board as soon as the screensaver window ends
+  static bool wasQuiet = false;
+  const bool quiet = inQuietHours();
+
+  // [TRAKKR] Timer is just another trigger; the fetch task does the network work.
+  // With a budget set, no timer polls inside the screensaver window: that time
+  // is left out of the plan. Unmetered boards keep polling.
+  const bool idle = quiet && Quota::metered();
+  if ((int32_t)(now - nextPoll) >= 0){
+    if (!idle) Rail::requestRefresh(Rail::TRIG_TIMER);
+    nextPoll = now + Quota::nextPollMs(true);    // re-armed properly when the result lands
   }
 
-  if (now >= nextClockTick){
-    if (xSemaphoreTake(gTftMutex, pdMS_TO_TICKS(50)) == pdTRUE){
-      drawClockIfChanged();
-      xSemaphoreGive(gTftMutex);
-    }
-    scheduleNextMinute();
+  if (wasQuiet && !quiet) Rail::requestRefresh(Rail::TRIG_RESUME);
+  wasQuiet = quiet;
+
+  // [TRAKKR] New result published: re-arm the timer; the display task adopts it
+  const uint32_t gen = Rail::publishedGen();
+  if (gen != gSeenGen){
+    gSeenGen = gen;
+    nextPoll = millis() + Quota::nextPollMs(Rail::lastFetchOk());
+    dispPost(DISP_ADOPT);
+  }
+  Peer::setSchedule(nextPoll, idle, Quota::metered());   // the leader advertises it
+
+  // [TRAKKR] Look-ahead timetable: refreshed while online (same rules as timer
+  // polls), projected onto the board while Darwin keeps failing
+  if (!idle) lookaheadMaybeStart();
+  const uint32_t projGen = projectOffline();
+  if (projGen){ gSeenGen = projGen; dispPost(DISP_ADOPT); }
+
+  // [TRAKKR] Auto-advance pages on long boards
+  if (Cfg::pageSecs() && (int32_t)(now - nextPageFlip) >= 0){
+    nextPageFlip = now + (uint32_t)Cfg::pageSecs() * 1000u;
+    dispPost(DISP_PAGE);
+  }
+
+  // (a clock style change from the web UI shouldn't wait for the next minute).
+  // gClockStyle belongs to the display task; compare with what was last posted.
+  static uint8_t postedStyle = Cfg::clockStyle();
+  if (now >= nextClockTick || Cfg::clockStyle() != postedStyle){
+    postedStyle = Cfg::clockStyle();
+    dispPost(DISP_CLOCK);
+    scheduleNextClockTick();
   }
 
   delay(3);